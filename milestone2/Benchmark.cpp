@@ -0,0 +1,178 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "GestureDetector.h"
+#include <algorithm>
+#include <crtdbg.h>
+
+extern GestureDetector* gestureDetectors[NUI_SKELETON_COUNT];
+extern BOOL showOverlays;
+extern BOOL headlessMode;
+
+/*** Allocation counting ***/
+
+static long numAllocations = 0;
+
+#ifdef _DEBUG
+static int __cdecl CountingAllocHook(int allocType, void* /*userData*/, size_t /*size*/, int /*blockType*/,
+									 long /*requestNumber*/, const unsigned char* /*filename*/, int /*lineNumber*/)
+{
+	if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+	{
+		numAllocations++;
+	}
+	return TRUE;
+}
+#endif
+
+long BenchmarkAllocations()
+{
+#ifdef _DEBUG
+	return numAllocations;
+#else
+	return -1;
+#endif
+}
+
+/*** BenchmarkTimer ***/
+
+BenchmarkTimer::BenchmarkTimer(int maxSamples)
+{
+	this->maxSamples = maxSamples;
+	samples = new LONGLONG[maxSamples];
+	LARGE_INTEGER li;
+	QueryPerformanceFrequency(&li);
+	frequency = li.QuadPart;
+	reset();
+}
+
+BenchmarkTimer::~BenchmarkTimer(void)
+{
+	delete [] samples;
+}
+
+void BenchmarkTimer::reset()
+{
+	numSamples = 0;
+	startTicks = 0;
+	startAllocations = BenchmarkAllocations();
+}
+
+void BenchmarkTimer::start()
+{
+	LARGE_INTEGER li;
+	QueryPerformanceCounter(&li);
+	startTicks = li.QuadPart;
+}
+
+void BenchmarkTimer::stop()
+{
+	LARGE_INTEGER li;
+	QueryPerformanceCounter(&li);
+	if (numSamples < maxSamples)
+	{
+		samples[numSamples++] = li.QuadPart - startTicks;
+	}
+}
+
+void BenchmarkTimer::report(FILE* results, const char* name)
+{
+	long allocations = BenchmarkAllocations() - startAllocations;
+	if (numSamples == 0)
+	{
+		fprintf(results, "%-24s no samples\n", name);
+		return;
+	}
+
+	LONGLONG total = 0;
+	for (int i = 0; i < numSamples; i++)
+	{
+		total += samples[i];
+	}
+	std::sort(samples, samples + numSamples);
+
+	double ticksToNs = 1000000000.0 / (double) frequency;
+	double mean = (double) total * ticksToNs / numSamples;
+	double p50 = samples[numSamples / 2] * ticksToNs;
+	double p99 = samples[(numSamples * 99) / 100] * ticksToNs;
+
+	fprintf(results, "%-24s %8d frames  mean %9.1f ns  p50 %9.1f ns  p99 %9.1f ns  ",
+		name, numSamples, mean, p50, p99);
+	if (allocations >= 0)
+	{
+		fprintf(results, "allocs/frame %.3f\n", (double) allocations / numSamples);
+	}
+	else
+	{
+		fprintf(results, "allocs/frame n/a (release build)\n");
+	}
+}
+
+void BenchmarkTimer::reportThroughput(FILE* results, const char* name, DWORD pixelsPerSample)
+{
+	if (numSamples == 0)
+	{
+		fprintf(results, "%-24s no samples\n", name);
+		return;
+	}
+
+	LONGLONG total = 0;
+	for (int i = 0; i < numSamples; i++)
+	{
+		total += samples[i];
+	}
+	std::sort(samples, samples + numSamples);
+
+	double seconds = (double) total / (double) frequency;
+	double megapixels = (double) pixelsPerSample * numSamples / 1000000.0;
+	double p50 = samples[numSamples / 2] * 1000000.0 / (double) frequency;
+	fprintf(results, "%-24s %8d frames  %9.1f MPix/s  p50 %9.1f us/frame\n",
+		name, numSamples, megapixels / seconds, p50);
+}
+
+int RunBenchmarks(const char* resultsPath)
+{
+	// No windows, no cursor, no clicks
+	headlessMode = TRUE;
+	showOverlays = FALSE;
+
+	FILE* results = NULL;
+	if (fopen_s(&results, resultsPath, "w") != 0)
+	{
+		MessageBoxA(NULL, resultsPath, "Couldn't write benchmark results", MB_OK | MB_ICONERROR);
+		return 1;
+	}
+
+#ifdef _DEBUG
+	_CRT_ALLOC_HOOK oldHook = _CrtSetAllocHook(CountingAllocHook);
+#endif
+
+	for (int ii = 0; ii < NUI_SKELETON_COUNT; ii++)
+	{
+		gestureDetectors[ii] = new GestureDetector(ii);
+	}
+
+	checksFailed = 0;
+	BenchmarkTimer timer(benchmarkFrames);
+	BenchmarkGestures(results, timer);
+	BenchmarkSkeletons(results, timer);
+	BenchmarkDynamicGestures(results, timer);
+	BenchmarkOverlays(results, timer);
+	BenchmarkMagnifier(results, timer);
+	BenchmarkMotion(results, timer);
+	BenchmarkDepth(results);
+	BenchmarkGuiGuard(results, timer);
+
+	for (int ii = 0; ii < NUI_SKELETON_COUNT; ii++)
+	{
+		delete gestureDetectors[ii];
+		gestureDetectors[ii] = NULL;
+	}
+
+#ifdef _DEBUG
+	_CrtSetAllocHook(oldHook);
+#endif
+
+	fprintf(results, "\n%d checks failed\n", checksFailed);
+	fclose(results);
+	return (checksFailed == 0) ? 0 : 1;
+}
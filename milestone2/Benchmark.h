@@ -0,0 +1,64 @@
+/************************************************************************
+*                                                                       *
+*   Benchmark.h -- Headless benchmarks for the gesture pipeline         *
+*                                                                       *
+*   Drives the gesture detectors, gesture states and movement handler   *
+*   with synthetic skeletons and times them, without a sensor or any    *
+*   windows.  Run with "-benchmark".  Each subsystem's checks and       *
+*   timings are in its own *Benchmark.cpp, next to the code they test.  *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include <stdio.h>
+#include "NuiApi.h"
+
+// Frames run through each scenario
+const int benchmarkFrames = 20000;
+// Depth frames run through each colorizer (the sensor sends 320x240)
+const int benchmarkDepthFrames = 2000;
+const DWORD benchmarkDepthWidth = 320;
+const DWORD benchmarkDepthHeight = 240;
+
+// Timing for one scenario.  samples holds one QueryPerformanceCounter
+// delta per frame.
+class BenchmarkTimer
+{
+public:
+	BenchmarkTimer(int maxSamples);
+	~BenchmarkTimer(void);
+
+	void start();
+	void stop();
+	void reset();
+	// Writes ns/frame (mean, p50, p99) and heap allocations per frame
+	void report(FILE* results, const char* name);
+	// Writes megapixels per second, for kernels that do pixelsPerSample each
+	void reportThroughput(FILE* results, const char* name, DWORD pixelsPerSample);
+
+	LONGLONG* samples;
+	int numSamples;
+	int maxSamples;
+	LONGLONG frequency;
+	LONGLONG startTicks;
+	long startAllocations;
+};
+
+// Heap allocations made so far (only counted in debug builds, -1 otherwise)
+long BenchmarkAllocations();
+
+// Each subsystem's checks and timings, written to results.  RunBenchmarks()
+// runs them in this order, with the gesture detectors set up.
+void BenchmarkGestures(FILE* results, BenchmarkTimer &timer);
+void BenchmarkSkeletons(FILE* results, BenchmarkTimer &timer);
+void BenchmarkDynamicGestures(FILE* results, BenchmarkTimer &timer);
+void BenchmarkOverlays(FILE* results, BenchmarkTimer &timer);
+void BenchmarkMagnifier(FILE* results, BenchmarkTimer &timer);
+void BenchmarkMotion(FILE* results, BenchmarkTimer &timer);
+void BenchmarkDepth(FILE* results);
+void BenchmarkGuiGuard(FILE* results, BenchmarkTimer &timer);
+
+// Entry point for "-benchmark".  Returns 1 if any check failed, so the
+// exit code says whether the run was good.
+int RunBenchmarks(const char* resultsPath);
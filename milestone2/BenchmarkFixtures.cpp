@@ -0,0 +1,58 @@
+#include "BenchmarkFixtures.h"
+
+/*** Checks ***/
+
+int checksFailed = 0;
+
+const char* CheckResult(BOOL passed)
+{
+	checksFailed += passed ? 0 : 1;
+	return passed ? "pass" : "FAILED";
+}
+
+/*** Synthetic skeletons ***/
+
+void MakeSkeleton(NUI_SKELETON_DATA &skeleton, FLOAT xOffset, const HandPose &pose)
+{
+	ZeroMemory(&skeleton, sizeof(skeleton));
+	skeleton.eTrackingState = NUI_SKELETON_TRACKED;
+	for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+	{
+		skeleton.eSkeletonPositionTrackingState[j] = NUI_SKELETON_POSITION_TRACKED;
+		skeleton.SkeletonPositions[j].x = xOffset;
+		skeleton.SkeletonPositions[j].y = 0;
+		skeleton.SkeletonPositions[j].z = bodyZ;
+		skeleton.SkeletonPositions[j].w = 1;
+	}
+	skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HEAD].y = headY;
+	skeleton.SkeletonPositions[NUI_SKELETON_POSITION_SHOULDER_CENTER].y = 0.45f;
+	skeleton.SkeletonPositions[NUI_SKELETON_POSITION_SPINE].y = spineY;
+
+	Vector4 &rightHand = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT];
+	rightHand.x = xOffset + pose.rightX;
+	rightHand.y = pose.rightY;
+	rightHand.z = pose.rightZ;
+	Vector4 &leftHand = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HAND_LEFT];
+	leftHand.x = xOffset + pose.leftX;
+	leftHand.y = pose.leftY;
+	leftHand.z = pose.leftZ;
+	skeleton.Position = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HIP_CENTER];
+}
+
+void MakeFrame(NUI_SKELETON_FRAME &SkeletonFrame, const HandPose &pose, DWORD frameNumber)
+{
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	SkeletonFrame.dwFrameNumber = frameNumber;
+	// 30 frames a second, in milliseconds
+	SkeletonFrame.liTimeStamp.QuadPart = (frameNumber * 1000) / 30;
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		MakeSkeleton(SkeletonFrame.SkeletonData[i], (FLOAT) i, (i == 0) ? pose : restPose);
+	}
+}
+
+int RasterNoise(DWORD &noise, int range)
+{
+	noise = noise * 1103515245 + 12345;
+	return (int) ((noise >> 16) % range);
+}
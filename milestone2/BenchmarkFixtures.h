@@ -0,0 +1,59 @@
+/************************************************************************
+*                                                                       *
+*   BenchmarkFixtures.h -- What the benchmark files share               *
+*                                                                       *
+*   The count of failed checks, the synthetic skeletons most of the     *
+*   benchmarks feed through the pipeline, and the gesture switch the    *
+*   rule table is held to.  Each subsystem's checks and timings are in  *
+*   its own *Benchmark.cpp.                                             *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "GestureDetector.h"
+
+/*** Checks ***/
+
+// Checks that failed this run; RunBenchmarks() returns whether it's 0
+extern int checksFailed;
+
+// What a check writes after its name, counting it if it failed
+const char* CheckResult(BOOL passed);
+
+/*** Synthetic skeletons ***/
+
+// Where the user's hands are, in skeleton space.  The body is always the
+// same standing pose, about two meters from the sensor.
+struct HandPose
+{
+	FLOAT rightX, rightY, rightZ;
+	FLOAT leftX, leftY, leftZ;
+	// How many frames to hold the pose for
+	int frames;
+};
+
+const FLOAT bodyZ = 2.0f;
+const FLOAT headY = 0.6f;
+const FLOAT spineY = 0.1f;
+
+// Hands hanging by the sides, nowhere near any gesture
+#define HANDS_AT_REST 0.25f, -0.2f, bodyZ, -0.25f, -0.2f, bodyZ
+
+// Sensor noise on every joint, uniform, in meters
+const FLOAT jointNoise = 0.005f;
+
+// Fill in a standing skeleton at xOffset, with its hands posed
+void MakeSkeleton(NUI_SKELETON_DATA &skeleton, FLOAT xOffset, const HandPose &pose);
+// Skeleton 0 does the gesture; everyone else stands around a meter apart
+// with their hands down, so all six detectors run every frame.
+void MakeFrame(NUI_SKELETON_FRAME &SkeletonFrame, const HandPose &pose, DWORD frameNumber);
+// Pseudo-random numbers in [0, range), the same every run
+int RasterNoise(DWORD &noise, int range);
+
+/*** The switch ***/
+
+// detect(), but with the state machine the way it was before the rule
+// table (GestureSwitchBenchmark.cpp)
+void DetectWithSwitch(GestureDetector &detector, const NUI_SKELETON_FRAME &SkeletonFrame, const JointHistory &history);
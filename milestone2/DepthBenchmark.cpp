@@ -0,0 +1,185 @@
+#include "Benchmark.h"
+#include "DepthColorizer.h"
+#include "DepthPalette.h"
+#include "WorkerPool.h"
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern DepthPalette depthPalette;
+
+/*** Depth colorizing ***/
+
+// Something that looks a bit like a depth frame: a ramp of depths, with
+// a couple of players standing in it and a bit of noise
+static void MakeDepthFrame(USHORT* depth, DWORD width, DWORD height)
+{
+	DWORD noise = 12345;
+	for (DWORD y = 0; y < height; y++)
+	{
+		for (DWORD x = 0; x < width; x++)
+		{
+			noise = noise * 1103515245 + 12345;
+			USHORT millimeters = (USHORT) (800 + (y * 3200) / height + ((noise >> 16) & 31));
+			USHORT player = 0;
+			if (x > width / 4 && x < width / 3)
+			{
+				player = 1;
+			}
+			else if (x > width / 2 && x < (width * 2) / 3)
+			{
+				player = 2;
+			}
+			depth[y * width + x] = (USHORT) ((millimeters << 3) | player);
+		}
+	}
+}
+
+static void RunColorizer(FILE* results, const char* name, void (*colorize)(const USHORT*, RGBQUAD*, DWORD),
+						 const USHORT* depth, RGBQUAD* out, DWORD numPixels, BenchmarkTimer &timer)
+{
+	timer.reset();
+	for (int frame = 0; frame < benchmarkDepthFrames; frame++)
+	{
+		timer.start();
+		colorize(depth, out, numPixels);
+		timer.stop();
+	}
+	timer.reportThroughput(results, name, numPixels);
+}
+
+// What Nui_GotDepthAlert used to do, a call per pixel
+static void ColorizeDepthPerPixel(const USHORT* depth, RGBQUAD* out, DWORD numPixels)
+{
+	for (DWORD i = 0; i < numPixels; i++)
+	{
+		out[i] = DepthPixelToQuad(depth[i]);
+	}
+}
+
+static void RunDepthBenchmark(FILE* results)
+{
+	// First make sure the fast version gives exactly the same pixels, for
+	// every possible input value
+	const DWORD numValues = 65536;
+	USHORT* allValues = new USHORT[numValues];
+	RGBQUAD* expected = new RGBQUAD[numValues];
+	RGBQUAD* actual = new RGBQUAD[numValues];
+	for (DWORD i = 0; i < numValues; i++)
+	{
+		allValues[i] = (USHORT) i;
+	}
+	ColorizeDepthPerPixel(allValues, expected, numValues);
+	ColorizeDepthSSE2(allValues, actual, numValues);
+	DWORD mismatches = 0;
+	for (DWORD i = 0; i < numValues; i++)
+	{
+		if (*(DWORD*) &expected[i] != *(DWORD*) &actual[i])
+		{
+			mismatches++;
+		}
+	}
+	fprintf(results, "SSE2 colorizer bit-exact: %s (%lu of %lu values differ)\n",
+		(mismatches == 0) ? "yes" : "NO", mismatches, numValues);
+	delete [] allValues;
+	delete [] expected;
+	delete [] actual;
+
+	DWORD numPixels = benchmarkDepthWidth * benchmarkDepthHeight;
+	USHORT* depth = new USHORT[numPixels];
+	RGBQUAD* out = new RGBQUAD[numPixels];
+	MakeDepthFrame(depth, benchmarkDepthWidth, benchmarkDepthHeight);
+
+	BenchmarkTimer timer(benchmarkDepthFrames);
+	RunColorizer(results, "per-pixel", ColorizeDepthPerPixel, depth, out, numPixels, timer);
+	RunColorizer(results, "scalar", ColorizeDepthScalar, depth, out, numPixels, timer);
+	RunColorizer(results, "SSE2", ColorizeDepthSSE2, depth, out, numPixels, timer);
+
+	// Lookup tables, one run per colormap.  Building them isn't timed.
+	for (int map = 0; map < NUM_DEPTH_COLORMAPS; map++)
+	{
+		const RGBQUAD* palette = depthPalette.table((DepthColormap) map);
+		if (palette == NULL)
+		{
+			continue;
+		}
+		char name[64];
+		sprintf_s(name, sizeof(name), "lookup (%s)", DepthColormapName((DepthColormap) map));
+		timer.reset();
+		for (int frame = 0; frame < benchmarkDepthFrames; frame++)
+		{
+			timer.start();
+			ColorizeDepthLookup(palette, depth, out, numPixels);
+			timer.stop();
+		}
+		timer.reportThroughput(results, name, numPixels);
+	}
+
+	// And how long a table takes to build in the first place
+	LARGE_INTEGER buildStart, buildEnd, frequency;
+	QueryPerformanceFrequency(&frequency);
+	DepthPalette freshPalette;
+	QueryPerformanceCounter(&buildStart);
+	freshPalette.table(DEPTH_HEATMAP);
+	QueryPerformanceCounter(&buildEnd);
+	fprintf(results, "building one 64K palette: %.1f us\n",
+		(buildEnd.QuadPart - buildStart.QuadPart) * 1000000.0 / (double) frequency.QuadPart);
+
+	delete [] depth;
+	delete [] out;
+}
+
+// The same frame split into bands over 1 to N threads, the way
+// Nui_GotDepthAlert does it
+static void RunDepthScalingBenchmark(FILE* results, DWORD width, DWORD height)
+{
+	DWORD numPixels = width * height;
+	USHORT* depth = new USHORT[numPixels];
+	RGBQUAD* out = new RGBQUAD[numPixels];
+	MakeDepthFrame(depth, width, height);
+
+	DepthBandJob job;
+	job.palette = &depthPalette;
+	job.depth = depth;
+	job.out = out;
+	job.width = width;
+
+	BenchmarkTimer timer(benchmarkDepthFrames);
+	int maxThreads = WorkerPool::defaultWorkers() + 1;
+	// The SIMD kernel and one of the lookup tables
+	static const DepthColormap maps[] = { PLAYER_GRAYSCALE, DEPTH_HEATMAP };
+	for (int m = 0; m < sizeof(maps) / sizeof(maps[0]); m++)
+	{
+		job.map = maps[m];
+		// Don't time building the table
+		depthPalette.table(job.map);
+		for (int threads = 1; threads <= maxThreads; threads++)
+		{
+			WorkerPool pool(threads - 1);
+			char name[64];
+			sprintf_s(name, sizeof(name), "%lux%lu %s, %d thr", width, height,
+				(job.map == PLAYER_GRAYSCALE) ? "SSE2" : "lookup", pool.numThreads());
+			timer.reset();
+			for (int frame = 0; frame < benchmarkDepthFrames; frame++)
+			{
+				timer.start();
+				pool.run(ColorizeDepthBand, &job, height);
+				timer.stop();
+			}
+			timer.reportThroughput(results, name, numPixels);
+		}
+	}
+
+	delete [] depth;
+	delete [] out;
+}
+
+void BenchmarkDepth(FILE* results)
+{
+	fprintf(results, "\nDepth colorizing, %lux%lu\n", benchmarkDepthWidth, benchmarkDepthHeight);
+	RunDepthBenchmark(results);
+
+	fprintf(results, "\nBanded depth colorizing, %d processors\n", WorkerPool::defaultWorkers() + 1);
+	RunDepthScalingBenchmark(results, benchmarkDepthWidth, benchmarkDepthHeight);
+	RunDepthScalingBenchmark(results, 640, 480);
+}
@@ -0,0 +1,92 @@
+#include "DepthColorizer.h"
+#include <emmintrin.h>
+
+//lookups for color tinting based on player index
+const int g_IntensityShiftByPlayerR[8] = { 1, 2, 0, 2, 0, 0, 2, 0 };
+const int g_IntensityShiftByPlayerG[8] = { 1, 2, 2, 0, 2, 0, 0, 1 };
+const int g_IntensityShiftByPlayerB[8] = { 1, 0, 2, 2, 0, 2, 0, 2 };
+
+void ColorizeDepth(const USHORT* depth, RGBQUAD* out, DWORD numPixels)
+{
+	// Every x64 processor has SSE2, but check on 32-bit
+	static const BOOL haveSSE2 = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	if (haveSSE2)
+	{
+		ColorizeDepthSSE2(depth, out, numPixels);
+	}
+	else
+	{
+		ColorizeDepthScalar(depth, out, numPixels);
+	}
+}
+
+void ColorizeDepthScalar(const USHORT* depth, RGBQUAD* out, DWORD numPixels)
+{
+	const USHORT* depthEnd = depth + numPixels;
+	while (depth < depthEnd)
+	{
+		*out = DepthPixelToQuad(*depth);
+		++depth;
+		++out;
+	}
+}
+
+// Shift each lane of whole right by 0, 1 or 2, as given by the same lane
+// of shift.  half and quarter are whole already shifted by 1 and 2.
+static __forceinline __m128i SelectShift(__m128i whole, __m128i half, __m128i quarter, __m128i shift)
+{
+	__m128i isHalf = _mm_cmpeq_epi16(shift, _mm_set1_epi16(1));
+	__m128i isQuarter = _mm_cmpeq_epi16(shift, _mm_set1_epi16(2));
+	__m128i result = _mm_andnot_si128(_mm_or_si128(isHalf, isQuarter), whole);
+	result = _mm_or_si128(result, _mm_and_si128(isHalf, half));
+	result = _mm_or_si128(result, _mm_and_si128(isQuarter, quarter));
+	return result;
+}
+
+// Eight pixels at a time.  The three per-player shifts are packed into
+// one code per player (R in bits 0-1, G in 2-3, B in 4-5), so there's only
+// one lookup per pixel, done with a compare against each of the 8 players.
+void ColorizeDepthSSE2(const USHORT* depth, RGBQUAD* out, DWORD numPixels)
+{
+	__m128i playerCodes[8];
+	for (int p = 0; p < 8; p++)
+	{
+		playerCodes[p] = _mm_set1_epi16((short) (g_IntensityShiftByPlayerR[p]
+			| (g_IntensityShiftByPlayerG[p] << 2)
+			| (g_IntensityShiftByPlayerB[p] << 4)));
+	}
+	const __m128i playerMask = _mm_set1_epi16(7);
+	const __m128i byteMask = _mm_set1_epi16(0xFF);
+	const __m128i shiftMask = _mm_set1_epi16(3);
+
+	DWORD i = 0;
+	for (; i + 8 <= numPixels; i += 8)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i*) (depth + i));
+
+		// (BYTE)~(RealDepth >> 4), where RealDepth = s >> 3
+		__m128i intensity = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(s, 7), byteMask), byteMask);
+		__m128i player = _mm_and_si128(s, playerMask);
+
+		__m128i code = _mm_setzero_si128();
+		for (int p = 0; p < 8; p++)
+		{
+			__m128i isPlayer = _mm_cmpeq_epi16(player, _mm_set1_epi16((short) p));
+			code = _mm_or_si128(code, _mm_and_si128(isPlayer, playerCodes[p]));
+		}
+
+		__m128i half = _mm_srli_epi16(intensity, 1);
+		__m128i quarter = _mm_srli_epi16(intensity, 2);
+		__m128i red = SelectShift(intensity, half, quarter, _mm_and_si128(code, shiftMask));
+		__m128i green = SelectShift(intensity, half, quarter, _mm_and_si128(_mm_srli_epi16(code, 2), shiftMask));
+		__m128i blue = SelectShift(intensity, half, quarter, _mm_and_si128(_mm_srli_epi16(code, 4), shiftMask));
+
+		// RGBQUAD is blue, green, red, reserved in memory
+		__m128i blueGreen = _mm_or_si128(blue, _mm_slli_epi16(green, 8));
+		_mm_storeu_si128((__m128i*) (out + i), _mm_unpacklo_epi16(blueGreen, red));
+		_mm_storeu_si128((__m128i*) (out + i + 4), _mm_unpackhi_epi16(blueGreen, red));
+	}
+
+	// Whatever's left over
+	ColorizeDepthScalar(depth + i, out + i, numPixels - i);
+}
@@ -0,0 +1,44 @@
+/************************************************************************
+*                                                                       *
+*   DepthColorizer.h -- Turns depth frames into player-tinted pixels    *
+*                                                                       *
+*   Same output as CSkeletalViewerApp::Nui_ShortToQuad_Depth, but for   *
+*   a whole frame at once, eight pixels at a time with SSE2 when the    *
+*   processor has it.                                                   *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+// How much to darken each color channel by, indexed by player (0 = nobody)
+extern const int g_IntensityShiftByPlayerR[8];
+extern const int g_IntensityShiftByPlayerG[8];
+extern const int g_IntensityShiftByPlayerB[8];
+
+// One packed depth pixel (depth << 3 | player) to a display color
+inline RGBQUAD DepthPixelToQuad(USHORT s)
+{
+	// NuiDepthPixelToDepth() and NuiDepthPixelToPlayerIndex(), done by hand
+	USHORT RealDepth = s >> 3;
+	USHORT Player    = s & 7;
+
+	// transform 13-bit depth information into an 8-bit intensity appropriate
+	// for display (we disregard information in most significant bit)
+	BYTE intensity = (BYTE)~(RealDepth >> 4);
+
+	// tint the intensity by dividing by per-player values
+	RGBQUAD color;
+	color.rgbRed      = intensity >> g_IntensityShiftByPlayerR[Player];
+	color.rgbGreen    = intensity >> g_IntensityShiftByPlayerG[Player];
+	color.rgbBlue     = intensity >> g_IntensityShiftByPlayerB[Player];
+	color.rgbReserved = 0;
+
+	return color;
+}
+
+// Whole-frame versions.  ColorizeDepth() picks the fastest one this
+// processor can run; the others are there to compare against.
+void ColorizeDepth(const USHORT* depth, RGBQUAD* out, DWORD numPixels);
+void ColorizeDepthScalar(const USHORT* depth, RGBQUAD* out, DWORD numPixels);
+void ColorizeDepthSSE2(const USHORT* depth, RGBQUAD* out, DWORD numPixels);
@@ -0,0 +1,214 @@
+#include "DepthPalette.h"
+#include "DepthColorizer.h"
+#include <stdlib.h>
+
+// The one the depth view uses
+DepthPalette depthPalette;
+
+static const char* colormapNames[NUM_DEPTH_COLORMAPS] = {
+	"Player grayscale",
+	"Heatmap",
+	"Near range",
+};
+
+DepthPalette::DepthPalette()
+{
+	colormap = PLAYER_GRAYSCALE;
+	for (int i = 0; i < NUM_DEPTH_COLORMAPS; i++)
+	{
+		tables[i] = NULL;
+	}
+}
+
+DepthPalette::~DepthPalette(void)
+{
+	for (int i = 0; i < NUM_DEPTH_COLORMAPS; i++)
+	{
+		_aligned_free(tables[i]);
+	}
+}
+
+const RGBQUAD* DepthPalette::table(DepthColormap map)
+{
+	if (tables[map] == NULL)
+	{
+		RGBQUAD* palette = (RGBQUAD*) _aligned_malloc(depthPaletteSize * sizeof(RGBQUAD), 64);
+		if (palette == NULL)
+		{
+			return NULL;
+		}
+		build(map, palette);
+		// If someone else got there first, use theirs
+		if (InterlockedCompareExchangePointer((PVOID volatile*) &tables[map], palette, NULL) != NULL)
+		{
+			_aligned_free(palette);
+		}
+	}
+	return tables[map];
+}
+
+void DepthPalette::colorize(const USHORT* depth, RGBQUAD* out, DWORD numPixels)
+{
+	colorize(colormap, depth, out, numPixels);
+}
+
+void DepthPalette::colorize(DepthColormap map, const USHORT* depth, RGBQUAD* out, DWORD numPixels)
+{
+	// The SIMD kernel beats the table for the default look (see -benchmark)
+	if (map == PLAYER_GRAYSCALE)
+	{
+		ColorizeDepth(depth, out, numPixels);
+		return;
+	}
+
+	const RGBQUAD* palette = table(map);
+	if (palette == NULL)
+	{
+		ColorizeDepth(depth, out, numPixels);
+		return;
+	}
+	ColorizeDepthLookup(palette, depth, out, numPixels);
+}
+
+RGBQUAD DepthPalette::lookup(USHORT s)
+{
+	const RGBQUAD* palette = table(colormap);
+	if (palette == NULL)
+	{
+		return DepthPixelToQuad(s);
+	}
+	return palette[s];
+}
+
+void DepthPalette::nextColormap()
+{
+	colormap = (DepthColormap) ((colormap + 1) % NUM_DEPTH_COLORMAPS);
+}
+
+const char* DepthPalette::colormapName()
+{
+	return DepthColormapName(colormap);
+}
+
+const char* DepthColormapName(DepthColormap map)
+{
+	return colormapNames[map];
+}
+
+static BYTE ToByte(float f)
+{
+	if (f <= 0)
+	{
+		return 0;
+	}
+	if (f >= 1)
+	{
+		return 255;
+	}
+	return (BYTE) (f * 255 + 0.5f);
+}
+
+// Polynomial fit of the Turbo colormap, t from 0 (blue) to 1 (red)
+static RGBQUAD Turbo(float t)
+{
+	RGBQUAD color;
+	color.rgbRed   = ToByte(0.13572138f + t * (4.61539260f + t * (-42.66032258f + t * (132.13108234f + t * (-152.94239396f + t * 59.28637943f)))));
+	color.rgbGreen = ToByte(0.09140261f + t * (2.19418839f + t * (4.84296658f + t * (-14.18503333f + t * (4.27729857f + t * 2.82956604f)))));
+	color.rgbBlue  = ToByte(0.10667330f + t * (12.64194608f + t * (-60.58204836f + t * (110.36276771f + t * (-89.90310912f + t * 27.34824973f)))));
+	color.rgbReserved = 0;
+	return color;
+}
+
+static RGBQUAD Scale(RGBQUAD color, int numerator, int denominator)
+{
+	color.rgbRed   = (BYTE) (color.rgbRed * numerator / denominator);
+	color.rgbGreen = (BYTE) (color.rgbGreen * numerator / denominator);
+	color.rgbBlue  = (BYTE) (color.rgbBlue * numerator / denominator);
+	return color;
+}
+
+// Player tint at a given brightness, the same way the grayscale view does it
+static RGBQUAD Tint(BYTE intensity, USHORT player)
+{
+	RGBQUAD color;
+	color.rgbRed      = intensity >> g_IntensityShiftByPlayerR[player];
+	color.rgbGreen    = intensity >> g_IntensityShiftByPlayerG[player];
+	color.rgbBlue     = intensity >> g_IntensityShiftByPlayerB[player];
+	color.rgbReserved = 0;
+	return color;
+}
+
+void DepthPalette::build(DepthColormap map, RGBQUAD* palette)
+{
+	for (DWORD s = 0; s < depthPaletteSize; s++)
+	{
+		USHORT millimeters = (USHORT) (s >> 3);
+		USHORT player = (USHORT) (s & 7);
+		RGBQUAD color = DepthPixelToQuad((USHORT) s);
+
+		switch (map)
+		{
+		case PLAYER_GRAYSCALE:
+			break;
+		case DEPTH_HEATMAP:
+			if (millimeters == 0)
+			{
+				// Unknown depth
+				color = Tint(0, 0);
+			}
+			else
+			{
+				// Near is hot
+				float t = 1.0f - (float) ((int) millimeters - heatmapNearMM) / (float) (heatmapFarMM - heatmapNearMM);
+				if (t < 0)
+				{
+					t = 0;
+				}
+				else if (t > 1)
+				{
+					t = 1;
+				}
+				color = Turbo(t);
+				if (player == 0)
+				{
+					color = Scale(color, 3, 5);
+				}
+			}
+			break;
+		case NEAR_RANGE:
+			if (player != 0 && millimeters >= interactionNearMM && millimeters <= interactionFarMM)
+			{
+				color = Tint(255, player);
+			}
+			else if (player != 0)
+			{
+				color = Tint(96, player);
+			}
+			else
+			{
+				color = Scale(color, 1, 4);
+			}
+			break;
+		}
+
+		palette[s] = color;
+	}
+}
+
+void ColorizeDepthLookup(const RGBQUAD* palette, const USHORT* depth, RGBQUAD* out, DWORD numPixels)
+{
+	const USHORT* depthEnd = depth + numPixels;
+	while (depth < depthEnd)
+	{
+		*out = palette[*depth];
+		++depth;
+		++out;
+	}
+}
+
+void ColorizeDepthBand(void* context, DWORD firstRow, DWORD endRow)
+{
+	DepthBandJob* job = (DepthBandJob*) context;
+	DWORD first = firstRow * job->width;
+	job->palette->colorize(job->map, job->depth + first, job->out + first, (endRow - firstRow) * job->width);
+}
@@ -0,0 +1,74 @@
+/************************************************************************
+*                                                                       *
+*   DepthPalette.h -- Declaration of DepthPalette class                 *
+*                                                                       *
+*   Every possible packed depth pixel (depth << 3 | player) mapped to   *
+*   its display color ahead of time, one 64K table per colormap, so     *
+*   showing a depth frame is one lookup per pixel.                      *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+enum DepthColormap {
+	// The original look: inverted depth, tinted per player
+	PLAYER_GRAYSCALE,
+	// Turbo-style heatmap of distance, players brightened
+	DEPTH_HEATMAP,
+	// Players inside the range gestures work at stand out, the rest is dimmed
+	NEAR_RANGE,
+	NUM_DEPTH_COLORMAPS,
+};
+
+// Distances (in mm) the heatmap is stretched over
+const USHORT heatmapNearMM = 800;
+const USHORT heatmapFarMM = 4000;
+// Where people can actually use the gestures from
+const USHORT interactionNearMM = 1200;
+const USHORT interactionFarMM = 2800;
+
+const DWORD depthPaletteSize = 65536;
+
+class DepthPalette
+{
+public:
+	DepthPalette();
+	~DepthPalette(void);
+
+	// Tables are only built the first time they're asked for
+	const RGBQUAD* table(DepthColormap map);
+	// Colors a whole frame with the current colormap
+	void colorize(const USHORT* depth, RGBQUAD* out, DWORD numPixels);
+	void colorize(DepthColormap map, const USHORT* depth, RGBQUAD* out, DWORD numPixels);
+	RGBQUAD lookup(USHORT s);
+	void nextColormap();
+	const char* colormapName();
+
+	// Set from the GUI thread, read from the NUI thread; a single aligned
+	// DWORD-sized write, so there's nothing to lock
+	volatile DepthColormap colormap;
+
+private:
+	void build(DepthColormap map, RGBQUAD* palette);
+	RGBQUAD* tables[NUM_DEPTH_COLORMAPS];
+};
+
+const char* DepthColormapName(DepthColormap map);
+
+// Lookup-table version of a whole frame (what colorize() uses for
+// everything but PLAYER_GRAYSCALE, which has its own SIMD kernel)
+void ColorizeDepthLookup(const RGBQUAD* palette, const USHORT* depth, RGBQUAD* out, DWORD numPixels);
+
+// One frame's worth of colorizing, to be split into row bands by a
+// WorkerPool.  The colormap is picked once for the whole frame.
+struct DepthBandJob
+{
+	DepthPalette* palette;
+	DepthColormap map;
+	const USHORT* depth;
+	RGBQUAD* out;
+	DWORD width;
+};
+
+void ColorizeDepthBand(void* context, DWORD firstRow, DWORD endRow);
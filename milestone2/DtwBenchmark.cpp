@@ -0,0 +1,431 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "DtwRecognizer.h"
+#include "GestureTable.h"
+#include "JointHistory.h"
+#include "FrameClock.h"
+#include <math.h>
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern int activeSkeleton;
+extern GestureDetector* gestureDetectors[NUI_SKELETON_COUNT];
+extern FLOAT moveAmount_x;
+extern FLOAT moveAmount_y;
+extern float magnifyAmount;
+extern float magnificationFloor;
+extern BOOL headlessMagnifierHidden;
+extern BOOL allowMagnifyGestures;
+extern BOOL hideWindowOn;
+
+/*** Dynamic gestures ***/
+
+// Frames of rest on either side of each performance, and getting from
+// rest to where the gesture starts (or back)
+const int gestureRestFrames = 20;
+const int gestureReachFrames = 15;
+
+enum PerformedGesture {
+	PERFORM_SWIPE_OUT,
+	PERFORM_SWIPE_IN,
+	PERFORM_WAVE,
+	PERFORM_CIRCLE,
+	// Things that shouldn't match anything
+	PERFORM_REACH,
+	PERFORM_SALUTE,
+};
+// What each should be recognized as, by the default template names
+static const char* const performedNames[] = { "swipe out", "swipe in", "wave", "circle", "reach", "salute" };
+static const int performedFrames[] = { 15, 15, 30, 30, 30, 40 };
+
+struct Performance
+{
+	PerformedGesture gesture;
+	Direction hand;
+	// How much faster and bigger than the templates it's done
+	FLOAT speed;
+	FLOAT size;
+};
+
+static const Performance performances[] = {
+	{ PERFORM_SWIPE_OUT, RIGHT, 1.0f, 1.0f },
+	{ PERFORM_SWIPE_OUT, RIGHT, 1.3f, 0.8f },
+	{ PERFORM_SWIPE_OUT, LEFT, 0.8f, 1.1f },
+	{ PERFORM_SWIPE_IN, RIGHT, 1.0f, 1.0f },
+	{ PERFORM_SWIPE_IN, LEFT, 1.25f, 0.9f },
+	{ PERFORM_WAVE, RIGHT, 1.0f, 1.0f },
+	{ PERFORM_WAVE, LEFT, 0.8f, 1.2f },
+	{ PERFORM_CIRCLE, RIGHT, 1.0f, 1.0f },
+	{ PERFORM_CIRCLE, RIGHT, 1.2f, 0.85f },
+	{ PERFORM_CIRCLE, LEFT, 0.85f, 1.1f },
+	{ PERFORM_REACH, RIGHT, 1.0f, 1.0f },
+	{ PERFORM_REACH, LEFT, 1.0f, 1.0f },
+	{ PERFORM_SALUTE, RIGHT, 1.0f, 1.0f },
+	{ PERFORM_SALUTE, LEFT, 1.3f, 1.0f },
+};
+
+// Where the moving hand is, t of the way through, in the same units and
+// (right-handed) layout as DtwRecognizer::addDefaultTemplates()
+static void PerformedPoint(const Performance &performance, FLOAT t, FLOAT point[3])
+{
+	const FLOAT twoPi = 6.28318531f;
+	FLOAT s = t * t * t * (10 - 15 * t + 6 * t * t);
+	FLOAT size = performance.size;
+	switch (performance.gesture)
+	{
+	case PERFORM_SWIPE_OUT:
+		point[0] = 0.1f + 1.6f * size * s;
+		point[1] = -0.2f;
+		point[2] = -1.0f;
+		break;
+	case PERFORM_SWIPE_IN:
+		point[0] = 0.1f + 1.6f * size * (1 - s);
+		point[1] = -0.2f;
+		point[2] = -1.0f;
+		break;
+	case PERFORM_WAVE:
+		point[0] = 1.2f + 0.4f * size * sin(twoPi * 2 * t);
+		point[1] = 0.7f;
+		point[2] = -0.6f;
+		break;
+	case PERFORM_CIRCLE:
+		point[0] = 1.0f + 0.6f * size * sin(twoPi * t);
+		point[1] = 0.6f * size * cos(twoPi * t);
+		point[2] = -1.0f;
+		break;
+	case PERFORM_REACH:
+		// Out to the movement box, and hold it there
+		point[0] = 0.6f + 0.3f * s;
+		point[1] = -1.6f + 0.6f * s;
+		point[2] = -0.3f - 0.7f * s;
+		break;
+	default:
+		// To the head, then up and away
+		if (t < 0.5f)
+		{
+			point[0] = 0.2f;
+			point[1] = 0.4f;
+			point[2] = -0.2f;
+		}
+		else
+		{
+			FLOAT u = (t - 0.5f) * 2;
+			u = u * u * (3 - 2 * u);
+			point[0] = 0.2f + 0.5f * u;
+			point[1] = 0.4f + 0.4f * u;
+			point[2] = -0.2f;
+		}
+		break;
+	}
+}
+
+// Fills in one frame of a performance: rest, reach to the start, the
+// gesture itself, back to rest, rest.  Returns FALSE after the end.
+static BOOL MakePerformanceFrame(NUI_SKELETON_FRAME &SkeletonFrame, const Performance &performance, int frame, DWORD &noise)
+{
+	static const FLOAT rest[3] = { 0.6f, -1.6f, -0.3f };
+	int gestureFrames = (int) (performedFrames[performance.gesture] / performance.speed + 0.5f);
+	int total = 2 * gestureRestFrames + 2 * gestureReachFrames + gestureFrames;
+	if (frame >= total)
+	{
+		return FALSE;
+	}
+
+	FLOAT start[3];
+	FLOAT end[3];
+	FLOAT point[3];
+	PerformedPoint(performance, 0, start);
+	PerformedPoint(performance, 1, end);
+	int f = frame - gestureRestFrames;
+	if (f < 0 || f >= 2 * gestureReachFrames + gestureFrames)
+	{
+		point[0] = rest[0];
+		point[1] = rest[1];
+		point[2] = rest[2];
+	}
+	else if (f < gestureReachFrames || f >= gestureReachFrames + gestureFrames)
+	{
+		// Easing between rest and the start (or the end and rest)
+		BOOL going = (f < gestureReachFrames);
+		FLOAT u = going ? (FLOAT) f / gestureReachFrames
+			: (FLOAT) (f - gestureReachFrames - gestureFrames + 1) / gestureReachFrames;
+		u = u * u * (3 - 2 * u);
+		const FLOAT* from = going ? rest : end;
+		const FLOAT* to = going ? start : rest;
+		for (int k = 0; k < 3; k++)
+		{
+			point[k] = from[k] + u * (to[k] - from[k]);
+		}
+	}
+	else
+	{
+		PerformedPoint(performance, (FLOAT) (f - gestureReachFrames) / (gestureFrames - 1), point);
+	}
+
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	ZeroMemory(&SkeletonFrame, sizeof(SkeletonFrame));
+	SkeletonFrame.dwFrameNumber = frame;
+	SkeletonFrame.liTimeStamp.QuadPart = (frame * 1000) / 30;
+	NUI_SKELETON_DATA &skeleton = SkeletonFrame.SkeletonData[0];
+	MakeSkeleton(skeleton, 0, restPose);
+	skeleton.dwTrackingID = 1;
+	const Vector4 &center = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_SHOULDER_CENTER];
+	Vector4 &moving = skeleton.SkeletonPositions[(performance.hand == RIGHT) ? NUI_SKELETON_POSITION_HAND_RIGHT : NUI_SKELETON_POSITION_HAND_LEFT];
+	Vector4 &resting = skeleton.SkeletonPositions[(performance.hand == RIGHT) ? NUI_SKELETON_POSITION_HAND_LEFT : NUI_SKELETON_POSITION_HAND_RIGHT];
+	FLOAT side = (performance.hand == RIGHT) ? 1.0f : -1.0f;
+	const FLOAT* positions[2] = { point, rest };
+	Vector4* hands[2] = { &moving, &resting };
+	for (int h = 0; h < 2; h++)
+	{
+		FLOAT n[3];
+		for (int k = 0; k < 3; k++)
+		{
+			noise = noise * 1103515245 + 12345;
+			n[k] = jointNoise * (((noise >> 16) % 2001) / 1000.0f - 1.0f);
+		}
+		// Left-handed is the same thing mirrored, and the resting hand is on the other side
+		FLOAT handSide = (h == 0) ? side : -side;
+		hands[h]->x = center.x + handSide * positions[h][0] * defaultShoulderWidth + n[0];
+		hands[h]->y = center.y + positions[h][1] * defaultShoulderWidth + n[1];
+		hands[h]->z = center.z + positions[h][2] * defaultShoulderWidth + n[2];
+	}
+	return TRUE;
+}
+
+// Every performance should be recognized as what it is, once, and the
+// things that aren't gestures as nothing
+static void CheckDtwRecognizer(FILE* results, BOOL useSSE)
+{
+	DtwRecognizer recognizer;
+	recognizer.addDefaultTemplates();
+	recognizer.useSSE = useSSE;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	DWORD noise = 4321;
+	int right = 0;
+	int wrong = 0;
+	for (int p = 0; p < sizeof(performances) / sizeof(performances[0]); p++)
+	{
+		const Performance &performance = performances[p];
+		char expected[32];
+		sprintf_s(expected, sizeof(expected), "%s, %s", performedNames[performance.gesture],
+			(performance.hand == RIGHT) ? "right" : "left");
+		BOOL isGesture = (performance.gesture < PERFORM_REACH);
+
+		recognizer.reset();
+		int seen = 0;
+		char got[128] = "";
+		for (int frame = 0; MakePerformanceFrame(SkeletonFrame, performance, frame, noise); frame++)
+		{
+			recognizer.recognize(SkeletonFrame);
+			DtwMatch match;
+			if (recognizer.takeMatch(0, match))
+			{
+				const char* name = recognizer.templateName(match.templateIndex);
+				if (isGesture && seen == 0 && strcmp(name, expected) == 0)
+				{
+					seen = 1;
+				}
+				else
+				{
+					seen = -1;
+					strncpy_s(got, sizeof(got), name, _TRUNCATE);
+				}
+			}
+		}
+
+		char name[64];
+		sprintf_s(name, sizeof(name), "%s x%.2f", expected, performance.speed);
+		if ((isGesture && seen == 1) || (! isGesture && seen == 0))
+		{
+			right++;
+		}
+		else
+		{
+			wrong++;
+			checksFailed++;
+			fprintf(results, "%-24s FAILED: %s\n", name, (seen == 0) ? "not recognized" : got);
+		}
+	}
+	fprintf(results, "%-24s %d of %d right, %d templates\n", useSSE ? "recognition, SSE" : "recognition, scalar",
+		right, right + wrong, recognizer.numTemplates);
+}
+
+// What a performance should make the rule table do, from where (the
+// move states follow the hand about, so it can be matched in any of them)
+struct DynamicCommand
+{
+	const char* name;
+	Performance performance;
+	GestureStateEnum from;
+	int matchedIn;		// STATE_BITs
+	GestureStateEnum to;
+};
+
+static const DynamicCommand dynamicCommands[] = {
+	{ "swipe -> move",        { PERFORM_SWIPE_OUT, RIGHT, 1.0f, 1.0f }, SALUTE2,    STATE_BIT(SALUTE2), MOVECENTER },
+	{ "circle -> magnify",    { PERFORM_CIRCLE, RIGHT, 1.0f, 1.0f },    SALUTE2,    STATE_BIT(SALUTE2), MAGNIFYLEFT },
+	{ "wave -> salute",       { PERFORM_WAVE, RIGHT, 1.0f, 1.0f },      MOVECENTER, MOVE_STATES,        SALUTE2 },
+	{ "swipe, other hand",    { PERFORM_SWIPE_OUT, LEFT, 1.0f, 1.0f },  SALUTE2,    STATE_BIT(SALUTE2), SALUTE2 },
+};
+
+// A match has to reach the rule table, and take it where the rules say
+// on the frame it's matched, not after a lock-on
+static void CheckDynamicCommands(FILE* results)
+{
+	BOOL savedAllowMagnify = allowMagnifyGestures;
+	allowMagnifyGestures = TRUE;
+	hideWindowOn = FALSE;
+	frameClock.useVirtualTime();
+
+	DtwRecognizer recognizer;
+	recognizer.addDefaultTemplates();
+	NUI_SKELETON_FRAME SkeletonFrame;
+	GestureDetector* detector = gestureDetectors[0];
+	for (int c = 0; c < sizeof(dynamicCommands) / sizeof(dynamicCommands[0]); c++)
+	{
+		const DynamicCommand &command = dynamicCommands[c];
+		JointHistory history;
+		DWORD noise = 4321;
+		recognizer.reset();
+		GestureStateEnum before = command.from;
+		GestureStateEnum after = command.from;
+		int matchedAt = -1;
+		for (int frame = 0; MakePerformanceFrame(SkeletonFrame, command.performance, frame, noise); frame++)
+		{
+			frameClock.newFrame(SkeletonFrame.liTimeStamp);
+			if (frame == 0)
+			{
+				activeSkeleton = 0;
+				magnificationFloor = 0;
+				headlessMagnifierHidden = FALSE;
+				detector->state->set(command.from);
+				detector->hand = RIGHT;
+				detector->lockingOn_move = FALSE;
+				detector->lockingOn_magnify = FALSE;
+				detector->startTime = detector->getTimeIn100NSIntervals();
+			}
+			history.add(SkeletonFrame, frameClock.frameTime());
+			recognizer.recognize(SkeletonFrame);
+			DtwMatch match;
+			BOOL matched = detector->takeDynamicGesture(recognizer, match);
+			if (matched && matchedAt == -1)
+			{
+				matchedAt = frame;
+				before = detector->state->state;
+			}
+			detector->detect(SkeletonFrame, history);
+			if (matched && matchedAt == frame)
+			{
+				after = detector->state->state;
+			}
+		}
+
+		BOOL passed = (matchedAt != -1 && (STATE_BIT(before) & command.matchedIn) && after == command.to);
+		checksFailed += passed ? 0 : 1;
+		fprintf(results, "%-24s %s (%s -> %s at frame %d)\n", command.name, CheckResult(passed),
+			GestureStateName(before), GestureStateName(after), matchedAt);
+	}
+
+	activeSkeleton = -1;
+	moveAmount_x = 0;
+	moveAmount_y = 0;
+	magnifyAmount = 0;
+	detector->state->set(OFF);
+	allowMagnifyGestures = savedAllowMagnify;
+	frameClock.useRealTime();
+}
+
+// Every skeleton moving against a full bank of templates, with the budget
+// off so every comparison is made every frame, then with it on
+static void RunDtwBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	CheckDtwRecognizer(results, TRUE);
+	CheckDtwRecognizer(results, FALSE);
+	CheckDynamicCommands(results);
+
+	// A whole bank: the defaults, plus as many again played back slower
+	DtwRecognizer recognizer;
+	recognizer.addDefaultTemplates();
+	NUI_SKELETON_FRAME SkeletonFrame;
+	FLOAT features[maxTemplateFrames][dtwFeatures];
+	while (recognizer.numTemplates < maxDtwTemplates)
+	{
+		Performance slow = { PERFORM_CIRCLE, RIGHT, 0.7f, 1.0f };
+		DWORD quiet = 0;
+		int f;
+		for (f = 0; f < maxTemplateFrames; f++)
+		{
+			MakePerformanceFrame(SkeletonFrame, slow, gestureRestFrames + gestureReachFrames + f, quiet);
+			DtwSkeletonFeatures(SkeletonFrame.SkeletonData[0], features[f]);
+		}
+		recognizer.addTemplate("slow circle", features, maxTemplateFrames);
+	}
+
+	// Everyone punching out and sweeping across at once, which is enough
+	// movement to be worth comparing but doesn't look like any template
+	const int benchmarkDtwFrames = benchmarkFrames / 10;
+	const int motionFrames = 90;
+	NUI_SKELETON_FRAME* frames = new NUI_SKELETON_FRAME[motionFrames];
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	for (int f = 0; f < motionFrames; f++)
+	{
+		ZeroMemory(&frames[f], sizeof(frames[f]));
+		frames[f].dwFrameNumber = f;
+		for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+		{
+			NUI_SKELETON_DATA &skeleton = frames[f].SkeletonData[s];
+			MakeSkeleton(skeleton, (FLOAT) s, restPose);
+			skeleton.dwTrackingID = s + 1;
+			FLOAT t = (f + 5 * s) / 30.0f;
+			Vector4 &hand = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT];
+			hand.x = s + 0.35f * (1.0f + 0.5f * (FLOAT) sin(6.28318531 * 1.3 * t));
+			hand.y = 0.3f;
+			hand.z = bodyZ - 0.35f * (0.5f + 0.5f * (FLOAT) sin(6.28318531 * 2.0 * t));
+		}
+	}
+
+	for (int k = 0; k < 3; k++)
+	{
+		recognizer.reset();
+		recognizer.useSSE = (k != 1);
+		recognizer.cellBudget = (k < 2) ? 0xFFFFFFFF : dtwCellBudget;
+		DWORD comparisons = 0;
+		DWORD deferred = 0;
+		timer.reset();
+		for (int frame = 0; frame < benchmarkDtwFrames; frame++)
+		{
+			timer.start();
+			recognizer.recognize(frames[frame % motionFrames]);
+			timer.stop();
+			// Only count frames once every window is full
+			if (frame >= dtwWindowFrames)
+			{
+				comparisons += recognizer.comparisonsLastFrame;
+				deferred += recognizer.comparisonsDeferred;
+			}
+		}
+		// Leaving out the frames before every window is full, before
+		// report() sorts them
+		LONGLONG ticks = 0;
+		for (int i = dtwWindowFrames; i < timer.numSamples; i++)
+		{
+			ticks += timer.samples[i];
+		}
+		const char* name = (k == 0) ? "DTW SSE" : (k == 1) ? "DTW scalar" : "DTW SSE, budgeted";
+		timer.report(results, name);
+
+		double seconds = (double) ticks / (double) timer.frequency;
+		int measured = benchmarkDtwFrames - dtwWindowFrames;
+		fprintf(results, "%-24s %.0f templates x frames/s (%.1f compared, %.1f put off per frame)\n", "",
+			comparisons / seconds, (double) comparisons / measured, (double) deferred / measured);
+	}
+
+	delete [] frames;
+}
+
+void BenchmarkDynamicGestures(FILE* results, BenchmarkTimer &timer)
+{
+	fprintf(results, "\nDynamic gestures, %d skeletons\n", NUI_SKELETON_COUNT);
+	RunDtwBenchmark(results, timer);
+}
@@ -0,0 +1,630 @@
+#include "DtwRecognizer.h"
+#include "SkeletonReplayer.h"
+#include <emmintrin.h>
+#include <math.h>
+#include <stdio.h>
+
+const FLOAT twoPi = 6.28318531f;
+// Bigger than any real distance, but small enough to add to
+const FLOAT dtwInfinity = 1e30f;
+// A row of the warping table, plus the column in front of it, rounded up
+// to whole SSE registers
+const int dtwRowSize = dtwLength + 4;
+
+const FLOAT dtwScaleFactors[dtwScales] = { 0.75f, 1.0f, 1.33f };
+
+DtwRecognizer::DtwRecognizer()
+{
+	templates = (DtwTemplate*) _aligned_malloc(maxDtwTemplates * sizeof(DtwTemplate), 16);
+	resampled = (DtwSequence*) _aligned_malloc((dtwWindowFrames + 1) * sizeof(DtwSequence), 16);
+	resampledEpoch = 0;
+	for (int length = 0; length <= dtwWindowFrames; length++)
+	{
+		resampledEpochs[length] = 0;
+	}
+	windows = new DtwWindow[NUI_SKELETON_COUNT];
+	numTemplates = 0;
+	cellBudget = dtwCellBudget;
+	// Every x64 processor has SSE2, but check on 32-bit
+	useSSE = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	reset();
+}
+
+DtwRecognizer::~DtwRecognizer(void)
+{
+	_aligned_free(templates);
+	_aligned_free(resampled);
+	delete [] windows;
+}
+
+void DtwRecognizer::reset()
+{
+	for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+	{
+		windows[s].next = 0;
+		windows[s].count = 0;
+		windows[s].trackingId = 0;
+		haveMatch[s] = FALSE;
+		tracked[s] = FALSE;
+		for (int t = 0; t < maxDtwTemplates; t++)
+		{
+			lastDistances[s][t] = dtwInfinity;
+		}
+	}
+	nextComparison = 0;
+	cellsLastFrame = 0;
+	comparisonsLastFrame = 0;
+	comparisonsDeferred = 0;
+}
+
+/*** Templates ***/
+
+// How far a hand goes over a sequence (0 = right, 1 = left)
+static FLOAT HandTravel(const DtwSequence &sequence, int hand)
+{
+	const FLOAT* x = sequence.features[3 * hand];
+	const FLOAT* y = sequence.features[3 * hand + 1];
+	const FLOAT* z = sequence.features[3 * hand + 2];
+	FLOAT travel = 0;
+	for (int i = 1; i < dtwLength; i++)
+	{
+		FLOAT dx = x[i] - x[i - 1];
+		FLOAT dy = y[i] - y[i - 1];
+		FLOAT dz = z[i] - z[i - 1];
+		travel += sqrt(dx * dx + dy * dy + dz * dz);
+	}
+	return travel;
+}
+
+int DtwRecognizer::addTemplate(const char* name, const FLOAT (*features)[dtwFeatures], int frames,
+								DynamicGesture gesture)
+{
+	if (numTemplates >= maxDtwTemplates || frames < 2)
+	{
+		return -1;
+	}
+
+	DtwTemplate &added = templates[numTemplates];
+	DtwResample(features, frames, added.sequence);
+	// Anything too slow to fit in the window is matched as if done faster
+	added.frames = (frames > maxTemplateFrames) ? maxTemplateFrames : frames;
+	strncpy_s(added.name, sizeof(added.name), name, _TRUNCATE);
+	FLOAT rightTravel = HandTravel(added.sequence, 0);
+	FLOAT leftTravel = HandTravel(added.sequence, 1);
+	added.hand = (leftTravel > rightTravel) ? 1 : 0;
+	added.travel = (leftTravel > rightTravel) ? leftTravel : rightTravel;
+	added.threshold = dtwMatchThreshold;
+	added.gesture = gesture;
+	return numTemplates++;
+}
+
+int DtwRecognizer::addTemplatePair(const char* name, const FLOAT (*features)[dtwFeatures], int frames,
+									DynamicGesture gesture)
+{
+	char handName[32];
+	sprintf_s(handName, sizeof(handName), "%s, right", name);
+	int first = addTemplate(handName, features, frames, gesture);
+	if (first < 0)
+	{
+		return -1;
+	}
+
+	// The same thing with the other hand: swap the hands over and flip x
+	FLOAT (*mirrored)[dtwFeatures] = new FLOAT[frames][dtwFeatures];
+	for (int i = 0; i < frames; i++)
+	{
+		mirrored[i][0] = -features[i][3];
+		mirrored[i][1] = features[i][4];
+		mirrored[i][2] = features[i][5];
+		mirrored[i][3] = -features[i][0];
+		mirrored[i][4] = features[i][1];
+		mirrored[i][5] = features[i][2];
+	}
+	sprintf_s(handName, sizeof(handName), "%s, left", name);
+	addTemplate(handName, mirrored, frames, gesture);
+	delete [] mirrored;
+	return first;
+}
+
+int DtwRecognizer::addRecordedTemplate(const char* name, const char* path, DynamicGesture gesture)
+{
+	SkeletonReplayer replayer;
+	if (! replayer.open(path))
+	{
+		return -1;
+	}
+
+	// A recording of just the gesture shouldn't be more than a few seconds
+	const int maxRecordedFrames = 300;
+	FLOAT (*features)[dtwFeatures] = new FLOAT[maxRecordedFrames][dtwFeatures];
+	int frames = 0;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	while (frames < maxRecordedFrames && replayer.nextFrame(SkeletonFrame))
+	{
+		for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+		{
+			if (SkeletonFrame.SkeletonData[s].eTrackingState == NUI_SKELETON_TRACKED)
+			{
+				DtwSkeletonFeatures(SkeletonFrame.SkeletonData[s], features[frames++]);
+				break;
+			}
+		}
+	}
+	replayer.close();
+
+	int index = addTemplate(name, features, frames, gesture);
+	delete [] features;
+	return index;
+}
+
+// Minimum-jerk progress from 0 to 1
+static FLOAT Ease(FLOAT s)
+{
+	return s * s * s * (10 - 15 * s + 6 * s * s);
+}
+
+void DtwRecognizer::addDefaultTemplates()
+{
+	// In shoulder widths from the middle of the shoulders, with the hand
+	// about a forearm out in front and the other one hanging down
+	FLOAT features[30][dtwFeatures];
+	const FLOAT front = -1.0f;
+	const FLOAT restX = -0.6f;
+	const FLOAT restY = -1.6f;
+	const FLOAT restZ = -0.3f;
+	for (int i = 0; i < 30; i++)
+	{
+		features[i][3] = restX;
+		features[i][4] = restY;
+		features[i][5] = restZ;
+	}
+
+	// Swipes: half a second across from the middle of the body, and back
+	for (int i = 0; i < 15; i++)
+	{
+		FLOAT s = Ease(i / 14.0f);
+		features[i][0] = 1.6f * s;
+		features[i][1] = -0.3f;
+		features[i][2] = front;
+	}
+	addTemplatePair("swipe out", features, 15, DYNAMIC_SWIPE);
+	for (int i = 0; i < 15; i++)
+	{
+		features[i][0] = 1.6f - features[i][0];
+	}
+	addTemplatePair("swipe in", features, 15, DYNAMIC_SWIPE);
+
+	// A wave: side to side twice, up by the head
+	for (int i = 0; i < 30; i++)
+	{
+		features[i][0] = 1.2f + 0.4f * sin(twoPi * 2 * i / 30.0f);
+		features[i][1] = 0.6f;
+		features[i][2] = front + 0.4f;
+	}
+	addTemplatePair("wave", features, 30, DYNAMIC_WAVE);
+
+	// A circle, clockwise from the top, in a second
+	for (int i = 0; i < 30; i++)
+	{
+		features[i][0] = 1.0f + 0.6f * sin(twoPi * i / 30.0f);
+		features[i][1] = 0.6f * cos(twoPi * i / 30.0f);
+		features[i][2] = front;
+	}
+	addTemplatePair("circle", features, 30, DYNAMIC_CIRCLE);
+}
+
+const char* DtwRecognizer::templateName(int index)
+{
+	if (index < 0 || index >= numTemplates)
+	{
+		return "none";
+	}
+	return templates[index].name;
+}
+
+DynamicGesture DtwRecognizer::templateGesture(int index)
+{
+	if (index < 0 || index >= numTemplates)
+	{
+		return DYNAMIC_NONE;
+	}
+	return templates[index].gesture;
+}
+
+int DtwRecognizer::templateHand(int index)
+{
+	if (index < 0 || index >= numTemplates)
+	{
+		return 0;
+	}
+	return templates[index].hand;
+}
+
+/*** Recognition ***/
+
+int DtwRecognizer::recognize(const NUI_SKELETON_FRAME &SkeletonFrame)
+{
+	// Add this frame to everyone's history
+	resampledEpoch++;
+	resampledSkeleton = -1;
+	for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+	{
+		SkeletonView skeleton(SkeletonFrame, s);
+		DtwWindow &window = windows[s];
+		tracked[s] = (skeleton.trackingState() == NUI_SKELETON_TRACKED);
+		if (! tracked[s] || skeleton.trackingId() != window.trackingId)
+		{
+			startOver(s);
+			window.trackingId = skeleton.trackingId();
+		}
+		if (tracked[s])
+		{
+			DtwSkeletonFeatures(skeleton, window.frames[window.next]);
+			window.next = (window.next + 1) % dtwWindowFrames;
+			if (window.count < dtwWindowFrames)
+			{
+				window.count++;
+			}
+		}
+	}
+
+	// Then compare as many (skeleton, template) pairs as the budget allows,
+	// starting where the last frame left off
+	FLOAT best[NUI_SKELETON_COUNT];
+	int bestTemplate[NUI_SKELETON_COUNT];
+	for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+	{
+		best[s] = dtwInfinity;
+		bestTemplate[s] = -1;
+	}
+	cellsLastFrame = 0;
+	comparisonsLastFrame = 0;
+	comparisonsDeferred = 0;
+	int numComparisons = NUI_SKELETON_COUNT * numTemplates;
+	DWORD cellsPerComparison = dtwScales * DtwCellsPerComparison();
+	int resumeAt = -1;
+	for (int k = 0; k < numComparisons; k++)
+	{
+		int c = (nextComparison + k) % numComparisons;
+		int s = c / numTemplates;
+		int t = c % numTemplates;
+		// Not enough history yet to try it at any speed
+		if (! tracked[s] || windows[s].count < (int) (templates[t].frames * dtwScaleFactors[0] + 0.5f))
+		{
+			continue;
+		}
+		if (resumeAt >= 0 || cellsLastFrame + cellsPerComparison > cellBudget)
+		{
+			if (resumeAt < 0)
+			{
+				resumeAt = c;
+			}
+			comparisonsDeferred++;
+			continue;
+		}
+
+		FLOAT distance = matchOne(s, t);
+		cellsLastFrame += cellsPerComparison;
+		comparisonsLastFrame++;
+		// Matched last time, and it's only getting worse from here
+		FLOAT last = lastDistances[s][t];
+		if (last < templates[t].threshold && distance >= last && last < best[s])
+		{
+			best[s] = last;
+			bestTemplate[s] = t;
+		}
+		lastDistances[s][t] = distance;
+	}
+	nextComparison = (resumeAt >= 0) ? resumeAt : 0;
+
+	// Start anyone who matched over, so one gesture is only seen once
+	int numMatches = 0;
+	for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+	{
+		if (bestTemplate[s] >= 0)
+		{
+			matches[s].templateIndex = bestTemplate[s];
+			matches[s].distance = best[s];
+			matches[s].frameNumber = SkeletonFrame.dwFrameNumber;
+			haveMatch[s] = TRUE;
+			startOver(s);
+			numMatches++;
+		}
+	}
+	return numMatches;
+}
+
+// Forget a skeleton's history
+void DtwRecognizer::startOver(int skeleton)
+{
+	windows[skeleton].count = 0;
+	for (int t = 0; t < maxDtwTemplates; t++)
+	{
+		lastDistances[skeleton][t] = dtwInfinity;
+	}
+}
+
+FLOAT DtwRecognizer::matchOne(int skeleton, int templateIndex)
+{
+	const DtwTemplate &matched = templates[templateIndex];
+	// Comparisons go a skeleton at a time, so that's how long resampled
+	// windows are kept for
+	if (skeleton != resampledSkeleton)
+	{
+		resampledSkeleton = skeleton;
+		resampledEpoch++;
+	}
+
+	FLOAT best = dtwInfinity;
+	for (int k = 0; k < dtwScales; k++)
+	{
+		int length = (int) (matched.frames * dtwScaleFactors[k] + 0.5f);
+		if (length < 2 || length > windows[skeleton].count)
+		{
+			continue;
+		}
+		const DtwSequence &recent = resampledWindow(skeleton, length);
+		// Holding still looks like anything once the mean's taken out
+		if (resampledTravel[length][matched.hand] < minTravelFraction * matched.travel)
+		{
+			continue;
+		}
+		FLOAT limit = (best < matched.threshold) ? best : matched.threshold;
+		FLOAT distance = useSSE ? DtwDistanceSSE(recent, matched.sequence, limit)
+			: DtwDistanceScalar(recent, matched.sequence, limit);
+		if (distance < best)
+		{
+			best = distance;
+		}
+	}
+	return best;
+}
+
+// The last length frames of a skeleton's history, resampled, and how far
+// each hand went over them.  Templates that took as long share them.
+const DtwSequence &DtwRecognizer::resampledWindow(int skeleton, int length)
+{
+	DtwSequence &sequence = resampled[length];
+	if (resampledEpochs[length] == resampledEpoch)
+	{
+		return sequence;
+	}
+
+	const DtwWindow &window = windows[skeleton];
+	FLOAT recent[dtwWindowFrames][dtwFeatures];
+	for (int i = 0; i < length; i++)
+	{
+		const FLOAT* frame = window.frames[(window.next - length + i + dtwWindowFrames) % dtwWindowFrames];
+		for (int f = 0; f < dtwFeatures; f++)
+		{
+			recent[i][f] = frame[f];
+		}
+	}
+	DtwResample(recent, length, sequence);
+	resampledTravel[length][0] = HandTravel(sequence, 0);
+	resampledTravel[length][1] = HandTravel(sequence, 1);
+	resampledEpochs[length] = resampledEpoch;
+	return sequence;
+}
+
+BOOL DtwRecognizer::takeMatch(int skeleton, DtwMatch &match)
+{
+	if (! haveMatch[skeleton])
+	{
+		return FALSE;
+	}
+	match = matches[skeleton];
+	haveMatch[skeleton] = FALSE;
+	return TRUE;
+}
+
+/*** Features ***/
+
+void DtwSkeletonFeatures(const SkeletonView &skeleton, FLOAT features[dtwFeatures])
+{
+	const Vector4 &center = skeleton.joint(NUI_SKELETON_POSITION_SHOULDER_CENTER);
+	const Vector4 &rightShoulder = skeleton.joint(NUI_SKELETON_POSITION_SHOULDER_RIGHT);
+	const Vector4 &leftShoulder = skeleton.joint(NUI_SKELETON_POSITION_SHOULDER_LEFT);
+
+	FLOAT width = defaultShoulderWidth;
+	if (skeleton.jointState(NUI_SKELETON_POSITION_SHOULDER_RIGHT) == NUI_SKELETON_POSITION_TRACKED
+		&& skeleton.jointState(NUI_SKELETON_POSITION_SHOULDER_LEFT) == NUI_SKELETON_POSITION_TRACKED)
+	{
+		FLOAT dx = rightShoulder.x - leftShoulder.x;
+		FLOAT dy = rightShoulder.y - leftShoulder.y;
+		FLOAT dz = rightShoulder.z - leftShoulder.z;
+		FLOAT measured = sqrt(dx * dx + dy * dy + dz * dz);
+		// Anything wildly off is the tracker being confused, not a small person
+		if (measured > defaultShoulderWidth / 2 && measured < defaultShoulderWidth * 2)
+		{
+			width = measured;
+		}
+	}
+
+	const Vector4 &rightHand = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+	const Vector4 &leftHand = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+	features[0] = (rightHand.x - center.x) / width;
+	features[1] = (rightHand.y - center.y) / width;
+	features[2] = (rightHand.z - center.z) / width;
+	features[3] = (leftHand.x - center.x) / width;
+	features[4] = (leftHand.y - center.y) / width;
+	features[5] = (leftHand.z - center.z) / width;
+}
+
+void DtwResample(const FLOAT (*frames)[dtwFeatures], int numFrames, DtwSequence &sequence)
+{
+	for (int f = 0; f < dtwFeatures; f++)
+	{
+		FLOAT sum = 0;
+		for (int i = 0; i < dtwLength; i++)
+		{
+			FLOAT position = (FLOAT) i * (numFrames - 1) / (dtwLength - 1);
+			int before = (int) position;
+			if (before >= numFrames - 1)
+			{
+				before = numFrames - 2;
+			}
+			FLOAT fraction = position - before;
+			FLOAT value = frames[before][f] + fraction * (frames[before + 1][f] - frames[before][f]);
+			sequence.features[f][i] = value;
+			sum += value;
+		}
+		FLOAT mean = sum / dtwLength;
+		for (int i = 0; i < dtwLength; i++)
+		{
+			sequence.features[f][i] -= mean;
+		}
+	}
+}
+
+/*** Warping kernels ***/
+
+// Both kernels fill in the table a row at a time.  Row i, column j is the
+// cheapest way of lining up the first i steps of a with the first j of b,
+// and only columns within dtwBand of the diagonal are ever filled in.
+// Each row is stored one along, so [0] is the column before the first:
+// zero in the row before the first (so the path can start there) and
+// infinity everywhere else.
+
+static void BandLimits(int i, int &lo, int &hi)
+{
+	lo = (i > dtwBand) ? i - dtwBand : 0;
+	hi = (i + dtwBand < dtwLength - 1) ? i + dtwBand : dtwLength - 1;
+}
+
+DWORD DtwCellsPerComparison()
+{
+	DWORD cells = 0;
+	for (int i = 0; i < dtwLength; i++)
+	{
+		int lo, hi;
+		BandLimits(i, lo, hi);
+		cells += hi - lo + 1;
+	}
+	return cells;
+}
+
+FLOAT DtwDistanceScalar(const DtwSequence &a, const DtwSequence &b, FLOAT limit)
+{
+	FLOAT rows[2][dtwRowSize];
+	FLOAT* previous = rows[0];
+	FLOAT* current = rows[1];
+	for (int j = 0; j < dtwRowSize; j++)
+	{
+		previous[j] = dtwInfinity;
+	}
+	previous[0] = 0;
+	FLOAT giveUp = limit * dtwLength;
+
+	for (int i = 0; i < dtwLength; i++)
+	{
+		int lo, hi;
+		BandLimits(i, lo, hi);
+		for (int j = 0; j < dtwRowSize; j++)
+		{
+			current[j] = dtwInfinity;
+		}
+
+		FLOAT rowMin = dtwInfinity;
+		for (int j = lo; j <= hi; j++)
+		{
+			FLOAT cost = 0;
+			for (int f = 0; f < dtwFeatures; f++)
+			{
+				FLOAT d = a.features[f][i] - b.features[f][j];
+				cost += d * d;
+			}
+			FLOAT from = previous[j];
+			if (previous[j + 1] < from)
+			{
+				from = previous[j + 1];
+			}
+			if (current[j] < from)
+			{
+				from = current[j];
+			}
+			current[j + 1] = cost + from;
+			if (current[j + 1] < rowMin)
+			{
+				rowMin = current[j + 1];
+			}
+		}
+		// Every path to the end goes through this row
+		if (rowMin > giveUp)
+		{
+			return rowMin / dtwLength;
+		}
+
+		FLOAT* swap = previous;
+		previous = current;
+		current = swap;
+	}
+	return previous[dtwLength] / dtwLength;
+}
+
+// Same as the scalar one, except that the costs and the best of the two
+// cells above are worked out four columns at a time.  Only the run along
+// the row, which depends on the cell just before, is left one at a time.
+FLOAT DtwDistanceSSE(const DtwSequence &a, const DtwSequence &b, FLOAT limit)
+{
+	__declspec(align(16)) FLOAT rows[2][dtwRowSize];
+	__declspec(align(16)) FLOAT costs[dtwLength];
+	__declspec(align(16)) FLOAT fromAbove[dtwLength];
+	FLOAT* previous = rows[0];
+	FLOAT* current = rows[1];
+	const __m128 infinity = _mm_set1_ps(dtwInfinity);
+	for (int j = 0; j < dtwRowSize; j += 4)
+	{
+		_mm_store_ps(previous + j, infinity);
+	}
+	previous[0] = 0;
+	FLOAT giveUp = limit * dtwLength;
+
+	for (int i = 0; i < dtwLength; i++)
+	{
+		int lo, hi;
+		BandLimits(i, lo, hi);
+		for (int j = 0; j < dtwRowSize; j += 4)
+		{
+			_mm_store_ps(current + j, infinity);
+		}
+
+		__m128 step[dtwFeatures];
+		for (int f = 0; f < dtwFeatures; f++)
+		{
+			step[f] = _mm_set1_ps(a.features[f][i]);
+		}
+		// dtwLength is a multiple of 4, so whole registers never run off the end
+		for (int j = lo & ~3; j <= hi; j += 4)
+		{
+			__m128 cost = _mm_setzero_ps();
+			for (int f = 0; f < dtwFeatures; f++)
+			{
+				__m128 d = _mm_sub_ps(step[f], _mm_load_ps(&b.features[f][j]));
+				cost = _mm_add_ps(cost, _mm_mul_ps(d, d));
+			}
+			_mm_store_ps(costs + j, cost);
+			_mm_store_ps(fromAbove + j, _mm_min_ps(_mm_loadu_ps(previous + j), _mm_loadu_ps(previous + j + 1)));
+		}
+
+		FLOAT rowMin = dtwInfinity;
+		for (int j = lo; j <= hi; j++)
+		{
+			FLOAT from = (current[j] < fromAbove[j]) ? current[j] : fromAbove[j];
+			current[j + 1] = costs[j] + from;
+			if (current[j + 1] < rowMin)
+			{
+				rowMin = current[j + 1];
+			}
+		}
+		if (rowMin > giveUp)
+		{
+			return rowMin / dtwLength;
+		}
+
+		FLOAT* swap = previous;
+		previous = current;
+		current = swap;
+	}
+	return previous[dtwLength] / dtwLength;
+}
@@ -0,0 +1,172 @@
+/************************************************************************
+*                                                                       *
+*   DtwRecognizer.h -- Declaration of DtwRecognizer class               *
+*                                                                       *
+*   Recognizes gestures by how the hands move, not where they stop:     *
+*   swipes, waves and circles.  Every skeleton keeps the last couple    *
+*   of seconds of its hands, relative to its shoulders, and each frame  *
+*   that's compared against recorded templates with dynamic time        *
+*   warping, so a gesture done a bit faster or slower still matches.    *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "SkeletonView.h"
+
+// Right hand x, y, z, then left hand x, y, z
+const int dtwFeatures = 6;
+// Both a template and what it's compared against are resampled to this
+// many steps (a multiple of 4, for SSE)
+const int dtwLength = 32;
+// How far off the diagonal the warping can go, in steps
+const int dtwBand = 6;
+// Frames of history kept per skeleton
+const int dtwWindowFrames = 64;
+// The longest a template can take, in frames, leaving room for slower
+const int maxTemplateFrames = 48;
+const int maxDtwTemplates = 16;
+// Each template is also tried this much slower and faster
+const int dtwScales = 3;
+extern const FLOAT dtwScaleFactors[dtwScales];
+// Average squared distance per step, in shoulder widths, under which it's a
+// match.  A match is only taken once the distance stops getting smaller,
+// which is a frame after the gesture's best lined up.
+const FLOAT dtwMatchThreshold = 0.03f;
+// The hand has to travel at least this fraction of the template's path
+const FLOAT minTravelFraction = 0.6f;
+// Warping cells to spend per frame, across every skeleton and template:
+// enough for a full bank for everyone, which is about 100 us.  What
+// doesn't fit is picked up next frame.
+const DWORD dtwCellBudget = 120000;
+// Shoulder width to assume when the shoulders aren't both tracked, in meters
+const FLOAT defaultShoulderWidth = 0.35f;
+
+// What a template's match asks the gesture detectors to do; see the
+// GUARD_DYNAMIC rules in GestureTable.cpp
+enum DynamicGesture {
+	DYNAMIC_NONE,
+	DYNAMIC_SWIPE,
+	DYNAMIC_WAVE,
+	DYNAMIC_CIRCLE,
+};
+
+// dtwFeatures rows of dtwLength steps, mean removed
+struct __declspec(align(16)) DtwSequence
+{
+	FLOAT features[dtwFeatures][dtwLength];
+};
+
+struct DtwTemplate
+{
+	DtwSequence sequence;
+	char name[32];
+	// How long it took when it was recorded
+	int frames;
+	// Which hand does the moving (0 = right, 1 = left) and how far it goes
+	int hand;
+	FLOAT travel;
+	FLOAT threshold;
+	DynamicGesture gesture;
+};
+
+// One skeleton's recent history, newest at (next - 1)
+struct DtwWindow
+{
+	FLOAT frames[dtwWindowFrames][dtwFeatures];
+	int next;
+	int count;
+	DWORD trackingId;
+};
+
+struct DtwMatch
+{
+	int templateIndex;
+	FLOAT distance;
+	DWORD frameNumber;
+};
+
+class DtwRecognizer
+{
+public:
+	DtwRecognizer();
+	~DtwRecognizer(void);
+
+	// Adds a template from raw features (frames of dtwFeatures each, at 30
+	// frames a second).  Returns its index, or -1 if there's no room.
+	int addTemplate(const char* name, const FLOAT (*features)[dtwFeatures], int frames,
+		DynamicGesture gesture = DYNAMIC_NONE);
+	// Adds one template for each hand: the one given, and it mirrored
+	int addTemplatePair(const char* name, const FLOAT (*features)[dtwFeatures], int frames,
+		DynamicGesture gesture = DYNAMIC_NONE);
+	// A template from a SkeletonRecorder file: the first tracked skeleton
+	// in it, start to finish
+	int addRecordedTemplate(const char* name, const char* path, DynamicGesture gesture = DYNAMIC_NONE);
+	// Swipes left and right, a wave and a circle, with either hand
+	void addDefaultTemplates();
+	const char* templateName(int index);
+	// What a match of the template is for, and which hand does it (0 =
+	// right, 1 = left)
+	DynamicGesture templateGesture(int index);
+	int templateHand(int index);
+
+	// Adds the frame to every tracked skeleton's history, and matches as
+	// much as cellBudget allows.  Returns how many matches there were.
+	int recognize(const NUI_SKELETON_FRAME &SkeletonFrame);
+	// The newest match for a skeleton since the last call, if any
+	BOOL takeMatch(int skeleton, DtwMatch &match);
+	void reset();
+
+	// Settings, which start off as the constants above
+	BOOL useSSE;
+	DWORD cellBudget;
+
+	int numTemplates;
+	// What the last recognize() did
+	DWORD cellsLastFrame;
+	DWORD comparisonsLastFrame;
+	DWORD comparisonsDeferred;
+
+private:
+	// The best distance over every scale, or something over the template's
+	// threshold if it can't match
+	FLOAT matchOne(int skeleton, int templateIndex);
+	void startOver(int skeleton);
+
+	const DtwSequence &resampledWindow(int skeleton, int length);
+
+	// Both 16-byte aligned
+	DtwTemplate* templates;
+	// Indexed by length, and only good while resampledEpochs[length] is
+	// resampledEpoch
+	DtwSequence* resampled;
+	DWORD resampledEpochs[dtwWindowFrames + 1];
+	DWORD resampledEpoch;
+	int resampledSkeleton;
+	FLOAT resampledTravel[dtwWindowFrames + 1][2];
+	DtwWindow* windows;
+
+	DtwMatch matches[NUI_SKELETON_COUNT];
+	BOOL haveMatch[NUI_SKELETON_COUNT];
+	BOOL tracked[NUI_SKELETON_COUNT];
+	// Each comparison's distance the last time it was made
+	FLOAT lastDistances[NUI_SKELETON_COUNT][maxDtwTemplates];
+	// Where the round-robin over (skeleton, template) picks up next frame
+	int nextComparison;
+};
+
+// Body-relative features for one skeleton, in shoulder widths from the
+// center of the shoulders
+void DtwSkeletonFeatures(const SkeletonView &skeleton, FLOAT features[dtwFeatures]);
+// numFrames frames, oldest first, resampled to dtwLength steps with the
+// mean of each feature taken out
+void DtwResample(const FLOAT (*frames)[dtwFeatures], int numFrames, DtwSequence &sequence);
+
+// The warping kernels: the banded DTW distance between two sequences,
+// averaged per step.  Anything that's sure to end above limit gives up
+// early and returns a number over limit.
+FLOAT DtwDistanceScalar(const DtwSequence &a, const DtwSequence &b, FLOAT limit);
+FLOAT DtwDistanceSSE(const DtwSequence &a, const DtwSequence &b, FLOAT limit);
+// Cells either kernel looks at for one comparison
+DWORD DtwCellsPerComparison();
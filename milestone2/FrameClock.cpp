@@ -0,0 +1,93 @@
+#include "FrameClock.h"
+
+FrameClock frameClock;
+
+FrameClock::FrameClock()
+{
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	counterFrequency = frequency.QuadPart;
+	virtualTime = FALSE;
+	virtualNow = 0;
+	haveFrame = FALSE;
+	frameOffset = 0;
+	currentFrameTime = 0;
+}
+
+long long FrameClock::now()
+{
+	if (virtualTime)
+	{
+		return virtualNow;
+	}
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	// Split up so the multiply can't overflow after a long uptime
+	long long seconds = counter.QuadPart / counterFrequency;
+	long long remainder = counter.QuadPart % counterFrequency;
+	return seconds * frameClockTicksPerSecond + remainder * frameClockTicksPerSecond / counterFrequency;
+}
+
+long long FrameClock::frameTime()
+{
+	if (! haveFrame)
+	{
+		return now();
+	}
+	return currentFrameTime;
+}
+
+void FrameClock::newFrame(LARGE_INTEGER liTimeStamp)
+{
+	long long stamp = liTimeStamp.QuadPart * frameClockTicksPerMs;
+	long long mapped = stamp + frameOffset;
+
+	if (virtualTime)
+	{
+		// The recording is the only clock there is, so follow it across
+		// gaps; only start again if it goes backwards
+		if (! haveFrame || mapped < currentFrameTime)
+		{
+			frameOffset = virtualNow - stamp;
+			mapped = virtualNow;
+		}
+		virtualNow = mapped;
+	}
+	else
+	{
+		long long counterNow = now();
+		long long drift = mapped - counterNow;
+		if (! haveFrame || drift > maxFrameClockDrift || drift < -maxFrameClockDrift)
+		{
+			frameOffset = counterNow - stamp;
+			mapped = counterNow;
+		}
+	}
+
+	// Never go backwards
+	if (haveFrame && mapped < currentFrameTime)
+	{
+		mapped = currentFrameTime;
+	}
+	currentFrameTime = mapped;
+	haveFrame = TRUE;
+}
+
+void FrameClock::useVirtualTime()
+{
+	virtualNow = now();
+	virtualTime = TRUE;
+	haveFrame = FALSE;
+}
+
+void FrameClock::useRealTime()
+{
+	virtualTime = FALSE;
+	haveFrame = FALSE;
+}
+
+BOOL FrameClock::isVirtual()
+{
+	return virtualTime;
+}
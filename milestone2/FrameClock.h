@@ -0,0 +1,56 @@
+/************************************************************************
+*                                                                       *
+*   FrameClock.h -- Declaration of FrameClock class                     *
+*                                                                       *
+*   Where the gesture detectors and the movement handler get the time   *
+*   from.  It never jumps when the system clock is changed, gesture     *
+*   timing follows the sensor's own frame timestamps, and replays can   *
+*   swap in a virtual clock driven by the recorded frames.              *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+// Times are in 100 ns intervals, like the detectors' timeouts
+const long long frameClockTicksPerSecond = 10000000;
+const long long frameClockTicksPerMs = 10000;
+
+// If a frame timestamp wanders further than this from the counter (the
+// sensor was restarted, say), start mapping frames from scratch
+const long long maxFrameClockDrift = frameClockTicksPerSecond;
+
+class FrameClock
+{
+public:
+	FrameClock();
+
+	// Monotonic time, from QueryPerformanceCounter (or the virtual clock)
+	long long now();
+	// The time of the skeleton frame being processed, on the same timeline
+	// as now().  Until there's been a frame, just now().
+	long long frameTime();
+
+	// A new skeleton frame; liTimeStamp is the sensor's, in milliseconds.
+	// Only call from the thread that runs the gesture detectors.
+	void newFrame(LARGE_INTEGER liTimeStamp);
+
+	// Time only moves when frames arrive, so a replay gives the same
+	// results however fast it runs.  Single-threaded use only.
+	void useVirtualTime();
+	void useRealTime();
+	BOOL isVirtual();
+
+private:
+	LONGLONG counterFrequency;
+	BOOL virtualTime;
+	long long virtualNow;
+
+	BOOL haveFrame;
+	// Added to a frame timestamp to put it on now()'s timeline
+	long long frameOffset;
+	long long currentFrameTime;
+};
+
+// The one everything uses
+extern FrameClock frameClock;
@@ -0,0 +1,106 @@
+#include "FramePacer.h"
+#include <math.h>
+
+/*** Jitter ***/
+
+FrameJitter::FrameJitter()
+{
+	reset();
+}
+
+void FrameJitter::reset()
+{
+	intervals = 0;
+	ZeroMemory(histogram, sizeof(histogram));
+	worstMs = 0.0;
+}
+
+void FrameJitter::record(double intervalMs, double periodMs)
+{
+	double error = fabs(intervalMs - periodMs);
+	int bin = (int) (error / jitterBinMs);
+	histogram[(bin < jitterHistogramBins) ? bin : jitterHistogramBins - 1]++;
+	intervals++;
+	worstMs = (error > worstMs) ? error : worstMs;
+}
+
+double FrameJitter::percentile(double p)
+{
+	if (intervals == 0)
+	{
+		return 0.0;
+	}
+	LONG wanted = (LONG) ceil(p * intervals);
+	LONG counted = 0;
+	for (int bin = 0; bin < jitterHistogramBins - 1; bin++)
+	{
+		counted += histogram[bin];
+		if (counted >= wanted)
+		{
+			return (bin + 1) * jitterBinMs;
+		}
+	}
+	// Off the end of the histogram
+	return worstMs;
+}
+
+/*** Pacing ***/
+
+FramePacer::FramePacer()
+{
+	start(defaultFramePeriodMs, 0.0);
+}
+
+void FramePacer::start(double periodMs, double nowMs)
+{
+	period = periodMs;
+	deadline = nowMs;
+	lastTick = nowMs;
+	ticks = 0;
+	missed = 0;
+	lead = 0.0;
+	jitter.reset();
+}
+
+double FramePacer::untilDue(double nowMs)
+{
+	return deadline - lead - nowMs;
+}
+
+LONGLONG FramePacer::waitFor(double nowMs)
+{
+	double until = untilDue(nowMs);
+	return (until > 0.0) ? (LONGLONG) ceil(until * frameClockTicksPerMs) : 0;
+}
+
+DWORD FramePacer::sleepFor(double nowMs)
+{
+	double until = untilDue(nowMs);
+	return (until > 0.0) ? (DWORD) ceil(until) : 0;
+}
+
+void FramePacer::tick(double nowMs)
+{
+	if (ticks > 0)
+	{
+		jitter.record(nowMs - lastTick, period);
+	}
+	ticks++;
+	lastTick = nowMs;
+
+	// Wake earlier the later it's been, and later the earlier
+	double late = nowMs - deadline;
+	lead += pacerLeadGain * late;
+	lead = (lead < 0.0) ? 0.0 : lead;
+	lead = (lead > maxPacerLead * period) ? maxPacerLead * period : lead;
+
+	// Deadlines slipped past stay missed rather than being caught up on;
+	// the next is still on the grid
+	if (late >= period)
+	{
+		LONG behind = (LONG) floor(late / period);
+		missed += behind;
+		deadline += behind * period;
+	}
+	deadline += period;
+}
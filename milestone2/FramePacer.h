@@ -0,0 +1,81 @@
+/************************************************************************
+*                                                                       *
+*   FramePacer.h -- Declaration of FramePacer class                     *
+*                                                                       *
+*   When the magnifier's next update is due.  A 16 ms SetTimer() fires  *
+*   whenever the system timer next ticks after that, and drifts         *
+*   against the display, so some frames get two updates and some none. *
+*   The pacer keeps its deadlines on a grid of display periods instead, *
+*   brings them forward by however late it's been waking up, and keeps  *
+*   track of how far each interval was from the period and how many     *
+*   deadlines went by without an update.  It only does arithmetic on    *
+*   times it's given, so a simulated clock can drive it anywhere.       *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "FrameClock.h"
+
+// The period when the display won't say what it is
+const double defaultFramePeriodMs = 1000.0 / 60;
+// How far lead can go, as a fraction of the period, and how much of the
+// lateness it follows each tick
+const double maxPacerLead = 0.25;
+const double pacerLeadGain = 0.125;
+
+// Interval errors are counted in bins this wide; the last bin has
+// everything beyond
+const int jitterHistogramBins = 1024;
+const double jitterBinMs = 0.05;
+
+// How far between ticks was from the period they should have been apart
+class FrameJitter
+{
+public:
+	FrameJitter();
+
+	void reset();
+	void record(double intervalMs, double periodMs);
+
+	// The error that a fraction p (0 to 1) of the intervals were within, to
+	// the nearest bin, rounded up
+	double percentile(double p);
+
+	LONG intervals;
+	LONG histogram[jitterHistogramBins];
+	double worstMs;
+};
+
+class FramePacer
+{
+public:
+	FramePacer();
+
+	// Ticks every periodMs from now on, the first one now
+	void start(double periodMs, double nowMs);
+
+	// How long until the next tick is due; zero or less means now
+	double untilDue(double nowMs);
+	// How long to wait before the next tick, in frameClock ticks the way a
+	// waitable timer takes it, and in whole milliseconds for a plain sleep.
+	// Both are rounded up, so they're never nothing while a tick isn't due;
+	// waking late is made up for by lead.
+	LONGLONG waitFor(double nowMs);
+	DWORD sleepFor(double nowMs);
+	// A tick is being done at nowMs
+	void tick(double nowMs);
+
+	double period;
+	// Ticks done, and deadlines that passed without one
+	LONG ticks;
+	LONG missed;
+	FrameJitter jitter;
+	// How far ahead of a deadline it says a tick's due, to make up for
+	// waking late
+	double lead;
+
+private:
+	double deadline;
+	double lastTick;
+};
@@ -0,0 +1,76 @@
+#include "FrameTripleBuffer.h"
+
+FrameTripleBuffer::FrameTripleBuffer(DWORD frameBytes)
+{
+	this->frameBytes = frameBytes;
+	for (int i = 0; i < 3; i++)
+	{
+		buffers[i] = (BYTE*) _aligned_malloc(frameBytes, 16);
+		if (buffers[i] != NULL)
+		{
+			ZeroMemory(buffers[i], frameBytes);
+		}
+	}
+	back = 0;
+	middle = 1;
+	front = 2;
+	haveFront = FALSE;
+	framesPublished = 0;
+	framesDropped = 0;
+	framesPresented = 0;
+}
+
+FrameTripleBuffer::~FrameTripleBuffer(void)
+{
+	for (int i = 0; i < 3; i++)
+	{
+		_aligned_free(buffers[i]);
+	}
+}
+
+BYTE* FrameTripleBuffer::writeBuffer()
+{
+	return buffers[back];
+}
+
+BOOL FrameTripleBuffer::publish()
+{
+	// The interlocked exchange is a full barrier, so the frame's contents
+	// are visible before the consumer can see the fresh bit
+	LONG old = InterlockedExchange(&middle, back | freshBit);
+	back = old & bufferIndexMask;
+	InterlockedIncrement(&framesPublished);
+
+	if (old & freshBit)
+	{
+		InterlockedIncrement(&framesDropped);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+BOOL FrameTripleBuffer::acquire()
+{
+	if (! (middle & freshBit))
+	{
+		return FALSE;
+	}
+	LONG old = InterlockedExchange(&middle, front);
+	front = old & bufferIndexMask;
+	haveFront = TRUE;
+	return TRUE;
+}
+
+BYTE* FrameTripleBuffer::readBuffer()
+{
+	if (! haveFront)
+	{
+		return NULL;
+	}
+	return buffers[front];
+}
+
+void FrameTripleBuffer::presented()
+{
+	InterlockedIncrement(&framesPresented);
+}
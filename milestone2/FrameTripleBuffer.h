@@ -0,0 +1,56 @@
+/************************************************************************
+*                                                                       *
+*   FrameTripleBuffer.h -- Declaration of FrameTripleBuffer class       *
+*                                                                       *
+*   Hands finished frames from the sensor thread to the GUI thread      *
+*   without either one waiting on the other.  The producer always has   *
+*   a buffer of its own to fill, the consumer always draws a complete   *
+*   frame, and a frame nobody picked up in time is simply replaced.     *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+class FrameTripleBuffer
+{
+public:
+	FrameTripleBuffer(DWORD frameBytes);
+	~FrameTripleBuffer(void);
+
+	/* Producer side (sensor thread) */
+	// Where to put the next frame
+	BYTE* writeBuffer();
+	// Hand over the frame just written.  Returns TRUE if this replaced one
+	// that was never read.
+	BOOL publish();
+
+	/* Consumer side (GUI thread) */
+	// Swaps in the newest published frame, if there's one we haven't seen.
+	// Returns FALSE if nothing new has been published since last time.
+	BOOL acquire();
+	// The frame acquire() last swapped in (NULL if there's never been one)
+	BYTE* readBuffer();
+	// Count one frame as actually drawn
+	void presented();
+
+	DWORD frameBytes;
+
+	// Statistics, only ever incremented
+	volatile LONG framesPublished;
+	volatile LONG framesDropped;
+	volatile LONG framesPresented;
+
+private:
+	BYTE* buffers[3];
+	// Only the producer touches back, only the consumer touches front
+	LONG back;
+	LONG front;
+	BOOL haveFront;
+	// The buffer in between, with freshBit set if it holds a frame the
+	// consumer hasn't taken yet.  Only ever changed with InterlockedExchange.
+	volatile LONG middle;
+};
+
+const LONG freshBit = 4;
+const LONG bufferIndexMask = 3;
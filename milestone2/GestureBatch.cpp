@@ -0,0 +1,276 @@
+#include "GestureBatch.h"
+#include "GestureDSL.h"
+#include <emmintrin.h>
+#include <malloc.h>
+#include <cmath>
+
+// The rows every batch has
+const int rightHandRow = 0;
+const int leftHandRow = 1;
+
+GestureBatch::GestureBatch(const GestureTable &table)
+	: table(table)
+{
+	joints = (BatchJoints*) _aligned_malloc(sizeof(BatchJoints), 16);
+	ZeroMemory(joints, sizeof(BatchJoints));
+
+	for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+	{
+		rows[j] = -1;
+	}
+	static const int fixedJoints[] = {
+		NUI_SKELETON_POSITION_HAND_RIGHT,
+		NUI_SKELETON_POSITION_HAND_LEFT,
+	};
+	numRows = 0;
+	for (int r = 0; r < sizeof(fixedJoints) / sizeof(fixedJoints[0]); r++)
+	{
+		rows[fixedJoints[r]] = numRows;
+		rowJoints[numRows++] = fixedJoints[r];
+	}
+	for (int g = 0; g < table.numGuards; g++)
+	{
+		int joint = table.guardPoints[g]->joint;
+		if (rows[joint] == -1)
+		{
+			rows[joint] = numRows;
+			rowJoints[numRows++] = joint;
+		}
+	}
+
+	// Every x64 processor has SSE2, but check on 32-bit
+	useSSE = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	count = 0;
+	stopMask = 0;
+	cancelMask = 0;
+	clickMask = 0;
+	ZeroMemory(nearMasks, sizeof(nearMasks));
+	ZeroMemory(centerMasks, sizeof(centerMasks));
+	ZeroMemory(aboveMasks, sizeof(aboveMasks));
+	ZeroMemory(aboveAntiMasks, sizeof(aboveAntiMasks));
+}
+
+GestureBatch::~GestureBatch(void)
+{
+	_aligned_free(joints);
+}
+
+void GestureBatch::evaluate(const NUI_SKELETON_FRAME &SkeletonFrame, GestureDetector** detectors)
+{
+	// Untracked slots are worked out too; nothing reads them
+	C_ASSERT(NUI_SKELETON_COUNT == 6);
+	const SkeletonView skeletons[NUI_SKELETON_COUNT] = {
+		SkeletonView(SkeletonFrame, 0), SkeletonView(SkeletonFrame, 1), SkeletonView(SkeletonFrame, 2),
+		SkeletonView(SkeletonFrame, 3), SkeletonView(SkeletonFrame, 4), SkeletonView(SkeletonFrame, 5),
+	};
+	Direction hands[NUI_SKELETON_COUNT];
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		hands[i] = detectors[i]->hand;
+	}
+	evaluate(skeletons, hands, NUI_SKELETON_COUNT);
+}
+
+void GestureBatch::evaluate(const SkeletonView* skeletons, const Direction* hands, int numSkeletons)
+{
+	if (numSkeletons > maxBatchSkeletons)
+	{
+		numSkeletons = maxBatchSkeletons;
+	}
+	gather(skeletons, hands, numSkeletons);
+
+	// The gestures that work in any state come straight from their
+	// definitions in GestureDSL.h, so there's only the one of each.  None
+	// of them is held, so the time doesn't matter.
+	StopGesture stopGesture;
+	EitherHand<CancelGesture> cancelGesture;
+	ClickGesture clickGesture;
+	stopMask = 0;
+	cancelMask = 0;
+	clickMask = 0;
+	for (int i = 0; i < numSkeletons; i++)
+	{
+		DWORD bit = 1u << i;
+		stopMask |= stopGesture.test(skeletons[i], 0) ? bit : 0;
+		cancelMask |= cancelGesture.test(hands[i], skeletons[i], 0) ? bit : 0;
+		clickMask |= clickGesture.test(skeletons[i], 0) ? bit : 0;
+	}
+	ZeroMemory(nearMasks, sizeof(nearMasks));
+	ZeroMemory(centerMasks, sizeof(centerMasks));
+	ZeroMemory(aboveMasks, sizeof(aboveMasks));
+	ZeroMemory(aboveAntiMasks, sizeof(aboveAntiMasks));
+	if (useSSE)
+	{
+		evaluateSSE();
+	}
+	else
+	{
+		evaluateScalar();
+	}
+}
+
+// Turns the skeletons sideways: one array per joint and axis
+void GestureBatch::gather(const SkeletonView* skeletons, const Direction* hands, int numSkeletons)
+{
+	count = numSkeletons;
+	for (int i = 0; i < numSkeletons; i++)
+	{
+		for (int r = 0; r < numRows; r++)
+		{
+			const Vector4 &joint = skeletons[i].joint(rowJoints[r]);
+			joints->x[r][i] = joint.x;
+			joints->y[r][i] = joint.y;
+		}
+		joints->rightHand[i] = (hands[i] == RIGHT) ? 0xFFFFFFFF : 0;
+	}
+}
+
+void GestureBatch::evaluateScalar()
+{
+	const BatchJoints &j = *joints;
+	for (int i = 0; i < count; i++)
+	{
+		DWORD bit = 1u << i;
+		BOOL right = (j.rightHand[i] != 0);
+		FLOAT rightX = j.x[rightHandRow][i], rightY = j.y[rightHandRow][i];
+		FLOAT leftX = j.x[leftHandRow][i], leftY = j.y[leftHandRow][i];
+
+		for (int g = 0; g < table.numGuards; g++)
+		{
+			const GesturePoint &point = *table.guardPoints[g];
+			RuleHand hand = table.guardHands[g];
+			BOOL rightSide = (hand == ACTIVE_HAND) ? right : (hand == RIGHT_HAND);
+			int row = rows[point.joint];
+
+			// The same sums, in the same order, as GestureTable::run()
+			FLOAT targetX = j.x[row][i];
+			FLOAT targetY = j.y[row][i];
+			targetX += rightSide ? point.rightX : point.leftX;
+			targetY += point.y;
+			targetX += point.extraX;
+			targetY += point.extraY;
+			FLOAT handX = rightSide ? rightX : leftX;
+			FLOAT handY = rightSide ? rightY : leftY;
+
+			if ((fabs(targetX - handX) < detectRange) && (fabs(targetY - handY) < detectRange))
+			{
+				nearMasks[g] |= bit;
+			}
+			if ((fabs(targetX - handX) < centerBoxSize) && (fabs(targetY - handY) < centerBoxSize))
+			{
+				centerMasks[g] |= bit;
+			}
+			FLOAT x = handX - targetX;
+			FLOAT y = handY - targetY;
+			if (y > x)
+			{
+				aboveMasks[g] |= bit;
+			}
+			if (y > -x)
+			{
+				aboveAntiMasks[g] |= bit;
+			}
+		}
+	}
+}
+
+// a where mask is set, b where it isn't
+static inline __m128 Select(__m128 mask, __m128 a, __m128 b)
+{
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static inline __m128 Within(__m128 a, __m128 b, __m128 range, __m128 absMask)
+{
+	return _mm_cmplt_ps(_mm_and_ps(_mm_sub_ps(a, b), absMask), range);
+}
+
+void GestureBatch::evaluateSSE()
+{
+	const BatchJoints &j = *joints;
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+	const __m128 range = _mm_set1_ps(detectRange);
+	const __m128 box = _mm_set1_ps(centerBoxSize);
+
+	// Past count is whatever was there before, and gets masked off below
+	for (int base = 0; base < count; base += 4)
+	{
+		__m128 right = _mm_load_ps((const float*) &j.rightHand[base]);
+		__m128 rightX = _mm_load_ps(&j.x[rightHandRow][base]);
+		__m128 rightY = _mm_load_ps(&j.y[rightHandRow][base]);
+		__m128 leftX = _mm_load_ps(&j.x[leftHandRow][base]);
+		__m128 leftY = _mm_load_ps(&j.y[leftHandRow][base]);
+
+		for (int g = 0; g < table.numGuards; g++)
+		{
+			const GesturePoint &point = *table.guardPoints[g];
+			RuleHand hand = table.guardHands[g];
+			int row = rows[point.joint];
+
+			__m128 side = (hand == ACTIVE_HAND) ? right
+				: (hand == RIGHT_HAND) ? _mm_castsi128_ps(_mm_set1_epi32(-1)) : _mm_setzero_ps();
+			__m128 targetX = _mm_load_ps(&j.x[row][base]);
+			__m128 targetY = _mm_load_ps(&j.y[row][base]);
+			targetX = _mm_add_ps(targetX, Select(side, _mm_set1_ps(point.rightX), _mm_set1_ps(point.leftX)));
+			targetY = _mm_add_ps(targetY, _mm_set1_ps(point.y));
+			targetX = _mm_add_ps(targetX, _mm_set1_ps(point.extraX));
+			targetY = _mm_add_ps(targetY, _mm_set1_ps(point.extraY));
+			__m128 handX = Select(side, rightX, leftX);
+			__m128 handY = Select(side, rightY, leftY);
+
+			nearMasks[g] |= _mm_movemask_ps(_mm_and_ps(Within(targetX, handX, range, absMask),
+				Within(targetY, handY, range, absMask))) << base;
+			centerMasks[g] |= _mm_movemask_ps(_mm_and_ps(Within(targetX, handX, box, absMask),
+				Within(targetY, handY, box, absMask))) << base;
+			__m128 x = _mm_sub_ps(handX, targetX);
+			__m128 y = _mm_sub_ps(handY, targetY);
+			aboveMasks[g] |= _mm_movemask_ps(_mm_cmpgt_ps(y, x)) << base;
+			aboveAntiMasks[g] |= _mm_movemask_ps(_mm_cmpgt_ps(y, _mm_xor_ps(x, signMask))) << base;
+		}
+	}
+
+	DWORD valid = (count >= 32) ? 0xFFFFFFFF : ((1u << count) - 1);
+	for (int g = 0; g < table.numGuards; g++)
+	{
+		nearMasks[g] &= valid;
+		centerMasks[g] &= valid;
+		aboveMasks[g] &= valid;
+		aboveAntiMasks[g] &= valid;
+	}
+}
+
+BOOL GestureBatch::stop(int skeleton) const
+{
+	return (stopMask >> skeleton) & 1;
+}
+
+BOOL GestureBatch::cancel(int skeleton) const
+{
+	return (cancelMask >> skeleton) & 1;
+}
+
+BOOL GestureBatch::click(int skeleton) const
+{
+	return (clickMask >> skeleton) & 1;
+}
+
+BOOL GestureBatch::isNear(int skeleton, int guard) const
+{
+	return (nearMasks[guard] >> skeleton) & 1;
+}
+
+// Put back together the way findQuadrant() decides
+Quadrant GestureBatch::quadrant(int skeleton, int guard) const
+{
+	if ((centerMasks[guard] >> skeleton) & 1)
+	{
+		return Q_CENTER;
+	}
+	BOOL aboveAnti = (aboveAntiMasks[guard] >> skeleton) & 1;
+	if ((aboveMasks[guard] >> skeleton) & 1)
+	{
+		return aboveAnti ? Q_TOP : Q_LEFT;
+	}
+	return aboveAnti ? Q_RIGHT : Q_BOTTOM;
+}
@@ -0,0 +1,86 @@
+/************************************************************************
+*                                                                       *
+*   GestureBatch.h -- Declaration of GestureBatch class                 *
+*                                                                       *
+*   Works out what every detector is going to ask about its skeleton,   *
+*   for every skeleton at once, before any of them runs: the stop,      *
+*   cancel and click gestures, and whether the hand is near each point  *
+*   the rule table checks or which part of the movement box it's in.    *
+*   The gestures are GestureDSL.h's own; the table's points are         *
+*   gathered one array per axis, so SSE does four skeletons at a time   *
+*   however many there are.                                             *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "GestureDetector.h"
+#include "GestureTable.h"
+#include "SkeletonView.h"
+
+// Skeletons one batch can hold, a multiple of 4: every slot of a few
+// sensors.  Results are kept as one bit per skeleton.
+const int maxBatchSkeletons = 32;
+// Joints the batch gathers: the hands, plus whatever else the rule
+// table's points are on, which is never more than all of them
+const int maxBatchRows = NUI_SKELETON_POSITION_COUNT;
+
+// One row per joint gathered, one column per skeleton
+struct __declspec(align(16)) BatchJoints
+{
+	FLOAT x[maxBatchRows][maxBatchSkeletons];
+	FLOAT y[maxBatchRows][maxBatchSkeletons];
+	// All ones where the skeleton's detector is watching the right hand
+	DWORD rightHand[maxBatchSkeletons];
+};
+
+class GestureBatch
+{
+public:
+	GestureBatch(const GestureTable &table);
+	~GestureBatch(void);
+
+	// Works out everything for count skeletons; hands[i] is the hand the
+	// detector for skeletons[i] is watching
+	void evaluate(const SkeletonView* skeletons, const Direction* hands, int count);
+	// Every slot of a frame, with each detector's hand
+	void evaluate(const NUI_SKELETON_FRAME &SkeletonFrame, GestureDetector** detectors);
+
+	// What GestureDSL.h's StopGesture, CancelGesture and ClickGesture said
+	BOOL stop(int skeleton) const;
+	BOOL cancel(int skeleton) const;
+	BOOL click(int skeleton) const;
+	// Guards are numbered as in the table
+	BOOL isNear(int skeleton, int guard) const;
+	Quadrant quadrant(int skeleton, int guard) const;
+
+	// Which kernel to use; defaults to the fastest this processor can run
+	BOOL useSSE;
+	int count;
+
+private:
+	void gather(const SkeletonView* skeletons, const Direction* hands, int count);
+	void evaluateScalar();
+	void evaluateSSE();
+
+	const GestureTable &table;
+	// Which row each joint is gathered into, or -1
+	int rows[NUI_SKELETON_POSITION_COUNT];
+	int rowJoints[maxBatchRows];
+	int numRows;
+
+	// 16-byte aligned
+	BatchJoints* joints;
+
+	// One bit per skeleton
+	DWORD stopMask;
+	DWORD cancelMask;
+	DWORD clickMask;
+	DWORD nearMasks[maxTableGuards];
+	// findQuadrant(), taken apart: in the center box, above the diagonal
+	// that goes up to the right, and above the one that goes up to the left
+	DWORD centerMasks[maxTableGuards];
+	DWORD aboveMasks[maxTableGuards];
+	DWORD aboveAntiMasks[maxTableGuards];
+};
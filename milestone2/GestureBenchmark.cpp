@@ -0,0 +1,905 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "GestureDetector.h"
+#include "GestureEventRing.h"
+#include "GestureTable.h"
+#include "GestureDSL.h"
+#include "GestureBatch.h"
+#include "JointHistory.h"
+#include "OverlayScene.h"
+#include "FrameClock.h"
+#include "Magnifier.h"
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern int activeSkeleton;
+extern GestureDetector* gestureDetectors[NUI_SKELETON_COUNT];
+extern FLOAT moveAmount_x;
+extern FLOAT moveAmount_y;
+extern float magnifyAmount;
+extern float magnificationFloor;
+extern BOOL showOverlays;
+extern BOOL headlessMagnifierHidden;
+extern BOOL allowMagnifyGestures;
+extern BOOL hideWindowOn;
+
+/*** Scenarios ***/
+
+struct Scenario
+{
+	const char* name;
+	// The detector is put back into this state at the start of every cycle
+	GestureStateEnum startState;
+	const HandPose* poses;
+	int numPoses;
+};
+
+static const HandPose idlePoses[] = {
+	{ HANDS_AT_REST, 1 },
+};
+// Hand to the head, then up and away
+static const HandPose salutePoses[] = {
+	{ 0.05f, headY, bodyZ, -0.25f, -0.2f, bodyZ, 1 },
+	{ saluteOver, headY + saluteUp, bodyZ, -0.25f, -0.2f, bodyZ, 1 },
+	{ HANDS_AT_REST, 2 },
+};
+// Hovering over the movement lock-on box (never long enough to finish)
+static const HandPose lockonPoses[] = {
+	{ centerRightOver, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 30 },
+};
+static const HandPose moveUpPoses[] = {
+	{ centerRightOver, spineY + 0.3f, bodyZ, -0.25f, -0.2f, bodyZ, 1 },
+};
+static const HandPose moveDownPoses[] = {
+	{ centerRightOver, spineY - 0.3f, bodyZ, -0.25f, -0.2f, bodyZ, 1 },
+};
+static const HandPose moveLeftPoses[] = {
+	{ centerRightOver - 0.3f, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 1 },
+};
+static const HandPose moveRightPoses[] = {
+	{ centerRightOver + 0.3f, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 1 },
+};
+// Push the hand out past clickDistance and back
+static const HandPose clickPoses[] = {
+	{ centerRightOver, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 10 },
+	{ centerRightOver, spineY, bodyZ - clickDistance - 0.1f, -0.25f, -0.2f, bodyZ, 10 },
+};
+// Both hands on the head
+static const HandPose stopPoses[] = {
+	{ 0.05f, headY, bodyZ, -0.05f, headY, bodyZ, 5 },
+	{ HANDS_AT_REST, 5 },
+};
+
+#define SCENARIO(name, state, poses) { name, state, poses, sizeof(poses) / sizeof(poses[0]) }
+static const Scenario scenarios[] = {
+	SCENARIO("idle", OFF, idlePoses),
+	SCENARIO("salute", OFF, salutePoses),
+	SCENARIO("lock-on", SALUTE2, lockonPoses),
+	SCENARIO("move up", MOVECENTER, moveUpPoses),
+	SCENARIO("move down", MOVECENTER, moveDownPoses),
+	SCENARIO("move left", MOVECENTER, moveLeftPoses),
+	SCENARIO("move right", MOVECENTER, moveRightPoses),
+	SCENARIO("click", MOVECENTER, clickPoses),
+	SCENARIO("stop", MOVECENTER, stopPoses),
+};
+
+// Put everything back how a scenario expects to find it
+static void ResetScenario(const Scenario &scenario)
+{
+	activeSkeleton = 0;
+	moveAmount_x = 0;
+	moveAmount_y = 0;
+	magnifyAmount = 0;
+	magnificationFloor = 0;
+	headlessMagnifierHidden = FALSE;
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		GestureDetector* detector = gestureDetectors[i];
+		detector->state->set((i == 0) ? scenario.startState : OFF);
+		detector->hand = RIGHT;
+		detector->lockingOn_move = FALSE;
+		detector->lockingOn_magnify = FALSE;
+		detector->startTime = detector->getTimeIn100NSIntervals();
+	}
+}
+
+static void RunScenario(FILE* results, const Scenario &scenario, BOOL useSwitch, BenchmarkTimer &timer)
+{
+	// Building frames isn't part of what we're timing, so do it up front
+	int cycleLength = 0;
+	for (int p = 0; p < scenario.numPoses; p++)
+	{
+		cycleLength += scenario.poses[p].frames;
+	}
+	NUI_SKELETON_FRAME* cycle = new NUI_SKELETON_FRAME[cycleLength];
+	int f = 0;
+	for (int p = 0; p < scenario.numPoses; p++)
+	{
+		for (int r = 0; r < scenario.poses[p].frames; r++, f++)
+		{
+			ZeroMemory(&cycle[f], sizeof(NUI_SKELETON_FRAME));
+			MakeFrame(cycle[f], scenario.poses[p], f);
+		}
+	}
+
+	ResetScenario(scenario);
+	JointHistory history;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		int c = frame % cycleLength;
+		if (c == 0 && frame != 0)
+		{
+			ResetScenario(scenario);
+		}
+		NUI_SKELETON_FRAME* SkeletonFrame = &cycle[c];
+		history.add(*SkeletonFrame, (long long) frame * 10000000 / 30);
+
+		timer.start();
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			if (useSwitch)
+			{
+				DetectWithSwitch(*gestureDetectors[i], *SkeletonFrame, history);
+			}
+			else
+			{
+				gestureDetectors[i]->detect(*SkeletonFrame, history);
+			}
+		}
+		timer.stop();
+	}
+	char name[64];
+	sprintf_s(name, sizeof(name), "%s, %s", scenario.name, useSwitch ? "switch" : "table");
+	timer.report(results, name);
+
+	delete [] cycle;
+}
+
+/*** Gesture engines ***/
+
+// The whole flow, start to finish: salute, lock on to moving and go every
+// way, click, cancel, do it all again left-handed, then lock on to
+// magnifying, turn the dial both ways, and stop
+static const HandPose flowPoses[] = {
+	{ HANDS_AT_REST, 5 },
+	{ 0.05f, headY, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ saluteOver, headY + saluteUp, bodyZ, -0.25f, -0.2f, bodyZ, 2 },
+	{ centerRightOver, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 70 },
+	{ centerRightOver, spineY + 0.3f, bodyZ, -0.25f, -0.2f, bodyZ, 5 },
+	{ centerRightOver, spineY - 0.3f, bodyZ, -0.25f, -0.2f, bodyZ, 5 },
+	{ centerRightOver - 0.3f, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 5 },
+	{ centerRightOver + 0.3f, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 5 },
+	{ centerRightOver, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 5 },
+	{ centerRightOver, spineY, bodyZ - clickDistance - 0.1f, -0.25f, -0.2f, bodyZ, 5 },
+	{ centerRightOver, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ 0.05f, headY, bodyZ, -0.25f, -0.2f, bodyZ, 1 },
+	{ HANDS_AT_REST, 5 },
+	{ 0.25f, -0.2f, bodyZ, -0.05f, headY, bodyZ, 3 },
+	{ 0.25f, -0.2f, bodyZ, -saluteOver, headY + saluteUp, bodyZ, 2 },
+	{ 0.25f, -0.2f, bodyZ, -centerLeftOver, spineY, bodyZ, 70 },
+	{ 0.25f, -0.2f, bodyZ, -centerLeftOver - 0.3f, spineY, bodyZ, 5 },
+	{ 0.25f, -0.2f, bodyZ, -centerLeftOver, spineY + 0.3f, bodyZ, 5 },
+	{ 0.25f, -0.2f, bodyZ, -centerLeftOver, spineY, bodyZ, 5 },
+	{ 0.25f, -0.2f, bodyZ, -0.05f, headY, bodyZ, 1 },
+	{ HANDS_AT_REST, 5 },
+	{ 0.05f, headY, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ saluteOver, headY + saluteUp, bodyZ, -0.25f, -0.2f, bodyZ, 2 },
+	{ 0.02f, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 70 },
+	{ centerRightOver, spineY + directionRadius, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ centerRightOver + directionRadius, spineY + 0.02f, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ centerRightOver - 0.03f, spineY - directionRadius, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ centerRightOver - directionRadius, spineY, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ centerRightOver + 0.05f, spineY - directionRadius, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ centerRightOver + directionRadius, spineY - 0.05f, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ centerRightOver, spineY + directionRadius, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ centerRightOver - directionRadius, spineY + 0.04f, bodyZ, -0.25f, -0.2f, bodyZ, 3 },
+	{ 0.05f, headY, bodyZ, -0.05f, headY, bodyZ, 5 },
+	{ HANDS_AT_REST, 5 },
+};
+
+// Everything the state machine can change, after one frame
+struct GestureTrace
+{
+	int activeSkeleton;
+	FLOAT moveAmount_x;
+	FLOAT moveAmount_y;
+	float magnifyAmount;
+	GestureStateEnum states[NUI_SKELETON_COUNT];
+	Direction hands[NUI_SKELETON_COUNT];
+	BOOL lockingOn[NUI_SKELETON_COUNT][2];
+	// Relative to the first frame, since the virtual clock starts wherever
+	long long startTimes[NUI_SKELETON_COUNT];
+	long long lockonStartTimes[NUI_SKELETON_COUNT];
+	// What the overlay was left showing
+	BOOL overlayVisible;
+	int numPrimitives;
+	OverlayPrimitive primitives[maxOverlayPrimitives];
+};
+
+// Plays the flow through every detector, with the switch or the table, on
+// the frame clock, writing what happened after each frame into traces.
+// With a batch, everything's worked out for all the detectors up front.
+static void TraceFlow(BOOL useSwitch, BOOL allowMagnify, GestureTrace* traces, int numFrames,
+					  GestureBatch* batch)
+{
+	allowMagnifyGestures = allowMagnify;
+	hideWindowOn = FALSE;
+	frameClock.useVirtualTime();
+	// The overlays are part of what the switch did too
+	BOOL savedShowOverlays = showOverlays;
+	showOverlays = TRUE;
+	overlayScene.hide();
+	overlayScene.commit();
+
+	NUI_SKELETON_FRAME SkeletonFrame;
+	JointHistory history;
+	int pose = 0;
+	int poseFrame = 0;
+	long long firstFrameTime = 0;
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		ZeroMemory(&SkeletonFrame, sizeof(SkeletonFrame));
+		MakeFrame(SkeletonFrame, flowPoses[pose], frame);
+		if (++poseFrame == flowPoses[pose].frames)
+		{
+			pose++;
+			poseFrame = 0;
+		}
+		frameClock.newFrame(SkeletonFrame.liTimeStamp);
+
+		if (frame == 0)
+		{
+			// Start from the same place every time
+			firstFrameTime = frameClock.frameTime();
+			ResetScenario(scenarios[0]);
+			for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+			{
+				gestureDetectors[i]->lockonStartTime = gestureDetectors[i]->startTime;
+			}
+		}
+
+		history.add(SkeletonFrame, frameClock.frameTime());
+		if (batch != NULL)
+		{
+			batch->evaluate(SkeletonFrame, gestureDetectors);
+		}
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			if (useSwitch)
+			{
+				DetectWithSwitch(*gestureDetectors[i], SkeletonFrame, history);
+			}
+			else
+			{
+				gestureDetectors[i]->detect(SkeletonFrame, history, batch);
+			}
+		}
+
+		overlayScene.commit();
+
+		GestureTrace &trace = traces[frame];
+		ZeroMemory(&trace, sizeof(trace));
+		trace.numPrimitives = overlayScene.published(trace.primitives, trace.overlayVisible);
+		trace.activeSkeleton = activeSkeleton;
+		trace.moveAmount_x = moveAmount_x;
+		trace.moveAmount_y = moveAmount_y;
+		trace.magnifyAmount = magnifyAmount;
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			GestureDetector* detector = gestureDetectors[i];
+			trace.states[i] = detector->state->state;
+			trace.hands[i] = detector->hand;
+			trace.lockingOn[i][0] = detector->lockingOn_move;
+			trace.lockingOn[i][1] = detector->lockingOn_magnify;
+			trace.startTimes[i] = detector->startTime - firstFrameTime;
+			trace.lockonStartTimes[i] = detector->lockonStartTime - firstFrameTime;
+		}
+	}
+
+	overlayScene.hide();
+	overlayScene.commit();
+	showOverlays = savedShowOverlays;
+	frameClock.useRealTime();
+}
+
+// The rule table has to do exactly what the switch did, frame for frame,
+// and so does the table run from a batch, with either kernel
+static void CheckGestureTable(FILE* results)
+{
+	fprintf(results, "%-24s %d rules, %s\n", "rule table", numGestureRules,
+		gestureTable.compiled ? "compiled" : "FAILED to compile");
+	checksFailed += gestureTable.compiled ? 0 : 1;
+
+	int numFrames = 0;
+	for (int p = 0; p < sizeof(flowPoses) / sizeof(flowPoses[0]); p++)
+	{
+		numFrames += flowPoses[p].frames;
+	}
+	GestureTrace* switchTraces = new GestureTrace[numFrames];
+	GestureTrace* tableTraces = new GestureTrace[numFrames];
+	BOOL savedAllowMagnify = allowMagnifyGestures;
+	GestureBatch batch(gestureTable);
+	static const char* const names[3][2] = {
+		{ "table = switch, move", "table = switch, magnify" },
+		{ "batch = switch, move", "batch = switch, magnify" },
+		{ "scalar = switch, move", "scalar = switch, magnify" },
+	};
+
+	for (int test = 0; test < 6; test++)
+	{
+		int allowMagnify = test % 2;
+		int kind = test / 2;
+		batch.useSSE = (kind == 1);
+		TraceFlow(TRUE, allowMagnify, switchTraces, numFrames, NULL);
+		TraceFlow(FALSE, allowMagnify, tableTraces, numFrames, (kind == 0) ? NULL : &batch);
+
+		int firstDifference = -1;
+		int stateChanges = 0;
+		int overlayChanges = 0;
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			if (firstDifference == -1 && memcmp(&switchTraces[frame], &tableTraces[frame], sizeof(GestureTrace)) != 0)
+			{
+				firstDifference = frame;
+			}
+			if (frame > 0 && switchTraces[frame].states[0] != switchTraces[frame - 1].states[0])
+			{
+				stateChanges++;
+			}
+			if (frame > 0 && (switchTraces[frame].numPrimitives != switchTraces[frame - 1].numPrimitives
+				|| memcmp(switchTraces[frame].primitives, switchTraces[frame - 1].primitives,
+					switchTraces[frame].numPrimitives * sizeof(OverlayPrimitive)) != 0))
+			{
+				overlayChanges++;
+			}
+		}
+
+		const char* name = names[kind][allowMagnify];
+		if (firstDifference == -1)
+		{
+			fprintf(results, "%-24s pass (%d frames, %d state changes, %d overlay changes)\n", name, numFrames,
+				stateChanges, overlayChanges);
+		}
+		else
+		{
+			checksFailed++;
+			const GestureTrace &expected = switchTraces[firstDifference];
+			const GestureTrace &got = tableTraces[firstDifference];
+			fprintf(results, "%-24s FAILED at frame %d: state %s/%s move (%.2f,%.2f)/(%.2f,%.2f) magnify %.3f/%.3f overlay %d/%d\n",
+				name, firstDifference, GestureStateName(expected.states[0]), GestureStateName(got.states[0]),
+				expected.moveAmount_x, expected.moveAmount_y, got.moveAmount_x, got.moveAmount_y,
+				expected.magnifyAmount, got.magnifyAmount, expected.numPrimitives, got.numPrimitives);
+		}
+	}
+
+	allowMagnifyGestures = savedAllowMagnify;
+	delete [] switchTraces;
+	delete [] tableTraces;
+}
+
+/*** Gesture templates ***/
+
+// Which gestures were seen, as bits
+const int seenStop = 0x01;
+const int seenCancel = 0x02;
+const int seenSaluteStart = 0x04;
+const int seenSalute = 0x08;
+const int seenClick = 0x10;
+const int seenMoveLockon = 0x20;
+
+// How far the hands get pushed around from the flow poses, so some of
+// the tests land right at the edges of their ranges
+const FLOAT gestureJitter = 0.012f;
+
+struct HandWrittenLockon
+{
+	BOOL holding;
+	long long since;
+};
+
+// The gestures the way detect() used to test them, one hand at a time
+static int HandWrittenGestures(GestureDetector &detector, const NUI_SKELETON_DATA &SkeletonData, Direction hand,
+	long long curTime, HandWrittenLockon &lockon)
+{
+	Vector4 headPoint = SkeletonData.SkeletonPositions[NUI_SKELETON_POSITION_HEAD];
+	Vector4 rightHandPoint = SkeletonData.SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT];
+	Vector4 leftHandPoint = SkeletonData.SkeletonPositions[NUI_SKELETON_POSITION_HAND_LEFT];
+	Vector4 spinePoint = SkeletonData.SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+	Vector4 handPoint;
+	Vector4 salutePoint = headPoint;
+	Vector4 centerPoint = spinePoint;
+	salutePoint.y += saluteUp;
+	if (hand == RIGHT)
+	{
+		handPoint = rightHandPoint;
+		salutePoint.x += saluteOver;
+		centerPoint.x += centerRightOver;
+	}
+	else
+	{
+		handPoint = leftHandPoint;
+		salutePoint.x -= saluteOver;
+		centerPoint.x -= centerLeftOver;
+	}
+
+	int seen = 0;
+	if (detector.areClose3D(headPoint, rightHandPoint, detectRange)
+		&& detector.areClose3D(headPoint, leftHandPoint, detectRange))
+	{
+		seen |= seenStop;
+	}
+	if (detector.areClose3D(headPoint, handPoint, detectRange))
+	{
+		seen |= seenCancel;
+	}
+	if (detector.areClose(headPoint, handPoint, detectRange))
+	{
+		seen |= seenSaluteStart;
+	}
+	if (detector.areClose(salutePoint, handPoint, detectRange))
+	{
+		seen |= seenSalute;
+	}
+	if (((spinePoint.z - rightHandPoint.z) > clickDistance)
+		|| ((spinePoint.z - leftHandPoint.z) > clickDistance))
+	{
+		seen |= seenClick;
+	}
+	if (detector.areClose(centerPoint, handPoint, detectRange))
+	{
+		if (! lockon.holding)
+		{
+			lockon.holding = TRUE;
+			lockon.since = curTime;
+		}
+		if ((curTime - lockon.since) > lockonTime)
+		{
+			seen |= seenMoveLockon;
+		}
+	}
+	else
+	{
+		lockon.holding = FALSE;
+	}
+	return seen;
+}
+
+// The rest of the gestures, which the rule table has as rows, in the
+// same terms as GestureDSL.h
+GESTURE_CONSTANT(SaluteOver, saluteOver)
+GESTURE_CONSTANT(SaluteUp, saluteUp)
+GESTURE_CONSTANT(CenterRightOver, centerRightOver)
+GESTURE_CONSTANT(CenterLeftOver, centerLeftOver)
+
+// Durations, in 100ns intervals like everything else timed here
+#define GESTURE_DURATION(Name, Value) struct Name { static long long ticks() { return (Value); } };
+GESTURE_DURATION(LockonTime, lockonTime)
+
+// Over towards the given hand's side of the body
+template <Direction hand, class Distance>
+struct Outward
+{
+	static FLOAT value()
+	{
+		return (hand == RIGHT) ? Distance::value() : -Distance::value();
+	}
+};
+
+// Over from the spine to the middle of the movement box, which isn't the
+// same distance on both sides
+template <Direction hand>
+struct CenterOver
+{
+	static FLOAT value()
+	{
+		return (hand == RIGHT) ? CenterRightOver::value() : -CenterLeftOver::value();
+	}
+};
+
+template <Direction hand>
+struct MoveCenterPoint : Offset<SpinePoint, CenterOver<hand>, NoOffset>
+{
+};
+
+// P has been true for longer than Duration, like the lock-ons.  On the
+// right of an And or Or it only counts the frames that get that far.
+template <class P, class Duration>
+struct Held
+{
+	Held()
+	{
+		reset();
+	}
+	bool test(const SkeletonView &skeleton, long long now)
+	{
+		if (! p.test(skeleton, now))
+		{
+			holding = FALSE;
+			return false;
+		}
+		if (! holding)
+		{
+			holding = TRUE;
+			since = now;
+		}
+		return (now - since) > Duration::ticks();
+	}
+	void reset()
+	{
+		holding = FALSE;
+		since = 0;
+	}
+	P p;
+	BOOL holding;
+	long long since;
+};
+
+// The start of a salute: a hand to the head
+template <Direction hand>
+struct SaluteStartGesture : Near<HeadPoint, HandPoint<hand>, DetectRange>
+{
+};
+
+// The end of a salute: the hand up and away from the head
+template <Direction hand>
+struct SaluteGesture : Near<Offset<HeadPoint, Outward<hand, SaluteOver>, SaluteUp>, HandPoint<hand>, DetectRange>
+{
+};
+
+// Locking on to moving: the hand held in the middle of the movement box,
+// starting over if it leaves, as the rule table's lock-on does (SALUTE2's
+// last rows clear lockingOn_move whenever the hand isn't there)
+template <Direction hand>
+struct MoveLockonGesture : Held<Near<MoveCenterPoint<hand>, HandPoint<hand>, DetectRange>, LockonTime>
+{
+};
+
+// The same, out of GestureDSL.h and the pieces above
+struct TemplateGestures
+{
+	int test(const NUI_SKELETON_DATA &skeleton, Direction hand, long long now)
+	{
+		int seen = 0;
+		if (stop.test(skeleton, now))
+		{
+			seen |= seenStop;
+		}
+		if (cancel.test(hand, skeleton, now))
+		{
+			seen |= seenCancel;
+		}
+		if (saluteStart.test(hand, skeleton, now))
+		{
+			seen |= seenSaluteStart;
+		}
+		if (salute.test(hand, skeleton, now))
+		{
+			seen |= seenSalute;
+		}
+		if (click.test(skeleton, now))
+		{
+			seen |= seenClick;
+		}
+		if (lockon.test(hand, skeleton, now))
+		{
+			seen |= seenMoveLockon;
+		}
+		return seen;
+	}
+
+	StopGesture stop;
+	EitherHand<CancelGesture> cancel;
+	EitherHand<SaluteStartGesture> saluteStart;
+	EitherHand<SaluteGesture> salute;
+	ClickGesture click;
+	EitherHand<MoveLockonGesture> lockon;
+};
+
+// The flow, with the hands jiggled a little differently every frame
+static NUI_SKELETON_DATA* MakeGestureSkeletons(int &numFrames)
+{
+	numFrames = 0;
+	for (int p = 0; p < sizeof(flowPoses) / sizeof(flowPoses[0]); p++)
+	{
+		numFrames += flowPoses[p].frames;
+	}
+	NUI_SKELETON_DATA* skeletons = new NUI_SKELETON_DATA[numFrames];
+	int frame = 0;
+	for (int p = 0; p < sizeof(flowPoses) / sizeof(flowPoses[0]); p++)
+	{
+		for (int f = 0; f < flowPoses[p].frames; f++, frame++)
+		{
+			HandPose pose = flowPoses[p];
+			FLOAT jiggle = gestureJitter * ((frame * 7) % 11 - 5);
+			switch (frame % 3)
+			{
+			case 0:
+				pose.rightX += jiggle;
+				pose.leftY -= jiggle;
+				break;
+			case 1:
+				pose.rightY += jiggle;
+				pose.leftZ += jiggle;
+				break;
+			default:
+				pose.rightZ -= jiggle;
+				pose.leftX += jiggle;
+				break;
+			}
+			MakeSkeleton(skeletons[frame], 0, pose);
+		}
+	}
+	return skeletons;
+}
+
+// The templates have to see exactly the gestures the hand-written tests do,
+// and take no longer about it
+static void RunGestureTemplateBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	int numFrames;
+	NUI_SKELETON_DATA* skeletons = MakeGestureSkeletons(numFrames);
+	GestureDetector &detector = *gestureDetectors[0];
+	const long long frameTicks = oneSecondTimeout / 30;
+
+	HandWrittenLockon lockons[2];
+	ZeroMemory(lockons, sizeof(lockons));
+	TemplateGestures templates;
+	int firstDifference = -1;
+	int seenAll = 0;
+	for (int frame = 0; frame < numFrames; frame++)
+	{
+		for (int h = 0; h < 2; h++)
+		{
+			Direction hand = (h == 0) ? RIGHT : LEFT;
+			int expected = HandWrittenGestures(detector, skeletons[frame], hand, frame * frameTicks, lockons[h]);
+			int got = templates.test(skeletons[frame], hand, frame * frameTicks);
+			if (firstDifference == -1 && got != expected)
+			{
+				firstDifference = frame;
+				checksFailed++;
+				fprintf(results, "%-24s FAILED at frame %d, %s hand: saw %#x, not %#x\n", "templates = hand-written",
+					frame, (hand == RIGHT) ? "right" : "left", got, expected);
+			}
+			seenAll |= expected;
+		}
+	}
+	checksFailed += (seenAll == 0x3f) ? 0 : 1;
+	if (firstDifference == -1)
+	{
+		fprintf(results, "%-24s pass (%d frames, %s)\n", "templates = hand-written", numFrames,
+			(seenAll == 0x3f) ? "every gesture seen" : "NOT every gesture seen");
+	}
+
+	// A sample is the whole flow, both hands
+	volatile int sink = 0;
+	const int samples = benchmarkFrames / 20;
+	timer.reset();
+	for (int sample = 0; sample < samples; sample++)
+	{
+		timer.start();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			sink += HandWrittenGestures(detector, skeletons[frame], RIGHT, frame * frameTicks, lockons[0]);
+			sink += HandWrittenGestures(detector, skeletons[frame], LEFT, frame * frameTicks, lockons[1]);
+		}
+		timer.stop();
+	}
+	timer.report(results, "gestures, hand-written");
+
+	timer.reset();
+	for (int sample = 0; sample < samples; sample++)
+	{
+		timer.start();
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			sink += templates.test(skeletons[frame], RIGHT, frame * frameTicks);
+			sink += templates.test(skeletons[frame], LEFT, frame * frameTicks);
+		}
+		timer.stop();
+	}
+	timer.report(results, "gestures, templates");
+
+	delete [] skeletons;
+}
+
+/*** Batched gestures ***/
+
+// Everything a GestureBatch works out, for one skeleton, the way detect()
+// and the rule table work it out one detector at a time.  Returns stop,
+// cancel and click as bits 0 to 2.
+static int OneSkeletonAtATime(GestureDetector &detector, const SkeletonView &skeleton, Direction hand,
+							  BOOL near[maxTableGuards], Quadrant quadrants[maxTableGuards])
+{
+	StopGesture stopGesture;
+	EitherHand<CancelGesture> cancelGesture;
+	ClickGesture clickGesture;
+	int gestures = (stopGesture.test(skeleton, 0) ? 1 : 0) | (cancelGesture.test(hand, skeleton, 0) ? 2 : 0)
+		| (clickGesture.test(skeleton, 0) ? 4 : 0);
+
+	for (int g = 0; g < gestureTable.numGuards; g++)
+	{
+		const GesturePoint &point = *gestureTable.guardPoints[g];
+		RuleHand ruleHand = gestureTable.guardHands[g];
+		BOOL right = (ruleHand == ACTIVE_HAND) ? (hand == RIGHT) : (ruleHand == RIGHT_HAND);
+		Vector4 target = skeleton.joint(point.joint);
+		target.x += right ? point.rightX : point.leftX;
+		target.y += point.y;
+		target.x += point.extraX;
+		target.y += point.extraY;
+		const Vector4 &handPoint = skeleton.joint(right ? NUI_SKELETON_POSITION_HAND_RIGHT : NUI_SKELETON_POSITION_HAND_LEFT);
+		near[g] = detector.areClose(target, handPoint, detectRange);
+		quadrants[g] = detector.findQuadrant(target, handPoint);
+	}
+	return gestures;
+}
+
+// Batches of 1 to maxBatchSkeletons skeletons, each somewhere different in
+// the gesture flow, against working them out one at a time
+static void RunGestureBatchBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	int numFrames;
+	NUI_SKELETON_DATA* poses = MakeGestureSkeletons(numFrames);
+	GestureDetector &detector = *gestureDetectors[0];
+	SkeletonView skeletons[maxBatchSkeletons] = {
+		poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0],
+		poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0],
+		poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0],
+		poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0], poses[0],
+	};
+	C_ASSERT(maxBatchSkeletons == 32);
+	Direction hands[maxBatchSkeletons];
+	for (int i = 0; i < maxBatchSkeletons; i++)
+	{
+		hands[i] = (i % 2 == 0) ? RIGHT : LEFT;
+	}
+
+	// Both kernels have to agree with one at a time, everywhere in the flow
+	GestureBatch batch(gestureTable);
+	BOOL near[maxTableGuards];
+	Quadrant quadrants[maxTableGuards];
+	for (int kernel = 0; kernel < 2; kernel++)
+	{
+		batch.useSSE = (kernel == 0);
+		int mismatches = 0;
+		for (int frame = 0; frame < numFrames; frame++)
+		{
+			for (int i = 0; i < maxBatchSkeletons; i++)
+			{
+				skeletons[i] = SkeletonView(poses[(frame + 7 * i) % numFrames]);
+			}
+			batch.evaluate(skeletons, hands, maxBatchSkeletons);
+			for (int i = 0; i < maxBatchSkeletons; i++)
+			{
+				int gestures = OneSkeletonAtATime(detector, skeletons[i], hands[i], near, quadrants);
+				BOOL same = (batch.stop(i) == ((gestures & 1) != 0)) && (batch.cancel(i) == ((gestures & 2) != 0))
+					&& (batch.click(i) == ((gestures & 4) != 0));
+				for (int g = 0; g < gestureTable.numGuards; g++)
+				{
+					same = same && (batch.isNear(i, g) == near[g]) && (batch.quadrant(i, g) == quadrants[g]);
+				}
+				if (! same)
+				{
+					mismatches++;
+				}
+			}
+		}
+		fprintf(results, "%-24s %s (%d skeletons x %d frames, %d guards)\n",
+			batch.useSSE ? "batch SSE = one by one" : "batch scalar = one by one",
+			CheckResult(mismatches == 0), maxBatchSkeletons, numFrames, gestureTable.numGuards);
+	}
+
+	static const int batchSizes[] = { 1, 2, 4, 6, 8, 16, 32 };
+	volatile int sink = 0;
+	for (int b = 0; b < sizeof(batchSizes) / sizeof(batchSizes[0]); b++)
+	{
+		int count = batchSizes[b];
+		for (int k = 0; k < 3; k++)
+		{
+			batch.useSSE = (k == 2);
+			timer.reset();
+			for (int frame = 0; frame < benchmarkFrames; frame++)
+			{
+				int f = frame % numFrames;
+				for (int i = 0; i < count; i++)
+				{
+					skeletons[i] = SkeletonView(poses[(f + 7 * i) % numFrames]);
+				}
+				timer.start();
+				if (k == 0)
+				{
+					for (int i = 0; i < count; i++)
+					{
+						sink += OneSkeletonAtATime(detector, skeletons[i], hands[i], near, quadrants);
+					}
+				}
+				else
+				{
+					batch.evaluate(skeletons, hands, count);
+					sink += batch.click(0);
+				}
+				timer.stop();
+			}
+			char name[64];
+			sprintf_s(name, sizeof(name), "%2d skeletons, %s", count,
+				(k == 0) ? "one by one" : (k == 1) ? "batch scalar" : "batch SSE");
+			timer.report(results, name);
+		}
+	}
+
+	delete [] poses;
+}
+
+// GestureState::set() on its own, cycling through every state
+static void RunStateBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	GestureState* state = gestureDetectors[0]->state;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		GestureStateEnum newState = (GestureStateEnum) (frame % (MOVECENTER + 1));
+		timer.start();
+		state->set(newState);
+		timer.stop();
+	}
+	timer.report(results, "GestureState::set");
+
+	// What the detectors mostly do: set the state they're already in
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		timer.start();
+		state->set(state->state);
+		timer.stop();
+	}
+	timer.report(results, "GestureState::set same");
+}
+
+// State changes through the event ring, drained every frame the way the
+// skeletal viewer does
+static void RunGestureEventBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	GestureEventRing ring;
+	GestureEvent event;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		GestureStateEnum newState = (GestureStateEnum) (frame % (MOVECENTER + 1));
+		timer.start();
+		for (int ii = 0; ii < NUI_SKELETON_COUNT; ii++)
+		{
+			ring.push(ii, newState);
+		}
+		if (ring.needsWake())
+		{
+			ring.clearWake();
+			while (ring.pop(event))
+			{
+			}
+		}
+		timer.stop();
+	}
+	timer.report(results, "Gesture event ring");
+	fprintf(results, "%-24s pushed %ld  dropped %ld  wakes %ld\n", "",
+		ring.eventsPushed, ring.eventsDropped, ring.wakesPosted);
+}
+
+// Every scenario through the switch and the table, the checks that they
+// agree, then the gesture templates, batching, and the state plumbing
+void BenchmarkGestures(FILE* results, BenchmarkTimer &timer)
+{
+	fprintf(results, "Gesture pipeline, %d detectors per frame\n", NUI_SKELETON_COUNT);
+	for (int s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++)
+	{
+		RunScenario(results, scenarios[s], TRUE, timer);
+		RunScenario(results, scenarios[s], FALSE, timer);
+	}
+	fprintf(results, "\n");
+	CheckGestureTable(results);
+	RunGestureTemplateBenchmark(results, timer);
+	RunGestureBatchBenchmark(results, timer);
+	fprintf(results, "\n");
+	RunStateBenchmark(results, timer);
+	RunGestureEventBenchmark(results, timer);
+}
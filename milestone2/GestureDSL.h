@@ -0,0 +1,168 @@
+/************************************************************************
+*                                                                       *
+*   GestureDSL.h -- Templates for describing gestures                   *
+*                                                                       *
+*   A gesture is put together out of small pieces: points on the body,  *
+*   offsets from them, and how close two points have to be.  The        *
+*   compiler turns each one into its own test, with the joints,         *
+*   offsets and which hand all decided ahead of time, so all that's     *
+*   left to run is the comparisons.  These are the gestures that work   *
+*   in any state; the rest are rows in GestureTable.cpp.                *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include <cmath>
+#include "NuiApi.h"
+#include "GestureDetector.h"
+#include "SkeletonView.h"
+
+/*** Constants ***/
+
+// Templates can't take FLOATs, so each constant is a type wrapping one
+// of the magic constants in GestureDetector.h
+#define GESTURE_CONSTANT(Name, Value) struct Name { static FLOAT value() { return (Value); } };
+GESTURE_CONSTANT(DetectRange, detectRange)
+GESTURE_CONSTANT(ClickDistance, clickDistance)
+GESTURE_CONSTANT(NoOffset, 0.0f)
+
+/*** Points ***/
+
+template <int joint>
+struct JointPoint
+{
+	static const Vector4 &at(const SkeletonView &skeleton)
+	{
+		return skeleton.joint(joint);
+	}
+};
+
+typedef JointPoint<NUI_SKELETON_POSITION_HEAD> HeadPoint;
+typedef JointPoint<NUI_SKELETON_POSITION_SPINE> SpinePoint;
+
+template <Direction hand>
+struct HandPoint : JointPoint<(hand == RIGHT) ? NUI_SKELETON_POSITION_HAND_RIGHT : NUI_SKELETON_POSITION_HAND_LEFT>
+{
+};
+
+// Another point, moved across by X and up by Y
+template <class Point, class X, class Y>
+struct Offset
+{
+	static Vector4 at(const SkeletonView &skeleton)
+	{
+		Vector4 point = Point::at(skeleton);
+		point.x += X::value();
+		point.y += Y::value();
+		return point;
+	}
+};
+
+/*** Tests ***/
+
+// Every test has test(skeleton, now), where now is the frame time, for
+// tests that keep something between frames.  None of these do.
+
+// Within range of each other across and up and down, like areClose()
+template <class A, class B, class Range>
+struct Near
+{
+	bool test(const SkeletonView &skeleton, long long /*now*/)
+	{
+		const Vector4 &a = A::at(skeleton);
+		const Vector4 &b = B::at(skeleton);
+		return (fabs(a.x - b.x) < Range::value()) && (fabs(a.y - b.y) < Range::value());
+	}
+};
+
+// Within range in depth as well, like areClose3D()
+template <class A, class B, class Range>
+struct Near3D
+{
+	bool test(const SkeletonView &skeleton, long long /*now*/)
+	{
+		const Vector4 &a = A::at(skeleton);
+		const Vector4 &b = B::at(skeleton);
+		return (fabs(a.x - b.x) < Range::value()) && (fabs(a.y - b.y) < Range::value())
+			&& (fabs(a.z - b.z) < Range::value());
+	}
+};
+
+// A is more than Distance closer to the sensor than B
+template <class A, class B, class Distance>
+struct InFront
+{
+	bool test(const SkeletonView &skeleton, long long /*now*/)
+	{
+		return (B::at(skeleton).z - A::at(skeleton).z) > Distance::value();
+	}
+};
+
+// Both sides short-circuit
+template <class P, class Q>
+struct And
+{
+	bool test(const SkeletonView &skeleton, long long now)
+	{
+		return p.test(skeleton, now) && q.test(skeleton, now);
+	}
+	P p;
+	Q q;
+};
+
+template <class P, class Q>
+struct Or
+{
+	bool test(const SkeletonView &skeleton, long long now)
+	{
+		return p.test(skeleton, now) || q.test(skeleton, now);
+	}
+	P p;
+	Q q;
+};
+
+template <class P>
+struct Not
+{
+	bool test(const SkeletonView &skeleton, long long now)
+	{
+		return ! p.test(skeleton, now);
+	}
+	P p;
+};
+
+// A one-handed gesture, built for both hands, for when which hand is only
+// known once it's running.  This is the only place the hand is looked at.
+template <template <Direction> class Gesture>
+struct EitherHand
+{
+	bool test(Direction hand, const SkeletonView &skeleton, long long now)
+	{
+		return (hand == RIGHT) ? right.test(skeleton, now) : left.test(skeleton, now);
+	}
+	Gesture<RIGHT> right;
+	Gesture<LEFT> left;
+};
+
+/*** The gestures ***/
+
+// Stop: both hands on the head
+struct StopGesture : And<
+	Near3D<HeadPoint, HandPoint<RIGHT>, DetectRange>,
+	Near3D<HeadPoint, HandPoint<LEFT>, DetectRange> >
+{
+};
+
+// Cancel: the hand in use back on the head
+template <Direction hand>
+struct CancelGesture : Near3D<HeadPoint, HandPoint<hand>, DetectRange>
+{
+};
+
+// Click: either hand pushed out in front of the body
+struct ClickGesture : Or<
+	InFront<HandPoint<RIGHT>, SpinePoint, ClickDistance>,
+	InFront<HandPoint<LEFT>, SpinePoint, ClickDistance> >
+{
+};
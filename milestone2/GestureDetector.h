@@ -11,6 +11,11 @@
 #include <windows.h>
 #include "NuiApi.h"
 #include "GestureState.h"
+#include "JointHistory.h"
+#include "SkeletonView.h"
+#include "DtwRecognizer.h"
+
+class GestureBatch;
 
 /* Mode selection, because Karan likes one method and I like another */
 enum Movement_Style {
@@ -84,12 +89,27 @@ public:
 	/* Time to wait before recognizing hands together */
 	long long killGesturesStartTime;
 
+	// What DtwRecognizer matched for this skeleton this frame, and with
+	// which hand; only good for the next detect()
+	DynamicGesture dynamicGesture;
+	Direction dynamicHand;
+
 	/* Functions */
-	void detect(NUI_SKELETON_FRAME &SkeletonFrame, NUI_SKELETON_FRAME &prevFrame);
-	bool areClose(Vector4 &obj1, Vector4 &obj2, double range);
+	// history has to have this frame in it already.  If there's a batch,
+	// it has to have been evaluated on this frame, and the gestures are
+	// read from it.
+	void detect(const NUI_SKELETON_FRAME &SkeletonFrame, const JointHistory &history, const GestureBatch* batch = NULL);
+	// Takes this frame's match from the recognizer, if there was one, for
+	// the next detect().  Returns FALSE if there wasn't.
+	BOOL takeDynamicGesture(DtwRecognizer &recognizer, DtwMatch &match);
+	// The stop, cancel and click gestures, which work whatever state the
+	// machine's in.  Returns FALSE if that's all there is to do this frame;
+	// otherwise clicking says whether the click is being held.
+	BOOL detectAnyState(const SkeletonView &skeleton, const GestureBatch* batch, BOOL &clicking);
+	bool areClose(const Vector4 &obj1, const Vector4 &obj2, double range);
 	long long getTimeIn100NSIntervals();
 	void moveCursor(Direction dir);
-	void GestureDetector::getDifference(Vector4 now, Vector4 prev, FLOAT& displacement_x, FLOAT& displacement_y);
-	bool GestureDetector::areClose3D(Vector4 &obj1, Vector4 &obj2, double range);
-	Quadrant GestureDetector::findQuadrant(Vector4 center, Vector4 point);
+	void GestureDetector::getDifference(const Vector4 &now, const Vector4 &prev, FLOAT& displacement_x, FLOAT& displacement_y);
+	bool GestureDetector::areClose3D(const Vector4 &obj1, const Vector4 &obj2, double range);
+	Quadrant GestureDetector::findQuadrant(const Vector4 &center, const Vector4 &point);
 };
@@ -0,0 +1,64 @@
+#include "GestureEventRing.h"
+
+// The one the skeletal viewer drains
+GestureEventRing gestureEvents;
+
+GestureEventRing::GestureEventRing(void)
+{
+	head = 0;
+	tail = 0;
+	wakePending = 0;
+	eventsPushed = 0;
+	eventsDropped = 0;
+	wakesPosted = 0;
+}
+
+BOOL GestureEventRing::push(int skeletonId, GestureStateEnum newState)
+{
+	LONG position = head;
+	if (position - tail >= gestureEventRingSize)
+	{
+		InterlockedIncrement(&eventsDropped);
+		return FALSE;
+	}
+
+	GestureEvent &event = events[position & (gestureEventRingSize - 1)];
+	event.skeletonId = skeletonId;
+	event.newState = newState;
+	event.timestamp = GetTickCount();
+
+	// Full barrier, so the event is written before the consumer can see it
+	InterlockedExchange(&head, position + 1);
+	InterlockedIncrement(&eventsPushed);
+	return TRUE;
+}
+
+BOOL GestureEventRing::needsWake()
+{
+	if (InterlockedExchange(&wakePending, 1) != 0)
+	{
+		return FALSE;
+	}
+	InterlockedIncrement(&wakesPosted);
+	return TRUE;
+}
+
+BOOL GestureEventRing::pop(GestureEvent &event)
+{
+	LONG position = tail;
+	if (position == head)
+	{
+		return FALSE;
+	}
+
+	event = events[position & (gestureEventRingSize - 1)];
+
+	// Only hand the slot back once we're done reading it
+	InterlockedExchange(&tail, position + 1);
+	return TRUE;
+}
+
+void GestureEventRing::clearWake()
+{
+	InterlockedExchange(&wakePending, 0);
+}
@@ -0,0 +1,59 @@
+/************************************************************************
+*                                                                       *
+*   GestureEventRing.h -- Declaration of GestureEventRing class         *
+*                                                                       *
+*   Gesture state changes on their way from the sensor thread to the    *
+*   skeletal viewer.  One thread pushes, one thread pops, neither       *
+*   locks or allocates; if the viewer falls a whole ring behind, the    *
+*   newest changes are dropped and counted.                             *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "GestureState.h"
+
+// Must be a power of two
+const LONG gestureEventRingSize = 64;
+
+struct GestureEvent
+{
+	int skeletonId;
+	GestureStateEnum newState;
+	// GetTickCount() when the state changed
+	DWORD timestamp;
+};
+
+class GestureEventRing
+{
+public:
+	GestureEventRing(void);
+
+	/* Producer side (whoever runs the gesture detectors) */
+	// Returns FALSE if the ring was full and the event was dropped
+	BOOL push(int skeletonId, GestureStateEnum newState);
+	// TRUE the first time it's called after the consumer's last clearWake(),
+	// so only one wake-up message is ever outstanding
+	BOOL needsWake();
+
+	/* Consumer side (GUI thread) */
+	// Returns FALSE once the ring is empty
+	BOOL pop(GestureEvent &event);
+	// Call before draining, so a push during the drain asks for another wake
+	void clearWake();
+
+	// Statistics, only ever incremented
+	volatile LONG eventsPushed;
+	volatile LONG eventsDropped;
+	volatile LONG wakesPosted;
+
+private:
+	GestureEvent events[gestureEventRingSize];
+	// Free-running counts; only the producer writes head, only the consumer tail
+	volatile LONG head;
+	volatile LONG tail;
+	volatile LONG wakePending;
+};
+
+// The one the skeletal viewer drains
+extern GestureEventRing gestureEvents;
@@ -3,25 +3,46 @@
 #include "resource.h"
 #include <string.h>
 #include "Magnifier.h"
+#include "GestureEventRing.h"
 
-extern int activeSkeleton;
 extern CSkeletalViewerApp* skeletalViewer;
 extern BOOL GUI_On;
 
+// Indexed by GestureStateEnum, so keep it in the same order
+static const char* gestureStateNames[] =
+{
+	"OFF",
+	"SALUTE1",
+	"SALUTE2",
+	"MAGNIFYUP",
+	"MAGNIFYDOWN",
+	"MAGNIFYLEFT",
+	"MAGNIFYRIGHT",
+	"MOVERIGHT",
+	"MOVELEFT",
+	"MOVEUP",
+	"MOVEDOWN",
+	"MOVECENTER",
+};
+
+const char* GestureStateName(GestureStateEnum state)
+{
+	if (state < 0 || state >= (int) (sizeof(gestureStateNames) / sizeof(gestureStateNames[0])))
+	{
+		return "UNKNOWN";
+	}
+	return gestureStateNames[state];
+}
+
 GestureState::GestureState(int userId)
 {
 	state = OFF;
-	name = NULL;
 	id = userId;
 	updateDebug();
 }
 
 GestureState::~GestureState(void)
 {
-	if (name != NULL)
-	{
-		free(name);
-	}
 }
 
 // Very well might not be used, but avoids confusion with the other
@@ -37,98 +58,30 @@ GestureState& GestureState::operator=(GestureState& other)
 
 void GestureState::set(GestureStateEnum newState)
 {
+	// The detectors set the same state most frames; only report changes
+	if (newState == state)
+	{
+		return;
+	}
 	state = newState;
 	updateDebug();
 }
 
-// Send the state to the output window, which unfortunately is an absolute pain to do.
+// Let the skeletal viewer know the state changed.  The change goes into
+// gestureEvents, and the viewer is only woken if it isn't already due to
+// drain them.
 void GestureState::updateDebug()
 {
 	// If the skeletal viewer is off, don't do anything
-	if (! GUI_On)
+	if (! GUI_On || ! skeletalViewer->increment_num_GUIers())
 	{
 		return;
 	}
-	skeletalViewer->increment_num_GUIers();
-
-	// Transform the state name into a string
-	char* statename;
-	switch(state)
-	{
-	case OFF:
-		statename = _strdup("OFF");
-		break;
-	case SALUTE1:
-		statename = _strdup("SALUTE1");
-		break;
-	case SALUTE2:
-		statename = _strdup("SALUTE2");
-		break;
-	// case BODYCENTER:
-	// 	statename = _strdup("BODYCENTER");
-	// 	break;
-		//case MAGNIFY:
-		//	statename = _strdup("MAGNIFY");
-		//	break;
-		// case MOVE:
-		// 	statename = _strdup("MOVE");
-		// 	break;
-	case MOVECENTER:
-		statename = _strdup("MOVECENTER");
-		break;
-	case MOVEUP:
-		statename = _strdup("MOVEUP");
-		break;
-	case MOVEDOWN:
-		statename = _strdup("MOVEDOWN");
-		break;
-	case MOVELEFT:
-		statename = _strdup("MOVELEFT");
-		break;
-	case MOVERIGHT:
-		statename = _strdup("MOVERIGHT");
-		break;
-	case MAGNIFYUP:
-		statename = _strdup("MAGNIFYUP");
-		break;
-	case MAGNIFYDOWN:
-		statename = _strdup("MAGNIFYDOWN");
-		break;
-	case MAGNIFYRIGHT:
-		statename = _strdup("MAGNIFYRIGHT");
-		break;
-	case MAGNIFYLEFT:
-		statename = _strdup("MAGNIFYLEFT");
-		break;
-	// case MAGNIFYCENTER:
-	// 	statename = _strdup("MAGNIFYCENTER");
-	// 	break;
-	default:
-		statename = _strdup("UNKNOWN");
-	}
-
-	// Print state
-	// I want to pass a char*.  The function wants an int*.  Solve the problem by casting.
-	// Note, the other uses are casting an int* to an int anyway, so this isn't anything particularly out of the ordinary
-	void* tmp = (void*)statename;
-	LONG_PTR longptr = (LONG_PTR) tmp;
-	// Actually post the message to the output
-	if (id == activeSkeleton)
-	{
-		::PostMessageW(skeletalViewer->m_hWnd, WM_USER_UPDATE_STATE, IDC_STATE, longptr);
-	}
-	else
-	{
-		::PostMessageW(skeletalViewer->m_hWnd, WM_USER_UPDATE_STATE, IDC_STATE2, longptr);
-	}
 
-	// Delete the old string, keep the new one
-	if (name != NULL)
+	if (gestureEvents.push(id, state) && gestureEvents.needsWake())
 	{
-		// free(), since using strdup()
-		free(name);
+		::PostMessageW(skeletalViewer->m_hWnd, WM_USER_UPDATE_STATE, 0, 0);
 	}
-	name = statename;
 
 	skeletalViewer->decrement_num_GUIers();
 }
@@ -1,9 +1,6 @@
 #pragma once
 #include <Windows.h>
 
-// Size of the name string
-const int NAMESIZE = 16;
-
 enum GestureStateEnum {
 	OFF,
 	SALUTE1,
@@ -22,6 +19,9 @@ enum GestureStateEnum {
 	/* add more as necessary */
 };
 
+// Printable name of a state, for logs and transcripts
+const char* GestureStateName(GestureStateEnum state);
+
 class GestureState
 {
 public:
@@ -29,8 +29,6 @@ public:
 	~GestureState(void);
 	
 	GestureStateEnum state;
-	// This needs to be passed to the SkeletalViewer window, so it needs to be persistent
-	char* name;
 	GestureState& operator=(GestureState& other);
 	void set(GestureStateEnum newState);
 	void updateDebug();
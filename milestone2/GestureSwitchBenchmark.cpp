@@ -0,0 +1,1063 @@
+#include "BenchmarkFixtures.h"
+#include "GestureDetector.h"
+#include "JointHistory.h"
+#include "SkeletonView.h"
+#include "Magnifier.h"
+#include <math.h>
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern int activeSkeleton;
+extern FLOAT moveAmount_x;
+extern FLOAT moveAmount_y;
+extern float magnifyAmount;
+extern BOOL showOverlays;
+extern BOOL allowMagnifyGestures;
+extern int xRes;
+extern int yRes;
+
+/*** The switch ***/
+
+// The state machine the way detect() used to run it, before the rule
+// table.  Nothing runs it any more except the checks, which hold the
+// table to doing exactly what it did.
+static void SwitchStateMachine(GestureDetector &detector, const SkeletonView &skeleton, const JointHistory &history,
+							   BOOL amClicking)
+{
+	/*** The compiler does not like initializing variables within case statements ***/
+	// Temporary variables for actual body part points
+	Vector4 headPoint;
+	Vector4 rightHandPoint;
+	Vector4 leftHandPoint;
+	Vector4 handPoint;
+	Vector4 spinePoint;
+	// These are derived points used for magnification and movement
+	Vector4 upPoint;
+	Vector4 downPoint;
+	Vector4 leftPoint;
+	Vector4 rightPoint;
+	Vector4 centerPoint;
+	FLOAT displacement_x = 0;
+	FLOAT displacement_y = 0;
+	long long curTime = 0;
+	Quadrant curQuadrant;
+
+	switch (detector.state->state)
+	{
+	case OFF:
+		if (detector.id == activeSkeleton)
+		{
+			moveAmount_y = 0;
+			moveAmount_x = 0;
+		}
+		// Check if a hand is close to the head
+		headPoint = skeleton.joint(NUI_SKELETON_POSITION_HEAD);
+		rightHandPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+		leftHandPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+
+		if (detector.areClose(headPoint, rightHandPoint, detectRange))
+		{
+			detector.state->set(SALUTE1);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			detector.hand = RIGHT;
+			return;
+		}
+		if (detector.areClose(headPoint, leftHandPoint, detectRange))
+		{
+			detector.state->set(SALUTE1);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			detector.hand = LEFT;
+			return;
+		}
+		break;
+	case SALUTE1:
+		// Check for saluting action (box up and away)
+		headPoint = skeleton.joint(NUI_SKELETON_POSITION_HEAD);
+		headPoint.y += saluteUp;
+		if (detector.hand == RIGHT)
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+			headPoint.x += saluteOver;
+		}
+		else
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+			headPoint.x -= saluteOver;
+		}
+
+		if (detector.areClose(headPoint, handPoint, detectRange))
+		{
+			if (showOverlays)
+			{
+				if (allowMagnifyGestures)
+				{
+					if (detector.hand == RIGHT)
+					{
+						drawRectangle ((xRes*3/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+					}
+					else
+					{
+						drawRectangle ((xRes/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+					}
+					drawRectangle ((xRes/2) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+				}
+				else
+				{
+					if (detector.hand == RIGHT)
+					{
+						drawRectangle ((xRes*3/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+					}
+					else
+					{
+						drawRectangle ((xRes/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+					}
+				}
+			}
+			detector.state->set(SALUTE2);
+			// Right now, an alert to let me know gesture tracking is working
+			//MessageBox(NULL, "Salute detected", "Gesture Detection", NULL);
+			// Change the active user
+			// This is a race condition, but what it's doing is also inherently one
+			if (activeSkeleton != detector.id)
+			{
+				activeSkeleton = detector.id;
+				clearOverlay();
+				moveAmount_x = 0;
+				moveAmount_y = 0;
+			}
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		// Otherwise, keep looking (until the timeout)
+		break;
+	case SALUTE2:
+		spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+		centerPoint = spinePoint;
+		if (detector.hand == RIGHT)
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+			centerPoint.x += centerRightOver;
+		}
+		else
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+			centerPoint.x -= centerLeftOver;
+		}
+
+		// Only allow user magnification if it's turned on
+		if (allowMagnifyGestures)
+		{
+			if (detector.areClose(spinePoint, handPoint, detectRange))
+			{
+				// Lock-on
+				if (! detector.lockingOn_magnify)
+				{
+					detector.lockingOn_magnify = TRUE;
+					detector.lockonStartTime = detector.getTimeIn100NSIntervals();
+					if (showOverlays)
+					{
+						clearOverlay();
+						drawLockOn(xRes/2, yRes/2);
+						drawText ((xRes/3), (yRes/10), L"Locking on to Magnification Mode", 56);
+					}
+				}
+				else // We're locking on already
+				{
+					curTime = detector.getTimeIn100NSIntervals();
+					if ((curTime - detector.lockonStartTime) > lockonTime)
+					{
+						detector.state->set(MAGNIFYLEFT);
+						detector.startTime = detector.getTimeIn100NSIntervals();
+						if (showOverlays)
+						{
+							clearOverlay();
+							drawRectangle ((xRes/2) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 1);
+							drawText ((xRes/3), (yRes/10), L"Magnification Gesture Mode", 56);
+						}
+					}
+				}
+				return;
+			}
+			else if (detector.areClose(centerPoint, handPoint, detectRange))
+			{
+				// Don't do anything during the dead time
+				if (! detector.lockingOn_move)
+				{
+					detector.lockingOn_move = TRUE;
+					detector.lockonStartTime = detector.getTimeIn100NSIntervals();
+					if (showOverlays)
+					{
+						clearOverlay();
+						if (detector.hand == RIGHT)
+						{
+							drawLockOn(xRes*3/4, yRes/2);
+						}
+						else
+						{
+							drawLockOn(xRes/4, yRes/2);
+						}
+						drawText ((xRes/3), (yRes/10), L"Locking on to Movement Mode", 56);
+					}
+				}
+				else
+				{
+					curTime = detector.getTimeIn100NSIntervals();
+					if ((curTime - detector.lockonStartTime) > lockonTime)
+					{
+						detector.state->set(MOVECENTER);
+						detector.startTime = detector.getTimeIn100NSIntervals();
+						if (showOverlays)
+						{
+							clearOverlay();
+
+							int ulx;
+							int ulx_small;
+							int ulx_ss;
+							int uly = (yRes/2) - (boxLarge/2);
+							int uly_small = (yRes/2) - (boxSmall/2);
+							int uly_ss = (yRes/2) - (boxSuperSmall/2);
+							if (detector.hand == RIGHT)
+							{
+								ulx = (xRes*3/4) - (boxLarge/2);
+								ulx_small = (xRes*3/4) - (boxSmall/2);
+								ulx_ss = (xRes*3/4) - (boxSuperSmall/2);
+							}
+							else
+							{
+								ulx = (xRes/4) - (boxLarge/2);
+								ulx_small = (xRes/4) - (boxSmall/2);
+								ulx_ss = (xRes/4) - (boxSuperSmall/2);
+							}
+							drawTrapezoid(ulx, uly, Q_TOP, 0);
+							drawTrapezoid(ulx, uly, Q_BOTTOM, 0);
+							// drawTrapezoid(ulx, uly, Q_RIGHT, 0);
+							// drawTrapezoid(ulx, uly, Q_LEFT, 0);
+							drawRectangle(ulx, uly, boxLarge, boxLarge, 1);
+							drawRectangle(ulx_small, uly_small, boxSmall, boxSmall, 1);
+							drawRectangle(ulx_ss, uly_ss, boxSuperSmall, boxSuperSmall, 1);
+							drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+						}
+					}
+				}
+				return;
+			}
+			// Nothing hit, so we're not locking on
+			detector.lockingOn_move = FALSE;
+			detector.lockingOn_magnify = FALSE;
+			if (showOverlays)
+			{
+				clearOverlay();
+				if (detector.hand == RIGHT)
+				{
+					drawRectangle ((xRes*3/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+				}
+				else
+				{
+					drawRectangle ((xRes/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+				}
+				drawRectangle ((xRes/2) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+			}
+		}
+		else 		// Only movement gestures
+		{
+			if (detector.areClose(centerPoint, handPoint, detectRange))
+			{
+				if (! detector.lockingOn_move)
+				{
+					detector.lockingOn_move = TRUE;
+					detector.lockonStartTime = detector.getTimeIn100NSIntervals();
+					if (showOverlays)
+					{
+						clearOverlay();
+						if (detector.hand == RIGHT)
+						{
+							drawLockOn(xRes*3/4, yRes/2);
+						}
+						else
+						{
+							drawLockOn(xRes/4, yRes/2);
+						}
+						drawText ((xRes/3), (yRes/10), L"Locking on to Movement Mode", 56);
+					}
+				}
+				else
+				{ // We're locking on
+					curTime = detector.getTimeIn100NSIntervals();
+					if ((curTime - detector.lockonStartTime) > lockonTime)
+					{
+						detector.state->set(MOVECENTER);
+						detector.startTime = detector.getTimeIn100NSIntervals();
+						if (showOverlays)
+						{
+							clearOverlay();
+
+							int ulx;
+							int ulx_small;
+							int ulx_ss;
+							int uly = (yRes/2) - (boxLarge/2);
+							int uly_small = (yRes/2) - (boxSmall/2);
+							int uly_ss = (yRes/2) - (boxSuperSmall/2);
+							if (detector.hand == RIGHT)
+							{
+								ulx = (xRes*3/4) - (boxLarge/2);
+								ulx_small = (xRes*3/4) - (boxSmall/2);
+								ulx_ss = (xRes*3/4) - (boxSuperSmall/2);
+							}
+							else
+							{
+								ulx = (xRes/4) - (boxLarge/2);
+								ulx_small = (xRes/4) - (boxSmall/2);
+								ulx_ss = (xRes/4) - (boxSuperSmall/2);
+							}
+							drawTrapezoid(ulx, uly, Q_TOP, 0);
+							drawTrapezoid(ulx, uly, Q_BOTTOM, 0);
+							// drawTrapezoid(ulx, uly, Q_RIGHT, 0);
+							// drawTrapezoid(ulx, uly, Q_LEFT, 0);
+							drawRectangle(ulx, uly, boxLarge, boxLarge, 1);
+							drawRectangle(ulx_small, uly_small, boxSmall, boxSmall, 1);
+							drawRectangle(ulx_ss, uly_ss, boxSuperSmall, boxSuperSmall, 1);
+							drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+						}
+					}
+				}
+				return;
+			}
+			// We're not close to anything, so turn off the lockon
+			detector.lockingOn_move = FALSE;
+			if (showOverlays)
+			{
+				clearOverlay();
+				if (detector.hand == RIGHT)
+				{
+					drawRectangle ((xRes*3/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+				}
+				else
+				{
+					drawRectangle ((xRes/4) - (boxLarge/2), (yRes/2) - (boxLarge/2), boxLarge, boxLarge, 0);
+				}
+			}
+		}
+		break;
+	// case BODYCENTER:
+	// 	spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+	// 	centerPoint = spinePoint;
+	// 	if (hand == RIGHT)
+	// 	{
+	// 		handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+	// 		centerPoint.x += centerRightOver;
+	// 	}
+	// 	else
+	// 	{
+	// 		handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+	// 		centerPoint.x -= centerLeftOver;
+	// 	}
+	// 	if (areClose(centerPoint, handPoint, detectRange))
+	// 	{
+	// 		if (hand == RIGHT)
+	// 		{
+	// 			// Center
+	// 			drawRectangle ((xRes*3/4) - (boxSmall/2), (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 1);
+	// 			// Vert
+	// 			drawRectangle ((xRes*3/4) - (boxSmall/2), (yRes/2) - (boxSmall/2) - overlayCircleRadius, boxSmall, boxSmall, 0);
+	// 			drawRectangle ((xRes*3/4) - (boxSmall/2), (yRes/2) - (boxSmall/2) + overlayCircleRadius, boxSmall, boxSmall, 0);
+	// 			// Horiz
+	// 			drawRectangle ((xRes*3/4) - (boxSmall/2) - overlayCircleRadius, (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 0);
+	// 			drawRectangle ((xRes*3/4) - (boxSmall/2) + overlayCircleRadius, (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 0);
+	// 		}
+	// 		else
+	// 		{
+	// 			// Center
+	// 			drawRectangle ((xRes/4) - (boxSmall/2), (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 1);
+	// 			// Vert
+	// 			drawRectangle ((xRes/4) - (boxSmall/2), (yRes/2) - (boxSmall/2) - overlayCircleRadius, boxSmall, boxSmall, 0);
+	// 			drawRectangle ((xRes/4) - (boxSmall/2), (yRes/2) - (boxSmall/2) + overlayCircleRadius, boxSmall, boxSmall, 0);
+	// 			// Horiz
+	// 			drawRectangle ((xRes/4) - (boxSmall/2) - overlayCircleRadius, (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 0);
+	// 			drawRectangle ((xRes/4) - (boxSmall/2) + overlayCircleRadius, (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 0);
+	// 		}
+	// 		state->set(MOVECENTER);
+	// 		startTime = getTimeIn100NSIntervals();
+	// 		return;
+	// 	}
+	// 	// Otherwise, keep looking (until the timeout)
+	// 	break;
+	case MOVECENTER:
+	case MOVEUP:
+	case MOVEDOWN:
+	case MOVERIGHT:
+	case MOVELEFT:
+		spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+		centerPoint = spinePoint;
+		if (detector.hand == RIGHT)
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+			centerPoint.x += centerRightOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_RIGHT, 1), displacement_x, displacement_y);
+		}
+		else
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+			centerPoint.x -= centerLeftOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_LEFT, 1), displacement_x, displacement_y);
+		}
+		// Specific direction
+		curQuadrant = detector.findQuadrant(centerPoint, handPoint);
+
+		// Place the direction arrows
+		if (curQuadrant == Q_TOP)
+		{
+			if (showOverlays)
+			{
+				int ulx;
+				int ulx_small;
+				int ulx_ss;
+				int uly = (yRes/2) - (boxLarge/2);
+				int uly_small = (yRes/2) - (boxSmall/2);
+				int uly_ss = (yRes/2) - (boxSuperSmall/2);
+				if (detector.hand == RIGHT)
+				{
+					ulx = (xRes*3/4) - (boxLarge/2);
+					ulx_small = (xRes*3/4) - (boxSmall/2);
+					ulx_ss = (xRes*3/4) - (boxSuperSmall/2);
+				}
+				else
+				{
+					ulx = (xRes/4) - (boxLarge/2);
+					ulx_small = (xRes/4) - (boxSmall/2);
+					ulx_ss = (xRes/4) - (boxSuperSmall/2);
+				}
+				// Overwrite old center stuff
+				drawRectangle(ulx_small, uly_small, boxSmall, boxSmall, 2);
+				drawRectangle(ulx_ss, uly_ss, boxSuperSmall, boxSuperSmall, 2);
+
+				drawRectangle(ulx, uly, boxLarge, boxLarge, 0);
+				drawTrapezoid(ulx, uly, Q_BOTTOM, 0);
+				/*drawTrapezoid(ulx, uly, Q_RIGHT, 0);
+				drawTrapezoid(ulx, uly, Q_LEFT, 0);*/
+				drawTrapezoid(ulx, uly, Q_TOP, 1);				
+				drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+			}
+			detector.state->set(MOVEUP);
+			if (MOVEMENT_STYLE == Velocity_Style)
+			{
+				if (displacement_y < 0)
+				{
+					moveAmount_y += 500*displacement_y;
+				}
+			}
+			else if (MOVEMENT_STYLE == Constant_Style)
+			{
+				moveAmount_x = 0;
+				moveAmount_y = -constantMovement;
+			}
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		else if (curQuadrant == Q_BOTTOM)
+		{
+			if (showOverlays)
+			{
+				int ulx;
+				int ulx_small;
+				int ulx_ss;
+				int uly = (yRes/2) - (boxLarge/2);
+				int uly_small = (yRes/2) - (boxSmall/2);
+				int uly_ss = (yRes/2) - (boxSuperSmall/2);
+				if (detector.hand == RIGHT)
+				{
+					ulx = (xRes*3/4) - (boxLarge/2);
+					ulx_small = (xRes*3/4) - (boxSmall/2);
+					ulx_ss = (xRes*3/4) - (boxSuperSmall/2);
+				}
+				else
+				{
+					ulx = (xRes/4) - (boxLarge/2);
+					ulx_small = (xRes/4) - (boxSmall/2);
+					ulx_ss = (xRes/4) - (boxSuperSmall/2);
+				}
+				// Overwrite old center stuff
+				drawRectangle(ulx_small, uly_small, boxSmall, boxSmall, 2);
+				drawRectangle(ulx_ss, uly_ss, boxSuperSmall, boxSuperSmall, 2);
+
+				drawRectangle(ulx, uly, boxLarge, boxLarge, 0);
+				drawTrapezoid(ulx, uly, Q_TOP, 0);
+				/*drawTrapezoid(ulx, uly, Q_RIGHT, 0);
+				drawTrapezoid(ulx, uly, Q_LEFT, 0);*/
+				drawTrapezoid(ulx, uly, Q_BOTTOM, 1);				
+				drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+			}
+			detector.state->set(MOVEDOWN);
+			if (MOVEMENT_STYLE == Velocity_Style)
+			{
+				if (displacement_y > 0)
+				{
+					moveAmount_y += 500*displacement_y;
+				}
+			}
+			else if (MOVEMENT_STYLE == Constant_Style)
+			{
+				moveAmount_x = 0;
+				moveAmount_y = constantMovement;
+			}
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		else if (curQuadrant == Q_RIGHT)
+		{
+			if (showOverlays)
+			{
+				int ulx;
+				int ulx_small;
+				int ulx_ss;
+				int uly = (yRes/2) - (boxLarge/2);
+				int uly_small = (yRes/2) - (boxSmall/2);
+				int uly_ss = (yRes/2) - (boxSuperSmall/2);
+				if (detector.hand == RIGHT)
+				{
+					ulx = (xRes*3/4) - (boxLarge/2);
+					ulx_small = (xRes*3/4) - (boxSmall/2);
+					ulx_ss = (xRes*3/4) - (boxSuperSmall/2);
+				}
+				else
+				{
+					ulx = (xRes/4) - (boxLarge/2);
+					ulx_small = (xRes/4) - (boxSmall/2);
+					ulx_ss = (xRes/4) - (boxSuperSmall/2);
+				}
+				// Overwrite old center stuff
+				drawRectangle(ulx_small, uly_small, boxSmall, boxSmall, 2);
+				drawRectangle(ulx_ss, uly_ss, boxSuperSmall, boxSuperSmall, 2);
+				
+				drawRectangle(ulx, uly, boxLarge, boxLarge, 0);
+				/*drawTrapezoid(ulx, uly, Q_TOP, 0);
+				drawTrapezoid(ulx, uly, Q_BOTTOM, 0);*/
+				drawTrapezoid(ulx, uly, Q_LEFT, 0);
+				drawTrapezoid(ulx, uly, Q_RIGHT, 1);				
+				drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+			}
+			detector.state->set(MOVERIGHT);
+			if (MOVEMENT_STYLE == Velocity_Style)
+			{
+				if (displacement_x > 0)
+				{
+					moveAmount_x += 500*displacement_x;
+				}
+			}
+			else if (MOVEMENT_STYLE == Constant_Style)
+			{
+				moveAmount_y = 0;
+				moveAmount_x = constantMovement;
+			}
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		else if (curQuadrant == Q_LEFT)
+		{
+			if (showOverlays)
+			{
+				int ulx;
+				int ulx_small;
+				int ulx_ss;
+				int uly = (yRes/2) - (boxLarge/2);
+				int uly_small = (yRes/2) - (boxSmall/2);
+				int uly_ss = (yRes/2) - (boxSuperSmall/2);
+				if (detector.hand == RIGHT)
+				{
+					ulx = (xRes*3/4) - (boxLarge/2);
+					ulx_small = (xRes*3/4) - (boxSmall/2);
+					ulx_ss = (xRes*3/4) - (boxSuperSmall/2);
+				}
+				else
+				{
+					ulx = (xRes/4) - (boxLarge/2);
+					ulx_small = (xRes/4) - (boxSmall/2);
+					ulx_ss = (xRes/4) - (boxSuperSmall/2);
+				}
+				// Overwrite old center stuff
+				drawRectangle(ulx_small, uly_small, boxSmall, boxSmall, 2);
+				drawRectangle(ulx_ss, uly_ss, boxSuperSmall, boxSuperSmall, 2);
+				
+				drawRectangle(ulx, uly, boxLarge, boxLarge, 0);
+				/*drawTrapezoid(ulx, uly, Q_TOP, 0);
+				drawTrapezoid(ulx, uly, Q_BOTTOM, 0);*/
+				drawTrapezoid(ulx, uly, Q_RIGHT, 0);
+				drawTrapezoid(ulx, uly, Q_LEFT, 1);
+				drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+			}
+			detector.state->set(MOVELEFT);
+			if (MOVEMENT_STYLE == Velocity_Style)
+			{
+				if (displacement_x < 0)
+				{
+					moveAmount_x += 500*displacement_x;
+				}
+			}
+			else if (MOVEMENT_STYLE == Constant_Style)
+			{
+				moveAmount_y = 0;
+				moveAmount_x = -constantMovement;
+			}
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		// Back to MOVECENTER
+		else if (curQuadrant == Q_CENTER)
+		{
+			if (MOVEMENT_STYLE == Constant_Style)
+			{
+				moveAmount_y = 0;
+				moveAmount_x = 0;
+			}
+			if (showOverlays)
+			{
+				int ulx;
+				int ulx_small;
+				int ulx_ss;
+				int uly = (yRes/2) - (boxLarge/2);
+				int uly_small = (yRes/2) - (boxSmall/2);
+				int uly_ss = (yRes/2) - (boxSuperSmall/2);
+				if (detector.hand == RIGHT)
+				{
+					ulx = (xRes*3/4) - (boxLarge/2);
+					ulx_small = (xRes*3/4) - (boxSmall/2);
+					ulx_ss = (xRes*3/4) - (boxSuperSmall/2);
+				}
+				else
+				{
+					ulx = (xRes/4) - (boxLarge/2);
+					ulx_small = (xRes/4) - (boxSmall/2);
+					ulx_ss = (xRes/4) - (boxSuperSmall/2);
+				}
+				if (! amClicking)
+				{
+					drawRectangle(ulx_small, uly_small, boxSmall, boxSmall, 1);
+					drawRectangle(ulx_ss, uly_ss, boxSuperSmall, boxSuperSmall, 1);
+				}
+				
+				drawTrapezoid(ulx, uly, Q_TOP, 0);
+				drawTrapezoid(ulx, uly, Q_BOTTOM, 0);
+				/*drawTrapezoid(ulx, uly, Q_RIGHT, 0);
+				drawTrapezoid(ulx, uly, Q_LEFT, 0);*/
+				drawRectangle(ulx, uly, boxLarge, boxLarge, 1);
+				drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+			}
+			detector.state->set(MOVECENTER);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		// Otherwise, keep looking (until the timeout)
+		break;
+		// case MOVE:
+		// 	spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+		// 	centerPoint = spinePoint;
+		// 	if (hand == RIGHT)
+		// 	{
+		// 		handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+		// 		centerPoint.x += centerRightOver;
+		// 	}
+		// 	else
+		// 	{
+		// 		handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+		// 		centerPoint.x -= centerLeftOver;
+		// 	}
+		// 	// Back to MOVECENTER
+		// 	if (areClose(centerPoint, handPoint, detectRange))
+		// 	{
+		// 		state->set(MOVECENTER);
+		// 		startTime = getTimeIn100NSIntervals();
+		// 		return;
+		// 	}
+		// 	// Otherwise, keep looking (until the timeout)
+		// 	break;
+	// case MAGNIFYCENTER:
+	// 	spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+	// 	centerPoint = spinePoint;
+	// 	if (hand == RIGHT)
+	// 	{
+	// 		handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+	// 		centerPoint.x += centerRightOver;
+	// 	}
+	// 	else
+	// 	{
+	// 		handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+	// 		centerPoint.x -= centerLeftOver;
+	// 	}
+	// 	// Place the direction arrows
+	// 	upPoint = centerPoint;
+	// 	upPoint.y += directionRadius;
+	// 	if (areClose(upPoint, handPoint, detectRange))
+	// 	{
+	// 		state->set(MAGNIFYUP);
+	// 		return;
+	// 	}
+	// 	downPoint = centerPoint;
+	// 	downPoint.y -= directionRadius;
+	// 	if (areClose(downPoint, handPoint, detectRange))
+	// 	{
+	// 		state->set(MAGNIFYDOWN);
+	// 		startTime = getTimeIn100NSIntervals();
+	// 		return;
+	// 	}
+	// 	rightPoint = centerPoint;
+	// 	rightPoint.x += directionRadius;
+	// 	if (areClose(rightPoint, handPoint, detectRange))
+	// 	{
+	// 		state->set(MAGNIFYRIGHT);
+	// 		startTime = getTimeIn100NSIntervals();
+	// 		return;
+	// 	}
+	// 	leftPoint = centerPoint;
+	// 	leftPoint.x -= directionRadius;
+	// 	if (areClose(leftPoint, handPoint, detectRange))
+	// 	{
+	// 		state->set(MAGNIFYLEFT);
+	// 		startTime = getTimeIn100NSIntervals();
+	// 		return;
+	// 	}
+	// 	if (showOverlays)
+	// 	{
+	// 		clearOverlay();
+	// 		drawText ((xRes/3), (yRes/10), L"Rotate clockwise to decrease magnification and vice-versa to increase", 56);
+	// 		// Center
+	// 		drawRectangle ((xRes*3/4) - (boxSmall/2), (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 0);
+	// 		// Vert
+	// 		drawRectangle ((xRes*3/4) - (boxSmall/2), (yRes/2) - (boxSmall/2) - overlayCircleRadius, boxSmall, boxSmall, 0);
+	// 		drawRectangle ((xRes*3/4) - (boxSmall/2), (yRes/2) - (boxSmall/2) + overlayCircleRadius, boxSmall, boxSmall, 0);
+	// 		// Horiz
+	// 		drawRectangle ((xRes*3/4) - (boxSmall/2) - overlayCircleRadius, (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 0);
+	// 		drawRectangle ((xRes*3/4) - (boxSmall/2) + overlayCircleRadius, (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 0);
+	// 	}
+	// 	// Otherwise, keep looking (until the timeout)
+	// 	break;
+	case MAGNIFYUP:
+		spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+		centerPoint = spinePoint;
+		if (detector.hand == RIGHT)
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+			centerPoint.x += centerRightOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_RIGHT, 1), displacement_x, displacement_y);
+		}
+		else
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+			centerPoint.x -= centerLeftOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_LEFT, 1), displacement_x, displacement_y);
+		}
+		// Place the direction arrows
+		// upPoint = centerPoint;
+		// upPoint.y += directionRadius;
+		// if (areClose(upPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYUP);
+		// 	return;
+		// }
+		// downPoint = centerPoint;
+		// downPoint.y -= directionRadius;
+		// if (areClose(downPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYDOWN);
+		// 	startTime = getTimeIn100NSIntervals();
+		// 	return;
+		// }
+		rightPoint = centerPoint;
+		rightPoint.x += directionRadius;
+		if (detector.areClose(rightPoint, handPoint, detectRange))
+		{
+			detector.state->set(MAGNIFYRIGHT);
+			// Clockwise is increase magnification
+			magnifyAmount += abs(displacement_x + displacement_y);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		leftPoint = centerPoint;
+		leftPoint.x -= directionRadius;
+		if (detector.areClose(leftPoint, handPoint, detectRange))
+		{
+			detector.state->set(MAGNIFYLEFT);
+			// Counterclockwise is decrease magnification
+			magnifyAmount -= abs(displacement_x + displacement_y);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		if (showOverlays)
+		{
+			clearOverlay();
+			drawText ((xRes/3), (yRes/10), L"Clockwise = zoom in", 56);
+			drawText ((xRes/3), (yRes*9/10), L"Counter-Clockwise = zoom out", 56);
+			int ulx;
+			int uly = (yRes/2) - (boxSmall/2);
+			if (detector.hand == RIGHT)
+			{
+				ulx = (xRes*3/4) - (boxSmall/2);
+			}
+			else
+			{
+				ulx = (xRes/4) - (boxSmall/2);
+			}
+			// Vert
+			drawRectangle (ulx, uly - overlayCircleRadius, boxSmall, boxSmall, 1);
+			drawRectangle (ulx, uly + overlayCircleRadius, boxSmall, boxSmall, 0);
+			// Horiz
+			drawRectangle (ulx - overlayCircleRadius, uly, boxSmall, boxSmall, 0);
+			drawRectangle (ulx + overlayCircleRadius, uly, boxSmall, boxSmall, 0);
+		}
+		// Otherwise, keep looking (until the timeout)
+		break;
+	case MAGNIFYDOWN:
+		spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+		centerPoint = spinePoint;
+		if (detector.hand == RIGHT)
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+			centerPoint.x += centerRightOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_RIGHT, 1), displacement_x, displacement_y);
+		}
+		else
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+			centerPoint.x -= centerLeftOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_LEFT, 1), displacement_x, displacement_y);
+		}
+		// Place the direction arrows
+		// upPoint = centerPoint;
+		// upPoint.y += directionRadius;
+		// if (areClose(upPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYUP);
+		// 	return;
+		// }
+		// downPoint = centerPoint;
+		// downPoint.y -= directionRadius;
+		// if (areClose(downPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYDOWN);
+		// 	startTime = getTimeIn100NSIntervals();
+		// 	return;
+		// }
+		rightPoint = centerPoint;
+		rightPoint.x += directionRadius;
+		if (detector.areClose(rightPoint, handPoint, detectRange))
+		{
+			detector.state->set(MAGNIFYRIGHT);
+			// Counterclockwise is increase magnification
+			magnifyAmount -= abs(displacement_x + displacement_y);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		leftPoint = centerPoint;
+		leftPoint.x -= directionRadius;
+		if (detector.areClose(leftPoint, handPoint, detectRange))
+		{
+			detector.state->set(MAGNIFYLEFT);
+			// Clockwise is decrease magnification
+			magnifyAmount += abs(displacement_x + displacement_y);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		if (showOverlays)
+		{
+			clearOverlay();
+			drawText ((xRes/3), (yRes/10), L"Clockwise = zoom in", 56);
+			drawText ((xRes/3), (yRes*9/10), L"Counter-Clockwise = zoom out", 56);
+			int ulx;
+			int uly = (yRes/2) - (boxSmall/2);
+			if (detector.hand == RIGHT)
+			{
+				ulx = (xRes*3/4) - (boxSmall/2);
+			}
+			else
+			{
+				ulx = (xRes/4) - (boxSmall/2);
+			}
+			// Vert
+			drawRectangle (ulx, uly - overlayCircleRadius, boxSmall, boxSmall, 0);
+			drawRectangle (ulx, uly + overlayCircleRadius, boxSmall, boxSmall, 1);
+			// Horiz
+			drawRectangle (ulx - overlayCircleRadius, uly, boxSmall, boxSmall, 0);
+			drawRectangle (ulx + overlayCircleRadius, uly, boxSmall, boxSmall, 0);
+		}
+		// Otherwise, keep looking (until the timeout)
+		break;
+	case MAGNIFYLEFT:
+		spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+		centerPoint = spinePoint;
+		if (detector.hand == RIGHT)
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+			centerPoint.x += centerRightOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_RIGHT, 1), displacement_x, displacement_y);
+		}
+		else
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+			centerPoint.x -= centerLeftOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_LEFT, 1), displacement_x, displacement_y);
+		}
+		// Place the direction arrows
+		upPoint = centerPoint;
+		upPoint.y += directionRadius;
+		if (detector.areClose(upPoint, handPoint, detectRange))
+		{
+			detector.state->set(MAGNIFYUP);
+			// Clockwise is increase magnification
+			magnifyAmount += abs(displacement_x + displacement_y);
+			return;
+		}
+		downPoint = centerPoint;
+		downPoint.y -= directionRadius;
+		if (detector.areClose(downPoint, handPoint, detectRange))
+		{
+			detector.state->set(MAGNIFYDOWN);
+			// Counterclockwise is decrease magnification
+			magnifyAmount -= abs(displacement_x + displacement_y);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		// rightPoint = centerPoint;
+		// rightPoint.x += directionRadius;
+		// if (areClose(rightPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYRIGHT);
+		// 	// Clockwise is increase magnification
+		// 	magnifyAmount += abs(displacement_x + displacement_y);
+		// 	startTime = getTimeIn100NSIntervals();
+		// 	return;
+		// }
+		// leftPoint = centerPoint;
+		// leftPoint.x -= directionRadius;
+		// if (areClose(leftPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYLEFT);
+		// 	// Counterclockwise is decrease magnification
+		// 	magnifyAmount -= abs(displacement_x + displacement_y);
+		// 	startTime = getTimeIn100NSIntervals();
+		// 	return;
+		// }
+		if (showOverlays)
+		{
+			clearOverlay();
+			drawText ((xRes/3), (yRes/10), L"Clockwise = zoom in", 56);
+			drawText ((xRes/3), (yRes*9/10), L"Counter-Clockwise = zoom out", 56);
+			int ulx;
+			int uly = (yRes/2) - (boxSmall/2);
+			if (detector.hand == RIGHT)
+			{
+				ulx = (xRes*3/4) - (boxSmall/2);
+			}
+			else
+			{
+				ulx = (xRes/4) - (boxSmall/2);
+			}
+			// Vert
+			drawRectangle (ulx, uly - overlayCircleRadius, boxSmall, boxSmall, 0);
+			drawRectangle (ulx, uly + overlayCircleRadius, boxSmall, boxSmall, 0);
+			// Horiz
+			drawRectangle (ulx - overlayCircleRadius, uly, boxSmall, boxSmall, 1);
+			drawRectangle (ulx + overlayCircleRadius, uly, boxSmall, boxSmall, 0);
+		}
+		// Otherwise, keep looking (until the timeout)
+		break;
+	case MAGNIFYRIGHT:
+		spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+		centerPoint = spinePoint;
+		if (detector.hand == RIGHT)
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+			centerPoint.x += centerRightOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_RIGHT, 1), displacement_x, displacement_y);
+		}
+		else
+		{
+			handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+			centerPoint.x -= centerLeftOver;
+			// Add velocity
+			detector.getDifference(handPoint, history.position(detector.id, NUI_SKELETON_POSITION_HAND_LEFT, 1), displacement_x, displacement_y);
+		}
+		// Place the direction arrows
+		upPoint = centerPoint;
+		upPoint.y += directionRadius;
+		if (detector.areClose(upPoint, handPoint, detectRange))
+		{
+			// Counterclockwise is decrease magnification
+			magnifyAmount -= abs(displacement_x + displacement_y);
+			detector.state->set(MAGNIFYUP);
+			return;
+		}
+		downPoint = centerPoint;
+		downPoint.y -= directionRadius;
+		if (detector.areClose(downPoint, handPoint, detectRange))
+		{
+			detector.state->set(MAGNIFYDOWN);
+			// Clockwise is increase magnification
+			magnifyAmount += abs(displacement_x + displacement_y);
+			detector.startTime = detector.getTimeIn100NSIntervals();
+			return;
+		}
+		// rightPoint = centerPoint;
+		// rightPoint.x += directionRadius;
+		// if (areClose(rightPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYRIGHT);
+		// 	// Clockwise is increase magnification
+		// 	magnifyAmount += abs(displacement_x + displacement_y);
+		// 	startTime = getTimeIn100NSIntervals();
+		// 	return;
+		// }
+		// leftPoint = centerPoint;
+		// leftPoint.x -= directionRadius;
+		// if (areClose(leftPoint, handPoint, detectRange))
+		// {
+		// 	state->set(MAGNIFYLEFT);
+		// 	// Counterclockwise is decrease magnification
+		// 	magnifyAmount -= abs(displacement_x + displacement_y);
+		// 	startTime = getTimeIn100NSIntervals();
+		// 	return;
+		// }
+		if (showOverlays)
+		{
+			clearOverlay();
+			drawText ((xRes/3), (yRes/10), L"Clockwise = zoom in", 56);
+			drawText ((xRes/3), (yRes*9/10), L"Counter-Clockwise = zoom out", 56);
+			int ulx;
+			int uly = (yRes/2) - (boxSmall/2);
+			if (detector.hand == RIGHT)
+			{
+				ulx = (xRes*3/4) - (boxSmall/2);
+			}
+			else
+			{
+				ulx = (xRes/4) - (boxSmall/2);
+			}
+			// Vert
+			drawRectangle (ulx, uly - overlayCircleRadius, boxSmall, boxSmall, 0);
+			drawRectangle (ulx, uly + overlayCircleRadius, boxSmall, boxSmall, 0);
+			// Horiz
+			drawRectangle (ulx - overlayCircleRadius, uly, boxSmall, boxSmall, 0);
+			drawRectangle (ulx + overlayCircleRadius, uly, boxSmall, boxSmall, 1);
+		}
+		// Otherwise, keep looking (until the timeout)
+		break;
+	}
+}
+
+// detect(), but with the switch instead of the table
+void DetectWithSwitch(GestureDetector &detector, const NUI_SKELETON_FRAME &SkeletonFrame, const JointHistory &history)
+{
+	SkeletonView skeleton(SkeletonFrame, detector.id);
+	BOOL clicking;
+	if (detector.detectAnyState(skeleton, NULL, clicking))
+	{
+		SwitchStateMachine(detector, skeleton, history, clicking);
+	}
+}
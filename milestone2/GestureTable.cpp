@@ -0,0 +1,534 @@
+#include "GestureTable.h"
+#include <cmath>
+#include "Magnifier.h"
+#include "GestureBatch.h"
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern int activeSkeleton;
+extern FLOAT moveAmount_x;
+extern FLOAT moveAmount_y;
+extern float magnifyAmount;
+extern BOOL allowMagnifyGestures;
+extern BOOL showOverlays;
+extern int xRes;
+extern int yRes;
+
+/*** The points the hand is checked against ***/
+
+// Hand to the head starts a salute
+static const GesturePoint headTarget = { NUI_SKELETON_POSITION_HEAD, 0, 0, 0, 0, 0 };
+// Then up and away to finish it
+static const GesturePoint saluteTarget = { NUI_SKELETON_POSITION_HEAD, saluteOver, -saluteOver, saluteUp, 0, 0 };
+// Hand on the stomach locks on to magnifying
+static const GesturePoint spineTarget = { NUI_SKELETON_POSITION_SPINE, 0, 0, 0, 0, 0 };
+// Hand out to the side locks on to moving, and is the middle of the movement box
+static const GesturePoint centerTarget = { NUI_SKELETON_POSITION_SPINE, centerRightOver, -centerLeftOver, 0, 0, 0 };
+// The magnification dial around it
+static const GesturePoint dialUp = { NUI_SKELETON_POSITION_SPINE, centerRightOver, -centerLeftOver, 0, 0, directionRadius };
+static const GesturePoint dialDown = { NUI_SKELETON_POSITION_SPINE, centerRightOver, -centerLeftOver, 0, 0, -directionRadius };
+static const GesturePoint dialLeft = { NUI_SKELETON_POSITION_SPINE, centerRightOver, -centerLeftOver, 0, -directionRadius, 0 };
+static const GesturePoint dialRight = { NUI_SKELETON_POSITION_SPINE, centerRightOver, -centerLeftOver, 0, directionRadius, 0 };
+
+/*** The rules ***/
+
+// Turning the dial clockwise zooms in, anticlockwise zooms out
+const GestureRule gestureRules[] = {
+	//  from                    condition        guard           hand         point          quadrant  lock          to            motion         magnify  effects                                               overlay                  dynamic
+	{ STATE_BIT(OFF),          ANY_MODE,        GUARD_ALWAYS,   ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      keepState,    NO_MOTION,      0,  EFFECT_STOP_IF_ACTIVE | EFFECT_CONTINUE,                  OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(OFF),          ANY_MODE,        GUARD_NEAR,     RIGHT_HAND,  &headTarget,   Q_CENTER, NO_LOCK,      SALUTE1,      NO_MOTION,      0,  EFFECT_SET_HAND | EFFECT_RESET_TIMER,                   OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(OFF),          ANY_MODE,        GUARD_NEAR,     LEFT_HAND,   &headTarget,   Q_CENTER, NO_LOCK,      SALUTE1,      NO_MOTION,      0,  EFFECT_SET_HAND | EFFECT_RESET_TIMER,                   OVERLAY_NONE,            DYNAMIC_NONE },
+
+	{ STATE_BIT(SALUTE1),      ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &saluteTarget, Q_CENTER, NO_LOCK,      SALUTE2,      NO_MOTION,      0,  EFFECT_TAKE_FOCUS | EFFECT_RESET_TIMER,                 OVERLAY_SALUTED,         DYNAMIC_NONE },
+
+	// A swipe or a circle picks a mode straight away, rather than after lockonTime
+	{ STATE_BIT(SALUTE2),      ANY_MODE,        GUARD_DYNAMIC,  ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      MOVECENTER,   NO_MOTION,      0,  EFFECT_CLEAR_MOVE_LOCK | EFFECT_CLEAR_MAGNIFY_LOCK | EFFECT_RESET_TIMER, OVERLAY_MOVE_MODE, DYNAMIC_SWIPE },
+	{ STATE_BIT(SALUTE2),      MAGNIFY_ALLOWED, GUARD_DYNAMIC,  ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      MAGNIFYLEFT,  NO_MOTION,      0,  EFFECT_CLEAR_MOVE_LOCK | EFFECT_CLEAR_MAGNIFY_LOCK | EFFECT_RESET_TIMER, OVERLAY_MAGNIFY_MODE, DYNAMIC_CIRCLE },
+	{ STATE_BIT(SALUTE2),      MAGNIFY_ALLOWED, GUARD_NEAR,     ACTIVE_HAND, &spineTarget,  Q_CENTER, LOCK_MAGNIFY, MAGNIFYLEFT,  NO_MOTION,      0,  EFFECT_RESET_TIMER,                                     OVERLAY_MAGNIFY_MODE,    DYNAMIC_NONE },
+	{ STATE_BIT(SALUTE2),      ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &centerTarget, Q_CENTER, LOCK_MOVE,    MOVECENTER,   NO_MOTION,      0,  EFFECT_RESET_TIMER,                                     OVERLAY_MOVE_MODE,       DYNAMIC_NONE },
+	{ STATE_BIT(SALUTE2),      MAGNIFY_ALLOWED, GUARD_ALWAYS,   ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      keepState,    NO_MOTION,      0,  EFFECT_CLEAR_MOVE_LOCK | EFFECT_CLEAR_MAGNIFY_LOCK,     OVERLAY_SALUTE_WAITING,  DYNAMIC_NONE },
+	{ STATE_BIT(SALUTE2),      MOVE_ONLY,       GUARD_ALWAYS,   ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      keepState,    NO_MOTION,      0,  EFFECT_CLEAR_MOVE_LOCK,                                 OVERLAY_SALUTE_WAITING,  DYNAMIC_NONE },
+
+	// A wave goes back to picking a mode
+	{ MOVE_STATES | MAGNIFY_STATES, ANY_MODE,   GUARD_DYNAMIC,  ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      SALUTE2,      NO_MOTION,      0,  EFFECT_STOP_IF_ACTIVE | EFFECT_RESET_TIMER,             OVERLAY_SALUTED,         DYNAMIC_WAVE },
+
+	{ MOVE_STATES,             ANY_MODE,        GUARD_QUADRANT, ACTIVE_HAND, &centerTarget, Q_TOP,    NO_LOCK,      MOVEUP,       MOTION_UP,      0,  EFFECT_RESET_TIMER,                                     OVERLAY_MOVE_UP,         DYNAMIC_NONE },
+	{ MOVE_STATES,             ANY_MODE,        GUARD_QUADRANT, ACTIVE_HAND, &centerTarget, Q_BOTTOM, NO_LOCK,      MOVEDOWN,     MOTION_DOWN,    0,  EFFECT_RESET_TIMER,                                     OVERLAY_MOVE_DOWN,       DYNAMIC_NONE },
+	{ MOVE_STATES,             ANY_MODE,        GUARD_QUADRANT, ACTIVE_HAND, &centerTarget, Q_RIGHT,  NO_LOCK,      MOVERIGHT,    MOTION_RIGHT,   0,  EFFECT_RESET_TIMER,                                     OVERLAY_MOVE_RIGHT,      DYNAMIC_NONE },
+	{ MOVE_STATES,             ANY_MODE,        GUARD_QUADRANT, ACTIVE_HAND, &centerTarget, Q_LEFT,   NO_LOCK,      MOVELEFT,     MOTION_LEFT,    0,  EFFECT_RESET_TIMER,                                     OVERLAY_MOVE_LEFT,       DYNAMIC_NONE },
+	{ MOVE_STATES,             ANY_MODE,        GUARD_QUADRANT, ACTIVE_HAND, &centerTarget, Q_CENTER, NO_LOCK,      MOVECENTER,   MOTION_CENTER,  0,  EFFECT_RESET_TIMER,                                     OVERLAY_MOVE_CENTER,     DYNAMIC_NONE },
+
+	{ STATE_BIT(MAGNIFYUP),    ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialRight,    Q_CENTER, NO_LOCK,      MAGNIFYRIGHT, NO_MOTION,      1,  EFFECT_RESET_TIMER,                                     OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYUP),    ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialLeft,     Q_CENTER, NO_LOCK,      MAGNIFYLEFT,  NO_MOTION,     -1,  EFFECT_RESET_TIMER,                                     OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYUP),    ANY_MODE,        GUARD_ALWAYS,   ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      keepState,    NO_MOTION,      0,  0,                                                      OVERLAY_MAGNIFY_UP,      DYNAMIC_NONE },
+
+	{ STATE_BIT(MAGNIFYDOWN),  ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialRight,    Q_CENTER, NO_LOCK,      MAGNIFYRIGHT, NO_MOTION,     -1,  EFFECT_RESET_TIMER,                                     OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYDOWN),  ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialLeft,     Q_CENTER, NO_LOCK,      MAGNIFYLEFT,  NO_MOTION,      1,  EFFECT_RESET_TIMER,                                     OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYDOWN),  ANY_MODE,        GUARD_ALWAYS,   ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      keepState,    NO_MOTION,      0,  0,                                                      OVERLAY_MAGNIFY_DOWN,    DYNAMIC_NONE },
+
+	// (Going up from the sides has never put off the timeout)
+	{ STATE_BIT(MAGNIFYLEFT),  ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialUp,       Q_CENTER, NO_LOCK,      MAGNIFYUP,    NO_MOTION,      1,  0,                                                      OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYLEFT),  ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialDown,     Q_CENTER, NO_LOCK,      MAGNIFYDOWN,  NO_MOTION,     -1,  EFFECT_RESET_TIMER,                                     OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYLEFT),  ANY_MODE,        GUARD_ALWAYS,   ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      keepState,    NO_MOTION,      0,  0,                                                      OVERLAY_MAGNIFY_LEFT,    DYNAMIC_NONE },
+
+	{ STATE_BIT(MAGNIFYRIGHT), ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialUp,       Q_CENTER, NO_LOCK,      MAGNIFYUP,    NO_MOTION,     -1,  0,                                                      OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYRIGHT), ANY_MODE,        GUARD_NEAR,     ACTIVE_HAND, &dialDown,     Q_CENTER, NO_LOCK,      MAGNIFYDOWN,  NO_MOTION,      1,  EFFECT_RESET_TIMER,                                     OVERLAY_NONE,            DYNAMIC_NONE },
+	{ STATE_BIT(MAGNIFYRIGHT), ANY_MODE,        GUARD_ALWAYS,   ACTIVE_HAND, NULL,          Q_CENTER, NO_LOCK,      keepState,    NO_MOTION,      0,  0,                                                      OVERLAY_MAGNIFY_RIGHT,   DYNAMIC_NONE },
+};
+const int numGestureRules = sizeof(gestureRules) / sizeof(gestureRules[0]);
+
+GestureTable gestureTable(gestureRules, numGestureRules);
+
+/*** Compiling ***/
+
+GestureTable::GestureTable(const GestureRule* rules, int numRules)
+{
+	compiled = TRUE;
+	numGuards = 0;
+	int numTransitions = 0;
+	for (int s = 0; s < numGestureStates; s++)
+	{
+		GestureStateTable &table = states[s];
+		ZeroMemory(&table, sizeof(table));
+		table.first = numTransitions;
+		for (int r = 0; r < numRules; r++)
+		{
+			const GestureRule &rule = rules[r];
+			if (! (rule.fromStates & STATE_BIT(s)))
+			{
+				continue;
+			}
+			if (numTransitions == maxGestureTransitions)
+			{
+				compiled = FALSE;
+				break;
+			}
+
+			// Each point gets worked out once a frame, however many rows use it
+			int target = -1;
+			int guard = -1;
+			if (rule.point != NULL)
+			{
+				RuleHand hand = (rule.guard == GUARD_QUADRANT) ? ACTIVE_HAND : rule.hand;
+				for (int g = 0; g < numGuards; g++)
+				{
+					if (guardPoints[g] == rule.point && guardHands[g] == hand)
+					{
+						guard = g;
+					}
+				}
+				if (guard == -1)
+				{
+					if (numGuards == maxTableGuards)
+					{
+						compiled = FALSE;
+						continue;
+					}
+					guard = numGuards++;
+					guardPoints[guard] = rule.point;
+					guardHands[guard] = hand;
+				}
+
+				for (int t = 0; t < table.numTargets; t++)
+				{
+					if (table.targetPoints[t] == rule.point && table.targetHands[t] == hand)
+					{
+						target = t;
+					}
+				}
+				if (target == -1)
+				{
+					if (table.numTargets == maxStateTargets)
+					{
+						compiled = FALSE;
+						continue;
+					}
+					target = table.numTargets++;
+					table.targetPoints[target] = rule.point;
+					table.targetHands[target] = hand;
+				}
+			}
+			if (rule.motion != NO_MOTION || rule.magnify != 0)
+			{
+				table.needsDisplacement = TRUE;
+			}
+
+			transitions[numTransitions].rule = &rule;
+			transitions[numTransitions].target = target;
+			transitions[numTransitions].guard = guard;
+			numTransitions++;
+		}
+		table.end = numTransitions;
+	}
+}
+
+/*** Running ***/
+
+void GestureTable::run(GestureDetector &detector, const SkeletonView &skeleton, const JointHistory &history, BOOL amClicking,
+					   const GestureBatch* batch)
+{
+	const GestureStateTable &table = states[detector.state->state];
+
+	// Everything this state looks at, in one pass over its joints
+	Vector4 hands[3];
+	hands[RIGHT_HAND] = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+	hands[LEFT_HAND] = skeleton.joint(NUI_SKELETON_POSITION_HAND_LEFT);
+	hands[ACTIVE_HAND] = (detector.hand == RIGHT) ? hands[RIGHT_HAND] : hands[LEFT_HAND];
+
+	Vector4 targets[maxStateTargets];
+	for (int t = 0; t < table.numTargets && batch == NULL; t++)
+	{
+		const GesturePoint &point = *table.targetPoints[t];
+		BOOL right = (table.targetHands[t] == ACTIVE_HAND) ? (detector.hand == RIGHT) : (table.targetHands[t] == RIGHT_HAND);
+		targets[t] = skeleton.joint(point.joint);
+		targets[t].x += right ? point.rightX : point.leftX;
+		targets[t].y += point.y;
+		targets[t].x += point.extraX;
+		targets[t].y += point.extraY;
+	}
+
+	FLOAT displacement_x = 0;
+	FLOAT displacement_y = 0;
+	if (table.needsDisplacement)
+	{
+		int handJoint = (detector.hand == RIGHT) ? NUI_SKELETON_POSITION_HAND_RIGHT : NUI_SKELETON_POSITION_HAND_LEFT;
+		detector.getDifference(hands[ACTIVE_HAND], history.position(detector.id, handJoint, 1), displacement_x, displacement_y);
+	}
+
+	// Worked out the first time a row asks
+	int quadrant = -1;
+
+	for (int i = table.first; i < table.end; i++)
+	{
+		const GestureTransition &transition = transitions[i];
+		const GestureRule &rule = *transition.rule;
+
+		if ((rule.condition == MAGNIFY_ALLOWED && ! allowMagnifyGestures)
+			|| (rule.condition == MOVE_ONLY && allowMagnifyGestures))
+		{
+			continue;
+		}
+
+		switch (rule.guard)
+		{
+		case GUARD_ALWAYS:
+			break;
+		case GUARD_NEAR:
+			if (batch != NULL)
+			{
+				if (! batch->isNear(detector.id, transition.guard))
+				{
+					continue;
+				}
+			}
+			else if (! detector.areClose(targets[transition.target], hands[rule.hand], detectRange))
+			{
+				continue;
+			}
+			break;
+		case GUARD_DYNAMIC:
+			if (detector.dynamicGesture != rule.dynamic
+				|| detector.dynamicHand != ((rule.hand == ACTIVE_HAND) ? detector.hand : (rule.hand == RIGHT_HAND) ? RIGHT : LEFT))
+			{
+				continue;
+			}
+			break;
+		case GUARD_QUADRANT:
+			if (quadrant == -1)
+			{
+				quadrant = (batch != NULL) ? batch->quadrant(detector.id, transition.guard)
+					: detector.findQuadrant(targets[transition.target], hands[ACTIVE_HAND]);
+			}
+			if (quadrant != rule.quadrant)
+			{
+				continue;
+			}
+			break;
+		}
+
+		if (! fire(detector, rule, displacement_x, displacement_y, amClicking))
+		{
+			return;
+		}
+	}
+}
+
+// Does what a rule says.  Returns TRUE if the next rows should be looked at too.
+BOOL GestureTable::fire(GestureDetector &detector, const GestureRule &rule, FLOAT displacement_x, FLOAT displacement_y, BOOL amClicking)
+{
+	long long now = detector.getTimeIn100NSIntervals();
+
+	if (rule.lock != NO_LOCK)
+	{
+		BOOL &lockingOn = (rule.lock == LOCK_MOVE) ? detector.lockingOn_move : detector.lockingOn_magnify;
+		if (! lockingOn)
+		{
+			lockingOn = TRUE;
+			detector.lockonStartTime = now;
+			if (showOverlays)
+			{
+				DrawGestureOverlay((rule.lock == LOCK_MOVE) ? OVERLAY_LOCKING_MOVE : OVERLAY_LOCKING_MAGNIFY, detector.hand, amClicking);
+			}
+			return FALSE;
+		}
+		// Still locking on; nothing else gets a look in meanwhile
+		if ((now - detector.lockonStartTime) <= lockonTime)
+		{
+			return FALSE;
+		}
+	}
+
+	if (rule.effects & EFFECT_SET_HAND)
+	{
+		detector.hand = (rule.hand == LEFT_HAND) ? LEFT : RIGHT;
+	}
+	if ((rule.effects & EFFECT_STOP_IF_ACTIVE) && detector.id == activeSkeleton)
+	{
+		moveAmount_y = 0;
+		moveAmount_x = 0;
+	}
+	if (rule.effects & EFFECT_CLEAR_MOVE_LOCK)
+	{
+		detector.lockingOn_move = FALSE;
+	}
+	if (rule.effects & EFFECT_CLEAR_MAGNIFY_LOCK)
+	{
+		detector.lockingOn_magnify = FALSE;
+	}
+
+	if (showOverlays && rule.overlay != OVERLAY_NONE)
+	{
+		DrawGestureOverlay(rule.overlay, detector.hand, amClicking);
+	}
+
+	if (rule.to != keepState)
+	{
+		detector.state->set((GestureStateEnum) rule.to);
+	}
+
+	// Change the active user.  This is a race condition, but what it's
+	// doing is also inherently one.
+	if ((rule.effects & EFFECT_TAKE_FOCUS) && activeSkeleton != detector.id)
+	{
+		activeSkeleton = detector.id;
+		clearOverlay();
+		moveAmount_x = 0;
+		moveAmount_y = 0;
+	}
+
+	switch (rule.motion)
+	{
+	case NO_MOTION:
+		break;
+	case MOTION_CENTER:
+		if (MOVEMENT_STYLE == Constant_Style)
+		{
+			moveAmount_y = 0;
+			moveAmount_x = 0;
+		}
+		break;
+	case MOTION_UP:
+		if (MOVEMENT_STYLE == Velocity_Style)
+		{
+			if (displacement_y < 0)
+			{
+				moveAmount_y += 500*displacement_y;
+			}
+		}
+		else if (MOVEMENT_STYLE == Constant_Style)
+		{
+			moveAmount_x = 0;
+			moveAmount_y = -constantMovement;
+		}
+		break;
+	case MOTION_DOWN:
+		if (MOVEMENT_STYLE == Velocity_Style)
+		{
+			if (displacement_y > 0)
+			{
+				moveAmount_y += 500*displacement_y;
+			}
+		}
+		else if (MOVEMENT_STYLE == Constant_Style)
+		{
+			moveAmount_x = 0;
+			moveAmount_y = constantMovement;
+		}
+		break;
+	case MOTION_RIGHT:
+		if (MOVEMENT_STYLE == Velocity_Style)
+		{
+			if (displacement_x > 0)
+			{
+				moveAmount_x += 500*displacement_x;
+			}
+		}
+		else if (MOVEMENT_STYLE == Constant_Style)
+		{
+			moveAmount_y = 0;
+			moveAmount_x = constantMovement;
+		}
+		break;
+	case MOTION_LEFT:
+		if (MOVEMENT_STYLE == Velocity_Style)
+		{
+			if (displacement_x < 0)
+			{
+				moveAmount_x += 500*displacement_x;
+			}
+		}
+		else if (MOVEMENT_STYLE == Constant_Style)
+		{
+			moveAmount_y = 0;
+			moveAmount_x = -constantMovement;
+		}
+		break;
+	}
+
+	if (rule.magnify > 0)
+	{
+		magnifyAmount += abs(displacement_x + displacement_y);
+	}
+	else if (rule.magnify < 0)
+	{
+		magnifyAmount -= abs(displacement_x + displacement_y);
+	}
+
+	if (rule.effects & EFFECT_RESET_TIMER)
+	{
+		detector.startTime = now;
+	}
+
+	return (rule.effects & EFFECT_CONTINUE) != 0;
+}
+
+/*** Overlays ***/
+
+// Where the box for the hand in use goes
+static int HandBoxX(Direction hand, int size)
+{
+	if (hand == RIGHT)
+	{
+		return (xRes*3/4) - (size/2);
+	}
+	return (xRes/4) - (size/2);
+}
+
+// The movement box, with every part in its resting colour but the one given
+static void DrawMovementBox(Direction hand, Quadrant lit)
+{
+	int ulx = HandBoxX(hand, boxLarge);
+	int uly = (yRes/2) - (boxLarge/2);
+	// Overwrite old center stuff
+	drawRectangle(HandBoxX(hand, boxSmall), (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 2);
+	drawRectangle(HandBoxX(hand, boxSuperSmall), (yRes/2) - (boxSuperSmall/2), boxSuperSmall, boxSuperSmall, 2);
+
+	drawRectangle(ulx, uly, boxLarge, boxLarge, 0);
+	if (lit == Q_TOP || lit == Q_BOTTOM)
+	{
+		drawTrapezoid(ulx, uly, (lit == Q_TOP) ? Q_BOTTOM : Q_TOP, 0);
+	}
+	else
+	{
+		drawTrapezoid(ulx, uly, (lit == Q_RIGHT) ? Q_LEFT : Q_RIGHT, 0);
+	}
+	drawTrapezoid(ulx, uly, lit, 1);
+	drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+}
+
+// The four magnification boxes round the hand, with one lit up
+static void DrawMagnifyDial(Direction hand, Quadrant lit)
+{
+	clearOverlay();
+	drawText ((xRes/3), (yRes/10), L"Clockwise = zoom in", 56);
+	drawText ((xRes/3), (yRes*9/10), L"Counter-Clockwise = zoom out", 56);
+	int ulx = HandBoxX(hand, boxSmall);
+	int uly = (yRes/2) - (boxSmall/2);
+	// Vert
+	drawRectangle (ulx, uly - overlayCircleRadius, boxSmall, boxSmall, (lit == Q_TOP) ? 1 : 0);
+	drawRectangle (ulx, uly + overlayCircleRadius, boxSmall, boxSmall, (lit == Q_BOTTOM) ? 1 : 0);
+	// Horiz
+	drawRectangle (ulx - overlayCircleRadius, uly, boxSmall, boxSmall, (lit == Q_LEFT) ? 1 : 0);
+	drawRectangle (ulx + overlayCircleRadius, uly, boxSmall, boxSmall, (lit == Q_RIGHT) ? 1 : 0);
+}
+
+void DrawGestureOverlay(GestureOverlay overlay, Direction hand, BOOL amClicking)
+{
+	int uly = (yRes/2) - (boxLarge/2);
+	switch (overlay)
+	{
+	case OVERLAY_NONE:
+		break;
+	case OVERLAY_SALUTE_WAITING:
+		clearOverlay();
+		// Fall through
+	case OVERLAY_SALUTED:
+		drawRectangle (HandBoxX(hand, boxLarge), uly, boxLarge, boxLarge, 0);
+		if (allowMagnifyGestures)
+		{
+			drawRectangle ((xRes/2) - (boxLarge/2), uly, boxLarge, boxLarge, 0);
+		}
+		break;
+	case OVERLAY_LOCKING_MOVE:
+		clearOverlay();
+		drawLockOn((hand == RIGHT) ? xRes*3/4 : xRes/4, yRes/2);
+		drawText ((xRes/3), (yRes/10), L"Locking on to Movement Mode", 56);
+		break;
+	case OVERLAY_LOCKING_MAGNIFY:
+		clearOverlay();
+		drawLockOn(xRes/2, yRes/2);
+		drawText ((xRes/3), (yRes/10), L"Locking on to Magnification Mode", 56);
+		break;
+	case OVERLAY_MAGNIFY_MODE:
+		clearOverlay();
+		drawRectangle ((xRes/2) - (boxLarge/2), uly, boxLarge, boxLarge, 1);
+		drawText ((xRes/3), (yRes/10), L"Magnification Gesture Mode", 56);
+		break;
+	case OVERLAY_MOVE_MODE:
+		clearOverlay();
+		drawTrapezoid(HandBoxX(hand, boxLarge), uly, Q_TOP, 0);
+		drawTrapezoid(HandBoxX(hand, boxLarge), uly, Q_BOTTOM, 0);
+		drawRectangle(HandBoxX(hand, boxLarge), uly, boxLarge, boxLarge, 1);
+		drawRectangle(HandBoxX(hand, boxSmall), (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 1);
+		drawRectangle(HandBoxX(hand, boxSuperSmall), (yRes/2) - (boxSuperSmall/2), boxSuperSmall, boxSuperSmall, 1);
+		drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+		break;
+	case OVERLAY_MOVE_CENTER:
+		// Left red while a click is held
+		if (! amClicking)
+		{
+			drawRectangle(HandBoxX(hand, boxSmall), (yRes/2) - (boxSmall/2), boxSmall, boxSmall, 1);
+			drawRectangle(HandBoxX(hand, boxSuperSmall), (yRes/2) - (boxSuperSmall/2), boxSuperSmall, boxSuperSmall, 1);
+		}
+		drawTrapezoid(HandBoxX(hand, boxLarge), uly, Q_TOP, 0);
+		drawTrapezoid(HandBoxX(hand, boxLarge), uly, Q_BOTTOM, 0);
+		drawRectangle(HandBoxX(hand, boxLarge), uly, boxLarge, boxLarge, 1);
+		drawText ((xRes/3), (yRes/10), L"Movement Gesture Mode", 56);
+		break;
+	case OVERLAY_MOVE_UP:
+		DrawMovementBox(hand, Q_TOP);
+		break;
+	case OVERLAY_MOVE_DOWN:
+		DrawMovementBox(hand, Q_BOTTOM);
+		break;
+	case OVERLAY_MOVE_LEFT:
+		DrawMovementBox(hand, Q_LEFT);
+		break;
+	case OVERLAY_MOVE_RIGHT:
+		DrawMovementBox(hand, Q_RIGHT);
+		break;
+	case OVERLAY_MAGNIFY_UP:
+		DrawMagnifyDial(hand, Q_TOP);
+		break;
+	case OVERLAY_MAGNIFY_DOWN:
+		DrawMagnifyDial(hand, Q_BOTTOM);
+		break;
+	case OVERLAY_MAGNIFY_LEFT:
+		DrawMagnifyDial(hand, Q_LEFT);
+		break;
+	case OVERLAY_MAGNIFY_RIGHT:
+		DrawMagnifyDial(hand, Q_RIGHT);
+		break;
+	}
+}
@@ -0,0 +1,194 @@
+/************************************************************************
+*                                                                       *
+*   GestureTable.h -- Declaration of GestureTable class                 *
+*                                                                       *
+*   The gesture state machine as data.  Each rule says which states     *
+*   it applies in, what has to be true of the hand (near a point on     *
+*   the body, or in one part of the movement box, maybe for a while,    *
+*   or just done a swipe, wave or circle), and what to do about it.     *
+*   The rules are compiled once into a flat table per state, and a      *
+*   frame is one pass over the joints that state needs followed by a    *
+*   walk down its rows.                                                 *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "GestureDetector.h"
+
+class GestureBatch;
+
+const int numGestureStates = MOVECENTER + 1;
+#define STATE_BIT(state) (1 << (state))
+#define MOVE_STATES (STATE_BIT(MOVECENTER) | STATE_BIT(MOVEUP) | STATE_BIT(MOVEDOWN) | STATE_BIT(MOVERIGHT) | STATE_BIT(MOVELEFT))
+#define MAGNIFY_STATES (STATE_BIT(MAGNIFYUP) | STATE_BIT(MAGNIFYDOWN) | STATE_BIT(MAGNIFYLEFT) | STATE_BIT(MAGNIFYRIGHT))
+
+// A point on the body: a joint, moved over depending on which hand is in
+// use, then moved again (kept separate so the sums come out the same as
+// the hand-written version's)
+struct GesturePoint
+{
+	int joint;
+	FLOAT rightX;
+	FLOAT leftX;
+	FLOAT y;
+	FLOAT extraX;
+	FLOAT extraY;
+};
+
+// Which hand a rule watches
+enum RuleHand {
+	ACTIVE_HAND,	// whichever one saluted
+	RIGHT_HAND,
+	LEFT_HAND,
+};
+
+// Settings a rule only applies under
+enum RuleCondition {
+	ANY_MODE,
+	MAGNIFY_ALLOWED,
+	MOVE_ONLY,
+};
+
+enum GuardKind {
+	GUARD_ALWAYS,
+	// The hand is within detectRange of the point (x and y only)
+	GUARD_NEAR,
+	// The hand is in the given part of the movement box around the point
+	GUARD_QUADRANT,
+	// The hand has just done the rule's dynamic gesture (DtwRecognizer's)
+	GUARD_DYNAMIC,
+};
+
+// Rules that have to hold for lockonTime before they fire
+enum RuleLock {
+	NO_LOCK,
+	LOCK_MOVE,
+	LOCK_MAGNIFY,
+};
+
+enum MotionAction {
+	NO_MOTION,
+	MOTION_CENTER,
+	MOTION_UP,
+	MOTION_DOWN,
+	MOTION_LEFT,
+	MOTION_RIGHT,
+};
+
+// What gets drawn when a rule fires (if overlays are on)
+enum GestureOverlay {
+	OVERLAY_NONE,
+	OVERLAY_SALUTED,
+	OVERLAY_SALUTE_WAITING,
+	OVERLAY_LOCKING_MOVE,
+	OVERLAY_LOCKING_MAGNIFY,
+	OVERLAY_MOVE_MODE,
+	OVERLAY_MAGNIFY_MODE,
+	OVERLAY_MOVE_CENTER,
+	OVERLAY_MOVE_UP,
+	OVERLAY_MOVE_DOWN,
+	OVERLAY_MOVE_LEFT,
+	OVERLAY_MOVE_RIGHT,
+	OVERLAY_MAGNIFY_UP,
+	OVERLAY_MAGNIFY_DOWN,
+	OVERLAY_MAGNIFY_LEFT,
+	OVERLAY_MAGNIFY_RIGHT,
+};
+
+/* Rule effects, applied in this order */
+// Remember the rule's hand as the one to watch from now on
+const int EFFECT_SET_HAND = 0x01;
+// Stop the cursor, if this is the active skeleton
+const int EFFECT_STOP_IF_ACTIVE = 0x02;
+const int EFFECT_CLEAR_MOVE_LOCK = 0x04;
+const int EFFECT_CLEAR_MAGNIFY_LOCK = 0x08;
+// Become the active skeleton
+const int EFFECT_TAKE_FOCUS = 0x10;
+// Put off the timeout
+const int EFFECT_RESET_TIMER = 0x20;
+// Keep looking at the rest of the rows afterwards
+const int EFFECT_CONTINUE = 0x40;
+
+// A rule that doesn't change the state
+const int keepState = -1;
+
+struct GestureRule
+{
+	int fromStates;		// STATE_BITs
+	RuleCondition condition;
+	GuardKind guard;
+	RuleHand hand;
+	const GesturePoint* point;
+	Quadrant quadrant;
+	RuleLock lock;
+	int to;				// a GestureStateEnum, or keepState
+	MotionAction motion;
+	int magnify;		// +1 or -1 to zoom by how far the hand moved
+	int effects;
+	GestureOverlay overlay;
+	DynamicGesture dynamic;		// for GUARD_DYNAMIC
+};
+
+// The rules the detectors run, in priority order
+extern const GestureRule gestureRules[];
+extern const int numGestureRules;
+
+const int maxGestureTransitions = 64;
+// Distinct points any one state checks the hand against
+const int maxStateTargets = 4;
+// Distinct points the whole table checks the hand against
+const int maxTableGuards = 16;
+
+// A compiled row: the rule, which of its state's targets it checks, and
+// which of the table's guards that is
+struct GestureTransition
+{
+	const GestureRule* rule;
+	int target;
+	int guard;
+};
+
+struct GestureStateTable
+{
+	// Rows [first, end) of the transition table
+	int first;
+	int end;
+	int numTargets;
+	const GesturePoint* targetPoints[maxStateTargets];
+	RuleHand targetHands[maxStateTargets];
+	BOOL needsDisplacement;
+};
+
+class GestureTable
+{
+public:
+	GestureTable(const GestureRule* rules, int numRules);
+
+	// Runs the state machine for one frame, after detectAnyState().
+	// amClicking is whether the click gesture is being held.  With a batch,
+	// the guards are read from it instead of worked out here.
+	void run(GestureDetector &detector, const SkeletonView &skeleton, const JointHistory &history, BOOL amClicking,
+		const GestureBatch* batch = NULL);
+
+	// Whether every rule fit in the table
+	BOOL compiled;
+
+	// Every (point, hand) any rule checks, for GestureBatch
+	int numGuards;
+	const GesturePoint* guardPoints[maxTableGuards];
+	RuleHand guardHands[maxTableGuards];
+
+private:
+	BOOL fire(GestureDetector &detector, const GestureRule &rule, FLOAT displacement_x, FLOAT displacement_y, BOOL amClicking);
+
+	GestureStateTable states[numGestureStates];
+	GestureTransition transitions[maxGestureTransitions];
+};
+
+// Draws one of the overlays above for the given hand
+void DrawGestureOverlay(GestureOverlay overlay, Direction hand, BOOL amClicking);
+
+// The one the detectors use, compiled from gestureRules
+extern GestureTable gestureTable;
@@ -0,0 +1,108 @@
+#include "GuiGuard.h"
+
+GuiGuard::GuiGuard(void)
+{
+	numUsers = 0;
+	isOpen = FALSE;
+	closerUsers = 0;
+	drainedEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	tlsIndex = TlsAlloc();
+}
+
+GuiGuard::~GuiGuard(void)
+{
+	if (drainedEvent != NULL)
+	{
+		CloseHandle(drainedEvent);
+	}
+	if (tlsIndex != TLS_OUT_OF_INDEXES)
+	{
+		TlsFree(tlsIndex);
+	}
+}
+
+// How many times this thread is inside
+LONG GuiGuard::ownUsers()
+{
+	return (tlsIndex != TLS_OUT_OF_INDEXES) ? (LONG) (LONG_PTR) TlsGetValue(tlsIndex) : 0;
+}
+
+void GuiGuard::countOwn(LONG change)
+{
+	if (tlsIndex != TLS_OUT_OF_INDEXES)
+	{
+		TlsSetValue(tlsIndex, (LPVOID) (LONG_PTR) (ownUsers() + change));
+	}
+}
+
+BOOL GuiGuard::enter()
+{
+	// Count ourselves in first, then look.  close() does the opposite, so
+	// either it sees us or we see that it's closed.
+	InterlockedIncrement(&numUsers);
+	if (! isOpen)
+	{
+		// close() may be waiting on us anyway
+		release();
+		return FALSE;
+	}
+	countOwn(1);
+	return TRUE;
+}
+
+void GuiGuard::leave()
+{
+	countOwn(-1);
+	release();
+}
+
+void GuiGuard::release()
+{
+	if (InterlockedDecrement(&numUsers) <= closerUsers && ! isOpen)
+	{
+		SetEvent(drainedEvent);
+	}
+}
+
+void GuiGuard::open()
+{
+	InterlockedExchange(&isOpen, TRUE);
+}
+
+void GuiGuard::close()
+{
+	// Anything left over from a thread that bounced off last time
+	ResetEvent(drainedEvent);
+	// Only everyone else has to leave; set before closing, so whoever
+	// leaves after that knows when to wake us
+	LONG own = ownUsers();
+	InterlockedExchange(&closerUsers, own);
+	InterlockedExchange(&isOpen, FALSE);
+
+	// Nobody new gets in now, so just wait for the count to drain.  Sections
+	// are short, so spin a little before blocking.
+	for (int spins = 0; numUsers > own && spins < guiGuardSpins; spins++)
+	{
+		YieldProcessor();
+	}
+	while (numUsers > own)
+	{
+		if (drainedEvent != NULL)
+		{
+			MsgWaitForMultipleObjects(1, &drainedEvent, FALSE, INFINITE, QS_SENDMESSAGE);
+		}
+		else
+		{
+			// Couldn't make the event, so look again every so often
+			MsgWaitForMultipleObjects(0, NULL, FALSE, 1, QS_SENDMESSAGE);
+		}
+		// Peeking is enough to deliver any messages sent meanwhile
+		MSG msg;
+		PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE);
+	}
+}
+
+LONG GuiGuard::users()
+{
+	return numUsers;
+}
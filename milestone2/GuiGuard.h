@@ -0,0 +1,56 @@
+/************************************************************************
+*                                                                       *
+*   GuiGuard.h -- Declaration of GuiGuard class                         *
+*                                                                       *
+*   Keeps the skeletal viewer's window alive for as long as another     *
+*   thread is using it.  Getting in and out is one interlocked          *
+*   operation each, plus a count of the thread's own; only shutting     *
+*   the GUI down ever has to wait, and it waits for as long as it       *
+*   takes.                                                              *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+// How many times close() looks at the count before it blocks
+const int guiGuardSpins = 64;
+
+class GuiGuard
+{
+public:
+	GuiGuard(void);
+	~GuiGuard(void);
+
+	/* Any thread */
+	// Returns TRUE if the GUI is up, in which case it stays up until leave()
+	BOOL enter();
+	void leave();
+
+	/* GUI thread */
+	void open();
+	// Stops new entries, then waits for the ones already in to leave; the
+	// last of them to leave wakes it.  Messages other threads send the GUI
+	// thread are handled while it waits, so a thread inside that calls
+	// SendMessage() can still get out.  Entries the calling thread itself
+	// still holds aren't waited for, since they'd never leave.
+	void close();
+
+	// Threads currently inside
+	LONG users();
+
+private:
+	LONG ownUsers();
+	void countOwn(LONG change);
+	// Counts one out, waking close() if it was the last it waited for
+	void release();
+
+	volatile LONG numUsers;
+	volatile LONG isOpen;
+	// Set by whoever leaves last once it's closed
+	HANDLE drainedEvent;
+	// How many times each thread is inside, in thread local storage, and
+	// how many of the users close() is waiting for are its own
+	DWORD tlsIndex;
+	volatile LONG closerUsers;
+};
@@ -0,0 +1,184 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "GuiGuard.h"
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+/*** GUI guard ***/
+
+// Roughly how many times a skeleton frame goes in and out of the GUI
+const int guardSectionsPerFrame = 12;
+
+struct GuardContention
+{
+	BOOL useMutex;
+	// The old way: a kernel mutex around a plain count
+	HANDLE mutex;
+	int mutexUsers;
+	GuiGuard guard;
+	volatile BOOL stop;
+};
+
+static void GuardEnter(GuardContention* contention)
+{
+	if (contention->useMutex)
+	{
+		WaitForSingleObject(contention->mutex, INFINITE);
+		contention->mutexUsers++;
+		ReleaseMutex(contention->mutex);
+	}
+	else
+	{
+		contention->guard.enter();
+	}
+}
+
+static void GuardLeave(GuardContention* contention)
+{
+	if (contention->useMutex)
+	{
+		WaitForSingleObject(contention->mutex, INFINITE);
+		contention->mutexUsers--;
+		ReleaseMutex(contention->mutex);
+	}
+	else
+	{
+		contention->guard.leave();
+	}
+}
+
+// Stands in for the timer and depth threads hammering the same guard
+static DWORD WINAPI GuardContender(LPVOID lpParam)
+{
+	GuardContention* contention = (GuardContention*) lpParam;
+	while (! contention->stop)
+	{
+		GuardEnter(contention);
+		GuardLeave(contention);
+	}
+	return 0;
+}
+
+// close() called from inside the guard, while another thread is inside too
+struct GuardCloseFromInside
+{
+	GuiGuard guard;
+	volatile LONG holderIn;
+	volatile LONG holderOut;
+	// Whether the other thread had left by the time close() returned
+	LONG holderOutAtClose;
+};
+
+// Inside for a while, then out
+static DWORD WINAPI GuardHolder(LPVOID lpParam)
+{
+	GuardCloseFromInside* test = (GuardCloseFromInside*) lpParam;
+	test->guard.enter();
+	InterlockedExchange(&test->holderIn, TRUE);
+	Sleep(50);
+	InterlockedExchange(&test->holderOut, TRUE);
+	test->guard.leave();
+	return 0;
+}
+
+// What tearing the GUI down from a thread that's counted as using it does
+static DWORD WINAPI GuardInsideCloser(LPVOID lpParam)
+{
+	GuardCloseFromInside* test = (GuardCloseFromInside*) lpParam;
+	while (! test->holderIn)
+	{
+		Sleep(1);
+	}
+	test->guard.enter();
+	test->guard.close();
+	test->holderOutAtClose = test->holderOut;
+	test->guard.leave();
+	return 0;
+}
+
+// close() from inside the guard has to wait for everyone else, and not for
+// itself; it's given a few seconds before being called hung
+static void CheckGuardCloseFromInside(FILE* results)
+{
+	GuardCloseFromInside test;
+	test.guard.open();
+	test.holderIn = FALSE;
+	test.holderOut = FALSE;
+	test.holderOutAtClose = FALSE;
+	HANDLE holder = CreateThread(NULL, 0, GuardHolder, &test, 0, NULL);
+	HANDLE closer = CreateThread(NULL, 0, GuardInsideCloser, &test, 0, NULL);
+	BOOL returned = (WaitForSingleObject(closer, 5000) == WAIT_OBJECT_0);
+	WaitForSingleObject(holder, INFINITE);
+	fprintf(results, "%-24s %s (%s, %s)\n", "close() from inside", CheckResult(returned && test.holderOutAtClose),
+		returned ? "returned" : "hung", test.holderOutAtClose ? "after the other thread left" : "too early");
+	if (! returned)
+	{
+		// Nothing else will ever let it out
+		TerminateThread(closer, 1);
+	}
+	CloseHandle(holder);
+	CloseHandle(closer);
+}
+
+// Per-frame cost of the GUI liveness checks, mutex against GuiGuard, with
+// 0 to 2 other threads doing the same thing flat out
+static void RunGuardBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	GuardContention contention;
+	contention.mutex = CreateMutex(NULL, FALSE, NULL);
+	contention.mutexUsers = 0;
+	contention.guard.open();
+
+	const int maxContenders = 2;
+	for (int m = 0; m < 2; m++)
+	{
+		contention.useMutex = (m == 0);
+		for (int numContenders = 0; numContenders <= maxContenders; numContenders++)
+		{
+			HANDLE contenders[maxContenders];
+			contention.stop = FALSE;
+			for (int i = 0; i < numContenders; i++)
+			{
+				contenders[i] = CreateThread(NULL, 0, GuardContender, &contention, 0, NULL);
+			}
+
+			timer.reset();
+			for (int frame = 0; frame < benchmarkFrames; frame++)
+			{
+				timer.start();
+				for (int i = 0; i < guardSectionsPerFrame; i++)
+				{
+					GuardEnter(&contention);
+					GuardLeave(&contention);
+				}
+				timer.stop();
+			}
+
+			contention.stop = TRUE;
+			if (numContenders > 0)
+			{
+				WaitForMultipleObjects(numContenders, contenders, TRUE, INFINITE);
+			}
+			for (int i = 0; i < numContenders; i++)
+			{
+				CloseHandle(contenders[i]);
+			}
+
+			char name[64];
+			sprintf_s(name, sizeof(name), "%s, %d other thr", contention.useMutex ? "mutex" : "GuiGuard", numContenders);
+			timer.report(results, name);
+		}
+	}
+
+	contention.guard.close();
+	CloseHandle(contention.mutex);
+
+	CheckGuardCloseFromInside(results);
+}
+
+void BenchmarkGuiGuard(FILE* results, BenchmarkTimer &timer)
+{
+	fprintf(results, "\nGUI liveness checks, %d per frame\n", guardSectionsPerFrame);
+	RunGuardBenchmark(results, timer);
+}
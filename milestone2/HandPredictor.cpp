@@ -0,0 +1,222 @@
+#include "HandPredictor.h"
+#include <math.h>
+
+const int predictedJoints[predictedHands] = {
+	NUI_SKELETON_POSITION_HAND_LEFT,
+	NUI_SKELETON_POSITION_HAND_RIGHT,
+};
+
+// How quickly the fit forgets: about five frames
+const double fitWeight = 0.2;
+// Spread to start a new filter with: velocity in m/s, acceleration in m/s^2
+const double startVelocitySpread = 1.0;
+const double startAccelerationSpread = 10.0;
+
+static void StartAxis(AxisFilterState &axis, double position)
+{
+	ZeroMemory(&axis, sizeof(axis));
+	axis.x[0] = position;
+	axis.P[0][0] = handMeasurementNoise * handMeasurementNoise;
+	axis.P[1][1] = startVelocitySpread * startVelocitySpread;
+	axis.P[2][2] = startAccelerationSpread * startAccelerationSpread;
+}
+
+// One predict and update of a single axis.  Returns the squared innovation
+// over its expected variance, which averages 1 when the model fits.
+static double StepAxis(AxisFilterState &axis, double measured, double dt, BOOL acceleration)
+{
+	// State transition, and the process noise it picks up on the way
+	double F[3][3] = {
+		{ 1, dt, 0 },
+		{ 0, 1, 0 },
+		{ 0, 0, 0 },
+	};
+	double Q[3][3];
+	ZeroMemory(Q, sizeof(Q));
+	double dt2 = dt * dt;
+	double dt3 = dt2 * dt;
+	if (acceleration)
+	{
+		F[0][2] = dt2 / 2;
+		F[1][2] = dt;
+		F[2][2] = 1;
+		// Random changes in acceleration
+		double q = handJerkNoise;
+		Q[0][0] = q * dt3 * dt2 / 20;
+		Q[0][1] = Q[1][0] = q * dt2 * dt2 / 8;
+		Q[0][2] = Q[2][0] = q * dt3 / 6;
+		Q[1][1] = q * dt3 / 3;
+		Q[1][2] = Q[2][1] = q * dt2 / 2;
+		Q[2][2] = q * dt;
+	}
+	else
+	{
+		// Random changes in velocity
+		double q = handAccelerationNoise;
+		Q[0][0] = q * dt3 / 3;
+		Q[0][1] = Q[1][0] = q * dt2 / 2;
+		Q[1][1] = q * dt;
+	}
+
+	// Predict: x = F x, P = F P F' + Q
+	double x[3];
+	double FP[3][3];
+	for (int i = 0; i < 3; i++)
+	{
+		x[i] = F[i][0] * axis.x[0] + F[i][1] * axis.x[1] + F[i][2] * axis.x[2];
+		for (int j = 0; j < 3; j++)
+		{
+			FP[i][j] = F[i][0] * axis.P[0][j] + F[i][1] * axis.P[1][j] + F[i][2] * axis.P[2][j];
+		}
+	}
+	double P[3][3];
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			P[i][j] = FP[i][0] * F[j][0] + FP[i][1] * F[j][1] + FP[i][2] * F[j][2] + Q[i][j];
+		}
+	}
+
+	// Update with the measured position
+	double innovation = measured - x[0];
+	double S = P[0][0] + handMeasurementNoise * handMeasurementNoise;
+	double K[3];
+	for (int i = 0; i < 3; i++)
+	{
+		K[i] = P[i][0] / S;
+		axis.x[i] = x[i] + K[i] * innovation;
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			axis.P[i][j] = P[i][j] - K[i] * P[0][j];
+		}
+	}
+
+	return innovation * innovation / S;
+}
+
+HandPredictor::HandPredictor()
+{
+	style = PREDICTION_STYLE;
+	horizonMs = predictionHorizonMs;
+	minConfidence = minPredictionConfidence;
+	reset();
+}
+
+HandPredictor::~HandPredictor(void)
+{
+}
+
+void HandPredictor::reset()
+{
+	ZeroMemory(states, sizeof(states));
+	haveTimestamp = FALSE;
+	lastTimestamp = 0;
+}
+
+FLOAT HandPredictor::confidence(int skeleton, int hand)
+{
+	return states[skeleton].hands[hand].confidence;
+}
+
+void HandPredictor::predict(NUI_SKELETON_FRAME &SkeletonFrame)
+{
+	// Timestamps are in milliseconds
+	double dt = 0;
+	LONGLONG timestamp = SkeletonFrame.liTimeStamp.QuadPart;
+	if (haveTimestamp && timestamp > lastTimestamp && timestamp - lastTimestamp < 500)
+	{
+		dt = (timestamp - lastTimestamp) / 1000.0;
+	}
+	haveTimestamp = TRUE;
+	lastTimestamp = timestamp;
+
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		NUI_SKELETON_DATA &skeleton = SkeletonFrame.SkeletonData[i];
+		SkeletonPredictionState &state = states[i];
+		// Gone, somebody new, or it's been too long to carry on from where we were
+		if (skeleton.eTrackingState != NUI_SKELETON_TRACKED || skeleton.dwTrackingID != state.trackingId || dt == 0)
+		{
+			ZeroMemory(&state, sizeof(state));
+			state.trackingId = skeleton.dwTrackingID;
+		}
+		if (skeleton.eTrackingState != NUI_SKELETON_TRACKED)
+		{
+			continue;
+		}
+
+		for (int h = 0; h < predictedHands; h++)
+		{
+			int joint = predictedJoints[h];
+			predictHand(skeleton.SkeletonPositions[joint], skeleton.eSkeletonPositionTrackingState[joint], state.hands[h], dt);
+		}
+	}
+}
+
+void HandPredictor::predictHand(Vector4 &position, NUI_SKELETON_POSITION_TRACKING_STATE trackingState, HandFilterState &hand, double dt)
+{
+	// An inferred hand is a guess already, and once it's tracked again it may
+	// be somewhere else entirely, so any change starts the filter again
+	if (trackingState != hand.trackingState)
+	{
+		hand.frames = 0;
+		hand.trackingState = trackingState;
+	}
+	if (style == No_Prediction || trackingState != NUI_SKELETON_POSITION_TRACKED)
+	{
+		hand.confidence = 0;
+		return;
+	}
+
+	FLOAT measured[3] = { position.x, position.y, position.z };
+	if (hand.frames == 0)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			StartAxis(hand.axes[a], measured[a]);
+		}
+		hand.frames = 1;
+		hand.fit = 1;
+		hand.confidence = 0;
+		return;
+	}
+
+	BOOL acceleration = (style == Acceleration_Prediction);
+	double innovation = 0;
+	for (int a = 0; a < 3; a++)
+	{
+		innovation += StepAxis(hand.axes[a], measured[a], dt, acceleration);
+	}
+	hand.frames++;
+	hand.fit += fitWeight * (innovation / 3 - hand.fit);
+
+	// Trust the model less the worse it's been explaining the hand lately
+	hand.confidence = (hand.fit <= 1) ? 1.0f : (FLOAT) (1 / hand.fit);
+	if (hand.frames < predictionWarmupFrames || hand.confidence < minConfidence)
+	{
+		return;
+	}
+
+	// Where the filter thinks the hand will be, measured from where it was seen
+	double h = horizonMs * hand.confidence / 1000.0;
+	double lead[3];
+	double leadSquared = 0;
+	for (int a = 0; a < 3; a++)
+	{
+		const double* x = hand.axes[a].x;
+		lead[a] = x[0] + x[1] * h + x[2] * h * h / 2 - measured[a];
+		leadSquared += lead[a] * lead[a];
+	}
+	double scale = 1;
+	if (leadSquared > maxPredictionLead * maxPredictionLead)
+	{
+		scale = maxPredictionLead / sqrt(leadSquared);
+	}
+	position.x = (FLOAT) (measured[0] + lead[0] * scale);
+	position.y = (FLOAT) (measured[1] + lead[1] * scale);
+	position.z = (FLOAT) (measured[2] + lead[2] * scale);
+}
@@ -0,0 +1,94 @@
+/************************************************************************
+*                                                                       *
+*   HandPredictor.h -- Declaration of HandPredictor class               *
+*                                                                       *
+*   By the time a skeleton frame reaches the gesture detectors, the     *
+*   hands in it are a frame or two old.  This runs a small Kalman       *
+*   filter on each hand and moves it to where it should be a little     *
+*   way into the future, so moving and clicking react to where the      *
+*   hand is going rather than where it was.                             *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+
+/* Mode selection: how the hands are assumed to move between frames */
+enum Prediction_Style {
+	No_Prediction,
+	Velocity_Prediction,
+	Acceleration_Prediction,
+};
+const enum Prediction_Style PREDICTION_STYLE = Acceleration_Prediction;
+
+// How far ahead to predict: a frame of sensor latency plus what the
+// smoothing costs a moving hand (see -benchmark)
+const FLOAT predictionHorizonMs = 50.0f;
+// Below this the hand isn't moving the way the model thinks, so leave it be
+const FLOAT minPredictionConfidence = 0.25f;
+// Never put the hand further than this from where it was measured, in meters
+const FLOAT maxPredictionLead = 0.15f;
+// Kalman tuning: how noisy a (smoothed) hand is, in meters, and how
+// suddenly hands change what they're doing, as the spectral density of
+// acceleration (for Velocity_Prediction) or jerk (Acceleration_Prediction)
+const double handMeasurementNoise = 0.003;
+const double handAccelerationNoise = 20.0;
+const double handJerkNoise = 400.0;
+// Frames of history before the velocity is worth extrapolating
+const int predictionWarmupFrames = 3;
+
+// The two hands, in the order HandFilterState keeps them
+const int predictedHands = 2;
+extern const int predictedJoints[predictedHands];
+
+// One axis of one hand: position, velocity, acceleration and their covariance
+struct AxisFilterState
+{
+	double x[3];
+	double P[3][3];
+};
+
+struct HandFilterState
+{
+	AxisFilterState axes[3];
+	// Frames since the filter was started
+	int frames;
+	// Running mean of the normalized innovation, about 1 while the model fits
+	double fit;
+	FLOAT confidence;
+	NUI_SKELETON_POSITION_TRACKING_STATE trackingState;
+};
+
+struct SkeletonPredictionState
+{
+	HandFilterState hands[predictedHands];
+	DWORD trackingId;
+};
+
+class HandPredictor
+{
+public:
+	HandPredictor();
+	~HandPredictor(void);
+
+	// Moves the hands of every tracked skeleton to where they're predicted
+	// to be, in place.  Everything else in the frame is left alone.
+	void predict(NUI_SKELETON_FRAME &SkeletonFrame);
+	// Start again from the next frame
+	void reset();
+	// How much the last prediction for a hand was trusted, 0 to 1
+	FLOAT confidence(int skeleton, int hand);
+
+	// Settings, which start off as the constants above
+	Prediction_Style style;
+	FLOAT horizonMs;
+	FLOAT minConfidence;
+
+private:
+	void predictHand(Vector4 &position, NUI_SKELETON_POSITION_TRACKING_STATE trackingState, HandFilterState &hand, double dt);
+
+	SkeletonPredictionState states[NUI_SKELETON_COUNT];
+	BOOL haveTimestamp;
+	LONGLONG lastTimestamp;
+};
@@ -0,0 +1,234 @@
+#include "JointHistory.h"
+#include <malloc.h>
+
+// 100ns intervals in a second
+const double historyTicksPerSecond = 10000000.0;
+
+static const Vector4 noPosition = { 0, 0, 0, 0 };
+
+JointHistory::JointHistory()
+{
+	histories = (SkeletonHistory*) _aligned_malloc(NUI_SKELETON_COUNT * sizeof(SkeletonHistory), 64);
+	reset();
+}
+
+JointHistory::~JointHistory(void)
+{
+	_aligned_free(histories);
+}
+
+void JointHistory::reset()
+{
+	for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+	{
+		startOver(histories[s], 0);
+	}
+}
+
+void JointHistory::startOver(SkeletonHistory &history, DWORD trackingId)
+{
+	// Only the bookkeeping: nothing past count is ever read
+	ZeroMemory(history.sums, sizeof(history.sums));
+	ZeroMemory(history.sumSquares, sizeof(history.sumSquares));
+	history.newest = jointHistoryMask;
+	history.count = 0;
+	history.trackingId = trackingId;
+}
+
+void JointHistory::add(const NUI_SKELETON_FRAME &SkeletonFrame, long long now)
+{
+	for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+	{
+		SkeletonView skeleton(SkeletonFrame, s);
+		SkeletonHistory &history = histories[s];
+		if (skeleton.trackingState() != NUI_SKELETON_TRACKED)
+		{
+			if (history.count != 0)
+			{
+				startOver(history, 0);
+			}
+			continue;
+		}
+		if (skeleton.trackingId() != history.trackingId)
+		{
+			startOver(history, skeleton.trackingId());
+		}
+
+		int slot = (history.newest + 1) & jointHistoryMask;
+		Vector4* positions = history.positions[slot];
+		BOOL full = (history.count == jointHistoryFrames);
+		for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+		{
+			const Vector4 &p = skeleton.joint(j);
+			Vector4 &sum = history.sums[j];
+			Vector4 &sumSquares = history.sumSquares[j];
+			if (full)
+			{
+				// Take out the frame this one replaces
+				const Vector4 &old = positions[j];
+				sum.x -= old.x;
+				sum.y -= old.y;
+				sum.z -= old.z;
+				sumSquares.x -= old.x * old.x;
+				sumSquares.y -= old.y * old.y;
+				sumSquares.z -= old.z * old.z;
+			}
+			sum.x += p.x;
+			sum.y += p.y;
+			sum.z += p.z;
+			sumSquares.x += p.x * p.x;
+			sumSquares.y += p.y * p.y;
+			sumSquares.z += p.z * p.z;
+			positions[j] = p;
+		}
+		history.times[slot] = now;
+		history.newest = slot;
+		if (! full)
+		{
+			history.count++;
+		}
+		else if (slot == 0)
+		{
+			// Once around the ring, so rounding never builds up
+			resum(history);
+		}
+	}
+}
+
+void JointHistory::resum(SkeletonHistory &history)
+{
+	ZeroMemory(history.sums, sizeof(history.sums));
+	ZeroMemory(history.sumSquares, sizeof(history.sumSquares));
+	for (int age = 0; age < history.count; age++)
+	{
+		const Vector4* positions = history.positions[(history.newest - age) & jointHistoryMask];
+		for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+		{
+			const Vector4 &p = positions[j];
+			history.sums[j].x += p.x;
+			history.sums[j].y += p.y;
+			history.sums[j].z += p.z;
+			history.sumSquares[j].x += p.x * p.x;
+			history.sumSquares[j].y += p.y * p.y;
+			history.sumSquares[j].z += p.z * p.z;
+		}
+	}
+}
+
+int JointHistory::frames(int skeleton) const
+{
+	return histories[skeleton].count;
+}
+
+const Vector4 &JointHistory::position(int skeleton, int joint, int age) const
+{
+	const SkeletonHistory &history = histories[skeleton];
+	if (history.count == 0)
+	{
+		return noPosition;
+	}
+	if (age >= history.count)
+	{
+		age = history.count - 1;
+	}
+	return history.positions[(history.newest - age) & jointHistoryMask][joint];
+}
+
+long long JointHistory::time(int skeleton, int age) const
+{
+	const SkeletonHistory &history = histories[skeleton];
+	if (history.count == 0)
+	{
+		return 0;
+	}
+	if (age >= history.count)
+	{
+		age = history.count - 1;
+	}
+	return history.times[(history.newest - age) & jointHistoryMask];
+}
+
+Vector4 JointHistory::displacement(int skeleton, int joint, int age) const
+{
+	const Vector4 &now = position(skeleton, joint, 0);
+	const Vector4 &then = position(skeleton, joint, age);
+	Vector4 difference = { now.x - then.x, now.y - then.y, now.z - then.z, 0 };
+	return difference;
+}
+
+Vector4 JointHistory::velocity(int skeleton, int joint) const
+{
+	Vector4 velocity = noPosition;
+	long long ticks = time(skeleton, 0) - time(skeleton, 1);
+	if (ticks <= 0)
+	{
+		return velocity;
+	}
+	FLOAT perSecond = (FLOAT) (historyTicksPerSecond / ticks);
+	Vector4 difference = displacement(skeleton, joint, 1);
+	velocity.x = difference.x * perSecond;
+	velocity.y = difference.y * perSecond;
+	velocity.z = difference.z * perSecond;
+	return velocity;
+}
+
+Vector4 JointHistory::acceleration(int skeleton, int joint) const
+{
+	Vector4 acceleration = noPosition;
+	if (frames(skeleton) < 3)
+	{
+		return acceleration;
+	}
+	long long newerTicks = time(skeleton, 0) - time(skeleton, 1);
+	long long olderTicks = time(skeleton, 1) - time(skeleton, 2);
+	if (newerTicks <= 0 || olderTicks <= 0)
+	{
+		return acceleration;
+	}
+	const Vector4 &p0 = position(skeleton, joint, 0);
+	const Vector4 &p1 = position(skeleton, joint, 1);
+	const Vector4 &p2 = position(skeleton, joint, 2);
+	FLOAT newerRate = (FLOAT) (historyTicksPerSecond / newerTicks);
+	FLOAT olderRate = (FLOAT) (historyTicksPerSecond / olderTicks);
+	// The change in velocity, over the time between the middles of the two frames
+	FLOAT perSecond = (FLOAT) (2.0 * historyTicksPerSecond / (newerTicks + olderTicks));
+	acceleration.x = ((p0.x - p1.x) * newerRate - (p1.x - p2.x) * olderRate) * perSecond;
+	acceleration.y = ((p0.y - p1.y) * newerRate - (p1.y - p2.y) * olderRate) * perSecond;
+	acceleration.z = ((p0.z - p1.z) * newerRate - (p1.z - p2.z) * olderRate) * perSecond;
+	return acceleration;
+}
+
+Vector4 JointHistory::mean(int skeleton, int joint) const
+{
+	const SkeletonHistory &history = histories[skeleton];
+	Vector4 mean = noPosition;
+	if (history.count == 0)
+	{
+		return mean;
+	}
+	FLOAT scale = 1.0f / history.count;
+	mean.x = history.sums[joint].x * scale;
+	mean.y = history.sums[joint].y * scale;
+	mean.z = history.sums[joint].z * scale;
+	return mean;
+}
+
+Vector4 JointHistory::variance(int skeleton, int joint) const
+{
+	const SkeletonHistory &history = histories[skeleton];
+	Vector4 variance = noPosition;
+	if (history.count < 2)
+	{
+		return variance;
+	}
+	FLOAT scale = 1.0f / history.count;
+	Vector4 average = mean(skeleton, joint);
+	variance.x = history.sumSquares[joint].x * scale - average.x * average.x;
+	variance.y = history.sumSquares[joint].y * scale - average.y * average.y;
+	variance.z = history.sumSquares[joint].z * scale - average.z * average.z;
+	// Rounding can take a joint that's held still just under zero
+	variance.x = (variance.x < 0) ? 0 : variance.x;
+	variance.y = (variance.y < 0) ? 0 : variance.y;
+	variance.z = (variance.z < 0) ? 0 : variance.z;
+	return variance;
+}
@@ -0,0 +1,72 @@
+/************************************************************************
+*                                                                       *
+*   JointHistory.h -- Declaration of JointHistory class                 *
+*                                                                       *
+*   The last few frames of every joint of every skeleton, kept in a     *
+*   ring per skeleton so nothing has to copy whole frames around to     *
+*   know where a hand was.  Anything that wants a joint's earlier       *
+*   positions, its velocity or acceleration, or its average over the    *
+*   frames held asks this instead of keeping its own copy.              *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "SkeletonView.h"
+
+// Frames kept per skeleton, a power of two so the ring wraps with a mask
+const int jointHistoryFrames = 32;
+const int jointHistoryMask = jointHistoryFrames - 1;
+
+// One skeleton's ring, newest at newest.  Each one starts on its own
+// cache line, so skeletons never share one.
+struct __declspec(align(64)) SkeletonHistory
+{
+	Vector4 positions[jointHistoryFrames][NUI_SKELETON_POSITION_COUNT];
+	// When each frame was seen, in 100ns intervals like frameClock
+	long long times[jointHistoryFrames];
+	// Per joint, over the frames held, for mean() and variance()
+	Vector4 sums[NUI_SKELETON_POSITION_COUNT];
+	Vector4 sumSquares[NUI_SKELETON_POSITION_COUNT];
+	int newest;
+	int count;
+	DWORD trackingId;
+};
+
+class JointHistory
+{
+public:
+	JointHistory();
+	~JointHistory(void);
+
+	// Adds every tracked skeleton in the frame.  A skeleton that isn't
+	// tracked, or is someone else now, starts over.
+	void add(const NUI_SKELETON_FRAME &SkeletonFrame, long long now);
+	void reset();
+
+	// How many frames there are for a skeleton, up to jointHistoryFrames
+	int frames(int skeleton) const;
+	// Where a joint was age frames ago (0 is the newest).  Anything older
+	// than what's held gives the oldest there is.
+	const Vector4 &position(int skeleton, int joint, int age) const;
+	long long time(int skeleton, int age) const;
+
+	// Newest minus age frames ago, in meters
+	Vector4 displacement(int skeleton, int joint, int age) const;
+	// Over the last frame, in meters per second
+	Vector4 velocity(int skeleton, int joint) const;
+	// Over the last two frames, in meters per second per second
+	Vector4 acceleration(int skeleton, int joint) const;
+	// Per axis, over every frame held
+	Vector4 mean(int skeleton, int joint) const;
+	Vector4 variance(int skeleton, int joint) const;
+
+private:
+	void startOver(SkeletonHistory &history, DWORD trackingId);
+	// Adds the sums up again from scratch, so they don't drift
+	void resum(SkeletonHistory &history);
+
+	// 64-byte aligned
+	SkeletonHistory* histories;
+};
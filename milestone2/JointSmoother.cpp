@@ -0,0 +1,210 @@
+#include "JointSmoother.h"
+#include <emmintrin.h>
+#include <math.h>
+
+const FLOAT twoPi = 6.28318531f;
+
+// Hands and wrists are what the gestures watch, so they get the least lag;
+// the trunk barely moves, so it can be smoothed hard
+#define TRUNK { 0.4f, 1.0f }
+#define LIMB  { 0.8f, 4.0f }
+#define HAND  { 1.0f, 8.0f }
+const JointFilterParams defaultJointParams[NUI_SKELETON_POSITION_COUNT] = {
+	TRUNK,	// HIP_CENTER
+	TRUNK,	// SPINE
+	TRUNK,	// SHOULDER_CENTER
+	LIMB,	// HEAD
+	TRUNK,	// SHOULDER_LEFT
+	LIMB,	// ELBOW_LEFT
+	HAND,	// WRIST_LEFT
+	HAND,	// HAND_LEFT
+	TRUNK,	// SHOULDER_RIGHT
+	LIMB,	// ELBOW_RIGHT
+	HAND,	// WRIST_RIGHT
+	HAND,	// HAND_RIGHT
+	TRUNK,	// HIP_LEFT
+	LIMB,	// KNEE_LEFT
+	LIMB,	// ANKLE_LEFT
+	LIMB,	// FOOT_LEFT
+	TRUNK,	// HIP_RIGHT
+	LIMB,	// KNEE_RIGHT
+	LIMB,	// ANKLE_RIGHT
+	LIMB,	// FOOT_RIGHT
+};
+#undef TRUNK
+#undef LIMB
+#undef HAND
+
+JointSmoother::JointSmoother()
+{
+	states = (SkeletonFilterState*) _aligned_malloc(NUI_SKELETON_COUNT * sizeof(SkeletonFilterState), 16);
+	params = (FLOAT*) _aligned_malloc(2 * smoothedJoints * sizeof(FLOAT), 16);
+	// The padding joints never move, but give them something sane
+	for (int j = 0; j < smoothedJoints; j++)
+	{
+		params[j] = 1.0f;
+		params[smoothedJoints + j] = 0;
+	}
+	for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+	{
+		setJointParams(j, defaultJointParams[j]);
+	}
+
+	// Every x64 processor has SSE2, but check on 32-bit
+	useSSE = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	reset();
+}
+
+JointSmoother::~JointSmoother(void)
+{
+	_aligned_free(states);
+	_aligned_free(params);
+}
+
+void JointSmoother::reset()
+{
+	ZeroMemory(states, NUI_SKELETON_COUNT * sizeof(SkeletonFilterState));
+	haveTimestamp = FALSE;
+	lastTimestamp = 0;
+}
+
+void JointSmoother::setJointParams(int joint, const JointFilterParams &jointParams)
+{
+	params[joint] = jointParams.minCutoff;
+	params[smoothedJoints + joint] = jointParams.beta;
+}
+
+void JointSmoother::smooth(NUI_SKELETON_FRAME &SkeletonFrame)
+{
+	// Timestamps are in milliseconds
+	FLOAT rate = defaultFrameRate;
+	LONGLONG timestamp = SkeletonFrame.liTimeStamp.QuadPart;
+	if (haveTimestamp && timestamp > lastTimestamp && timestamp - lastTimestamp < 500)
+	{
+		rate = 1000.0f / (FLOAT) (timestamp - lastTimestamp);
+	}
+	else
+	{
+		// After a gap, whoever's there now may be somewhere else entirely
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			states[i].primed = FALSE;
+		}
+	}
+	haveTimestamp = TRUE;
+	lastTimestamp = timestamp;
+
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		NUI_SKELETON_DATA &skeleton = SkeletonFrame.SkeletonData[i];
+		SkeletonFilterState &state = states[i];
+		if (skeleton.eTrackingState != NUI_SKELETON_TRACKED)
+		{
+			state.primed = FALSE;
+			continue;
+		}
+		// Somebody new, don't drag them from where the last person was
+		if (skeleton.dwTrackingID != state.trackingId)
+		{
+			state.primed = FALSE;
+			state.trackingId = skeleton.dwTrackingID;
+		}
+		smoothSkeleton(skeleton, state, rate);
+	}
+}
+
+void JointSmoother::smoothSkeleton(NUI_SKELETON_DATA &skeleton, SkeletonFilterState &state, FLOAT rate)
+{
+	__declspec(align(16)) FLOAT raw[3][smoothedJoints];
+	for (int j = 0; j < smoothedJoints; j++)
+	{
+		if (j < NUI_SKELETON_POSITION_COUNT)
+		{
+			raw[0][j] = skeleton.SkeletonPositions[j].x;
+			raw[1][j] = skeleton.SkeletonPositions[j].y;
+			raw[2][j] = skeleton.SkeletonPositions[j].z;
+		}
+		else
+		{
+			raw[0][j] = raw[1][j] = raw[2][j] = 0;
+		}
+	}
+
+	if (! state.primed)
+	{
+		memcpy(state.smoothed, raw, sizeof(raw));
+		memcpy(state.previous, raw, sizeof(raw));
+		ZeroMemory(state.speed, sizeof(state.speed));
+		state.primed = TRUE;
+		return;
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (useSSE)
+		{
+			FilterJointsSSE(raw[axis], state.smoothed[axis], state.previous[axis], state.speed[axis],
+				params, params + smoothedJoints, rate, smoothedJoints);
+		}
+		else
+		{
+			FilterJointsScalar(raw[axis], state.smoothed[axis], state.previous[axis], state.speed[axis],
+				params, params + smoothedJoints, rate, smoothedJoints);
+		}
+	}
+
+	for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+	{
+		skeleton.SkeletonPositions[j].x = state.smoothed[0][j];
+		skeleton.SkeletonPositions[j].y = state.smoothed[1][j];
+		skeleton.SkeletonPositions[j].z = state.smoothed[2][j];
+	}
+	skeleton.Position = skeleton.SkeletonPositions[NUI_SKELETON_POSITION_HIP_CENTER];
+}
+
+// The One-Euro filter: a low-pass filter whose cutoff rises with the
+// (itself low-passed) speed.  alpha for cutoff fc at the frame rate is
+// 2 pi fc / (2 pi fc + rate).
+void FilterJointsScalar(const FLOAT* raw, FLOAT* smoothed, FLOAT* previous, FLOAT* speed,
+						const FLOAT* minCutoff, const FLOAT* beta, FLOAT rate, int count)
+{
+	FLOAT speedOmega = twoPi * speedCutoff;
+	FLOAT speedAlpha = speedOmega / (speedOmega + rate);
+	for (int j = 0; j < count; j++)
+	{
+		FLOAT velocity = (raw[j] - previous[j]) * rate;
+		speed[j] += speedAlpha * (velocity - speed[j]);
+		FLOAT omega = twoPi * (minCutoff[j] + beta[j] * fabs(speed[j]));
+		FLOAT alpha = omega / (omega + rate);
+		smoothed[j] += alpha * (raw[j] - smoothed[j]);
+		previous[j] = raw[j];
+	}
+}
+
+void FilterJointsSSE(const FLOAT* raw, FLOAT* smoothed, FLOAT* previous, FLOAT* speed,
+					 const FLOAT* minCutoff, const FLOAT* beta, FLOAT rate, int count)
+{
+	FLOAT speedOmega = twoPi * speedCutoff;
+	const __m128 speedAlpha = _mm_set1_ps(speedOmega / (speedOmega + rate));
+	const __m128 rates = _mm_set1_ps(rate);
+	const __m128 twoPis = _mm_set1_ps(twoPi);
+	// Everything but the sign bit, for fabs
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+	for (int j = 0; j < count; j += 4)
+	{
+		__m128 r = _mm_load_ps(raw + j);
+		__m128 s = _mm_load_ps(speed + j);
+		__m128 velocity = _mm_mul_ps(_mm_sub_ps(r, _mm_load_ps(previous + j)), rates);
+		s = _mm_add_ps(s, _mm_mul_ps(speedAlpha, _mm_sub_ps(velocity, s)));
+		_mm_store_ps(speed + j, s);
+
+		__m128 cutoff = _mm_add_ps(_mm_load_ps(minCutoff + j), _mm_mul_ps(_mm_load_ps(beta + j), _mm_and_ps(s, absMask)));
+		__m128 omega = _mm_mul_ps(twoPis, cutoff);
+		__m128 alpha = _mm_div_ps(omega, _mm_add_ps(omega, rates));
+		__m128 out = _mm_load_ps(smoothed + j);
+		out = _mm_add_ps(out, _mm_mul_ps(alpha, _mm_sub_ps(r, out)));
+		_mm_store_ps(smoothed + j, out);
+		_mm_store_ps(previous + j, r);
+	}
+}
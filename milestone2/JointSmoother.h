@@ -0,0 +1,86 @@
+/************************************************************************
+*                                                                       *
+*   JointSmoother.h -- Declaration of JointSmoother class               *
+*                                                                       *
+*   One-Euro filtering of every joint of every skeleton, in place of    *
+*   NuiTransformSmooth.  Each joint gets its own trade-off between      *
+*   jitter and lag, and the filter opens up the faster a joint moves,   *
+*   so hands stay quick while the spine stays still.  Joints are kept   *
+*   one array per axis, so SSE does four joints at a time.              *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+
+/* Mode selection: the SDK's smoothing, or ours */
+enum Smoothing_Style {
+	Sdk_Smoothing,
+	OneEuro_Smoothing,
+};
+const enum Smoothing_Style SMOOTHING_STYLE = OneEuro_Smoothing;
+
+// How much a joint is smoothed.  Cutoffs are in Hz, beta in Hz per m/s.
+struct JointFilterParams
+{
+	// Cutoff when the joint is still: lower is smoother, but lags more
+	FLOAT minCutoff;
+	// How much the cutoff rises with speed: higher lags less when moving
+	FLOAT beta;
+};
+
+// Cutoff for the speed estimate itself
+const FLOAT speedCutoff = 1.0f;
+// Frame rate to assume when timestamps don't give a sensible one
+const FLOAT defaultFrameRate = 30.0f;
+
+// Joint count rounded up to whole SSE registers
+const int smoothedJoints = (NUI_SKELETON_POSITION_COUNT + 3) & ~3;
+
+// Filter state for one skeleton, one array per axis
+struct SkeletonFilterState
+{
+	FLOAT smoothed[3][smoothedJoints];
+	FLOAT previous[3][smoothedJoints];
+	FLOAT speed[3][smoothedJoints];
+	// Whether there's anything to filter against yet
+	BOOL primed;
+	DWORD trackingId;
+};
+
+class JointSmoother
+{
+public:
+	JointSmoother();
+	~JointSmoother(void);
+
+	// Smooths every tracked skeleton in the frame, in place
+	void smooth(NUI_SKELETON_FRAME &SkeletonFrame);
+	// Start again from the next frame
+	void reset();
+	void setJointParams(int joint, const JointFilterParams &params);
+
+	// Which kernel to use; defaults to the fastest this processor can run
+	BOOL useSSE;
+
+private:
+	void smoothSkeleton(NUI_SKELETON_DATA &skeleton, SkeletonFilterState &state, FLOAT rate);
+
+	// Both 16-byte aligned
+	SkeletonFilterState* states;
+	FLOAT* params;	// minCutoff[smoothedJoints] then beta[smoothedJoints]
+
+	BOOL haveTimestamp;
+	LONGLONG lastTimestamp;
+};
+
+// The joint filter kernels: filters count values (a multiple of 4 for the
+// SSE one) towards raw, updating smoothed, previous and speed
+void FilterJointsScalar(const FLOAT* raw, FLOAT* smoothed, FLOAT* previous, FLOAT* speed,
+						const FLOAT* minCutoff, const FLOAT* beta, FLOAT rate, int count);
+void FilterJointsSSE(const FLOAT* raw, FLOAT* smoothed, FLOAT* previous, FLOAT* speed,
+					 const FLOAT* minCutoff, const FLOAT* beta, FLOAT rate, int count);
+
+// The starting parameters for each joint
+extern const JointFilterParams defaultJointParams[NUI_SKELETON_POSITION_COUNT];
@@ -39,6 +39,18 @@
 #include "Magnifier.h"
 #include "GestureDetector.h"
 #include "NuiImpl.h"
+#include "SkeletonRecorder.h"
+#include "SkeletonReplayer.h"
+#include "Benchmark.h"
+#include "OverlayScene.h"
+#include "OverlaySurface.h"
+#include "OverlayTextCache.h"
+#include "MagnifierUpdater.h"
+#include "FramePacer.h"
+#include "FrameClock.h"
+#include <mmsystem.h>
+
+#pragma comment (lib,"winmm.lib")
 
 // Disable "conditional expression is constant" warning
 #pragma warning( disable : 4127 )
@@ -65,7 +77,11 @@ const TCHAR         WindowTitle[]= TEXT("Screen Magnifier");
 const TCHAR         ViewWindowTitle[]= TEXT("Viewfinder");
 const TCHAR         LensWindowTitle[]= TEXT("Lens");
 const TCHAR         OverlayWindowTitle[]= TEXT("Overlay");
-const UINT          timerInterval = 16; // close to the refresh rate @60hz 16
+// Updates on the display's period; stats go to the debugger this often
+FramePacer          framePacer;
+const LONG          pacerReportTicks = 600;
+// CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, which this SDK doesn't have
+const DWORD         pacerHighResolutionTimer = 0x00000002;
 HWND                hwndMag;
 HWND                hwndViewfinder;
 HWND                hwndLens;
@@ -84,11 +100,94 @@ int                 distanceInMM = 0;
 BOOL                isFullScreen = FALSE;
 int                 xRes = GetSystemMetrics(SM_CXVIRTUALSCREEN);
 int                 yRes = GetSystemMetrics(SM_CYVIRTUALSCREEN);
-Color               backgroundColor = Color(255, 255, 255, 255);
+// The overlay is a white veil, with what's drawn on it, this opaque
+const DWORD         overlayBackground = overlayWhite;
+const BYTE          overlayOpacity = 110;
+// What the overlay window shows, drawn into a DIB section
+OverlaySurface      overlaySurface;
+HDC                 overlayDC;
+HBITMAP             overlayBitmap;
+// Decides which of the windows the timer has to update
+MagnifierUpdater    magnifierUpdater;
 extern int	    activeSkeleton;
 extern BOOL quit_properly;
 BOOL                showSkeletalViewer = FALSE;
 extern NuiImpl* nui_impl;
+// Running without any windows (skeleton replay).  The magnifier's
+// visibility is only pretended, so the stop gesture still toggles it.
+BOOL                headlessMode = FALSE;
+BOOL                headlessMagnifierHidden = FALSE;
+// Set from the command line; see ParseCommandLine()
+char                recordPath[MAX_PATH] = "";
+char                templatePath[MAX_PATH] = "";
+// Whether the recording being replayed was made with the viewer's
+// application tracking on
+BOOL                replayAppTracking = FALSE;
+extern SkeletonRecorder* skeletonRecorder;
+
+//
+// FUNCTION: GetPacerTime()
+//
+// PURPOSE: Milliseconds from the frame clock, for the frame pacer
+//
+static double GetPacerTime()
+{
+	return (double) frameClock.now() / frameClockTicksPerMs;
+}
+
+//
+// FUNCTION: CreatePacerTimer()
+//
+// PURPOSE: A timer for the frame pacer to wait on.  A high resolution one
+// where Windows has them; otherwise an ordinary one, which goes off on the
+// first system timer tick after it's due.
+//
+static HANDLE CreatePacerTimer()
+{
+	typedef HANDLE (WINAPI *CreateWaitableTimerExWFunc)(LPSECURITY_ATTRIBUTES, LPCWSTR, DWORD, DWORD);
+	CreateWaitableTimerExWFunc createTimerEx = (CreateWaitableTimerExWFunc)
+		GetProcAddress(GetModuleHandle(TEXT("kernel32.dll")), "CreateWaitableTimerExW");
+	HANDLE timer = NULL;
+	if (createTimerEx != NULL)
+	{
+		timer = createTimerEx(NULL, NULL, pacerHighResolutionTimer, TIMER_ALL_ACCESS);
+	}
+	if (timer == NULL)
+	{
+		timer = CreateWaitableTimer(NULL, FALSE, NULL);
+	}
+	return timer;
+}
+
+//
+// FUNCTION: GetDisplayPeriod()
+//
+// PURPOSE: How long the display shows a frame for, in milliseconds
+//
+static double GetDisplayPeriod()
+{
+	HDC hDC = GetDC(NULL);
+	int refresh = GetDeviceCaps(hDC, VREFRESH);
+	ReleaseDC(NULL, hDC);
+	// 0 and 1 mean the hardware's default
+	return (refresh > 1) ? 1000.0 / refresh : defaultFramePeriodMs;
+}
+
+//
+// FUNCTION: ReportFramePacing()
+//
+// PURPOSE: How evenly the magnifier's been updated, and how much of the time
+// there was anything to update, to the debugger
+//
+static void ReportFramePacing()
+{
+	char pacing[256];
+	sprintf_s(pacing, sizeof(pacing),
+		"Magnifier ticks: interval error p50/p95/p99 %.2f/%.2f/%.2f ms, %ld missed; %ld updated, %ld skipped\r\n",
+		framePacer.jitter.percentile(0.50), framePacer.jitter.percentile(0.95), framePacer.jitter.percentile(0.99),
+		framePacer.missed, magnifierUpdater.updated, magnifierUpdater.skipped);
+	OutputDebugStringA(pacing);
+}
 
 //
 // FUNCTION: WinMain()
@@ -97,9 +196,25 @@ extern NuiImpl* nui_impl;
 //
 int APIENTRY WinMain(HINSTANCE hInstance,
 	HINSTANCE /*hPrevInstance*/,
-	LPSTR     /*lpCmdLine*/,
+	LPSTR     lpCmdLine,
 	int       nCmdShow)
 {
+	char replayPath[MAX_PATH] = "";
+	float replaySpeed = 1.0f;
+	BOOL runBenchmark = FALSE;
+	ParseCommandLine(lpCmdLine, replayPath, &replaySpeed, &runBenchmark);
+
+	if (runBenchmark)
+	{
+		return RunBenchmarks("benchmark_results.txt");
+	}
+
+	// Replaying a recording doesn't need the sensor or any windows
+	if (replayPath[0] != '\0')
+	{
+		return RunReplay(replayPath, replaySpeed, "replay_results.txt");
+	}
+
 	if (mode == KINECT_ONLY)
 	{
 		StartKinectProcessing(hInstance);
@@ -136,30 +251,126 @@ int APIENTRY WinMain(HINSTANCE hInstance,
 		ShowWindow(hwndHost, nCmdShow);
 		UpdateWindow(hwndHost);
 
-		// Create a timer to update the control.
-		UINT_PTR timerId = SetTimer(hwndHost, 0, timerInterval, UpdateMagWindow);
-
-		// Main message loop.
+		// Update the control every display period, waiting on the messages
+		// and the pacer's timer in between
+		timeBeginPeriod(1);
+		HANDLE pacerTimer = CreatePacerTimer();
+		framePacer.start(GetDisplayPeriod(), GetPacerTime());
 		MSG msg;
-		while (GetMessage(&msg, NULL, 0, 0))
+		msg.wParam = 0;
+		BOOL running = TRUE;
+		while (running && ! (quit_properly && nui_impl == NULL))
 		{
-			TranslateMessage(&msg);
-			DispatchMessage(&msg);
-			if (quit_properly && nui_impl == NULL)
+			double now = GetPacerTime();
+			if (framePacer.untilDue(now) <= 0.0)
 			{
-				break;
+				framePacer.tick(now);
+				UpdateMagWindow(hwndHost, WM_TIMER, 0, GetTickCount());
+				if (framePacer.ticks % pacerReportTicks == 0)
+				{
+					ReportFramePacing();
+				}
+				continue;
+			}
+
+			// Main message loop.  Without a timer, sleep whole milliseconds.
+			LARGE_INTEGER due;
+			due.QuadPart = -framePacer.waitFor(now);
+			if (pacerTimer != NULL && SetWaitableTimer(pacerTimer, &due, 0, NULL, NULL, FALSE))
+			{
+				MsgWaitForMultipleObjects(1, &pacerTimer, FALSE, INFINITE, QS_ALLINPUT);
+			}
+			else
+			{
+				MsgWaitForMultipleObjects(0, NULL, FALSE, framePacer.sleepFor(now), QS_ALLINPUT);
+			}
+			while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+			{
+				if (msg.message == WM_QUIT)
+				{
+					running = FALSE;
+					break;
+				}
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
 			}
 		}
 
 		// Shut down.
+		if (pacerTimer != NULL)
+		{
+			CloseHandle(pacerTimer);
+		}
+		timeEndPeriod(1);
         GdiplusShutdown(gdiplusToken);
-		KillTimer(NULL, timerId);
 		MagUninitialize();
 		return (int) msg.wParam;
 	}
 	return 0;
 }
 
+//
+// FUNCTION: ParseCommandLine()
+//
+// PURPOSE: Picks up the options we understand:
+//     -record <file>    append every skeleton frame to <file>
+//     -replay <file>    run <file> through the gesture detectors and quit
+//     -speed <x>        replay at x times real time (0 = flat out)
+//     -template <file>  also recognize the gesture recorded in <file>
+//     -apptracking      the replayed recording had application tracking on
+//     -benchmark        run the headless benchmarks and quit
+// Paths can't contain spaces.
+//
+void ParseCommandLine(LPSTR lpCmdLine, char* replayPath, float* replaySpeed, BOOL* runBenchmark)
+{
+	char cmdLine[1024];
+	if (lpCmdLine == NULL || strncpy_s(cmdLine, sizeof(cmdLine), lpCmdLine, _TRUNCATE) != 0)
+	{
+		return;
+	}
+
+	char* context = NULL;
+	char* token = strtok_s(cmdLine, " \t", &context);
+	while (token != NULL)
+	{
+		if (_stricmp(token, "-benchmark") == 0)
+		{
+			*runBenchmark = TRUE;
+			token = strtok_s(NULL, " \t", &context);
+			continue;
+		}
+		if (_stricmp(token, "-apptracking") == 0)
+		{
+			replayAppTracking = TRUE;
+			token = strtok_s(NULL, " \t", &context);
+			continue;
+		}
+
+		char* argument = strtok_s(NULL, " \t", &context);
+		if (argument == NULL)
+		{
+			break;
+		}
+		if (_stricmp(token, "-record") == 0)
+		{
+			strncpy_s(recordPath, MAX_PATH, argument, _TRUNCATE);
+		}
+		else if (_stricmp(token, "-replay") == 0)
+		{
+			strncpy_s(replayPath, MAX_PATH, argument, _TRUNCATE);
+		}
+		else if (_stricmp(token, "-template") == 0)
+		{
+			strncpy_s(templatePath, MAX_PATH, argument, _TRUNCATE);
+		}
+		else if (_stricmp(token, "-speed") == 0)
+		{
+			*replaySpeed = (float) atof(argument);
+		}
+		token = strtok_s(NULL, " \t", &context);
+	}
+}
+
 //
 // FUNCTION: HostWndProc()
 //
@@ -327,13 +538,13 @@ ATOM RegisterOverlayWindowClass(HINSTANCE hInstance)
 
 
 //
-// FUNCTION: UpdateMagnificationFactor()
+// FUNCTION: SetMagnificationFactor()
 //
-// PURPOSE: Change the amount the window is magnified
+// PURPOSE: Magnify the window by a given amount
 //
-BOOL UpdateMagnificationFactor()
+BOOL SetMagnificationFactor(float factor)
 {
-	MagFactor = GetMagnificationFactor();
+	MagFactor = factor;
 	// Set the magnification factor.
 	MAGTRANSFORM matrix;
 	memset(&matrix, 0, sizeof(matrix));
@@ -345,6 +556,16 @@ BOOL UpdateMagnificationFactor()
 	return ret;
 }
 
+//
+// FUNCTION: UpdateMagnificationFactor()
+//
+// PURPOSE: Change the amount the window is magnified
+//
+BOOL UpdateMagnificationFactor()
+{
+	return SetMagnificationFactor(GetMagnificationFactor());
+}
+
 //
 // FUNCTION: SetupMagnifier
 //
@@ -435,19 +656,7 @@ BOOL SetupViewfinder(HINSTANCE hInst)
 
 void ApplyLensRestrictions (RECT sourceRect){
 
-	lensWindowRect.left = viewfinderWindowRect.left + (sourceRect.left/5);
-	lensWindowRect.top = viewfinderWindowRect.top + (sourceRect.top/5);
-	lensWindowRect.right = (LONG) ((sourceRect.right-sourceRect.left)/5);
-	lensWindowRect.bottom = (LONG) ((sourceRect.bottom-sourceRect.top)/5);
-
-	if (lensWindowRect.left + lensWindowRect.right > viewfinderWindowRect.left + viewfinderWindowRect.right){
-		lensWindowRect.left = viewfinderWindowRect.left + viewfinderWindowRect.right - lensWindowRect.right;
-	}
-
-	if (lensWindowRect.top + lensWindowRect.bottom > viewfinderWindowRect.top + viewfinderWindowRect.bottom){
-		lensWindowRect.top = viewfinderWindowRect.top + viewfinderWindowRect.bottom - lensWindowRect.bottom;
-	}
-	return;
+	lensWindowRect = MagnifierLensRect(sourceRect, viewfinderWindowRect);
 }
 
 //
@@ -473,6 +682,45 @@ BOOL SetupLens(HINSTANCE hInst)
 	return TRUE;
 }
 
+//
+// FUNCTION: RenderOverlayGlyph()
+//
+// PURPOSE: Renders one glyph of the overlay's text with GDI+, for
+// overlayTextCache to keep.  Only called the first time a glyph's needed.
+//
+static BOOL RenderOverlayGlyph(void* /*context*/, WCHAR glyph, int size, GlyphMask &mask)
+{
+	FontFamily  fontFamily(L"Arial");
+	Font        font(&fontFamily, (float) size, FontStyleRegular, UnitPixel);
+	StringFormat format(StringFormat::GenericTypographic());
+	format.SetFormatFlags(format.GetFormatFlags() | StringFormatFlagsMeasureTrailingSpaces);
+	WCHAR text[2] = { glyph, 0 };
+
+	// White onto nothing, so its alpha is its coverage
+	Bitmap cell(mask.width, mask.height, PixelFormat32bppARGB);
+	Graphics g(&cell);
+	g.SetTextRenderingHint(TextRenderingHintAntiAliasGridFit);
+	SolidBrush solidBrush(Color(255, 255, 255, 255));
+	if (g.DrawString(text, 1, &font, PointF((float) mask.originX, 0), &format, &solidBrush) != Ok)
+	{
+		return FALSE;
+	}
+	RectF extent;
+	g.MeasureString(text, 1, &font, PointF(0, 0), &format, &extent);
+	mask.advance = (int) (extent.Width + 0.5f);
+
+	for (int y = 0; y < mask.height; y++)
+	{
+		for (int x = 0; x < mask.width; x++)
+		{
+			Color pixel;
+			cell.GetPixel(x, y, &pixel);
+			mask.coverage[y * mask.width + x] = pixel.GetAlpha();
+		}
+	}
+	return TRUE;
+}
+
 //
 // FUNCTION: SetupOverlay
 //
@@ -497,61 +745,56 @@ BOOL SetupOverlay(HINSTANCE hInst)
 	{
 		return FALSE;
 	}
-	SetLayeredWindowAttributes(hwndOverlay, 0, 110, LWA_ALPHA);  
+
+	// Drawn into a top-down DIB section, and pushed to the window whole
+	// with UpdateLayeredWindow()
+	BITMAPINFO bitmapInfo;
+	ZeroMemory(&bitmapInfo, sizeof(bitmapInfo));
+	bitmapInfo.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+	bitmapInfo.bmiHeader.biWidth = xRes;
+	bitmapInfo.bmiHeader.biHeight = -yRes;
+	bitmapInfo.bmiHeader.biPlanes = 1;
+	bitmapInfo.bmiHeader.biBitCount = 32;
+	bitmapInfo.bmiHeader.biCompression = BI_RGB;
+	void* bits = NULL;
+	overlayDC = CreateCompatibleDC(NULL);
+	overlayBitmap = CreateDIBSection(overlayDC, &bitmapInfo, DIB_RGB_COLORS, &bits, NULL, 0);
+	if (overlayBitmap == NULL)
+	{
+		return FALSE;
+	}
+	SelectObject(overlayDC, overlayBitmap);
+	overlaySurface.attach((DWORD*) bits, xRes, yRes, xRes);
+	overlaySurface.clear(overlayBackground);
+	overlayTextCache.setRenderer(RenderOverlayGlyph, NULL);
 
     ShowWindow(hwndOverlay, SW_HIDE);
 
 	return TRUE;
 }
 
-BOOL UpdateLens()
+//
+// FUNCTION: GetMagnifierInputs()
+//
+// PURPOSE: Everything the magnifier's windows are placed from, at the given
+// magnification
+//
+static MagnifierInputs GetMagnifierInputs(float factor)
 {
-	RECT source;
-	MagGetWindowSource(hwndMag,&source);
-	ApplyLensRestrictions (source);
-
-	SetWindowPos(hwndLens, NULL, 
-		lensWindowRect.left, 
-		lensWindowRect.top, 
-		lensWindowRect.right, 
-		lensWindowRect.bottom, 
-		SWP_NOACTIVATE|SWP_NOREDRAW);
-
-	return TRUE;
+	MagnifierInputs inputs;
+	inputs.magFactor = factor;
+	GetCursorPos(&inputs.cursor);
+	inputs.magWindow = magWindowRect;
+	inputs.viewfinder = viewfinderWindowRect;
+	inputs.screenWidth = GetSystemMetrics(SM_CXSCREEN);
+	inputs.screenHeight = GetSystemMetrics(SM_CYSCREEN);
+	inputs.now = GetTickCount();
+	return inputs;
 }
 
 RECT GetSourceRect (){
 
-	int width = (int)((magWindowRect.right - magWindowRect.left) / MagFactor);
-	int height = (int)((magWindowRect.bottom - magWindowRect.top) / MagFactor);
-	POINT mousePoint;
-	GetCursorPos(&mousePoint);
-	RECT sourceRect;
-	sourceRect.left = mousePoint.x - width / 2;
-	sourceRect.top = mousePoint.y - height / 2;
-
-	// Don't scroll outside desktop area.
-	if (sourceRect.left < 0)
-	{
-		sourceRect.left = 0;
-	}
-	if (sourceRect.left > GetSystemMetrics(SM_CXSCREEN) - width)
-	{
-		sourceRect.left = GetSystemMetrics(SM_CXSCREEN) - width;
-	}
-	sourceRect.right = sourceRect.left + width;
-
-	if (sourceRect.top < 0)
-	{
-		sourceRect.top = 0;
-	}
-	if (sourceRect.top > GetSystemMetrics(SM_CYSCREEN) - height)
-	{
-		sourceRect.top = GetSystemMetrics(SM_CYSCREEN) - height;
-	}        
-	sourceRect.bottom = sourceRect.top + height;
-
-	return sourceRect;
+	return MagnifierSourceRect(GetMagnifierInputs(MagFactor));
 }
 
 //
@@ -628,29 +871,52 @@ void CALLBACK UpdateMagWindow(HWND /*hwnd*/, UINT /*uMsg*/, UINT_PTR /*idEvent*/
 		exit(0);
 	}
 
-	UpdateMagnificationFactor();
-	RECT sourceRect = GetSourceRect();
-	// Set the source rectangle for the magnifier control.
-	MagSetWindowSource(hwndMag, sourceRect);
-
-	UpdateLens();
-	//UpdateOverlay();
-
-	// Reclaim topmost status, to prevent unmagnified menus from remaining in view. 
-	SetWindowPos(hwndHost, HWND_TOPMOST, 0, 0, 0, 0, 
-		SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );
-	// Make overlay topmost window. 
-	SetWindowPos(hwndOverlay, HWND_TOPMOST, NULL, NULL, NULL, NULL, 
-		     SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );    
-
-	// Make viewfinder topmost window. 
-	SetWindowPos(hwndViewfinder, HWND_TOPMOST, NULL, NULL, NULL, NULL, 
-		     SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );
-	// Make lens topmost window. 
-	SetWindowPos(hwndLens, HWND_TOPMOST, NULL, NULL, NULL, NULL, 
-		     SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );    
+	// Whatever the detectors last declared
+	CompositeOverlay();
+
+	// Only what's changed since the last tick is pushed to the windows
+	float factor = GetMagnificationFactor();
+	MagnifierUpdate update;
+	magnifierUpdater.plan(GetMagnifierInputs(factor), update);
+	if (update.transform)
+	{
+		SetMagnificationFactor(factor);
+	}
+	if (update.source)
+	{
+		// Set the source rectangle for the magnifier control.
+		MagSetWindowSource(hwndMag, update.sourceRect);
+	}
+	if (update.lens)
+	{
+		lensWindowRect = update.lensRect;
+		SetWindowPos(hwndLens, NULL, 
+			lensWindowRect.left, 
+			lensWindowRect.top, 
+			lensWindowRect.right, 
+			lensWindowRect.bottom, 
+			SWP_NOACTIVATE|SWP_NOREDRAW);
+	}
+
+	if (update.topmost)
+	{
+		// Reclaim topmost status, to prevent unmagnified menus from remaining in view. 
+		SetWindowPos(hwndHost, HWND_TOPMOST, 0, 0, 0, 0, 
+			SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );
+		// Make overlay topmost window. 
+		SetWindowPos(hwndOverlay, HWND_TOPMOST, NULL, NULL, NULL, NULL, 
+			     SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );    
+
+		// Make viewfinder topmost window. 
+		SetWindowPos(hwndViewfinder, HWND_TOPMOST, NULL, NULL, NULL, NULL, 
+			     SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );
+		// Make lens topmost window. 
+		SetWindowPos(hwndLens, HWND_TOPMOST, NULL, NULL, NULL, NULL, 
+			     SWP_NOACTIVATE | SWP_NOMOVE | SWP_NOSIZE );    
+	}
     
-	// Force redraw.
+	// Force redraw.  Still every tick: what's under a still cursor can change
+	// too, and this is how the control picks it up.
 	InvalidateRect(hwndMag, NULL, TRUE);   
     
 }
@@ -701,6 +967,11 @@ void GoFullScreen()
 //
 void HideMagnifier()
 {
+  if (headlessMode)
+    {
+      headlessMagnifierHidden = ! headlessMagnifierHidden;
+      return;
+    }
   if (IsWindowVisible(hwndMag))
     {
       ShowWindow(hwndMag, SW_HIDE);
@@ -716,58 +987,42 @@ void HideMagnifier()
       ShowWindow(hwndLens, SW_SHOW);
       ShowWindow(hwndHost, SW_SHOW);
       isMagnifierOff = TRUE;
+      // Back on top, where it was
+      magnifierUpdater.invalidate();
     }
 }
 
-// Just clear the overlay, without hiding it (should help eliminate some flashing)
-void clearOverlay()
+// Whether the magnifier is showing (or would be, when headless)
+BOOL IsMagnifierVisible()
 {
-	if (IsWindowVisible(hwndOverlay))
+	if (headlessMode)
 	{
-		Graphics g(hwndOverlay);    
-		SolidBrush brush(backgroundColor);
-		g.FillRectangle( &brush, overlayWindowRect.left, overlayWindowRect.top, overlayWindowRect.right, overlayWindowRect.bottom );        
+		return ! headlessMagnifierHidden;
 	}
+	return IsWindowVisible(hwndMag);
+}
 
-	return;
+/* The overlay is retained: the functions below declare what it should
+   show into overlayScene, and CompositeOverlay() draws whatever changed,
+   once per display frame. */
+
+// Just clear the overlay, without hiding it (should help eliminate some flashing)
+void clearOverlay()
+{
+	overlayScene.clear();
 }
 
 // Hide the overlay
 void clearAndHideOverlay()
 {
-	if (IsWindowVisible(hwndOverlay))
-	{
-		Graphics g(hwndOverlay);    
-		SolidBrush brush(backgroundColor);
-		g.FillRectangle( &brush, overlayWindowRect.left, overlayWindowRect.top, overlayWindowRect.right, overlayWindowRect.bottom );
-		
-		ShowWindow(hwndOverlay, SW_HIDE);
-	}
-
-	return;
+	overlayScene.hide();
 }
 
 
 Status drawText(int x1, int y1, WCHAR string[], int size)
 {
-	if (! IsWindowVisible(hwndOverlay))
-	{
-		ShowWindow(hwndOverlay, SW_SHOW);
-	}
-	Graphics g(hwndOverlay);
-	FontFamily  fontFamily(L"Arial");
-	Font        font(&fontFamily, (float) size, FontStyleRegular, UnitPixel);
-	PointF      pointF((float) x1, (float) y1);
-	SolidBrush  solidBrush(Color(255, 128, 255, 128));
-
-	// Create a solid background so the text is visible
-	SolidBrush backgroundBrush(Color(255, 0, 0, 0));
-	Rect backgroundRect(x1 - size, y1, size * strlen( (const char*) string) * 16, size);
-	g.FillRectangle(&backgroundBrush, backgroundRect);
-
-	Status result = g.DrawString(string, -1, &font, pointF, &solidBrush);
-    
-	return result;
+	overlayScene.add(OverlayText(x1, y1, string, size));
+	return Ok;
 }
 
 // Draw lock on boxes around a point.
@@ -783,38 +1038,7 @@ void drawLockOn(int cx, int cy)
 
 void drawRectangle(int ulx, int uly, int width, int height, int c)
 {
-	if (! IsWindowVisible(hwndOverlay))
-	{
-		ShowWindow(hwndOverlay, SW_SHOW);
-	}
-	Graphics g(hwndOverlay);
-	BYTE green = 0;
-	BYTE red = 0;
-	BYTE blue = 0;
-	if (c == 0) 		// Red
-	{
-		green = 0;
-		red = 255;
-		blue = 0;
-	}
-	else if (c == 1) 		// Green
-	{
-		green = 255;
-		red = 0;
-		blue = 0;
-	}
-	else if (c == 2) 	// White
-	{
-		green = 255;
-		red = 255;
-		blue = 255;
-	}
-	Pen pen(Color(255, red, green, blue ), 10.0f);
-
-	Rect rectangle(ulx, uly, width, height);    
-	g.DrawRectangle( &pen, rectangle );        
-
-	return;
+	overlayScene.add(OverlayRectangle(ulx, uly, width, height, c));
 }
 
 // void drawArrow(int lx, int ly, int rx, int ry, int midOffset)
@@ -828,26 +1052,10 @@ void drawRectangle(int ulx, int uly, int width, int height, int c)
 
 Status drawTrapezoid(int ulx, int uly, Quadrant quad, int on)
 {
-	const int pointsInTrapezoid = 5;
-
-	if (! IsWindowVisible(hwndOverlay))
+	if (quad != Q_TOP && quad != Q_BOTTOM && quad != Q_RIGHT && quad != Q_LEFT)
 	{
-		ShowWindow(hwndOverlay, SW_SHOW);
-	}
-
-	Graphics g(hwndOverlay);
-	BYTE red, green;
-	if (on)
-	{
-		red = 0;
-		green = 255;
-	}
-	else
-	{
-		red = 255;
-		green = 0;
+		return GenericError;
 	}
-	Pen pen( Color(255, red, green, 0), 10.0f);
 
 	int maxDist = 0;
 	if (xRes > yRes)
@@ -858,49 +1066,57 @@ Status drawTrapezoid(int ulx, int uly, Quadrant quad, int on)
 	{
 		maxDist = yRes;
 	}
+	overlayScene.add(OverlayTrapezoid(ulx, uly, boxLarge, quad, on, maxDist));
+	return Ok;
+}
 
-	if (quad == Q_TOP)
+//
+// FUNCTION: CompositeOverlay()
+//
+// PURPOSE: Brings the overlay window up to date with what the detectors last
+// declared, redrawing only what changed.  Called from the magnifier's timer.
+//
+void CompositeOverlay()
+{
+	// Too big for the stack, and only ever used from the timer
+	static OverlayDamage damage;
+	if (! overlayScene.compose(overlayWindowRect.right, overlayWindowRect.bottom, damage))
 	{
-		Point trapezoidPoints[pointsInTrapezoid] = {
-			Point(ulx, uly),
-			Point(ulx - maxDist, uly - maxDist),
-			Point(ulx + boxLarge + maxDist, uly - maxDist),
-			Point(ulx + boxLarge, uly),
-			Point(ulx, uly)};
-		return g.DrawPolygon(&pen, trapezoidPoints, pointsInTrapezoid);
+		return;
 	}
-	else if (quad == Q_BOTTOM)
+
+	if (damage.hide)
 	{
-		Point trapezoidPoints[pointsInTrapezoid] = {
-			Point(ulx, uly + boxLarge),
-			Point(ulx - maxDist, uly + boxLarge + maxDist),
-			Point(ulx + boxLarge + maxDist, uly + boxLarge + maxDist),
-			Point(ulx + boxLarge, uly + boxLarge),
-			Point(ulx, uly + boxLarge)};
-		return g.DrawPolygon(&pen, trapezoidPoints, pointsInTrapezoid);
+		ShowWindow(hwndOverlay, SW_HIDE);
+		return;
 	}
-	else if (quad == Q_RIGHT)
+
+	for (int d = 0; d < damage.numDirty; d++)
 	{
-		Point trapezoidPoints[pointsInTrapezoid] = {
-			Point(ulx + boxLarge, uly),
-			Point(ulx + boxLarge + maxDist, uly - maxDist),
-			Point(ulx + boxLarge + maxDist, uly + boxLarge + maxDist),
-			Point(ulx + boxLarge, uly + boxLarge),
-			Point(ulx + boxLarge, uly)};
-		return g.DrawPolygon(&pen, trapezoidPoints, pointsInTrapezoid);
+		const RECT &dirty = damage.dirty[d];
+		overlaySurface.setClip(dirty);
+		overlaySurface.clear(overlayBackground);
+		for (int i = 0; i < damage.numRedraw; i++)
+		{
+			if (! overlaySurface.draw(damage.redraw[i]))
+			{
+				overlayTextCache.draw(overlaySurface, damage.redraw[i]);
+			}
+		}
 	}
-	else if (quad == Q_LEFT)
+	overlaySurface.resetClip();
+
+	// One update for the whole frame
+	POINT origin = { overlayWindowRect.left, overlayWindowRect.top };
+	SIZE size = { overlaySurface.width, overlaySurface.height };
+	POINT source = { 0, 0 };
+	BLENDFUNCTION blend = { AC_SRC_OVER, 0, overlayOpacity, AC_SRC_ALPHA };
+	UpdateLayeredWindow(hwndOverlay, NULL, &origin, &size, overlayDC, &source, 0, &blend, ULW_ALPHA);
+
+	if (! IsWindowVisible(hwndOverlay))
 	{
-		Point trapezoidPoints[pointsInTrapezoid] = {
-			Point(ulx, uly),
-			Point(ulx - maxDist, uly - maxDist),
-			Point(ulx - maxDist, uly + boxLarge + maxDist),
-			Point(ulx, uly + boxLarge),
-			Point(ulx, uly)};
-		return g.DrawPolygon(&pen, trapezoidPoints, pointsInTrapezoid);
+		ShowWindow(hwndOverlay, SW_SHOW);
 	}
-
-	return GenericError;
 }
 
 //
@@ -36,16 +36,18 @@ BOOL                SetupViewfinder(HINSTANCE hinst);
 BOOL                SetupLens(HINSTANCE hinst);
 BOOL                SetupOverlay(HINSTANCE hinst);
 LRESULT CALLBACK    HostWndProc(HWND, UINT, WPARAM, LPARAM);
-BOOL                UpdateLens();
 void CALLBACK       UpdateMagWindow(HWND hwnd, UINT uMsg, UINT_PTR idEvent, DWORD dwTime);
 void                GoFullScreen();
 void                ApplyLensRestrictions (RECT sourceRect);
 float               GetMagnificationFactor();
 RECT                GetSourceRect ();
 void                HideMagnifier();
+BOOL                IsMagnifierVisible();
+void                ParseCommandLine(LPSTR lpCmdLine, char* replayPath, float* replaySpeed, BOOL* runBenchmark);
 void                drawRectangle(int ulx, int uly, int width, int height, int c);
 Status              drawText(int x1, int y1, WCHAR string[], int size);
 Status              drawTrapezoid(int ulx, int uly, Quadrant quad, int on);
 void                clearOverlay();
 void                drawLockOn(int cx, int cy);
 void                clearAndHideOverlay();
+void                CompositeOverlay();
@@ -0,0 +1,440 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "MagnifierUpdater.h"
+#include "FramePacer.h"
+#include "FrameClock.h"
+#include <algorithm>
+#include <math.h>
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+/*** Magnifier updates ***/
+
+// The magnifier's timer, and a session long enough to cross every phase
+const DWORD magnifierTickMs = 16;
+const int magnifierSessionTicks = 60 * 60 * 10;
+// Window calls a tick made before: the transform, setting and reading back
+// the source, moving the lens, four topmosts and the redraw
+const int oldMagnifierCallsPerTick = 9;
+
+// What the timer sees on one tick of a session that goes round reading
+// (nothing moves), pointing (the cursor moves), reading again, and leaning
+// in and out (the zoom changes), ten seconds each
+static MagnifierInputs MagnifierSessionTick(int tick)
+{
+	MagnifierInputs inputs;
+	RECT magWindow = { 0, 0, 1920, 1080 };
+	RECT viewfinder = { 0, 1080 - 1080 / 5, 1920 / 5, 1080 / 5 };
+	inputs.magWindow = magWindow;
+	inputs.viewfinder = viewfinder;
+	inputs.screenWidth = 1920;
+	inputs.screenHeight = 1080;
+	inputs.now = 0xFFFFFFFF - 1000 + tick * magnifierTickMs;
+
+	const int phaseTicks = 600;
+	int phase = (tick / phaseTicks) % 4;
+	int into = tick % phaseTicks;
+	inputs.cursor.x = 900;
+	inputs.cursor.y = 500;
+	inputs.magFactor = 2.0f;
+	if (phase == 1)
+	{
+		inputs.cursor.x += (LONG) (400 * sin(into / 40.0));
+		inputs.cursor.y += (LONG) (200 * cos(into / 55.0));
+	}
+	else if (phase == 3)
+	{
+		// Distance only changes a millimetre at a time
+		int distanceInMM = (int) (1000 + 300 * sin(into / 60.0));
+		inputs.magFactor = 1.0f + distanceInMM / 1000.0f;
+	}
+	return inputs;
+}
+
+// Whatever gets skipped, the windows end every tick placed just as
+// pushing everything would have placed them, and never go without
+// reclaiming topmost for longer than the interval
+static void CheckMagnifierUpdates(FILE* results)
+{
+	MagnifierUpdater updater;
+	float factor = 0.0f;
+	RECT source = { 0, 0, 0, 0 };
+	RECT lens = { 0, 0, 0, 0 };
+	DWORD lastTopmost = 0;
+	int mismatches = 0;
+	DWORD longestGap = 0;
+	int invalidations = 0;
+	int invalidationsMissed = 0;
+	for (int tick = 0; tick < magnifierSessionTicks; tick++)
+	{
+		// Shown again now and then
+		BOOL invalidated = (tick % 1000 == 999);
+		if (invalidated)
+		{
+			updater.invalidate();
+			invalidations++;
+		}
+
+		MagnifierInputs inputs = MagnifierSessionTick(tick);
+		MagnifierUpdate update;
+		updater.plan(inputs, update);
+		if (update.transform)
+		{
+			factor = inputs.magFactor;
+		}
+		if (update.source)
+		{
+			source = update.sourceRect;
+		}
+		if (update.lens)
+		{
+			lens = update.lensRect;
+		}
+		if (tick > 0 && inputs.now - lastTopmost > longestGap)
+		{
+			longestGap = inputs.now - lastTopmost;
+		}
+		if (update.topmost)
+		{
+			lastTopmost = inputs.now;
+		}
+		if (invalidated && ! (update.transform && update.source && update.lens && update.topmost))
+		{
+			invalidationsMissed++;
+		}
+
+		RECT expectedSource = MagnifierSourceRect(inputs);
+		RECT expectedLens = MagnifierLensRect(expectedSource, inputs.viewfinder);
+		if (factor != inputs.magFactor || memcmp(&source, &expectedSource, sizeof(RECT)) != 0
+			|| memcmp(&lens, &expectedLens, sizeof(RECT)) != 0)
+		{
+			mismatches++;
+		}
+	}
+
+	fprintf(results, "%-24s %s (%d ticks, %d placed differently)\n", "pushed = recomputed",
+		CheckResult(mismatches == 0), magnifierSessionTicks, mismatches);
+	fprintf(results, "%-24s %s (longest %lu ms without, interval %lu ms)\n", "topmost reclaimed",
+		CheckResult(longestGap <= topmostInterval + magnifierTickMs), longestGap, topmostInterval);
+	fprintf(results, "%-24s %s (%d of %d pushed everything)\n", "invalidate pushes all",
+		CheckResult(invalidationsMissed == 0), invalidations - invalidationsMissed, invalidations);
+}
+
+// How much of the session's ticks are skipped, the window calls it saves,
+// and what deciding costs a tick
+static void RunMagnifierUpdateBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	CheckMagnifierUpdates(results);
+
+	MagnifierUpdater updater;
+	MagnifierInputs* session = new MagnifierInputs[magnifierSessionTicks];
+	for (int tick = 0; tick < magnifierSessionTicks; tick++)
+	{
+		session[tick] = MagnifierSessionTick(tick);
+	}
+	int ticks = (benchmarkFrames < magnifierSessionTicks) ? benchmarkFrames : magnifierSessionTicks;
+	timer.reset();
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		MagnifierUpdate update;
+		timer.start();
+		updater.plan(session[tick], update);
+		timer.stop();
+	}
+	timer.report(results, "plan");
+
+	// The whole session, from a fresh start
+	MagnifierUpdater counted;
+	for (int tick = 0; tick < magnifierSessionTicks; tick++)
+	{
+		MagnifierUpdate update;
+		counted.plan(session[tick], update);
+	}
+	delete [] session;
+
+	// The redraw still happens every tick
+	LONG calls = counted.transforms + counted.sources + counted.lenses + 4 * counted.topmosts + counted.ticks;
+	fprintf(results, "%-24s %ld updated, %ld skipped (%.1f%%)\n", "ticks",
+		counted.updated, counted.skipped, 100.0 * counted.skipped / counted.ticks);
+	fprintf(results, "%-24s %ld transforms, %ld sources, %ld lenses, %ld topmosts\n", "",
+		counted.transforms, counted.sources, counted.lenses, counted.topmosts);
+	fprintf(results, "%-24s %.2f per tick, was %d\n", "window calls",
+		(double) calls / counted.ticks, oldMagnifierCallsPerTick);
+}
+
+/*** Frame pacing ***/
+
+// Five minutes of a 60 Hz display
+const double pacingDisplayPeriodMs = 1000.0 / 60;
+const int pacingFrames = 60 * 60 * 5;
+// The system timer's tick, as it is and after timeBeginPeriod(1); a high
+// resolution waitable timer doesn't wait for one
+const double defaultTimerQuantumMs = 15.625;
+const double raisedTimerQuantumMs = 1.0;
+const double highResolutionQuantumMs = 0.0;
+// What the magnifier's SetTimer() asked for
+const double oldTimerIntervalMs = 16.0;
+
+// Simulated time, for the magnifier's thread
+struct PacingClock
+{
+	double now;
+	double quantum;
+	// Waking up exactly when asked, and ticks taking no time
+	BOOL ideal;
+	DWORD noise;
+};
+
+static void InitPacingClock(PacingClock &clock, double quantum, BOOL ideal)
+{
+	clock.now = 0.0;
+	clock.quantum = quantum;
+	clock.ideal = ideal;
+	clock.noise = 2012;
+}
+
+// Waking up on a system timer tick: a little late, and now and then a few
+// milliseconds late (something else had the CPU)
+static void PacingWake(PacingClock &clock, double due)
+{
+	clock.now = (clock.quantum > 0.0) ? ceil(due / clock.quantum) * clock.quantum : due;
+	clock.now += RasterNoise(clock.noise, 300) / 1000.0;
+	if (RasterNoise(clock.noise, 100) == 0)
+	{
+		clock.now += 2.0 + RasterNoise(clock.noise, 3000) / 1000.0;
+	}
+}
+
+// A wait on a timer set waitMs ahead.  Waiting no time is polling.
+static void PacingWait(PacingClock &clock, double waitMs)
+{
+	if (waitMs <= 0.0)
+	{
+		clock.now += 0.01;
+	}
+	else if (clock.ideal)
+	{
+		clock.now += waitMs;
+	}
+	else
+	{
+		PacingWake(clock, clock.now + waitMs);
+	}
+}
+
+// A tick: a millisecond or so of work, and once in a while a slow one
+static void PacingWork(PacingClock &clock)
+{
+	if (clock.ideal)
+	{
+		return;
+	}
+	clock.now += 1.0 + RasterNoise(clock.noise, 2000) / 1000.0;
+	if (RasterNoise(clock.noise, 600) == 0)
+	{
+		clock.now += 40.0;
+	}
+}
+
+// How the ticks landed on the display: frames that got no update, and
+// frames that got more than one (so one was never seen).  Its frames start
+// a way into the first period, as nothing lines them up with the ticks.
+const double pacingDisplayPhaseMs = 0.4 * pacingDisplayPeriodMs;
+
+struct PacingFrames
+{
+	LONG lastFrame;
+	LONG updates;
+	LONG unupdated;
+	LONG doubled;
+};
+
+static void InitPacingFrames(PacingFrames &frames)
+{
+	frames.lastFrame = -1;
+	frames.updates = 0;
+	frames.unupdated = 0;
+	frames.doubled = 0;
+}
+
+static void PacingUpdate(PacingFrames &frames, double when)
+{
+	LONG frame = (LONG) floor((when - pacingDisplayPhaseMs) / pacingDisplayPeriodMs);
+	if (frame == frames.lastFrame)
+	{
+		frames.updates++;
+		frames.doubled += (frames.updates == 2) ? 1 : 0;
+		return;
+	}
+	if (frames.lastFrame != -1)
+	{
+		frames.unupdated += frame - frames.lastFrame - 1;
+	}
+	frames.lastFrame = frame;
+	frames.updates = 1;
+}
+
+// The magnifier's loop under the pacer, for a number of ticks.  Returns
+// how many times it waited no time at all, spinning.
+static LONG RunPacedTicks(FramePacer &pacer, PacingClock &clock, PacingFrames &frames, int ticks)
+{
+	LONG spins = 0;
+	pacer.start(pacingDisplayPeriodMs, clock.now);
+	while (pacer.ticks < ticks)
+	{
+		double until = pacer.untilDue(clock.now);
+		if (until <= 0.0)
+		{
+			pacer.tick(clock.now);
+			PacingUpdate(frames, clock.now);
+			PacingWork(clock);
+		}
+		else
+		{
+			LONGLONG wait = pacer.waitFor(clock.now);
+			spins += (wait == 0) ? 1 : 0;
+			PacingWait(clock, (double) wait / frameClockTicksPerMs);
+		}
+	}
+	return spins;
+}
+
+// The old 16 ms SetTimer(): it comes due every 16 ms, and WM_TIMER arrives
+// on the first system timer tick after that, once, however many times it
+// came due while the last tick was running
+static void RunTimerTicks(FrameJitter &jitter, PacingClock &clock, PacingFrames &frames, int ticks)
+{
+	double due = clock.now;
+	double lastTick = 0.0;
+	for (int tick = 0; tick < ticks; tick++)
+	{
+		double busy = clock.now;
+		PacingWake(clock, due);
+		clock.now = (busy > clock.now) ? busy : clock.now;
+		if (tick > 0)
+		{
+			jitter.record(clock.now - lastTick, pacingDisplayPeriodMs);
+		}
+		lastTick = clock.now;
+		PacingUpdate(frames, clock.now);
+		PacingWork(clock);
+		while (due <= clock.now)
+		{
+			due += oldTimerIntervalMs;
+		}
+	}
+}
+
+// Percentiles from the histogram against sorting the intervals, ticks on
+// an exact clock landing exactly a period apart, never waiting no time
+// between ticks, and a stall's deadlines counted as missed without
+// knocking later ones off the grid
+static void CheckFramePacing(FILE* results)
+{
+	FrameJitter jitter;
+	const int numIntervals = 10000;
+	double* errors = new double[numIntervals];
+	DWORD noise = 7;
+	for (int i = 0; i < numIntervals; i++)
+	{
+		double interval = pacingDisplayPeriodMs + (RasterNoise(noise, 8000) - 4000) / 1000.0;
+		jitter.record(interval, pacingDisplayPeriodMs);
+		errors[i] = fabs(interval - pacingDisplayPeriodMs);
+	}
+	std::sort(errors, errors + numIntervals);
+	const double fractions[] = { 0.50, 0.95, 0.99 };
+	int percentilesWrong = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		double sorted = errors[(int) ceil(fractions[i] * numIntervals) - 1];
+		double binned = jitter.percentile(fractions[i]);
+		if (binned < sorted || binned > sorted + jitterBinMs)
+		{
+			percentilesWrong++;
+		}
+	}
+	delete [] errors;
+	fprintf(results, "%-24s %s (%d of 3 off by more than a bin)\n", "percentiles = sorted",
+		CheckResult(percentilesWrong == 0), percentilesWrong);
+
+	FramePacer pacer;
+	PacingClock clock;
+	PacingFrames frames;
+	InitPacingClock(clock, raisedTimerQuantumMs, TRUE);
+	InitPacingFrames(frames);
+	RunPacedTicks(pacer, clock, frames, pacingFrames);
+	fprintf(results, "%-24s %s (p99 %.2f ms, %ld missed)\n", "exact clock, exact ticks",
+		CheckResult(pacer.jitter.percentile(0.99) <= jitterBinMs && pacer.missed == 0),
+		pacer.jitter.percentile(0.99), pacer.missed);
+
+	InitPacingClock(clock, raisedTimerQuantumMs, FALSE);
+	InitPacingFrames(frames);
+	LONG spins = RunPacedTicks(pacer, clock, frames, pacingFrames);
+	fprintf(results, "%-24s %s (%ld waits of no time in %d ticks)\n", "no spinning",
+		CheckResult(spins == 0), spins, pacingFrames);
+
+	// On time, then three and a half periods late
+	pacer.start(pacingDisplayPeriodMs, 0.0);
+	pacer.tick(0.0);
+	pacer.tick(3.5 * pacingDisplayPeriodMs);
+	double nextDeadline = 3.5 * pacingDisplayPeriodMs + pacer.untilDue(3.5 * pacingDisplayPeriodMs) + pacer.lead;
+	fprintf(results, "%-24s %s (%ld missed, next deadline %.2f periods in)\n", "stall",
+		CheckResult(pacer.missed == 2 && fabs(nextDeadline - 4 * pacingDisplayPeriodMs) < 0.001),
+		pacer.missed, nextDeadline / pacingDisplayPeriodMs);
+}
+
+static void ReportPacing(FILE* results, const char* name, FrameJitter &jitter, const PacingFrames &frames)
+{
+	fprintf(results, "%-24s %5.2f %5.2f %5.2f %6.2f   %6ld %6ld\n", name,
+		jitter.percentile(0.50), jitter.percentile(0.95), jitter.percentile(0.99), jitter.worstMs,
+		frames.unupdated, frames.doubled);
+}
+
+// The old timer and the pacer on the same simulated system, against the
+// display: how far intervals were from its period (ms), and how many of
+// its frames got no update or two
+static void RunFramePacingBenchmark(FILE* results)
+{
+	CheckFramePacing(results);
+
+	fprintf(results, "%-24s %5s %5s %5s %6s   %6s %6s\n", "", "p50", "p95", "p99", "worst", "none", "two");
+	PacingClock clock;
+	PacingFrames frames;
+
+	FrameJitter timerJitter;
+	InitPacingClock(clock, defaultTimerQuantumMs, FALSE);
+	InitPacingFrames(frames);
+	RunTimerTicks(timerJitter, clock, frames, pacingFrames);
+	ReportPacing(results, "SetTimer(16)", timerJitter, frames);
+
+	timerJitter.reset();
+	InitPacingClock(clock, raisedTimerQuantumMs, FALSE);
+	InitPacingFrames(frames);
+	RunTimerTicks(timerJitter, clock, frames, pacingFrames);
+	ReportPacing(results, "SetTimer(16), 1 ms timer", timerJitter, frames);
+
+	FramePacer pacer;
+	InitPacingClock(clock, raisedTimerQuantumMs, FALSE);
+	InitPacingFrames(frames);
+	RunPacedTicks(pacer, clock, frames, pacingFrames);
+	ReportPacing(results, "FramePacer, 1 ms timer", pacer.jitter, frames);
+	fprintf(results, "%-24s %ld deadlines missed, %.2f ms lead\n", "", pacer.missed, pacer.lead);
+
+	InitPacingClock(clock, highResolutionQuantumMs, FALSE);
+	InitPacingFrames(frames);
+	RunPacedTicks(pacer, clock, frames, pacingFrames);
+	ReportPacing(results, "FramePacer, hi-res timer", pacer.jitter, frames);
+	fprintf(results, "%-24s %ld deadlines missed, %.2f ms lead\n", "", pacer.missed, pacer.lead);
+}
+
+// How often the magnifier's windows get touched, then when its frames
+// land against the display's
+void BenchmarkMagnifier(FILE* results, BenchmarkTimer &timer)
+{
+	fprintf(results, "\nMagnifier updates, %lu ms ticks\n", magnifierTickMs);
+	RunMagnifierUpdateBenchmark(results, timer);
+
+	fprintf(results, "\nFrame pacing, %.0f s of a %.0f Hz display, simulated\n", pacingFrames * pacingDisplayPeriodMs / 1000, 1000 / pacingDisplayPeriodMs);
+	RunFramePacingBenchmark(results);
+}
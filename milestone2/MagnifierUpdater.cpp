@@ -0,0 +1,118 @@
+#include "MagnifierUpdater.h"
+#include <string.h>
+
+RECT MagnifierSourceRect(const MagnifierInputs &inputs)
+{
+	int width = (int)((inputs.magWindow.right - inputs.magWindow.left) / inputs.magFactor);
+	int height = (int)((inputs.magWindow.bottom - inputs.magWindow.top) / inputs.magFactor);
+	RECT sourceRect;
+	sourceRect.left = inputs.cursor.x - width / 2;
+	sourceRect.top = inputs.cursor.y - height / 2;
+
+	// Don't scroll outside desktop area.
+	if (sourceRect.left < 0)
+	{
+		sourceRect.left = 0;
+	}
+	if (sourceRect.left > inputs.screenWidth - width)
+	{
+		sourceRect.left = inputs.screenWidth - width;
+	}
+	sourceRect.right = sourceRect.left + width;
+
+	if (sourceRect.top < 0)
+	{
+		sourceRect.top = 0;
+	}
+	if (sourceRect.top > inputs.screenHeight - height)
+	{
+		sourceRect.top = inputs.screenHeight - height;
+	}
+	sourceRect.bottom = sourceRect.top + height;
+
+	return sourceRect;
+}
+
+RECT MagnifierLensRect(const RECT &sourceRect, const RECT &viewfinder)
+{
+	RECT lens;
+	lens.left = viewfinder.left + (sourceRect.left / 5);
+	lens.top = viewfinder.top + (sourceRect.top / 5);
+	lens.right = (LONG) ((sourceRect.right - sourceRect.left) / 5);
+	lens.bottom = (LONG) ((sourceRect.bottom - sourceRect.top) / 5);
+
+	if (lens.left + lens.right > viewfinder.left + viewfinder.right)
+	{
+		lens.left = viewfinder.left + viewfinder.right - lens.right;
+	}
+	if (lens.top + lens.bottom > viewfinder.top + viewfinder.bottom)
+	{
+		lens.top = viewfinder.top + viewfinder.bottom - lens.bottom;
+	}
+	return lens;
+}
+
+MagnifierUpdater::MagnifierUpdater()
+{
+	invalid = TRUE;
+	lastFactor = 0.0f;
+	ZeroMemory(&lastSource, sizeof(lastSource));
+	ZeroMemory(&lastLens, sizeof(lastLens));
+	lastTopmost = 0;
+	ticks = 0;
+	updated = 0;
+	skipped = 0;
+	transforms = 0;
+	sources = 0;
+	lenses = 0;
+	topmosts = 0;
+}
+
+void MagnifierUpdater::invalidate()
+{
+	InterlockedExchange(&invalid, TRUE);
+}
+
+BOOL MagnifierUpdater::plan(const MagnifierInputs &inputs, MagnifierUpdate &update)
+{
+	BOOL everything = (InterlockedExchange(&invalid, FALSE) != FALSE);
+	ticks++;
+
+	// Each only if what it's worked out from changed
+	update.transform = everything || inputs.magFactor != lastFactor;
+	update.sourceRect = MagnifierSourceRect(inputs);
+	update.source = everything || memcmp(&update.sourceRect, &lastSource, sizeof(RECT)) != 0;
+	update.lensRect = MagnifierLensRect(update.sourceRect, inputs.viewfinder);
+	update.lens = everything || memcmp(&update.lensRect, &lastLens, sizeof(RECT)) != 0;
+	// Unsigned, so it works across GetTickCount() wrapping
+	update.topmost = everything || inputs.now - lastTopmost >= topmostInterval;
+
+	if (update.transform)
+	{
+		lastFactor = inputs.magFactor;
+		transforms++;
+	}
+	if (update.source)
+	{
+		lastSource = update.sourceRect;
+		sources++;
+	}
+	if (update.lens)
+	{
+		lastLens = update.lensRect;
+		lenses++;
+	}
+	if (update.topmost)
+	{
+		lastTopmost = inputs.now;
+		topmosts++;
+	}
+
+	if (update.transform || update.source || update.lens || update.topmost)
+	{
+		updated++;
+		return TRUE;
+	}
+	skipped++;
+	return FALSE;
+}
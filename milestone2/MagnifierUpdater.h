@@ -0,0 +1,85 @@
+/************************************************************************
+*                                                                       *
+*   MagnifierUpdater.h -- Declaration of MagnifierUpdater class         *
+*                                                                       *
+*   Decides what the magnifier's timer actually has to push to the      *
+*   windows each tick.  The transform only changes with the zoom, the   *
+*   source rectangle with the cursor or zoom, and the lens with the     *
+*   source; none of them are set again if nothing they depend on has    *
+*   moved.  Reclaiming topmost is only done every so often.  Nothing    *
+*   here touches a window, so it's checked and timed without one, but   *
+*   it still uses the Windows types.                                    *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+// How often the windows are put back on top, in milliseconds, when
+// nothing else has called for it
+const DWORD topmostInterval = 250;
+
+// Everything the magnifier's windows are worked out from
+struct MagnifierInputs
+{
+	float magFactor;
+	POINT cursor;
+	// The magnifier control's client area, and the viewfinder the lens
+	// moves around in
+	RECT magWindow;
+	RECT viewfinder;
+	int screenWidth;
+	int screenHeight;
+	// GetTickCount(), or anything else in milliseconds
+	DWORD now;
+};
+
+// What to push this tick, and what with
+struct MagnifierUpdate
+{
+	BOOL transform;
+	BOOL source;
+	RECT sourceRect;
+	BOOL lens;
+	// Left, top, width and height, as SetWindowPos() takes them
+	RECT lensRect;
+	BOOL topmost;
+};
+
+// The part of the screen the magnifier shows: magWindow's size over the
+// factor, centered on the cursor, but kept on the screen
+RECT MagnifierSourceRect(const MagnifierInputs &inputs);
+// Where the lens goes in the viewfinder, a fifth the size of the source;
+// left, top, width and height
+RECT MagnifierLensRect(const RECT &sourceRect, const RECT &viewfinder);
+
+class MagnifierUpdater
+{
+public:
+	MagnifierUpdater();
+
+	// Push everything on the next tick (the windows were shown, resized,
+	// or reset).  Any thread.
+	void invalidate();
+
+	// Compares the inputs with what was last pushed, and says what needs
+	// pushing now.  Returns FALSE if nothing does.  Timer thread only.
+	BOOL plan(const MagnifierInputs &inputs, MagnifierUpdate &update);
+
+	// Ticks planned, and of those, how many pushed anything
+	LONG ticks;
+	LONG updated;
+	LONG skipped;
+	// What was pushed, each
+	LONG transforms;
+	LONG sources;
+	LONG lenses;
+	LONG topmosts;
+
+private:
+	volatile LONG invalid;
+	float lastFactor;
+	RECT lastSource;
+	RECT lastLens;
+	DWORD lastTopmost;
+};
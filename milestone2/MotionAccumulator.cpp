@@ -0,0 +1,37 @@
+#include "MotionAccumulator.h"
+#include <math.h>
+
+MotionAccumulator::MotionAccumulator()
+{
+	reset();
+}
+
+void MotionAccumulator::reset()
+{
+	carryX = 0;
+	carryY = 0;
+}
+
+void MotionAccumulator::move(double dx, double dy, POINT &curPos)
+{
+	carryX += dx;
+	carryY += dy;
+	// Truncating keeps the carry's sign the same as the motion's, so going
+	// back the other way undoes it exactly
+	LONG wholeX = (LONG) carryX;
+	LONG wholeY = (LONG) carryY;
+	carryX -= wholeX;
+	carryY -= wholeY;
+	curPos.x += wholeX;
+	curPos.y += wholeY;
+}
+
+FLOAT ApplyFriction(FLOAT amount, double factor)
+{
+	double scaled = amount * factor;
+	if (fabs(scaled) < motionRestThreshold)
+	{
+		return 0;
+	}
+	return (FLOAT) scaled;
+}
@@ -0,0 +1,35 @@
+/************************************************************************
+*                                                                       *
+*   MotionAccumulator.h -- Declaration of MotionAccumulator class       *
+*                                                                       *
+*   The cursor only moves in whole pixels, but the gestures ask for     *
+*   fractions of one.  This keeps the fractions until they add up to    *
+*   a pixel, instead of throwing them away every step.                  *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+// Movement amounts smaller than this (in pixels per step) have glided to
+// a stop, and are set to zero rather than halved forever
+const FLOAT motionRestThreshold = 0.01f;
+
+class MotionAccumulator
+{
+public:
+	MotionAccumulator();
+
+	// Adds dx, dy pixels, and moves curPos by however many whole pixels
+	// that makes, keeping the rest
+	void move(double dx, double dy, POINT &curPos);
+	// Forget any part-pixel left over
+	void reset();
+
+	// Movement not big enough to show yet, in pixels (always less than one)
+	double carryX;
+	double carryY;
+};
+
+// Friction for one step: scales amount by factor, stopping it once it's tiny
+FLOAT ApplyFriction(FLOAT amount, double factor);
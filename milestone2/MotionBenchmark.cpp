@@ -0,0 +1,383 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "MoveAndMagnifyHandler.h"
+#include "MotionIntegrator.h"
+#include "MotionAccumulator.h"
+#include "FrameClock.h"
+#include <math.h>
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern FLOAT moveAmount_x;
+extern FLOAT moveAmount_y;
+extern float magnifyAmount;
+extern float magnificationFloor;
+
+/*** Motion integration ***/
+
+// The movement handler's per-tick step, with something to move
+static void RunMotionBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	MotionIntegrator integrator;
+	POINT cursor = { 0, 0 };
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		moveAmount_x = (FLOAT) constantMovement;
+		moveAmount_y = (FLOAT) -constantMovement;
+		magnifyAmount = 0.05f;
+		timer.start();
+		integrator.step(motionOutputIntervalMs / 1000.0, cursor);
+		timer.stop();
+	}
+	timer.report(results, "MotionIntegrator step");
+	moveAmount_x = 0;
+	moveAmount_y = 0;
+	magnifyAmount = 0;
+}
+
+/*** Cursor latency ***/
+
+// Simulated time, in seconds
+const double motionSimulationLength = 6.0;
+const double motionSimulationStep = 0.001;
+const double skeletonFrameInterval = 1.0 / 30;
+// When the hand starts moving in the step trajectory
+const double motionOnset = 1.0;
+
+// Synthetic hand trajectories, as the cursor speed the gestures ask for
+// (pixels per second)
+static double StepVelocity(double t)
+{
+	return (t < motionOnset) ? 0 : 150;
+}
+
+static double SweepVelocity(double t)
+{
+	return 400 * sin(2 * 3.14159265358979 * 0.5 * t);
+}
+
+static long long SimulatedTicks(double t)
+{
+	return (long long) (t * frameClockTicksPerSecond + 0.5);
+}
+
+// Part-pixels for TimerModelStep
+static MotionAccumulator timerModelCarry;
+
+// One movement interval's worth of moving and magnifying, the way the
+// 10 Hz timer used to do it, to compare MotionIntegrator against
+static void TimerModelStep(POINT &curPos)
+{
+	magnificationFloor += magnifyAmount;
+	timerModelCarry.move(moveAmount_x, moveAmount_y, curPos);
+
+	magnifyAmount = ApplyFriction(magnifyAmount, 0.5);
+	if (MOVEMENT_STYLE == Velocity_Style)
+	{
+		moveAmount_x = ApplyFriction(moveAmount_x, 0.5);
+		moveAmount_y = ApplyFriction(moveAmount_y, 0.5);
+	}
+}
+
+// Runs a trajectory through either the old 10 Hz timer (TimerModelStep) or
+// MotionIntegrator at intervalMs, with timer ticks arriving up to half an
+// interval late.  Compares the cursor against the exact integral of what
+// the gesture detectors asked for, every millisecond.
+static void SimulateMotion(FILE* results, const char* name, double (*velocity)(double),
+						   double intervalMs, BOOL useIntegrator)
+{
+	MotionIntegrator integrator;
+	POINT cursor = { 0, 0 };
+	double ideal = 0;
+	double interval = intervalMs / 1000.0;
+	double nextFrame = 0;
+	double nextTick = interval;
+	double sumSquares = 0;
+	double maxError = 0;
+	double firstMove = -1;
+	int numSamples = 0;
+	DWORD jitter = 12345;
+
+	moveAmount_x = 0;
+	moveAmount_y = 0;
+	magnifyAmount = 0;
+	timerModelCarry.reset();
+
+	for (double t = 0; t < motionSimulationLength; t += motionSimulationStep)
+	{
+		// A skeleton frame: the detectors set a new amount
+		if (t >= nextFrame)
+		{
+			moveAmount_x = (FLOAT) (velocity(nextFrame) * movementTimeoutInMs / 1000.0);
+			integrator.frameArrived(SimulatedTicks(nextFrame));
+			nextFrame += skeletonFrameInterval;
+		}
+
+		// A timer tick: the cursor moves
+		if (t >= nextTick)
+		{
+			if (useIntegrator)
+			{
+				integrator.advance(SimulatedTicks(t), cursor);
+			}
+			else
+			{
+				TimerModelStep(cursor);
+			}
+			jitter = jitter * 1103515245 + 12345;
+			nextTick = t + interval * (1.0 + ((jitter >> 16) % 500) / 1000.0);
+		}
+
+		ideal += moveAmount_x * (1000.0 / movementTimeoutInMs) * motionSimulationStep;
+		if (firstMove < 0 && cursor.x != 0)
+		{
+			firstMove = t;
+		}
+
+		double error = fabs(cursor.x - ideal);
+		sumSquares += error * error;
+		if (error > maxError)
+		{
+			maxError = error;
+		}
+		numSamples++;
+	}
+
+	fprintf(results, "%-24s rms error %7.1f px  max %7.1f px", name, sqrt(sumSquares / numSamples), maxError);
+	if (velocity == StepVelocity)
+	{
+		fprintf(results, "  first move after %6.1f ms", (firstMove - motionOnset) * 1000.0);
+	}
+	fprintf(results, "\n");
+
+	moveAmount_x = 0;
+}
+
+// Frames stop coming for a second partway through, at a constant speed.
+// The cursor should stop shortly after the last frame, and pick up again
+// from the next one rather than jumping by the gap.
+static void CheckMotionStall(FILE* results)
+{
+	MotionIntegrator integrator;
+	POINT cursor = { 0, 0 };
+	const double speed = 150;
+	// In skeleton frames
+	const int stallStart = 30;
+	const int stallEnd = 60;
+	const int length = 90;
+	double interval = motionOutputIntervalMs / 1000.0;
+	double stallEndTime = stallEnd * skeletonFrameInterval;
+	double endTime = length * skeletonFrameInterval;
+	int frame = 0;
+	LONG atStallEnd = 0;
+	double lastTick = 0;
+
+	moveAmount_x = (FLOAT) (speed * movementTimeoutInMs / 1000.0);
+	moveAmount_y = 0;
+	magnifyAmount = 0;
+	for (int tick = 0; tick * interval < endTime; tick++)
+	{
+		double t = tick * interval;
+		while (frame * skeletonFrameInterval <= t)
+		{
+			if (frame < stallStart || frame >= stallEnd)
+			{
+				integrator.frameArrived(SimulatedTicks(frame * skeletonFrameInterval));
+			}
+			frame++;
+		}
+		integrator.advance(SimulatedTicks(t), cursor);
+		if (t < stallEndTime)
+		{
+			atStallEnd = cursor.x;
+		}
+		lastTick = t;
+	}
+	moveAmount_x = 0;
+
+	// Everything up to the hold after the last frame before the stall...
+	double held = (stallStart - 1) * skeletonFrameInterval + (double) motionFrameHold / frameClockTicksPerSecond;
+	double expectedAtStall = speed * held;
+	// ...and everything after the first frame after it
+	double expectedAfter = speed * (lastTick - stallEndTime);
+	double after = cursor.x - atStallEnd;
+	BOOL passed = fabs(atStallEnd - expectedAtStall) <= speed * interval + 1
+		&& fabs(after - expectedAfter) <= speed * interval + 1;
+	fprintf(results, "%-24s %s (%ld px by the stall, %.0f expected; %.0f px after, %.0f expected)\n", "stops with the frames",
+		CheckResult(passed), atStallEnd, expectedAtStall, after, expectedAfter);
+}
+
+static void RunMotionLatencyBenchmark(FILE* results)
+{
+	static const int rates[] = { 60, 120 };
+	char name[64];
+
+	SimulateMotion(results, "step, 10 Hz timer", StepVelocity, movementTimeoutInMs, FALSE);
+	for (int r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+	{
+		sprintf_s(name, sizeof(name), "step, %d Hz integrator", rates[r]);
+		SimulateMotion(results, name, StepVelocity, 1000.0 / rates[r], TRUE);
+	}
+
+	SimulateMotion(results, "sweep, 10 Hz timer", SweepVelocity, movementTimeoutInMs, FALSE);
+	for (int r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+	{
+		sprintf_s(name, sizeof(name), "sweep, %d Hz integrator", rates[r]);
+		SimulateMotion(results, name, SweepVelocity, 1000.0 / rates[r], TRUE);
+	}
+
+	CheckMotionStall(results);
+}
+
+/*** Sub-pixel motion ***/
+
+// Known answers for MotionAccumulator and ApplyFriction.  Returns the
+// number of checks that failed.
+static int CheckMotionAccumulator(FILE* results)
+{
+	int failures = 0;
+	MotionAccumulator carry;
+	POINT cursor;
+
+	// A third of a pixel a step adds up to a pixel every three steps
+	cursor.x = 0;
+	cursor.y = 0;
+	for (int i = 0; i < 30; i++)
+	{
+		carry.move(1.0 / 3, -1.0 / 3, cursor);
+	}
+	if (cursor.x < 9 || cursor.x > 10 || cursor.y > -9 || cursor.y < -10)
+	{
+		fprintf(results, "FAILED: 30 thirds of a pixel went to %ld, %ld\n", cursor.x, cursor.y);
+		failures++;
+	}
+
+	// Going back undoes it exactly
+	for (int i = 0; i < 30; i++)
+	{
+		carry.move(-1.0 / 3, 1.0 / 3, cursor);
+	}
+	if (cursor.x != 0 || cursor.y != 0)
+	{
+		fprintf(results, "FAILED: there and back ended at %ld, %ld\n", cursor.x, cursor.y);
+		failures++;
+	}
+
+	// Halving a glide from 3 px covers 6 px (less the part-pixel left at rest)
+	carry.reset();
+	cursor.x = 0;
+	FLOAT amount = 3;
+	int steps = 0;
+	while (amount != 0)
+	{
+		carry.move(amount, 0, cursor);
+		amount = ApplyFriction(amount, 0.5);
+		steps++;
+	}
+	if (cursor.x != 5 && cursor.x != 6)
+	{
+		fprintf(results, "FAILED: a 3 px glide went %ld px\n", cursor.x);
+		failures++;
+	}
+	// ... and comes to rest rather than halving forever
+	if (steps > 16)
+	{
+		fprintf(results, "FAILED: a 3 px glide took %d steps to stop\n", steps);
+		failures++;
+	}
+
+	checksFailed += (failures == 0) ? 0 : 1;
+	fprintf(results, "MotionAccumulator checks %s\n", (failures == 0) ? "passed" : "FAILED");
+	return failures;
+}
+
+// How fast the hand moves, as how far it moves each skeleton frame
+struct HandSpeed
+{
+	const char* name;
+	FLOAT displacement;
+};
+
+static const HandSpeed handSpeeds[] = {
+	{ "slow", 0.0005f },
+	{ "medium", 0.002f },
+	{ "fast", 0.01f },
+};
+
+// Velocity-style moving, the way the detectors do it: each skeleton frame
+// adds 500 * the hand's displacement, and each 100 ms step moves by the
+// amount and halves it.  The ideal path keeps every fraction; the old
+// timer truncated each step to whole pixels.
+static void SimulateGlide(FILE* results, const HandSpeed &speed, BOOL carryFractions)
+{
+	const int framesPerStep = 3;
+	const int movingSteps = 30;
+	const int glidingSteps = 20;
+	MotionAccumulator carry;
+	POINT cursor = { 0, 0 };
+	double amountX = 0;
+	double amountY = 0;
+	double idealX = 0;
+	double idealY = 0;
+	double sumSquares = 0;
+	double error = 0;
+
+	for (int step = 0; step < movingSteps + glidingSteps; step++)
+	{
+		if (step < movingSteps)
+		{
+			// Up and to the right, the right twice as fast
+			amountX += framesPerStep * 500 * speed.displacement;
+			amountY -= framesPerStep * 500 * speed.displacement / 2;
+		}
+
+		idealX += amountX;
+		idealY += amountY;
+		if (carryFractions)
+		{
+			carry.move(amountX, amountY, cursor);
+			amountX = ApplyFriction((FLOAT) amountX, 0.5);
+			amountY = ApplyFriction((FLOAT) amountY, 0.5);
+		}
+		else
+		{
+			cursor.x += (int) amountX;
+			cursor.y += (int) amountY;
+			amountX /= 2;
+			amountY /= 2;
+		}
+
+		double dx = cursor.x - idealX;
+		double dy = cursor.y - idealY;
+		error = sqrt(dx * dx + dy * dy);
+		sumSquares += error * error;
+	}
+
+	char name[64];
+	sprintf_s(name, sizeof(name), "%s, %s", speed.name, carryFractions ? "carried" : "truncated");
+	fprintf(results, "%-24s ideal %7.1f px  rms error %7.2f px  final error %7.2f px\n", name,
+		sqrt(idealX * idealX + idealY * idealY), sqrt(sumSquares / (movingSteps + glidingSteps)), error);
+}
+
+static void RunMotionFidelityBenchmark(FILE* results)
+{
+	CheckMotionAccumulator(results);
+	for (int i = 0; i < sizeof(handSpeeds) / sizeof(handSpeeds[0]); i++)
+	{
+		SimulateGlide(results, handSpeeds[i], FALSE);
+		SimulateGlide(results, handSpeeds[i], TRUE);
+	}
+}
+
+// The cursor's per-tick step, then how closely it follows the hand
+void BenchmarkMotion(FILE* results, BenchmarkTimer &timer)
+{
+	fprintf(results, "\nCursor motion against the ideal path, %.0f s simulated\n", motionSimulationLength);
+	RunMotionBenchmark(results, timer);
+	RunMotionLatencyBenchmark(results);
+
+	fprintf(results, "\nPointer path fidelity, 100 ms steps\n");
+	RunMotionFidelityBenchmark(results);
+}
@@ -0,0 +1,114 @@
+#include "MotionIntegrator.h"
+#include "GestureDetector.h"
+#include <math.h>
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern FLOAT moveAmount_x;
+extern FLOAT moveAmount_y;
+extern float magnifyAmount;
+extern float magnificationFloor;
+
+MotionIntegrator::MotionIntegrator()
+{
+	InitializeCriticalSection(&lock);
+	reset();
+}
+
+MotionIntegrator::~MotionIntegrator(void)
+{
+	DeleteCriticalSection(&lock);
+}
+
+void MotionIntegrator::reset()
+{
+	EnterCriticalSection(&lock);
+	latestFrame = 0;
+	lastStep = 0;
+	held = TRUE;
+	LeaveCriticalSection(&lock);
+	carry.reset();
+}
+
+void MotionIntegrator::frameArrived(long long frameTime)
+{
+	EnterCriticalSection(&lock);
+	// After a gap in the frames, carry on from this one rather than moving
+	// the new amounts by however long the gap was
+	if (held && frameTime > lastStep)
+	{
+		lastStep = frameTime;
+	}
+	held = FALSE;
+	if (frameTime > latestFrame)
+	{
+		latestFrame = frameTime;
+	}
+	LeaveCriticalSection(&lock);
+}
+
+void MotionIntegrator::advance(long long now, POINT &curPos)
+{
+	EnterCriticalSection(&lock);
+	long long until = latestFrame + motionFrameHold;
+	if (now < until)
+	{
+		until = now;
+	}
+	else
+	{
+		held = TRUE;
+	}
+	long long elapsed = until - lastStep;
+	if (elapsed > 0)
+	{
+		lastStep = until;
+	}
+	LeaveCriticalSection(&lock);
+
+	if (elapsed > 0)
+	{
+		step((double) elapsed / (double) frameClockTicksPerSecond, curPos);
+	}
+}
+
+void MotionIntegrator::step(double elapsedSeconds, POINT &curPos)
+{
+	if (elapsedSeconds <= 0)
+	{
+		return;
+	}
+	if (elapsedSeconds > maxMotionStep)
+	{
+		elapsedSeconds = maxMotionStep;
+	}
+
+	// Amounts are per movement interval; make them per second
+	const double perSecond = 1000.0 / movementTimeoutInMs;
+
+	// With friction, the amount decays as exp(-t/tau) over the step, so
+	// what it covers is amount * tau * (1 - exp(-t/tau))
+	double decay = exp(-elapsedSeconds / frictionTimeConstant);
+	double glide = frictionTimeConstant * (1 - decay);
+
+	magnificationFloor += (float) (magnifyAmount * perSecond * glide);
+	magnifyAmount = ApplyFriction(magnifyAmount, decay);
+
+	double dx, dy;
+	if (MOVEMENT_STYLE == Velocity_Style)
+	{
+		dx = moveAmount_x * perSecond * glide;
+		dy = moveAmount_y * perSecond * glide;
+		moveAmount_x = ApplyFriction(moveAmount_x, decay);
+		moveAmount_y = ApplyFriction(moveAmount_y, decay);
+	}
+	else
+	{
+		dx = moveAmount_x * perSecond * elapsedSeconds;
+		dy = moveAmount_y * perSecond * elapsedSeconds;
+	}
+
+	// Only whole pixels reach the cursor; keep the rest for next time
+	carry.move(dx, dy, curPos);
+}
@@ -0,0 +1,63 @@
+/************************************************************************
+*                                                                       *
+*   MotionIntegrator.h -- Declaration of MotionIntegrator class         *
+*                                                                       *
+*   Turns moveAmount_x/y and magnifyAmount into cursor movement and     *
+*   magnification over however much time has actually passed, so the   *
+*   cursor moves at the same speed however often (or unevenly) it's     *
+*   stepped.  Time only runs as far as the skeleton frames say it has:  *
+*   the amounts from a frame are moved by until shortly after it, and   *
+*   if the frames stop coming, so does the cursor.                      *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "MoveAndMagnifyHandler.h"
+#include "MotionAccumulator.h"
+#include "FrameClock.h"
+
+// How often the cursor gets moved
+const int motionOutputRateHz = 120;
+const DWORD motionOutputIntervalMs = 1000 / motionOutputRateHz;
+
+// The gesture detectors still talk in amounts per movementTimeoutInMs.
+// Halving those every interval glides twice the first step in total;
+// decaying continuously with a time constant of two intervals glides the same.
+const double frictionTimeConstant = 2.0 * movementTimeoutInMs / 1000.0;
+
+// Longer gaps than this (a breakpoint, a suspend) count as this long
+const double maxMotionStep = 0.25;
+
+// How long past the latest skeleton frame the cursor keeps moving by its
+// amounts; two frames at 30 Hz, so a late frame doesn't make it stutter
+const long long motionFrameHold = 2 * frameClockTicksPerSecond / 30;
+
+class MotionIntegrator
+{
+public:
+	MotionIntegrator();
+	~MotionIntegrator(void);
+
+	// A skeleton frame was processed; frameTime is frameClock.frameTime()
+	void frameArrived(long long frameTime);
+	// Steps from wherever the last advance() got to up to now, or up to
+	// motionFrameHold past the latest frame, whichever is sooner
+	void advance(long long now, POINT &curPos);
+
+	// Moves curPos and magnificationFloor by elapsedSeconds' worth of the
+	// current amounts, and applies friction to the amounts
+	void step(double elapsedSeconds, POINT &curPos);
+	// Forget any part-pixel left over, and wait for a frame before moving
+	void reset();
+
+	MotionAccumulator carry;
+
+private:
+	// Frames arrive on the skeleton thread, advance() runs on the timer's
+	CRITICAL_SECTION lock;
+	long long latestFrame;
+	long long lastStep;
+	// The last advance() ran out of frame, so start again from the next one
+	BOOL held;
+};
@@ -1,5 +1,8 @@
 #include "MoveAndMagnifyHandler.h"
 #include "SkeletalViewer.h"
+#include "DepthPalette.h"
+#include "MotionIntegrator.h"
+#include "FrameClock.h"
 
 // Disable "conditional expression is constant" warning
 #pragma warning( disable : 4127 )
@@ -9,6 +12,7 @@
 
 extern float magnificationFloor;
 extern CSkeletalViewerApp* skeletalViewer;
+extern DepthPalette depthPalette;
 
 // Global variables, so GestureDetector can access them
 FLOAT moveAmount_x;
@@ -17,6 +21,10 @@ float magnifyAmount;
 
 BOOL quit_properly = FALSE;
 
+// Stepped from the timer thread, as far as the skeleton thread's frames go
+static MotionIntegrator motion;
+static long long lastViewerUpdate = 0;
+
 // Mutex
 extern BOOL GUI_On;
 
@@ -26,6 +34,7 @@ MoveAndMagnifyHandler::MoveAndMagnifyHandler()
 	magnifyAmount = 0.0;
 	moveAmount_x = 0;
 	moveAmount_y = 0;
+	motion.reset();
 	// We could use the default queue, but this is more compartmentalized
 	hMovementTimerQueue = CreateTimerQueue();
 
@@ -34,8 +43,8 @@ MoveAndMagnifyHandler::MoveAndMagnifyHandler()
 		hMovementTimerQueue,
 		MoveAndMagnifyHandler::TimerHandler,
 		NULL,
-		movementTimeoutInMs,
-		movementTimeoutInMs,
+		motionOutputIntervalMs,
+		motionOutputIntervalMs,
 		// Execute in the timer thread, since we never want two of these to happen at the same time, 
 		// and it's better for the timing to be off than for that to happen
 		WT_EXECUTEINTIMERTHREAD);
@@ -57,6 +66,40 @@ MoveAndMagnifyHandler::~MoveAndMagnifyHandler(void)
 
 // Short function to handle moving and magnifying every timer interval
 void CALLBACK MoveAndMagnifyHandler::TimerHandler(void* /*lpParameter*/, BOOLEAN /*TimerOrWaitFired*/)
+{
+	// The readouts don't need to keep up with the cursor
+	long long now = frameClock.now();
+	if (now - lastViewerUpdate >= movementTimeoutInMs * frameClockTicksPerMs)
+	{
+		lastViewerUpdate = now;
+		UpdateViewer();
+	}
+
+	if (GetAsyncKeyState(VK_F4))
+	{
+		quit_properly = TRUE;
+	}
+
+	// Move by however long it's really been, not by how long it should have
+	// been, but not past what the skeleton frames have covered
+	POINT curPos;
+	GetCursorPos(&curPos);
+	POINT newPos = curPos;
+	motion.advance(now, newPos);
+	// Leave the cursor alone when there's nothing to do, so the mouse still works
+	if (newPos.x != curPos.x || newPos.y != curPos.y)
+	{
+		SetCursorPos(newPos.x, newPos.y);
+	}
+}
+
+void MoveAndMagnifyHandler::NewFrame(long long frameTime)
+{
+	motion.frameArrived(frameTime);
+}
+
+// Keys and readouts for the skeletal viewer
+void MoveAndMagnifyHandler::UpdateViewer()
 {
 	// Debug processing only necessary if the skeletal viewer exists
 	if (GUI_On && skeletalViewer->increment_num_GUIers())
@@ -84,6 +127,21 @@ void CALLBACK MoveAndMagnifyHandler::TimerHandler(void* /*lpParameter*/, BOOLEAN
 			hideSVButtonReleased = TRUE;
 		}
 
+		// Cycle through the depth view's colormaps
+		static BOOL colormapButtonReleased = TRUE;
+		if (GetAsyncKeyState(VK_INSERT))
+		{
+			if (colormapButtonReleased)
+			{
+				colormapButtonReleased = FALSE;
+				depthPalette.nextColormap();
+			}
+		}
+		else
+		{
+			colormapButtonReleased = TRUE;
+		}
+
 		// Print the amounts
 		::PostMessageW(skeletalViewer->m_hWnd, WM_USER_UPDATE_MOVEX, IDC_MOVEX, (int) moveAmount_x);
 		::PostMessageW(skeletalViewer->m_hWnd, WM_USER_UPDATE_MOVEY, IDC_MOVEY, (int) moveAmount_y);
@@ -93,26 +151,4 @@ void CALLBACK MoveAndMagnifyHandler::TimerHandler(void* /*lpParameter*/, BOOLEAN
 		::PostMessageW(skeletalViewer->m_hWnd, WM_USER_UPDATE_MAGNIFICATION, IDC_MAGNIFY, magnifyAmountInt);
 		skeletalViewer->decrement_num_GUIers();
 	}
-
-	if (GetAsyncKeyState(VK_F4))
-	{
-		quit_properly = TRUE;
-	}
-
-	// Adjust magnification
-	magnificationFloor += magnifyAmount;
-	// Adjust position
-	POINT curPos;
-	GetCursorPos(&curPos);
-	curPos.x += (int) moveAmount_x;
-	curPos.y += (int) moveAmount_y;
-	SetCursorPos(curPos.x, curPos.y);
-
-	// Exponentially decrease amounts (friction)
-	magnifyAmount /= 2;
-	if (MOVEMENT_STYLE == Velocity_Style)
-	{
-		moveAmount_x /= 2;
-		moveAmount_y /= 2;
-	}
 }
@@ -1,7 +1,8 @@
 #pragma once
 #include <windows.h>
 
-// Time in milliseconds between instances of movement happening
+// The interval moveAmount_x/y and magnifyAmount are amounts per, in
+// milliseconds.  Also how often the skeletal viewer's readouts update.
 const DWORD movementTimeoutInMs = 100;
 
 class MoveAndMagnifyHandler
@@ -11,7 +12,12 @@ public:
 	~MoveAndMagnifyHandler(void);
 
 	static void CALLBACK TimerHandler(void* lpParameter, BOOLEAN TimerOrWaitFired);
+	// A skeleton frame came in; the cursor moves as far as the frames go
+	static void NewFrame(long long frameTime);
 	HANDLE hMovementTimerQueue;
 	HANDLE hTimerHandle;
+
+private:
+	static void UpdateViewer();
 };
 
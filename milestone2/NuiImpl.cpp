@@ -14,6 +14,13 @@
 #include <assert.h>
 #include <strsafe.h>
 #include "NuiImpl.h"
+#include "SkeletonRecorder.h"
+#include "DepthPalette.h"
+#include "FrameClock.h"
+#include "OverlayScene.h"
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
 
 // Globals
 extern int distanceInMM;
@@ -25,14 +32,15 @@ extern FLOAT moveAmount_y;
 // The important one for splitting the functionality
 extern CSkeletalViewerApp* skeletalViewer;
 extern BOOL showSkeletalViewer;
+extern SkeletonRecorder* skeletonRecorder;
+extern DepthPalette depthPalette;
+extern char templatePath[MAX_PATH];
 
 // Variables used to deal with the problem that threads might be in a
 // GUI section when the GUI exits, and so we need to preserve the GUI
 // until all the events trying to use it have finished
 // (readers-writers problem, with a writer preference)
 extern BOOL GUI_On;
-extern int num_GUIers;
-extern HANDLE num_GUIers_mutex;
 
 
 //-------------------------------------------------------------------
@@ -43,6 +51,17 @@ NuiImpl::NuiImpl()
 	m_pNuiSensor = NULL;
 	// Even though this is a BSTR, you can treat it like a char*
 	m_instanceId = NULL;
+	m_pDepthWorkers = new WorkerPool( WorkerPool::defaultWorkers() );
+	m_pJointSmoother = new JointSmoother( );
+	m_pHandPredictor = new HandPredictor( );
+	m_pDtwRecognizer = new DtwRecognizer( );
+	m_pJointHistory = new JointHistory( );
+	m_pGestureBatch = new GestureBatch( gestureTable );
+	m_pDtwRecognizer->addDefaultTemplates( );
+	if ( templatePath[0] != '\0' )
+	{
+		m_pDtwRecognizer->addRecordedTemplate( "recorded", templatePath );
+	}
 	Nui_Zero();
 	NuiSetDeviceStatusCallback( &NuiImpl::Nui_StatusProcThunk, this );
 	Nui_Init();
@@ -56,6 +75,13 @@ NuiImpl::~NuiImpl()
 	Nui_UnInit();
 	Nui_Zero();
 	SysFreeString(m_instanceId);
+	// The processing thread is gone by now, so nobody's using them
+	delete m_pDepthWorkers;
+	delete m_pJointSmoother;
+	delete m_pHandPredictor;
+	delete m_pDtwRecognizer;
+	delete m_pJointHistory;
+	delete m_pGestureBatch;
 }
 
 //-------------------------------------------------------------------
@@ -135,10 +161,11 @@ void CALLBACK NuiImpl::Nui_StatusProc( HRESULT hrStatus, const OLECHAR* instance
 		{
 			Nui_UnInit();
 			Nui_Zero();
+			// The viewer is only ever torn down on its own thread, where
+			// nothing's drawing and nobody's inside the guard
 			if (GUI_On && skeletalViewer->increment_num_GUIers())
 			{
-				skeletalViewer->SV_UnInit();				
-				skeletalViewer->SV_Zero();
+				PostMessageW( skeletalViewer->m_hWnd, WM_USER_SENSOR_REMOVED, 0, 0 );
 				skeletalViewer->decrement_num_GUIers();
 			}
 		}
@@ -253,7 +280,7 @@ HRESULT NuiImpl::Nui_Init( )
 
 	hr = m_pNuiSensor->NuiImageStreamOpen(
 		NUI_IMAGE_TYPE_COLOR,
-		NUI_IMAGE_RESOLUTION_640x480,
+		colorResolution,
 		0,
 		2,
 		m_hNextColorFrameEvent,
@@ -271,7 +298,7 @@ HRESULT NuiImpl::Nui_Init( )
 
 	hr = m_pNuiSensor->NuiImageStreamOpen(
 		HasSkeletalEngine(m_pNuiSensor) ? NUI_IMAGE_TYPE_DEPTH_AND_PLAYER_INDEX : NUI_IMAGE_TYPE_DEPTH,
-		NUI_IMAGE_RESOLUTION_320x240,
+		depthResolution,
 		0,
 		2,
 		m_hNextDepthFrameEvent,
@@ -356,11 +383,8 @@ void NuiImpl::Nui_UnInit( )
 		m_pNuiSensor = NULL;
 	}
 
-	if (GUI_On && skeletalViewer->increment_num_GUIers())
-	{
-		skeletalViewer->SV_UnInit();
-		skeletalViewer->decrement_num_GUIers();
-	}
+	// The viewer is its own thread's to tear down: switching cameras and
+	// WM_DESTROY call SV_UnInit() themselves
 }
 
 DWORD WINAPI NuiImpl::Nui_ProcessThread(LPVOID pParam)
@@ -469,7 +493,15 @@ void NuiImpl::Nui_GotColorAlert( )
 		pTexture->LockRect( 0, &LockedRect, NULL, 0 );
 		if ( LockedRect.Pitch != 0 )
 		{
-			skeletalViewer->m_pDrawColor->Draw( static_cast<BYTE *>(LockedRect.pBits), LockedRect.size );
+			// The GUI thread draws it when it gets round to it
+			FrameTripleBuffer * frames = skeletalViewer->m_pColorFrames;
+			DWORD frameBytes = LockedRect.size;
+			if ( frameBytes > frames->frameBytes )
+			{
+				frameBytes = frames->frameBytes;
+			}
+			memcpy( frames->writeBuffer(), LockedRect.pBits, frameBytes );
+			skeletalViewer->PublishFrame( frames );
 		}
 		else
 		{
@@ -513,23 +545,24 @@ void NuiImpl::Nui_GotDepthAlert( )
 
 			NuiImageResolutionToSize( imageFrame.eResolution, frameWidth, frameHeight );
 
-			// draw the bits to the bitmap
-			RGBQUAD * rgbrun = skeletalViewer->m_rgbWk;
-			USHORT * pBufferRun = (USHORT *)LockedRect.pBits;
-
-			// end pixel is start + width*height - 1
-			USHORT * pBufferEnd = pBufferRun + (frameWidth * frameHeight);
-
-			assert( frameWidth * frameHeight <= ARRAYSIZE(skeletalViewer->m_rgbWk) );
-
-			while ( pBufferRun < pBufferEnd )
+			// Colorize straight into the frame the GUI thread will draw next
+			FrameTripleBuffer * frames = skeletalViewer->m_pDepthFrames;
+			DWORD rowBytes = frameWidth * sizeof(RGBQUAD);
+			if ( frameHeight * rowBytes > frames->frameBytes )
 			{
-				*rgbrun = skeletalViewer->Nui_ShortToQuad_Depth( *pBufferRun );
-				++pBufferRun;
-				++rgbrun;
+				// Only as many rows as there's room for
+				frameHeight = frames->frameBytes / rowBytes;
 			}
 
-			skeletalViewer->m_pDrawDepth->Draw( (BYTE*) skeletalViewer->m_rgbWk, frameWidth * frameHeight * 4 );
+			DepthBandJob job;
+			job.palette = &depthPalette;
+			job.map = depthPalette.colormap;
+			job.depth = (USHORT *)LockedRect.pBits;
+			job.out = (RGBQUAD *) frames->writeBuffer();
+			job.width = frameWidth;
+			m_pDepthWorkers->run( ColorizeDepthBand, &job, frameHeight );
+
+			skeletalViewer->PublishFrame( frames );
 		}
 		else
 		{
@@ -557,6 +590,11 @@ void NuiImpl::Nui_GotSkeletonAlert( )
 
 	if ( SUCCEEDED(m_pNuiSensor->NuiSkeletonGetNextFrame( 0, &SkeletonFrame )) )
 	{
+		// Gesture timing goes by when the sensor saw this, not when we got it
+		frameClock.newFrame( SkeletonFrame.liTimeStamp );
+		// The cursor moves by this frame's amounts until shortly after it
+		MoveAndMagnifyHandler::NewFrame( frameClock.frameTime( ) );
+
 		for ( int i = 0 ; i < NUI_SKELETON_COUNT ; i++ )
 		{
 			// If we're no longer tracking the active skeleton, we don't have an active skeleton
@@ -590,16 +628,48 @@ void NuiImpl::Nui_GotSkeletonAlert( )
 	// no skeletons!
 	if( !bFoundSkeleton )
 	{
+		// Still record it, since losing the active skeleton matters on replay
+		if (skeletonRecorder != NULL)
+		{
+			skeletonRecorder->record(SkeletonFrame);
+		}
 		return;
 	}
 
 	// smooth out the skeleton data
-	HRESULT hr = m_pNuiSensor->NuiTransformSmooth(&SkeletonFrame,NULL);
-	if ( FAILED(hr) )
+	if (SMOOTHING_STYLE == Sdk_Smoothing)
 	{
-		return;
+		HRESULT hr = m_pNuiSensor->NuiTransformSmooth(&SkeletonFrame,NULL);
+		if ( FAILED(hr) )
+		{
+			return;
+		}
+	}
+	else
+	{
+		m_pJointSmoother->smooth( SkeletonFrame );
 	}
 
+	// Record what the gesture detectors are about to see, before prediction
+	// so that a replay can predict from the same frames
+	if (skeletonRecorder != NULL)
+	{
+		skeletonRecorder->record(SkeletonFrame);
+	}
+
+	// Dynamic gestures go by the shape of the movement, so they're matched
+	// before prediction moves the hands around.  The rule table acts on
+	// them (GUARD_DYNAMIC) in detect() below.
+	m_pDtwRecognizer->recognize( SkeletonFrame );
+	for ( int i = 0 ; i < NUI_SKELETON_COUNT; i++ )
+	{
+		DtwMatch match;
+		gestureDetectors[i]->takeDynamicGesture( *m_pDtwRecognizer, match );
+	}
+
+	// React to where the hands are going, not where they were a frame ago
+	m_pHandPredictor->predict( SkeletonFrame );
+
 	// we found a skeleton, re-start the skeletal timer
 	if (GUI_On && skeletalViewer->increment_num_GUIers())
 	{
@@ -609,7 +679,8 @@ void NuiImpl::Nui_GotSkeletonAlert( )
 	m_LastSkeletonFoundTime = timeGetTime( );
 
 	// Save the velocities via comparison with the previous skeleton frame
-	static NUI_SKELETON_FRAME prevFrame = SkeletonFrame;
+	m_pJointHistory->add( SkeletonFrame, frameClock.frameTime( ) );
+	m_pGestureBatch->evaluate( SkeletonFrame, gestureDetectors );
 
 	// draw each skeleton color according to the slot within they are found.
 	if (GUI_On && skeletalViewer->increment_num_GUIers())
@@ -633,7 +704,7 @@ void NuiImpl::Nui_GotSkeletonAlert( )
 		{
 			if (GUI_On && skeletalViewer->increment_num_GUIers())
 			{
-				skeletalViewer->Nui_DrawSkeleton( &SkeletonFrame.SkeletonData[i], GetDlgItem( skeletalViewer->m_hWnd, IDC_SKELETALVIEW ), i );
+				skeletalViewer->Nui_DrawSkeleton( SkeletonView( SkeletonFrame, i ), GetDlgItem( skeletalViewer->m_hWnd, IDC_SKELETALVIEW ), i );
 				skeletalViewer->decrement_num_GUIers();
 			}
 			if (i == activeSkeleton)
@@ -658,30 +729,31 @@ void NuiImpl::Nui_GotSkeletonAlert( )
 			// Remember, gesture detectors are now per-skeleton, but we still only want to detect gestures for tracked skeletons
 
 			// TODO: Don't try to detect gestures for messed-up skeletons
-			gestureDetectors[i]->detect(SkeletonFrame, prevFrame);
+			gestureDetectors[i]->detect(SkeletonFrame, *m_pJointHistory, m_pGestureBatch);
 		}
-		else if ( GUI_On && m_bAppTracking && SkeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_POSITION_ONLY )
+		else if ( GUI_On && m_bAppTracking && SkeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_POSITION_ONLY
+				  && skeletalViewer->increment_num_GUIers() )
 		{
-			skeletalViewer->increment_num_GUIers();
-			skeletalViewer->Nui_DrawSkeletonId( &SkeletonFrame.SkeletonData[i], GetDlgItem( skeletalViewer->m_hWnd, IDC_SKELETALVIEW ), i );
+			skeletalViewer->Nui_DrawSkeletonId( SkeletonView( SkeletonFrame, i ), GetDlgItem( skeletalViewer->m_hWnd, IDC_SKELETALVIEW ), i );
 			skeletalViewer->decrement_num_GUIers();
 		}
 	}
 
-	if ( bSkeletonIdsChanged && GUI_On)
+	// The overlay shows what the detectors declared for this frame
+	overlayScene.commit( );
+
+	if ( bSkeletonIdsChanged && GUI_On && skeletalViewer->increment_num_GUIers() )
 	{
-		skeletalViewer->increment_num_GUIers();
 		skeletalViewer->UpdateTrackingComboBoxes();
 		skeletalViewer->decrement_num_GUIers();
 	}
 
 	if (GUI_On && skeletalViewer->increment_num_GUIers())
 	{
+		skeletalViewer->Nui_DrawSkeletons( SkeletonFrame, GetDlgItem( skeletalViewer->m_hWnd, IDC_SKELETALVIEW ) );
 		skeletalViewer->Nui_DoDoubleBuffer(GetDlgItem(skeletalViewer->m_hWnd,IDC_SKELETALVIEW), skeletalViewer->m_SkeletonDC);
 		skeletalViewer->decrement_num_GUIers();
 	}
-
-	prevFrame = SkeletonFrame;
 }
 
 void NuiImpl::Nui_SetApplicationTracking(bool applicationTracks)
@@ -1,6 +1,17 @@
 #pragma once
 
 #include "NuiApi.h"
+#include "WorkerPool.h"
+#include "JointSmoother.h"
+#include "HandPredictor.h"
+#include "DtwRecognizer.h"
+#include "JointHistory.h"
+#include "GestureBatch.h"
+
+// What the streams are opened at; the GUI sizes its views and frame
+// buffers from these too
+const NUI_IMAGE_RESOLUTION colorResolution = NUI_IMAGE_RESOLUTION_640x480;
+const NUI_IMAGE_RESOLUTION depthResolution = NUI_IMAGE_RESOLUTION_320x240;
 
 class NuiImpl
 {
@@ -48,6 +59,18 @@ private:
 	HANDLE        m_hNextSkeletonEvent;
 	HANDLE        m_pDepthStreamHandle;
 	HANDLE        m_pVideoStreamHandle;
+	// Splits up the per-pixel depth work, so the skeleton events aren't kept waiting
+	WorkerPool *  m_pDepthWorkers;
+	// Smooths the skeletons before the gesture detectors see them
+	JointSmoother * m_pJointSmoother;
+	// Then moves their hands to where they'll be by the time anyone reacts
+	HandPredictor * m_pHandPredictor;
+	// Watches for swipes, waves and circles
+	DtwRecognizer * m_pDtwRecognizer;
+	// The last few frames of every skeleton, for the gesture detectors
+	JointHistory * m_pJointHistory;
+	// What every detector is going to ask about its skeleton, all at once
+	GestureBatch * m_pGestureBatch;
 	/* HFONT         m_hFontFPS; */
 	/* HFONT		  m_smallFontFPS; */
 	/* HFONT         m_hFontSkeletonId; */
@@ -0,0 +1,720 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "OverlayScene.h"
+#include "OverlaySurface.h"
+#include "OverlayTextCache.h"
+#include "Magnifier.h"
+#include <math.h>
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+extern int xRes;
+extern int yRes;
+
+/*** Overlay compositing ***/
+
+// Where the overlay goes, a step at a time: hands up, a move lock-on, moving
+// with clicks, hidden, then a magnify lock-on and a turn of the dial
+struct OverlayStep
+{
+	GestureOverlay overlay;
+	Direction hand;
+	int frames;
+	// Flick the click on and off every few frames
+	BOOL clicking;
+	// Hide the overlay instead
+	BOOL hide;
+};
+
+static const OverlayStep overlaySteps[] = {
+	{ OVERLAY_SALUTE_WAITING, RIGHT, 30, FALSE, FALSE },
+	{ OVERLAY_SALUTED, RIGHT, 10, FALSE, FALSE },
+	{ OVERLAY_LOCKING_MOVE, RIGHT, 20, FALSE, FALSE },
+	{ OVERLAY_MOVE_MODE, RIGHT, 1, FALSE, FALSE },
+	{ OVERLAY_MOVE_CENTER, RIGHT, 30, TRUE, FALSE },
+	{ OVERLAY_MOVE_UP, RIGHT, 10, FALSE, FALSE },
+	{ OVERLAY_MOVE_CENTER, RIGHT, 10, FALSE, FALSE },
+	{ OVERLAY_MOVE_LEFT, RIGHT, 10, FALSE, FALSE },
+	{ OVERLAY_NONE, RIGHT, 20, FALSE, TRUE },
+	{ OVERLAY_SALUTE_WAITING, LEFT, 10, FALSE, FALSE },
+	{ OVERLAY_LOCKING_MAGNIFY, LEFT, 20, FALSE, FALSE },
+	{ OVERLAY_MAGNIFY_MODE, LEFT, 1, FALSE, FALSE },
+	{ OVERLAY_MAGNIFY_UP, LEFT, 10, FALSE, FALSE },
+	{ OVERLAY_MAGNIFY_RIGHT, LEFT, 10, FALSE, FALSE },
+	{ OVERLAY_MAGNIFY_DOWN, LEFT, 10, FALSE, FALSE },
+	{ OVERLAY_NONE, LEFT, 10, FALSE, TRUE },
+};
+
+static int OverlayScriptFrames()
+{
+	int frames = 0;
+	for (int i = 0; i < sizeof(overlaySteps) / sizeof(overlaySteps[0]); i++)
+	{
+		frames += overlaySteps[i].frames;
+	}
+	return frames;
+}
+
+// What the detectors would draw on one frame of the script, committed
+static void DeclareOverlayFrame(int frame)
+{
+	int i = 0;
+	while (frame >= overlaySteps[i].frames)
+	{
+		frame -= overlaySteps[i].frames;
+		i++;
+	}
+	const OverlayStep &step = overlaySteps[i];
+	if (step.hide)
+	{
+		// What clearAndHideOverlay() does
+		overlayScene.hide();
+	}
+	else
+	{
+		DrawGestureOverlay(step.overlay, step.hand, step.clicking && ((frame / 4) % 2 == 1));
+	}
+	overlayScene.commit();
+}
+
+// The overlay, looked at every few pixels: which primitive is on top there,
+// or 0 for the background
+const int overlaySampleStep = 4;
+
+static DWORD OverlayStamp(const OverlayPrimitive &primitive)
+{
+	// FNV-1a over the whole (zeroed) primitive, so any change shows
+	const BYTE* bytes = (const BYTE*) &primitive;
+	DWORD hash = 2166136261u;
+	for (int i = 0; i < sizeof(primitive); i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash | 1;
+}
+
+static void StampOverlay(DWORD* samples, int width, int height, RECT area, DWORD stamp)
+{
+	int columns = width / overlaySampleStep;
+	for (int y = 0; y < height; y += overlaySampleStep)
+	{
+		if (y < area.top || y >= area.bottom)
+		{
+			continue;
+		}
+		for (int x = 0; x < width; x += overlaySampleStep)
+		{
+			if (x >= area.left && x < area.right)
+			{
+				samples[(y / overlaySampleStep) * columns + (x / overlaySampleStep)] = stamp;
+			}
+		}
+	}
+}
+
+static RECT OverlayIntersection(const RECT &a, const RECT &b)
+{
+	RECT clipped;
+	clipped.left = (a.left > b.left) ? a.left : b.left;
+	clipped.top = (a.top > b.top) ? a.top : b.top;
+	clipped.right = (a.right < b.right) ? a.right : b.right;
+	clipped.bottom = (a.bottom < b.bottom) ? a.bottom : b.bottom;
+	return clipped;
+}
+
+// Composites the whole script, doing to a sampled window just what
+// CompositeOverlay() would, and checks it against repainting everything
+// that was declared from scratch
+static void CheckOverlayCompositing(FILE* results)
+{
+	const int width = xRes;
+	const int height = yRes;
+	const int numSamples = (width / overlaySampleStep) * (height / overlaySampleStep);
+	DWORD* window = new DWORD[numSamples];
+	DWORD* repainted = new DWORD[numSamples];
+	ZeroMemory(window, numSamples * sizeof(DWORD));
+	BOOL windowVisible = FALSE;
+
+	static OverlayDamage damage;
+	static OverlayPrimitive declared[maxOverlayPrimitives];
+	RECT screen = { 0, 0, width, height };
+	int frames = OverlayScriptFrames();
+	int mismatches = 0;
+	int steadyRedraws = 0;
+	for (int frame = 0; frame < 2 * frames; frame++)
+	{
+		DeclareOverlayFrame(frame % frames);
+		BOOL changed = overlayScene.compose(width, height, damage);
+		if (changed && damage.hide)
+		{
+			ZeroMemory(window, numSamples * sizeof(DWORD));
+			windowVisible = FALSE;
+		}
+		else if (changed)
+		{
+			windowVisible = TRUE;
+			for (int d = 0; d < damage.numDirty; d++)
+			{
+				StampOverlay(window, width, height, damage.dirty[d], 0);
+			}
+			for (int i = 0; i < damage.numRedraw; i++)
+			{
+				for (int d = 0; d < damage.numDirty; d++)
+				{
+					StampOverlay(window, width, height, OverlayIntersection(damage.redraw[i].bounds, damage.dirty[d]),
+						OverlayStamp(damage.redraw[i]));
+				}
+			}
+		}
+
+		// The same frame done the slow way
+		BOOL visible;
+		int numDeclared = overlayScene.published(declared, visible);
+		ZeroMemory(repainted, numSamples * sizeof(DWORD));
+		for (int i = 0; visible && i < numDeclared; i++)
+		{
+			StampOverlay(repainted, width, height, OverlayIntersection(declared[i].bounds, screen), OverlayStamp(declared[i]));
+		}
+		if (visible != windowVisible || memcmp(window, repainted, numSamples * sizeof(DWORD)) != 0)
+		{
+			mismatches++;
+		}
+		if (! changed)
+		{
+			steadyRedraws += damage.numRedraw;
+		}
+	}
+	delete [] window;
+	delete [] repainted;
+
+	fprintf(results, "%-24s %s (%d frames, %d redraws when nothing changed)\n", "composite = repaint",
+		CheckResult(mismatches == 0 && steadyRedraws == 0), 2 * frames, steadyRedraws);
+}
+
+// Declaring, committing and compositing every frame of the script on a
+// width x height screen, and how much of it actually reaches the window
+static void RunOverlayComposite(FILE* results, BenchmarkTimer &timer, int width, int height)
+{
+	xRes = width;
+	yRes = height;
+
+	// Start from a hidden, fully composited overlay
+	static OverlayDamage damage;
+	static OverlayPrimitive declared[maxOverlayPrimitives];
+	overlayScene.hide();
+	overlayScene.compose(width, height, damage);
+	LONG submitted = overlayScene.submitted;
+	LONG rasterized = overlayScene.rasterized;
+	LONG composed = overlayScene.composed;
+	LONG skipped = overlayScene.skipped;
+	double dirtyPixels = overlayScene.dirtyPixels;
+
+	int frames = OverlayScriptFrames();
+	int visibleFrames = 0;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		timer.start();
+		DeclareOverlayFrame(frame % frames);
+		overlayScene.compose(width, height, damage);
+		timer.stop();
+
+		BOOL visible;
+		overlayScene.published(declared, visible);
+		visibleFrames += visible ? 1 : 0;
+	}
+	char name[32];
+	sprintf_s(name, sizeof(name), "composite, %dx%d", width, height);
+	timer.report(results, name);
+
+	// Before, every primitive declared was drawn as soon as it was, and
+	// every clearOverlay() cleared the whole screen
+	fprintf(results, "%-24s %ld primitives declared, %ld drawn; %ld frames composited, %ld skipped\n", "",
+		overlayScene.submitted - submitted, overlayScene.rasterized - rasterized,
+		overlayScene.composed - composed, overlayScene.skipped - skipped);
+	fprintf(results, "%-24s %.1f%% of the screen cleared per frame shown\n", "",
+		100.0 * (overlayScene.dirtyPixels - dirtyPixels) / ((double) width * height * ((visibleFrames > 0) ? visibleFrames : 1)));
+
+	overlayScene.hide();
+	overlayScene.compose(width, height, damage);
+}
+
+static void RunOverlayBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	int savedXRes = xRes;
+	int savedYRes = yRes;
+
+	xRes = 1920;
+	yRes = 1080;
+	static OverlayDamage damage;
+	overlayScene.hide();
+	overlayScene.compose(xRes, yRes, damage);
+	CheckOverlayCompositing(results);
+
+	RunOverlayComposite(results, timer, 1920, 1080);
+	RunOverlayComposite(results, timer, 3840, 2160);
+
+	xRes = savedXRes;
+	yRes = savedYRes;
+}
+
+/*** Overlay rasterizing ***/
+
+// Every length and alignment of span, filled and blended both ways, over
+// the same made-up pixels
+static void CheckOverlaySpans(FILE* results)
+{
+	const int length = 80;
+	DWORD* scalar = (DWORD*) _aligned_malloc(length * sizeof(DWORD), 16);
+	DWORD* sse = (DWORD*) _aligned_malloc(length * sizeof(DWORD), 16);
+	DWORD noise = 31337;
+	int mismatches = 0;
+	int spans = 0;
+	for (int trial = 0; trial < 200; trial++)
+	{
+		DWORD color = Premultiply(((DWORD) RasterNoise(noise, 256) << 24) | ((DWORD) RasterNoise(noise, 65536) << 8) | RasterNoise(noise, 256));
+		for (int offset = 0; offset < 4; offset++)
+		{
+			for (int count = 0; offset + count <= length; count += 1 + count / 8)
+			{
+				for (int i = 0; i < length; i++)
+				{
+					scalar[i] = Premultiply(((DWORD) RasterNoise(noise, 65536) << 16) | RasterNoise(noise, 65536));
+					sse[i] = scalar[i];
+				}
+				if (trial % 2 == 0)
+				{
+					FillSpanScalar(scalar + offset, count, color);
+					FillSpanSSE2(sse + offset, count, color);
+				}
+				else
+				{
+					BlendSpanScalar(scalar + offset, count, color);
+					BlendSpanSSE2(sse + offset, count, color);
+				}
+				if (memcmp(scalar, sse, length * sizeof(DWORD)) != 0)
+				{
+					mismatches++;
+				}
+				spans++;
+			}
+		}
+	}
+
+	// Opaque over anything is just the color; clear over anything changes nothing
+	DWORD pixel = Premultiply(0x80402010);
+	BlendSpanSSE2(&pixel, 1, overlayGreen);
+	BOOL opaque = (pixel == overlayGreen);
+	BlendSpanScalar(&pixel, 1, 0);
+	opaque = opaque && (pixel == overlayGreen);
+
+	_aligned_free(scalar);
+	_aligned_free(sse);
+	fprintf(results, "%-24s %s (%d spans)\n", "SSE2 spans = scalar",
+		CheckResult(mismatches == 0 && opaque), spans);
+}
+
+// Whether a pixel's center is inside an even-odd polygon, worked out on
+// its own, the same way the rasterizer finds where a row's spans start
+static BOOL InsidePolygon(const OverlayVertex* vertices, int count, int x, int y)
+{
+	float center = y + 0.5f;
+	BOOL inside = FALSE;
+	for (int i = 0; i < count; i++)
+	{
+		const OverlayVertex &a = vertices[i];
+		const OverlayVertex &b = vertices[(i + 1) % count];
+		if ((a.y <= center) != (b.y <= center))
+		{
+			float crossing = a.x + (center - a.y) * (b.x - a.x) / (b.y - a.y);
+			if ((int) ceil(crossing - 0.5f) <= x)
+			{
+				inside = ! inside;
+			}
+		}
+	}
+	return inside;
+}
+
+static BOOL InsideRect(int left, int top, int right, int bottom, int x, int y)
+{
+	return (x >= left) && (x < right) && (y >= top) && (y < bottom);
+}
+
+// Random outlines and polygons, some partly off the surface and all drawn
+// through a random clip, against working each pixel out separately
+static void CheckOverlayShapes(FILE* results, BOOL useSSE)
+{
+	const int width = 203;
+	const int height = 157;
+	OverlaySurface surface;
+	surface.create(width, height);
+	surface.useSSE = useSSE;
+	DWORD noise = 4711;
+	int wrongPixels = 0;
+	const int shapes = 400;
+	for (int shape = 0; shape < shapes; shape++)
+	{
+		DWORD background = overlayWhite;
+		DWORD color = (shape % 3 == 0) ? 0x80FF0000 : overlayGreen;
+		surface.resetClip();
+		surface.clear(background);
+		RECT clip = { RasterNoise(noise, width / 2) - 10, RasterNoise(noise, height / 2) - 10,
+			width / 2 + RasterNoise(noise, width), height / 2 + RasterNoise(noise, height) };
+		surface.setClip(clip);
+
+		OverlayVertex vertices[4];
+		int numVertices = 3 + (shape % 2);
+		int x = RasterNoise(noise, width + 40) - 20;
+		int y = RasterNoise(noise, height + 40) - 20;
+		int w = RasterNoise(noise, width);
+		int h = RasterNoise(noise, height);
+		int pen = 1 + RasterNoise(noise, 12);
+		BOOL outline = (shape % 4 < 2);
+		if (outline)
+		{
+			surface.strokeRect(x, y, w, h, pen, color);
+		}
+		else
+		{
+			for (int v = 0; v < numVertices; v++)
+			{
+				vertices[v].x = (RasterNoise(noise, 4 * (width + 100)) - 200) / 4.0f;
+				vertices[v].y = (RasterNoise(noise, 4 * (height + 100)) - 200) / 4.0f;
+			}
+			surface.fillPolygon(vertices, numVertices, color);
+		}
+
+		DWORD over = Premultiply(background);
+		BlendSpanScalar(&over, 1, Premultiply(color));
+		int outside = pen / 2;
+		int inside = pen - outside;
+		for (int py = 0; py < height; py++)
+		{
+			for (int px = 0; px < width; px++)
+			{
+				BOOL covered;
+				if (outline)
+				{
+					covered = InsideRect(x - outside, y - outside, x + w + inside, y + h + inside, px, py)
+						&& ! InsideRect(x + inside, y + inside, x + w - outside, y + h - outside, px, py);
+				}
+				else
+				{
+					covered = InsidePolygon(vertices, numVertices, px, py);
+				}
+				covered = covered && InsideRect(clip.left, clip.top, clip.right, clip.bottom, px, py);
+				DWORD expected = covered ? over : Premultiply(background);
+				if (surface.pixels[py * surface.stride + px] != expected)
+				{
+					wrongPixels++;
+				}
+			}
+		}
+	}
+	fprintf(results, "%-24s %s (%d shapes, %d pixels wrong)\n", useSSE ? "shapes, SSE2" : "shapes, scalar",
+		CheckResult(wrongPixels == 0), shapes, wrongPixels);
+}
+
+// Everything the overlay script draws, one at a time: nothing may land
+// outside the bounds the scene dirties for it
+static void CheckOverlayBounds(FILE* results)
+{
+	OverlaySurface surface;
+	surface.create(xRes, yRes);
+	static OverlayPrimitive declared[maxOverlayPrimitives];
+	int frames = OverlayScriptFrames();
+	int primitives = 0;
+	int strays = 0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		DeclareOverlayFrame(frame);
+		BOOL visible;
+		int numDeclared = overlayScene.published(declared, visible);
+		for (int i = 0; i < numDeclared; i++)
+		{
+			surface.clear(0);
+			if (! surface.draw(declared[i]))
+			{
+				continue;
+			}
+			primitives++;
+			const RECT &bounds = declared[i].bounds;
+			for (int y = 0; y < surface.height; y++)
+			{
+				for (int x = 0; x < surface.width; x++)
+				{
+					if (surface.pixels[y * surface.stride + x] != 0 && ! InsideRect(bounds.left, bounds.top, bounds.right, bounds.bottom, x, y))
+					{
+						strays++;
+					}
+				}
+			}
+		}
+	}
+	overlayScene.hide();
+	fprintf(results, "%-24s %s (%d primitives, %d pixels outside)\n", "drawn within bounds",
+		CheckResult(strays == 0), primitives, strays);
+}
+
+// Clearing the whole overlay, and drawing the busiest scene the overlay
+// has (moving, with both trapezoids out to the screen's edges) over it
+static void RunOverlayRaster(FILE* results, BenchmarkTimer &timer, int width, int height, BOOL useSSE)
+{
+	xRes = width;
+	yRes = height;
+	OverlaySurface surface;
+	surface.create(width, height);
+	surface.useSSE = useSSE;
+	const int frames = benchmarkFrames / 100;
+	char name[48];
+
+	timer.reset();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		timer.start();
+		surface.clear(overlayWhite);
+		timer.stop();
+	}
+	sprintf_s(name, sizeof(name), "clear, %dx%d, %s", width, height, useSSE ? "SSE2" : "scalar");
+	timer.reportThroughput(results, name, width * height);
+
+	overlayScene.hide();
+	DrawGestureOverlay(OVERLAY_MOVE_UP, RIGHT, FALSE);
+	overlayScene.commit();
+	static OverlayPrimitive declared[maxOverlayPrimitives];
+	BOOL visible;
+	int numDeclared = overlayScene.published(declared, visible);
+	overlayScene.hide();
+
+	timer.reset();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		timer.start();
+		surface.clear(overlayWhite);
+		for (int i = 0; i < numDeclared; i++)
+		{
+			surface.draw(declared[i]);
+		}
+		timer.stop();
+	}
+	sprintf_s(name, sizeof(name), "move mode, %dx%d, %s", width, height, useSSE ? "SSE2" : "scalar");
+	timer.report(results, name);
+}
+
+static void RunOverlayRasterBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	int savedXRes = xRes;
+	int savedYRes = yRes;
+
+	CheckOverlaySpans(results);
+	CheckOverlayShapes(results, FALSE);
+	CheckOverlayShapes(results, TRUE);
+	xRes = 1920;
+	yRes = 1080;
+	CheckOverlayBounds(results);
+
+	RunOverlayRaster(results, timer, 1920, 1080, FALSE);
+	RunOverlayRaster(results, timer, 1920, 1080, TRUE);
+	RunOverlayRaster(results, timer, 3840, 2160, FALSE);
+	RunOverlayRaster(results, timer, 3840, 2160, TRUE);
+
+	xRes = savedXRes;
+	yRes = savedYRes;
+}
+
+/*** Overlay text ***/
+
+// Everything the detectors write on the overlay
+static const WCHAR* const overlayStrings[] = {
+	L"Locking on to Magnification Mode",
+	L"Magnification Gesture Mode",
+	L"Locking on to Movement Mode",
+	L"Movement Gesture Mode",
+	L"Clockwise = zoom in",
+	L"Counter-Clockwise = zoom out",
+};
+static const int numOverlayStrings = sizeof(overlayStrings) / sizeof(overlayStrings[0]);
+static const int overlayTextSize = 56;
+
+// Stands in for GDI+: solid strokes with soft edges, like a real glyph, in
+// a shape a little different for every character and size so misplaced
+// glyphs show.  Counts what it's asked to render through the context.
+static BOOL BenchmarkGlyph(void* context, WCHAR glyph, int size, GlyphMask &mask)
+{
+	if (context != NULL)
+	{
+		(*(LONG*) context)++;
+	}
+	mask.advance = size / 3 + (glyph % 7) * size / 20;
+	if (glyph == L' ')
+	{
+		return TRUE;
+	}
+	int top = size / 4 - (glyph % 3) * size / 8;
+	int bottom = size + (glyph % 4) * size / 8;
+	int left = mask.originX - (glyph % 2) * size / 10;
+	int right = mask.originX + mask.advance + (glyph % 5) * size / 10 - size / 10;
+	for (int y = top; y < bottom; y++)
+	{
+		for (int x = left; x < right; x++)
+		{
+			BOOL edge = (x == left || x == right - 1 || y == top || y == bottom - 1);
+			BOOL gap = ((x - left) / 6 + glyph) % 3 == 0 && y > top + size / 8 && y < bottom - size / 8;
+			mask.coverage[y * mask.width + x] = gap ? 0 : edge ? (BYTE) ((x * 7 + y * 13 + glyph * size) & 0xFF) : 255;
+		}
+	}
+	return TRUE;
+}
+
+// Text drawn straight from the renderer, a glyph at a time
+static void DrawTextUncached(OverlaySurface &surface, const OverlayPrimitive &text, BYTE* cell)
+{
+	int size = text.height;
+	surface.fillRect(OverlayTextBackground(text), overlayBlack);
+	int penX = text.x;
+	for (int i = 0; text.text[i] != 0; i++)
+	{
+		GlyphMask mask;
+		mask.width = 2 * size;
+		mask.height = 2 * size;
+		mask.originX = size / 2;
+		mask.coverage = cell;
+		ZeroMemory(cell, mask.width * mask.height);
+		BenchmarkGlyph(NULL, text.text[i], size, mask);
+		surface.blendMask(penX - mask.originX, text.y, cell, mask.width, mask.height, mask.width, overlayTextColor);
+		penX += mask.advance;
+	}
+}
+
+// Each glyph rendered once however often it's drawn, the cache drawing the
+// same pixels as the renderer would have, nothing outside the background,
+// and the background only as wide as the text
+static void CheckOverlayText(FILE* results)
+{
+	LONG renders = 0;
+	OverlayTextCache cache;
+	cache.setRenderer(BenchmarkGlyph, &renders);
+
+	int distinct = 0;
+	BOOL seen[numAtlasGlyphs];
+	ZeroMemory(seen, sizeof(seen));
+	OverlaySurface cached;
+	OverlaySurface uncached;
+	cached.create(1920, 1080);
+	uncached.create(1920, 1080);
+	BYTE* cell = new BYTE[4 * overlayTextSize * overlayTextSize];
+	int mismatches = 0;
+	int strays = 0;
+	int widest = 0;
+	int narrowest = 1920;
+	for (int pass = 0; pass < 3; pass++)
+	{
+		for (int i = 0; i < numOverlayStrings; i++)
+		{
+			const WCHAR* text = overlayStrings[i];
+			for (int c = 0; pass == 0 && text[c] != 0; c++)
+			{
+				distinct += seen[text[c] - firstAtlasGlyph] ? 0 : 1;
+				seen[text[c] - firstAtlasGlyph] = TRUE;
+			}
+
+			// The global cache measures the background; draw the same text
+			// with a cache of its own, and without one
+			OverlayPrimitive primitive = OverlayText(640 + 7 * i, 108 + 150 * i, text, overlayTextSize);
+			cached.clear(0);
+			uncached.clear(0);
+			cache.draw(cached, primitive);
+			DrawTextUncached(uncached, primitive, cell);
+			for (int y = 0; y < cached.height; y++)
+			{
+				if (memcmp(cached.pixels + y * cached.stride, uncached.pixels + y * uncached.stride, cached.width * sizeof(DWORD)) != 0)
+				{
+					mismatches++;
+				}
+				for (int x = 0; x < cached.width; x++)
+				{
+					if (cached.pixels[y * cached.stride + x] != 0 && ! InsideRect(primitive.bounds.left, primitive.bounds.top, primitive.bounds.right, primitive.bounds.bottom, x, y))
+					{
+						strays++;
+					}
+				}
+			}
+			int width = primitive.bounds.right - primitive.bounds.left;
+			widest = (width > widest) ? width : widest;
+			narrowest = (width < narrowest) ? width : narrowest;
+		}
+	}
+	delete [] cell;
+
+	fprintf(results, "%-24s %s (%ld glyphs rendered for %d different characters, %ld layout hits)\n", "glyphs rendered once",
+		CheckResult(renders == distinct && cache.glyphsRendered == distinct), renders, distinct, cache.layoutHits);
+	fprintf(results, "%-24s %s (%d rows differ)\n", "cached = rendered", CheckResult(mismatches == 0), mismatches);
+	fprintf(results, "%-24s %s (%d pixels outside)\n", "drawn within background", CheckResult(strays == 0), strays);
+	// The background was 16 font sizes wide whatever the text said
+	fprintf(results, "%-24s %s (%d to %d pixels wide, was always %d)\n", "background fits text",
+		CheckResult(narrowest < widest), narrowest, widest, 16 * overlayTextSize);
+}
+
+// Drawing the status texts the way the overlay does, from the cache, and
+// with every glyph rendered again each time as it was with GDI+
+static void RunOverlayText(FILE* results, BenchmarkTimer &timer, BOOL useCache)
+{
+	OverlaySurface surface;
+	surface.create(1920, 1080);
+	OverlayTextCache cache;
+	cache.setRenderer(BenchmarkGlyph, NULL);
+	BYTE* cell = new BYTE[4 * overlayTextSize * overlayTextSize];
+	OverlayPrimitive texts[numOverlayStrings];
+	for (int i = 0; i < numOverlayStrings; i++)
+	{
+		texts[i] = OverlayText(640, 108 + 150 * i, overlayStrings[i], overlayTextSize);
+	}
+
+	const int frames = benchmarkFrames / 10;
+	timer.reset();
+	for (int frame = 0; frame < frames; frame++)
+	{
+		const OverlayPrimitive &text = texts[frame % numOverlayStrings];
+		timer.start();
+		if (useCache)
+		{
+			cache.draw(surface, text);
+		}
+		else
+		{
+			DrawTextUncached(surface, text, cell);
+		}
+		timer.stop();
+	}
+	delete [] cell;
+	timer.report(results, useCache ? "text, cached" : "text, rendered each time");
+	if (useCache)
+	{
+		fprintf(results, "%-24s %ld glyphs rendered, %ld layouts made, %ld found\n", "",
+			cache.glyphsRendered, cache.layoutsMade, cache.layoutHits);
+	}
+}
+
+static void RunOverlayTextBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	CheckOverlayText(results);
+	RunOverlayText(results, timer, FALSE);
+	RunOverlayText(results, timer, TRUE);
+}
+
+// The scene, the rasterizer, then the text cache on top of both
+void BenchmarkOverlays(FILE* results, BenchmarkTimer &timer)
+{
+	// Text is measured and drawn with made-up glyphs rather than GDI+'s
+	overlayTextCache.setRenderer(BenchmarkGlyph, NULL);
+	fprintf(results, "\nOverlay compositing, %d frame script\n", OverlayScriptFrames());
+	RunOverlayBenchmark(results, timer);
+
+	fprintf(results, "\nOverlay rasterizing\n");
+	RunOverlayRasterBenchmark(results, timer);
+
+	fprintf(results, "\nOverlay text, %d pixel font\n", overlayTextSize);
+	RunOverlayTextBenchmark(results, timer);
+}
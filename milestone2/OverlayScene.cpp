@@ -0,0 +1,361 @@
+#include "OverlayScene.h"
+#include "OverlayTextCache.h"
+#include <string.h>
+
+OverlayScene overlayScene;
+
+/*** Primitives ***/
+
+static RECT MakeRect(int left, int top, int right, int bottom)
+{
+	RECT rect;
+	rect.left = left;
+	rect.top = top;
+	rect.right = right;
+	rect.bottom = bottom;
+	return rect;
+}
+
+static int Smaller(int a, int b)
+{
+	return (a < b) ? a : b;
+}
+
+static int Larger(int a, int b)
+{
+	return (a > b) ? a : b;
+}
+
+static BOOL Overlaps(const RECT &a, const RECT &b)
+{
+	return (a.left < b.right) && (b.left < a.right) && (a.top < b.bottom) && (b.top < a.bottom);
+}
+
+static RECT Union(const RECT &a, const RECT &b)
+{
+	return MakeRect(Smaller(a.left, b.left), Smaller(a.top, b.top), Larger(a.right, b.right), Larger(a.bottom, b.bottom));
+}
+
+OverlayPrimitive OverlayRectangle(int ulx, int uly, int width, int height, int c)
+{
+	// Zeroed, so whole primitives can be compared
+	OverlayPrimitive primitive;
+	ZeroMemory(&primitive, sizeof(primitive));
+	primitive.kind = PRIMITIVE_RECTANGLE;
+	primitive.x = ulx;
+	primitive.y = uly;
+	primitive.width = width;
+	primitive.height = height;
+	primitive.color = c;
+	primitive.bounds = MakeRect(ulx - overlayPenReach, uly - overlayPenReach,
+		ulx + width + overlayPenReach, uly + height + overlayPenReach);
+	return primitive;
+}
+
+OverlayPrimitive OverlayTrapezoid(int ulx, int uly, int size, Quadrant quad, int on, int maxDist)
+{
+	OverlayPrimitive primitive;
+	ZeroMemory(&primitive, sizeof(primitive));
+	primitive.kind = PRIMITIVE_TRAPEZOID;
+	primitive.x = ulx;
+	primitive.y = uly;
+	primitive.width = size;
+	primitive.height = size;
+	primitive.quadrant = quad;
+	primitive.reach = maxDist;
+	primitive.color = on;
+
+	// From the side of the box out past the edge of the screen
+	RECT box = MakeRect(ulx, uly, ulx + size, uly + size);
+	switch (quad)
+	{
+	case Q_TOP:
+		box = MakeRect(ulx - maxDist, uly - maxDist, ulx + size + maxDist, uly);
+		break;
+	case Q_BOTTOM:
+		box = MakeRect(ulx - maxDist, uly + size, ulx + size + maxDist, uly + size + maxDist);
+		break;
+	case Q_RIGHT:
+		box = MakeRect(ulx + size, uly - maxDist, ulx + size + maxDist, uly + size + maxDist);
+		break;
+	case Q_LEFT:
+		box = MakeRect(ulx - maxDist, uly - maxDist, ulx, uly + size + maxDist);
+		break;
+	}
+	primitive.bounds = MakeRect(box.left - overlayPenReach, box.top - overlayPenReach,
+		box.right + overlayPenReach, box.bottom + overlayPenReach);
+	return primitive;
+}
+
+OverlayPrimitive OverlayText(int x1, int y1, const WCHAR* string, int size)
+{
+	OverlayPrimitive primitive;
+	ZeroMemory(&primitive, sizeof(primitive));
+	primitive.kind = PRIMITIVE_TEXT;
+	primitive.x = x1;
+	primitive.y = y1;
+	primitive.width = size;
+	primitive.height = size;
+	int length = 0;
+	while (string[length] != 0 && length < maxOverlayText - 1)
+	{
+		primitive.text[length] = string[length];
+		length++;
+	}
+
+	// Laid out (and its glyphs rendered) now, rather than when it's drawn
+	primitive.bounds = OverlayTextBackground(primitive);
+	return primitive;
+}
+
+RECT OverlayTextBackground(const OverlayPrimitive &text)
+{
+	// The text, with a quarter of the font size either side
+	int size = text.height;
+	RECT box = overlayTextCache.measure(text.x, text.y, text.text, size);
+	return MakeRect(box.left - size / 4, box.top, box.right + size / 4, box.bottom);
+}
+
+/*** The scene ***/
+
+OverlayScene::OverlayScene()
+{
+	InitializeCriticalSection(&lock);
+	numBuilding = 0;
+	buildingVisible = FALSE;
+	numCommitted = 0;
+	committedVisible = FALSE;
+	generation = 0;
+	numShown = 0;
+	shownVisible = FALSE;
+	shownGeneration = 0;
+	submitted = 0;
+	rasterized = 0;
+	composed = 0;
+	skipped = 0;
+	dirtyPixels = 0;
+}
+
+OverlayScene::~OverlayScene(void)
+{
+	DeleteCriticalSection(&lock);
+}
+
+int OverlayScene::find(const OverlayPrimitive* list, int count, const OverlayPrimitive &primitive)
+{
+	for (int i = 0; i < count; i++)
+	{
+		const OverlayPrimitive &other = list[i];
+		if (other.kind == primitive.kind && other.x == primitive.x && other.y == primitive.y
+			&& other.width == primitive.width && other.height == primitive.height
+			&& other.quadrant == primitive.quadrant)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+void OverlayScene::clear()
+{
+	EnterCriticalSection(&lock);
+	numBuilding = 0;
+	LeaveCriticalSection(&lock);
+}
+
+void OverlayScene::hide()
+{
+	EnterCriticalSection(&lock);
+	numBuilding = 0;
+	buildingVisible = FALSE;
+	if (committedVisible || numCommitted > 0)
+	{
+		numCommitted = 0;
+		committedVisible = FALSE;
+		generation++;
+	}
+	LeaveCriticalSection(&lock);
+}
+
+void OverlayScene::add(const OverlayPrimitive &primitive)
+{
+	EnterCriticalSection(&lock);
+	submitted++;
+	buildingVisible = TRUE;
+	int i = find(building, numBuilding, primitive);
+	if (i != -1)
+	{
+		building[i] = primitive;
+	}
+	else if (numBuilding < maxOverlayPrimitives)
+	{
+		building[numBuilding++] = primitive;
+	}
+	LeaveCriticalSection(&lock);
+}
+
+void OverlayScene::commit()
+{
+	EnterCriticalSection(&lock);
+	// Most frames declare exactly what's already there
+	if (numBuilding != numCommitted || buildingVisible != committedVisible
+		|| memcmp(building, committed, numBuilding * sizeof(OverlayPrimitive)) != 0)
+	{
+		CopyMemory(committed, building, numBuilding * sizeof(OverlayPrimitive));
+		numCommitted = numBuilding;
+		committedVisible = buildingVisible;
+		generation++;
+	}
+	LeaveCriticalSection(&lock);
+}
+
+int OverlayScene::published(OverlayPrimitive* primitives, BOOL &visible)
+{
+	EnterCriticalSection(&lock);
+	CopyMemory(primitives, committed, numCommitted * sizeof(OverlayPrimitive));
+	int count = numCommitted;
+	visible = committedVisible;
+	LeaveCriticalSection(&lock);
+	return count;
+}
+
+void OverlayScene::addDirty(OverlayDamage &damage, const RECT &rect)
+{
+	// Soak up everything it overlaps, starting over whenever it grows
+	RECT merged = rect;
+	int i = 0;
+	while (i < damage.numDirty)
+	{
+		if (Overlaps(merged, damage.dirty[i]))
+		{
+			merged = Union(merged, damage.dirty[i]);
+			damage.dirty[i] = damage.dirty[--damage.numDirty];
+			i = 0;
+		}
+		else
+		{
+			i++;
+		}
+	}
+
+	if (damage.numDirty == maxOverlayDirtyRects)
+	{
+		for (int j = 0; j < damage.numDirty; j++)
+		{
+			merged = Union(merged, damage.dirty[j]);
+		}
+		damage.numDirty = 0;
+	}
+	damage.dirty[damage.numDirty++] = merged;
+}
+
+BOOL OverlayScene::compose(int screenWidth, int screenHeight, OverlayDamage &damage)
+{
+	damage.hide = FALSE;
+	damage.numDirty = 0;
+	damage.numRedraw = 0;
+
+	OverlayPrimitive next[maxOverlayPrimitives];
+	int numNext;
+	BOOL nextVisible;
+	EnterCriticalSection(&lock);
+	if (generation == shownGeneration)
+	{
+		LeaveCriticalSection(&lock);
+		skipped++;
+		return FALSE;
+	}
+	CopyMemory(next, committed, numCommitted * sizeof(OverlayPrimitive));
+	numNext = numCommitted;
+	nextVisible = committedVisible;
+	shownGeneration = generation;
+	LeaveCriticalSection(&lock);
+
+	if (! nextVisible)
+	{
+		damage.hide = shownVisible;
+		numShown = 0;
+		shownVisible = FALSE;
+		if (damage.hide)
+		{
+			composed++;
+			return TRUE;
+		}
+		skipped++;
+		return FALSE;
+	}
+
+	RECT screen = MakeRect(0, 0, screenWidth, screenHeight);
+	if (! shownVisible)
+	{
+		// Just shown, so everything on it is new
+		addDirty(damage, screen);
+	}
+	else
+	{
+		// Wherever something went away or changed...
+		for (int i = 0; i < numShown; i++)
+		{
+			int j = find(next, numNext, shown[i]);
+			if (j == -1 || memcmp(&next[j], &shown[i], sizeof(OverlayPrimitive)) != 0)
+			{
+				addDirty(damage, shown[i].bounds);
+			}
+			// (text that changed can cover more than it did)
+			if (j != -1 && memcmp(&next[j].bounds, &shown[i].bounds, sizeof(RECT)) != 0)
+			{
+				addDirty(damage, next[j].bounds);
+			}
+		}
+		// ...or something new came
+		for (int i = 0; i < numNext; i++)
+		{
+			if (find(shown, numShown, next[i]) == -1)
+			{
+				addDirty(damage, next[i].bounds);
+			}
+		}
+	}
+
+	// Nothing off the screen needs clearing
+	int numDirty = 0;
+	double pixels = 0;
+	for (int i = 0; i < damage.numDirty; i++)
+	{
+		RECT clipped = MakeRect(Larger(damage.dirty[i].left, screen.left), Larger(damage.dirty[i].top, screen.top),
+			Smaller(damage.dirty[i].right, screen.right), Smaller(damage.dirty[i].bottom, screen.bottom));
+		if (clipped.left < clipped.right && clipped.top < clipped.bottom)
+		{
+			damage.dirty[numDirty++] = clipped;
+			pixels += (double) (clipped.right - clipped.left) * (clipped.bottom - clipped.top);
+		}
+	}
+	damage.numDirty = numDirty;
+
+	// Redraw everything the cleared areas cut into, in the order declared
+	for (int i = 0; i < numNext; i++)
+	{
+		for (int d = 0; d < damage.numDirty; d++)
+		{
+			if (Overlaps(next[i].bounds, damage.dirty[d]))
+			{
+				damage.redraw[damage.numRedraw++] = next[i];
+				break;
+			}
+		}
+	}
+
+	CopyMemory(shown, next, numNext * sizeof(OverlayPrimitive));
+	numShown = numNext;
+	shownVisible = TRUE;
+
+	if (damage.numDirty == 0)
+	{
+		skipped++;
+		return FALSE;
+	}
+	rasterized += damage.numRedraw;
+	dirtyPixels += pixels;
+	composed++;
+	return TRUE;
+}
@@ -0,0 +1,137 @@
+/************************************************************************
+*                                                                       *
+*   OverlayScene.h -- Declaration of OverlayScene class                 *
+*                                                                       *
+*   What the gesture overlay should be showing.  The detectors          *
+*   declare it, a frame at a time, through drawRectangle() and the      *
+*   rest; the magnifier's timer composes it once per display frame,     *
+*   and only what changed since then is drawn again.  Nothing here      *
+*   touches the window, so compositing can be checked and timed         *
+*   without one.                                                        *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "GestureDetector.h"
+
+enum OverlayPrimitiveKind {
+	PRIMITIVE_RECTANGLE,
+	PRIMITIVE_TRAPEZOID,
+	PRIMITIVE_TEXT,
+};
+
+// Longest text the overlay shows, with its terminator
+const int maxOverlayText = 48;
+// Primitives one scene can hold; a full scene drops the rest
+const int maxOverlayPrimitives = 32;
+// Separate regions one composite redraws; past that, it's their union
+const int maxOverlayDirtyRects = 8;
+// How far a 10 pixel pen reaches past an outline: half of it, or just over
+// seven pixels where the trapezoids' squared-off edges meet at 45 degrees
+const int overlayPenReach = 8;
+
+// One thing on the overlay.  Where it is (kind, x, y, width, height,
+// quadrant) says which primitive it is; drawing one where there's
+// already one replaces it, the way drawing over it used to.
+struct OverlayPrimitive
+{
+	OverlayPrimitiveKind kind;
+	int x;
+	int y;
+	// The box for rectangles and trapezoids; the font size for text
+	int width;
+	int height;
+	// Which side a trapezoid opens out of, and how far
+	Quadrant quadrant;
+	int reach;
+	// drawRectangle()'s c, or drawTrapezoid()'s on
+	int color;
+	WCHAR text[maxOverlayText];
+	// Everything drawing it can touch
+	RECT bounds;
+};
+
+// What drawRectangle(), drawTrapezoid() and drawText() declare.
+// maxDist is how far a trapezoid goes off towards the edge of the screen.
+OverlayPrimitive OverlayRectangle(int ulx, int uly, int width, int height, int c);
+OverlayPrimitive OverlayTrapezoid(int ulx, int uly, int size, Quadrant quad, int on, int maxDist);
+OverlayPrimitive OverlayText(int x1, int y1, const WCHAR* string, int size);
+// Where drawText() puts the black background behind the text
+RECT OverlayTextBackground(const OverlayPrimitive &text);
+
+// What a composite has to do to the window
+struct OverlayDamage
+{
+	// Hide the window (after clearing it), and nothing else
+	BOOL hide;
+	// Clear these to the background, then draw redraw[] over them
+	RECT dirty[maxOverlayDirtyRects];
+	int numDirty;
+	OverlayPrimitive redraw[maxOverlayPrimitives];
+	int numRedraw;
+};
+
+class OverlayScene
+{
+public:
+	OverlayScene();
+	~OverlayScene(void);
+
+	/* Declaring, from the detectors */
+	// clearOverlay(): start again from nothing
+	void clear();
+	// clearAndHideOverlay(): nothing, and the window hidden.  Takes effect
+	// straight away.
+	void hide();
+	// Any of the draw functions; shows the window
+	void add(const OverlayPrimitive &primitive);
+	// Everything declared since the last commit() is ready to be shown
+	void commit();
+	// A copy of what the last commit() declared, and whether it's shown
+	int published(OverlayPrimitive* primitives, BOOL &visible);
+
+	/* Compositing, once per display frame */
+	// What has to be drawn to bring the window up to date with the last
+	// commit, or FALSE if it already is
+	BOOL compose(int screenWidth, int screenHeight, OverlayDamage &damage);
+
+	// Primitives the detectors declared, and how many of those the
+	// compositor actually drew
+	LONG submitted;
+	LONG rasterized;
+	// Display frames with something to draw, and without
+	LONG composed;
+	LONG skipped;
+	// Pixels cleared and redrawn, over all composites
+	double dirtyPixels;
+
+private:
+	// Where a primitive is in a list, or -1
+	static int find(const OverlayPrimitive* list, int count, const OverlayPrimitive &primitive);
+	static void addDirty(OverlayDamage &damage, const RECT &rect);
+
+	// Everything but shown; hide() can come from the magnifier's thread
+	CRITICAL_SECTION lock;
+
+	// Being declared
+	OverlayPrimitive building[maxOverlayPrimitives];
+	int numBuilding;
+	BOOL buildingVisible;
+
+	// The last commit
+	OverlayPrimitive committed[maxOverlayPrimitives];
+	int numCommitted;
+	BOOL committedVisible;
+	LONG generation;
+
+	// On the window (the compositor's thread only)
+	OverlayPrimitive shown[maxOverlayPrimitives];
+	int numShown;
+	BOOL shownVisible;
+	LONG shownGeneration;
+};
+
+// The one the overlay functions declare into
+extern OverlayScene overlayScene;
@@ -0,0 +1,423 @@
+#include "OverlaySurface.h"
+#include <emmintrin.h>
+#include <math.h>
+
+// Enough for any edge of any polygon the overlay draws to cross a row once
+const int maxPolygonCrossings = 16;
+
+/*** Spans ***/
+
+void FillSpanScalar(DWORD* span, int count, DWORD color)
+{
+	for (int i = 0; i < count; i++)
+	{
+		span[i] = color;
+	}
+}
+
+void FillSpanSSE2(DWORD* span, int count, DWORD color)
+{
+	// Up to the first whole register, then sixteen pixels a time, then
+	// whatever's left
+	int i = 0;
+	while (i < count && (((size_t) (span + i)) & 15) != 0)
+	{
+		span[i++] = color;
+	}
+	__m128i four = _mm_set1_epi32((int) color);
+	for (; i + 16 <= count; i += 16)
+	{
+		_mm_store_si128((__m128i*) (span + i), four);
+		_mm_store_si128((__m128i*) (span + i + 4), four);
+		_mm_store_si128((__m128i*) (span + i + 8), four);
+		_mm_store_si128((__m128i*) (span + i + 12), four);
+	}
+	for (; i + 4 <= count; i += 4)
+	{
+		_mm_store_si128((__m128i*) (span + i), four);
+	}
+	FillSpanScalar(span + i, count - i, color);
+}
+
+void BlendSpanScalar(DWORD* span, int count, DWORD color)
+{
+	// Premultiplied source over: out = source + destination * (1 - alpha)
+	DWORD inverse = 255 - (color >> 24);
+	for (int i = 0; i < count; i++)
+	{
+		DWORD out = 0;
+		for (int shift = 0; shift < 32; shift += 8)
+		{
+			DWORD channel = ((color >> shift) & 0xFF) + DivideBy255(((span[i] >> shift) & 0xFF) * inverse);
+			out |= ((channel > 255) ? 255 : channel) << shift;
+		}
+		span[i] = out;
+	}
+}
+
+// Four pixels' worth of destination * inverse / 255, in two halves of
+// eight 16-bit channels
+static __forceinline __m128i ScaleChannels(__m128i channels, __m128i inverse)
+{
+	__m128i scaled = _mm_add_epi16(_mm_mullo_epi16(channels, inverse), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(scaled, _mm_srli_epi16(scaled, 8)), 8);
+}
+
+void BlendSpanSSE2(DWORD* span, int count, DWORD color)
+{
+	__m128i source = _mm_set1_epi32((int) color);
+	__m128i inverse = _mm_set1_epi16((short) (255 - (color >> 24)));
+	__m128i zero = _mm_setzero_si128();
+	int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i destination = _mm_loadu_si128((const __m128i*) (span + i));
+		__m128i low = ScaleChannels(_mm_unpacklo_epi8(destination, zero), inverse);
+		__m128i high = ScaleChannels(_mm_unpackhi_epi8(destination, zero), inverse);
+		__m128i out = _mm_adds_epu8(source, _mm_packus_epi16(low, high));
+		_mm_storeu_si128((__m128i*) (span + i), out);
+	}
+	BlendSpanScalar(span + i, count - i, color);
+}
+
+/*** The surface ***/
+
+OverlaySurface::OverlaySurface()
+{
+	pixels = NULL;
+	width = 0;
+	height = 0;
+	stride = 0;
+	ownsPixels = FALSE;
+	// Every x64 processor has SSE2, but check on 32-bit
+	useSSE = IsProcessorFeaturePresent(PF_XMMI64_INSTRUCTIONS_AVAILABLE);
+	resetClip();
+}
+
+OverlaySurface::~OverlaySurface(void)
+{
+	if (ownsPixels)
+	{
+		_aligned_free(pixels);
+	}
+}
+
+BOOL OverlaySurface::create(int newWidth, int newHeight)
+{
+	// Rows a whole number of registers long, so they all start aligned
+	int newStride = (newWidth + 3) & ~3;
+	DWORD* newPixels = (DWORD*) _aligned_malloc((size_t) newStride * newHeight * sizeof(DWORD), 16);
+	if (newPixels == NULL)
+	{
+		return FALSE;
+	}
+	attach(newPixels, newWidth, newHeight, newStride);
+	ownsPixels = TRUE;
+	return TRUE;
+}
+
+void OverlaySurface::attach(DWORD* newPixels, int newWidth, int newHeight, int newStride)
+{
+	if (ownsPixels)
+	{
+		_aligned_free(pixels);
+	}
+	pixels = newPixels;
+	width = newWidth;
+	height = newHeight;
+	stride = newStride;
+	ownsPixels = FALSE;
+	resetClip();
+}
+
+void OverlaySurface::setClip(const RECT &area)
+{
+	clip.left = (area.left > 0) ? area.left : 0;
+	clip.top = (area.top > 0) ? area.top : 0;
+	clip.right = (area.right < width) ? area.right : width;
+	clip.bottom = (area.bottom < height) ? area.bottom : height;
+}
+
+void OverlaySurface::resetClip()
+{
+	clip.left = 0;
+	clip.top = 0;
+	clip.right = width;
+	clip.bottom = height;
+}
+
+void OverlaySurface::span(DWORD* start, int count, DWORD premultiplied)
+{
+	if ((premultiplied >> 24) == 255)
+	{
+		if (useSSE)
+		{
+			FillSpanSSE2(start, count, premultiplied);
+		}
+		else
+		{
+			FillSpanScalar(start, count, premultiplied);
+		}
+	}
+	else if (premultiplied != 0)
+	{
+		if (useSSE)
+		{
+			BlendSpanSSE2(start, count, premultiplied);
+		}
+		else
+		{
+			BlendSpanScalar(start, count, premultiplied);
+		}
+	}
+}
+
+void OverlaySurface::clear(DWORD color)
+{
+	DWORD premultiplied = Premultiply(color);
+	for (int y = clip.top; y < clip.bottom; y++)
+	{
+		DWORD* start = pixels + (size_t) y * stride + clip.left;
+		if (useSSE)
+		{
+			FillSpanSSE2(start, clip.right - clip.left, premultiplied);
+		}
+		else
+		{
+			FillSpanScalar(start, clip.right - clip.left, premultiplied);
+		}
+	}
+}
+
+void OverlaySurface::fillRect(const RECT &area, DWORD color)
+{
+	int left = (area.left > clip.left) ? area.left : clip.left;
+	int right = (area.right < clip.right) ? area.right : clip.right;
+	int top = (area.top > clip.top) ? area.top : clip.top;
+	int bottom = (area.bottom < clip.bottom) ? area.bottom : clip.bottom;
+	if (left >= right)
+	{
+		return;
+	}
+	DWORD premultiplied = Premultiply(color);
+	for (int y = top; y < bottom; y++)
+	{
+		span(pixels + (size_t) y * stride + left, right - left, premultiplied);
+	}
+}
+
+void OverlaySurface::strokeRect(int x, int y, int rectWidth, int rectHeight, int penWidth, DWORD color)
+{
+	// Four bars that don't overlap, so translucent outlines come out even:
+	// the whole top and bottom, and the sides between them.  A rectangle
+	// thinner than the pen is solid.
+	int outside = penWidth / 2;
+	int inside = penWidth - outside;
+	int bottomStart = (y + rectHeight - outside > y + inside) ? y + rectHeight - outside : y + inside;
+	int rightStart = (x + rectWidth - outside > x + inside) ? x + rectWidth - outside : x + inside;
+	RECT bar;
+	bar.left = x - outside;
+	bar.right = x + rectWidth + inside;
+	bar.top = y - outside;
+	bar.bottom = y + inside;
+	fillRect(bar, color);
+	bar.top = bottomStart;
+	bar.bottom = y + rectHeight + inside;
+	fillRect(bar, color);
+
+	bar.top = y + inside;
+	bar.bottom = bottomStart;
+	bar.left = x - outside;
+	bar.right = x + inside;
+	fillRect(bar, color);
+	bar.left = rightStart;
+	bar.right = x + rectWidth + inside;
+	fillRect(bar, color);
+}
+
+void OverlaySurface::fillPolygon(const OverlayVertex* vertices, int count, DWORD color)
+{
+	float minY = vertices[0].y;
+	float maxY = vertices[0].y;
+	for (int i = 1; i < count; i++)
+	{
+		minY = (vertices[i].y < minY) ? vertices[i].y : minY;
+		maxY = (vertices[i].y > maxY) ? vertices[i].y : maxY;
+	}
+	int top = (int) ceil(minY - 0.5f);
+	int bottom = (int) ceil(maxY - 0.5f);
+	top = (top > clip.top) ? top : clip.top;
+	bottom = (bottom < clip.bottom) ? bottom : clip.bottom;
+
+	DWORD premultiplied = Premultiply(color);
+	float crossings[maxPolygonCrossings];
+	for (int y = top; y < bottom; y++)
+	{
+		// Where the edges cross this row's pixel centers, in order.  An edge
+		// counts from its top end down to just before its bottom end.
+		float center = y + 0.5f;
+		int numCrossings = 0;
+		for (int i = 0; i < count; i++)
+		{
+			const OverlayVertex &a = vertices[i];
+			const OverlayVertex &b = vertices[(i + 1) % count];
+			if ((a.y <= center) == (b.y <= center) || numCrossings == maxPolygonCrossings)
+			{
+				continue;
+			}
+			float x = a.x + (center - a.y) * (b.x - a.x) / (b.y - a.y);
+			int j = numCrossings++;
+			while (j > 0 && crossings[j - 1] > x)
+			{
+				crossings[j] = crossings[j - 1];
+				j--;
+			}
+			crossings[j] = x;
+		}
+
+		DWORD* row = pixels + (size_t) y * stride;
+		for (int i = 0; i + 1 < numCrossings; i += 2)
+		{
+			int left = (int) ceil(crossings[i] - 0.5f);
+			int right = (int) ceil(crossings[i + 1] - 0.5f);
+			left = (left > clip.left) ? left : clip.left;
+			right = (right < clip.right) ? right : clip.right;
+			if (left < right)
+			{
+				span(row + left, right - left, premultiplied);
+			}
+		}
+	}
+}
+
+void OverlaySurface::strokePolygon(const POINT* points, int count, int penWidth, DWORD color)
+{
+	float half = penWidth / 2.0f;
+	for (int i = 0; i < count; i++)
+	{
+		const POINT &a = points[i];
+		const POINT &b = points[(i + 1) % count];
+		float dx = (float) (b.x - a.x);
+		float dy = (float) (b.y - a.y);
+		float length = sqrtf(dx * dx + dy * dy);
+		if (length == 0)
+		{
+			continue;
+		}
+
+		// Along the edge and across it, half a pen long
+		float alongX = dx * half / length;
+		float alongY = dy * half / length;
+		float acrossX = -alongY;
+		float acrossY = alongX;
+		OverlayVertex bar[4] = {
+			{ a.x - alongX + acrossX, a.y - alongY + acrossY },
+			{ b.x + alongX + acrossX, b.y + alongY + acrossY },
+			{ b.x + alongX - acrossX, b.y + alongY - acrossY },
+			{ a.x - alongX - acrossX, a.y - alongY - acrossY }};
+		fillPolygon(bar, 4, color);
+	}
+}
+
+void OverlaySurface::blendMask(int x, int y, const BYTE* coverage, int maskWidth, int maskHeight, int maskStride, DWORD color)
+{
+	int left = (x > clip.left) ? x : clip.left;
+	int right = (x + maskWidth < clip.right) ? x + maskWidth : clip.right;
+	int top = (y > clip.top) ? y : clip.top;
+	int bottom = (y + maskHeight < clip.bottom) ? y + maskHeight : clip.bottom;
+	DWORD premultiplied = Premultiply(color);
+	for (int py = top; py < bottom; py++)
+	{
+		const BYTE* row = coverage + (py - y) * maskStride - x;
+		DWORD* out = pixels + (size_t) py * stride;
+		for (int px = left; px < right; px++)
+		{
+			// Mostly nothing or everything, a run at a time; the edges are
+			// blended
+			DWORD c = row[px];
+			if (c == 255)
+			{
+				int run = 1;
+				while (px + run < right && row[px + run] == 255)
+				{
+					run++;
+				}
+				span(out + px, run, premultiplied);
+				px += run - 1;
+			}
+			else if (c != 0)
+			{
+				DWORD scaled = (DivideBy255((premultiplied >> 24) * c) << 24)
+					| (DivideBy255(((premultiplied >> 16) & 0xFF) * c) << 16)
+					| (DivideBy255(((premultiplied >> 8) & 0xFF) * c) << 8)
+					| DivideBy255((premultiplied & 0xFF) * c);
+				BlendSpanScalar(out + px, 1, scaled);
+			}
+		}
+	}
+}
+
+BOOL OverlaySurface::draw(const OverlayPrimitive &primitive)
+{
+	if (primitive.kind == PRIMITIVE_RECTANGLE)
+	{
+		DWORD color = overlayBlack;
+		if (primitive.color == 0)
+		{
+			color = overlayRed;
+		}
+		else if (primitive.color == 1)
+		{
+			color = overlayGreen;
+		}
+		else if (primitive.color == 2)
+		{
+			color = overlayWhite;
+		}
+		strokeRect(primitive.x, primitive.y, primitive.width, primitive.height, overlayPenWidth, color);
+		return TRUE;
+	}
+
+	if (primitive.kind == PRIMITIVE_TRAPEZOID)
+	{
+		// From one side of the box out to corners off the screen
+		int ulx = primitive.x;
+		int uly = primitive.y;
+		int size = primitive.width;
+		int reach = primitive.reach;
+		POINT corners[4];
+		switch (primitive.quadrant)
+		{
+		case Q_TOP:
+			corners[0].x = ulx;                corners[0].y = uly;
+			corners[1].x = ulx - reach;        corners[1].y = uly - reach;
+			corners[2].x = ulx + size + reach; corners[2].y = uly - reach;
+			corners[3].x = ulx + size;         corners[3].y = uly;
+			break;
+		case Q_BOTTOM:
+			corners[0].x = ulx;                corners[0].y = uly + size;
+			corners[1].x = ulx - reach;        corners[1].y = uly + size + reach;
+			corners[2].x = ulx + size + reach; corners[2].y = uly + size + reach;
+			corners[3].x = ulx + size;         corners[3].y = uly + size;
+			break;
+		case Q_RIGHT:
+			corners[0].x = ulx + size;         corners[0].y = uly;
+			corners[1].x = ulx + size + reach; corners[1].y = uly - reach;
+			corners[2].x = ulx + size + reach; corners[2].y = uly + size + reach;
+			corners[3].x = ulx + size;         corners[3].y = uly + size;
+			break;
+		case Q_LEFT:
+			corners[0].x = ulx;                corners[0].y = uly;
+			corners[1].x = ulx - reach;        corners[1].y = uly - reach;
+			corners[2].x = ulx - reach;        corners[2].y = uly + size + reach;
+			corners[3].x = ulx;                corners[3].y = uly + size;
+			break;
+		default:
+			return FALSE;
+		}
+		strokePolygon(corners, 4, overlayPenWidth, primitive.color ? overlayGreen : overlayRed);
+		return TRUE;
+	}
+
+	return FALSE;
+}
@@ -0,0 +1,107 @@
+/************************************************************************
+*                                                                       *
+*   OverlaySurface.h -- Declaration of OverlaySurface class             *
+*                                                                       *
+*   A software rasterizer for the gesture overlay.  It draws the        *
+*   overlay's rectangles, trapezoids and clears into premultiplied      *
+*   ARGB pixels, the way UpdateLayeredWindow() wants them, so the       *
+*   window takes one update a frame rather than a GDI+ call per         *
+*   primitive.  Spans are filled and blended four pixels at a time      *
+*   with SSE2.  Nothing here touches a window, so it's checked pixel    *
+*   by pixel in the benchmark, though it's still Win32 code: the        *
+*   Windows types, _aligned_malloc() and IsProcessorFeaturePresent().   *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "OverlayScene.h"
+
+// The overlay's colors, as GDI+ Color(a, r, g, b) would have them
+const DWORD overlayRed = 0xFFFF0000;
+const DWORD overlayGreen = 0xFF00FF00;
+const DWORD overlayWhite = 0xFFFFFFFF;
+const DWORD overlayBlack = 0xFF000000;
+// The pen every outline was drawn with
+const int overlayPenWidth = 10;
+
+// x / 255, rounded, for anything up to 255 * 255
+inline DWORD DivideBy255(DWORD x)
+{
+	x += 128;
+	return (x + (x >> 8)) >> 8;
+}
+
+// Straight ARGB to premultiplied
+inline DWORD Premultiply(DWORD argb)
+{
+	DWORD a = argb >> 24;
+	DWORD r = DivideBy255(((argb >> 16) & 0xFF) * a);
+	DWORD g = DivideBy255(((argb >> 8) & 0xFF) * a);
+	DWORD b = DivideBy255((argb & 0xFF) * a);
+	return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+// Runs of pixels along a row.  Fill replaces them with a premultiplied
+// color; Blend puts a premultiplied color over them.
+void FillSpanScalar(DWORD* span, int count, DWORD color);
+void FillSpanSSE2(DWORD* span, int count, DWORD color);
+void BlendSpanScalar(DWORD* span, int count, DWORD color);
+void BlendSpanSSE2(DWORD* span, int count, DWORD color);
+
+struct OverlayVertex
+{
+	float x;
+	float y;
+};
+
+class OverlaySurface
+{
+public:
+	OverlaySurface();
+	~OverlaySurface(void);
+
+	// Pixels of its own, or someone else's (a DIB section's), stride
+	// pixels from one row to the next
+	BOOL create(int width, int height);
+	void attach(DWORD* pixels, int width, int height, int stride);
+
+	// Nothing outside the clip is drawn on; it starts as the whole surface
+	void setClip(const RECT &area);
+	void resetClip();
+
+	// Colors are straight ARGB, and go over what's there unless they're
+	// clearing it.  Pixels are in if their centers are.
+	void clear(DWORD color);
+	void fillRect(const RECT &area, DWORD color);
+	// An outline penWidth thick, centered on the rectangle's edges, as GDI+
+	// draws one
+	void strokeRect(int x, int y, int width, int height, int penWidth, DWORD color);
+	// Even-odd filling
+	void fillPolygon(const OverlayVertex* vertices, int count, DWORD color);
+	// Each edge as a penWidth thick bar, squared off past its ends so the
+	// corners are filled in.  Where the bars overlap, a translucent color
+	// is put down twice.
+	void strokePolygon(const POINT* points, int count, int penWidth, DWORD color);
+
+	// A color through a coverage mask (0 to 255 a pixel, stride bytes from
+	// one row to the next), with its top left at (x, y)
+	void blendMask(int x, int y, const BYTE* coverage, int maskWidth, int maskHeight, int maskStride, DWORD color);
+
+	// A rectangle or trapezoid from the scene, as the GDI+ overlay drew it;
+	// FALSE for anything it doesn't draw (text)
+	BOOL draw(const OverlayPrimitive &primitive);
+
+	DWORD* pixels;
+	int width;
+	int height;
+	int stride;
+	BOOL useSSE;
+
+private:
+	void span(DWORD* start, int count, DWORD premultiplied);
+
+	RECT clip;
+	BOOL ownsPixels;
+};
@@ -0,0 +1,295 @@
+#include "OverlayTextCache.h"
+#include <stdlib.h>
+#include <string.h>
+
+OverlayTextCache overlayTextCache;
+
+/*** The atlas ***/
+
+GlyphAtlas::GlyphAtlas()
+{
+	size = 0;
+	coverage = NULL;
+	atlasHeight = 0;
+	rowsAllocated = 0;
+	cell = NULL;
+	rendered = 0;
+	lastUsed = 0;
+	reset(0);
+}
+
+GlyphAtlas::~GlyphAtlas(void)
+{
+	free(coverage);
+	free(cell);
+}
+
+void GlyphAtlas::reset(int newSize)
+{
+	// The memory is kept for the next size
+	size = newSize;
+	ZeroMemory(glyphs, sizeof(glyphs));
+	shelfX = 0;
+	shelfY = 0;
+	shelfHeight = 0;
+	atlasHeight = 0;
+	free(cell);
+	cell = (newSize > 0) ? (BYTE*) malloc(4 * newSize * newSize) : NULL;
+}
+
+BYTE* GlyphAtlas::reserve(int rows)
+{
+	if (rows > rowsAllocated)
+	{
+		int newRows = (2 * rowsAllocated > rows) ? 2 * rowsAllocated : rows;
+		BYTE* grown = (BYTE*) realloc(coverage, (size_t) newRows * glyphAtlasWidth);
+		if (grown == NULL)
+		{
+			return NULL;
+		}
+		ZeroMemory(grown + (size_t) rowsAllocated * glyphAtlasWidth, (size_t) (newRows - rowsAllocated) * glyphAtlasWidth);
+		coverage = grown;
+		rowsAllocated = newRows;
+	}
+	if (rows > atlasHeight)
+	{
+		atlasHeight = rows;
+	}
+	return coverage;
+}
+
+const AtlasGlyph &GlyphAtlas::glyph(WCHAR character, GlyphRenderer renderer, void* context)
+{
+	if (character < firstAtlasGlyph || character > lastAtlasGlyph)
+	{
+		character = L'?';
+	}
+	AtlasGlyph &found = glyphs[character - firstAtlasGlyph];
+	if (found.rendered)
+	{
+		return found;
+	}
+	found.rendered = TRUE;
+	found.advance = size / 2;
+
+	// Into a cell twice the font size each way...
+	GlyphMask mask;
+	mask.width = 2 * size;
+	mask.height = 2 * size;
+	mask.originX = size / 2;
+	mask.coverage = cell;
+	mask.advance = found.advance;
+	if (cell == NULL || renderer == NULL)
+	{
+		return found;
+	}
+	ZeroMemory(cell, mask.width * mask.height);
+	if (! renderer(context, character, size, mask))
+	{
+		return found;
+	}
+	found.advance = mask.advance;
+	rendered++;
+
+	// ...trimmed to its ink...
+	int left = mask.width;
+	int right = 0;
+	int top = mask.height;
+	int bottom = 0;
+	for (int y = 0; y < mask.height; y++)
+	{
+		for (int x = 0; x < mask.width; x++)
+		{
+			if (cell[y * mask.width + x] != 0)
+			{
+				left = (x < left) ? x : left;
+				right = (x + 1 > right) ? x + 1 : right;
+				top = (y < top) ? y : top;
+				bottom = (y + 1 > bottom) ? y + 1 : bottom;
+			}
+		}
+	}
+	if (left >= right)
+	{
+		// A space
+		return found;
+	}
+
+	// ...and put at the end of the current row, or on a new one
+	int width = right - left;
+	int height = bottom - top;
+	if (shelfX + width > glyphAtlasWidth)
+	{
+		shelfY += shelfHeight;
+		shelfX = 0;
+		shelfHeight = 0;
+	}
+	if (reserve(shelfY + height) == NULL)
+	{
+		return found;
+	}
+	for (int y = 0; y < height; y++)
+	{
+		CopyMemory(coverage + (size_t) (shelfY + y) * glyphAtlasWidth + shelfX, cell + (top + y) * mask.width + left, width);
+	}
+	found.atlasX = shelfX;
+	found.atlasY = shelfY;
+	found.width = width;
+	found.height = height;
+	found.offsetX = left - mask.originX;
+	found.offsetY = top;
+	shelfX += width;
+	shelfHeight = (height > shelfHeight) ? height : shelfHeight;
+	return found;
+}
+
+/*** Layouts ***/
+
+OverlayTextCache::OverlayTextCache()
+{
+	InitializeCriticalSection(&lock);
+	renderer = NULL;
+	context = NULL;
+	numLayouts = 0;
+	clock = 0;
+	glyphsRendered = 0;
+	layoutsMade = 0;
+	layoutHits = 0;
+}
+
+OverlayTextCache::~OverlayTextCache(void)
+{
+	DeleteCriticalSection(&lock);
+}
+
+void OverlayTextCache::setRenderer(GlyphRenderer newRenderer, void* newContext)
+{
+	EnterCriticalSection(&lock);
+	renderer = newRenderer;
+	context = newContext;
+	for (int i = 0; i < maxGlyphAtlases; i++)
+	{
+		atlases[i].reset(0);
+	}
+	numLayouts = 0;
+	LeaveCriticalSection(&lock);
+}
+
+GlyphAtlas &OverlayTextCache::atlas(int size)
+{
+	// The one for this size, or else the one used longest ago
+	int oldest = 0;
+	for (int i = 0; i < maxGlyphAtlases; i++)
+	{
+		if (atlases[i].size == size)
+		{
+			atlases[i].lastUsed = clock;
+			return atlases[i];
+		}
+		if (atlases[i].lastUsed < atlases[oldest].lastUsed)
+		{
+			oldest = i;
+		}
+	}
+
+	// Its layouts point into it
+	for (int i = 0; i < numLayouts; i++)
+	{
+		if (layouts[i].size == atlases[oldest].size)
+		{
+			layouts[i--] = layouts[--numLayouts];
+		}
+	}
+	atlases[oldest].reset(size);
+	atlases[oldest].lastUsed = clock;
+	return atlases[oldest];
+}
+
+const TextLayout &OverlayTextCache::layout(const WCHAR* text, int size)
+{
+	clock++;
+	for (int i = 0; i < numLayouts; i++)
+	{
+		if (layouts[i].size == size && wcsncmp(layouts[i].text, text, maxOverlayText - 1) == 0)
+		{
+			layoutHits++;
+			layouts[i].lastUsed = clock;
+			atlas(size).lastUsed = clock;
+			return layouts[i];
+		}
+	}
+
+	// A new one, in a free slot or the one used longest ago (once getting
+	// the atlas has thrown out any it had to)
+	GlyphAtlas &glyphs = atlas(size);
+	int oldest = 0;
+	for (int i = 1; i < numLayouts; i++)
+	{
+		if (layouts[i].lastUsed < layouts[oldest].lastUsed)
+		{
+			oldest = i;
+		}
+	}
+	int slot = (numLayouts < maxTextLayouts) ? numLayouts++ : oldest;
+	TextLayout &made = layouts[slot];
+	ZeroMemory(&made, sizeof(made));
+	made.size = size;
+	made.lastUsed = clock;
+	LONG renderedBefore = glyphs.rendered;
+	int penX = 0;
+	made.height = size;
+	while (made.numGlyphs < maxOverlayText - 1 && text[made.numGlyphs] != 0)
+	{
+		int i = made.numGlyphs++;
+		made.text[i] = text[i];
+		const AtlasGlyph &glyph = glyphs.glyph(text[i], renderer, context);
+		made.glyphX[i] = penX + glyph.offsetX;
+		made.glyphY[i] = glyph.offsetY;
+		if (glyph.width > 0)
+		{
+			made.left = (made.glyphX[i] < made.left) ? made.glyphX[i] : made.left;
+			made.right = (made.glyphX[i] + glyph.width > made.right) ? made.glyphX[i] + glyph.width : made.right;
+			made.height = (glyph.offsetY + glyph.height > made.height) ? glyph.offsetY + glyph.height : made.height;
+		}
+		penX += glyph.advance;
+		made.right = (penX > made.right) ? penX : made.right;
+	}
+	glyphsRendered += glyphs.rendered - renderedBefore;
+	layoutsMade++;
+	return made;
+}
+
+RECT OverlayTextCache::measure(int x, int y, const WCHAR* text, int size)
+{
+	EnterCriticalSection(&lock);
+	const TextLayout &found = layout(text, size);
+	RECT box;
+	box.left = x + found.left;
+	box.top = y;
+	box.right = x + found.right;
+	box.bottom = y + found.height;
+	LeaveCriticalSection(&lock);
+	return box;
+}
+
+void OverlayTextCache::draw(OverlaySurface &surface, const OverlayPrimitive &text)
+{
+	// Solid behind it, so it's readable
+	surface.fillRect(OverlayTextBackground(text), overlayBlack);
+
+	EnterCriticalSection(&lock);
+	int size = text.height;
+	const TextLayout &found = layout(text.text, size);
+	GlyphAtlas &glyphs = atlas(size);
+	for (int i = 0; i < found.numGlyphs; i++)
+	{
+		const AtlasGlyph &glyph = glyphs.glyph(found.text[i], renderer, context);
+		if (glyph.width > 0)
+		{
+			surface.blendMask(text.x + found.glyphX[i], text.y + found.glyphY[i],
+				glyphs.coverage + (size_t) glyph.atlasY * glyphAtlasWidth + glyph.atlasX,
+				glyph.width, glyph.height, glyphAtlasWidth, overlayTextColor);
+		}
+	}
+	LeaveCriticalSection(&lock);
+}
@@ -0,0 +1,150 @@
+/************************************************************************
+*                                                                       *
+*   OverlayTextCache.h -- Declaration of OverlayTextCache class         *
+*                                                                       *
+*   The overlay's text, drawn from cache.  Each font size gets an       *
+*   atlas its glyphs are rendered into once, the first time they're     *
+*   needed; each string gets a layout (where every glyph goes, and how  *
+*   big the whole thing is) the first time it's shown.  Drawing is      *
+*   then just blending glyphs out of the atlas.  Rendering a glyph is   *
+*   left to a GlyphRenderer (GDI+ on Windows), so the caching can be    *
+*   checked with a renderer of the benchmark's own.  It's still Win32   *
+*   code, locked with a CRITICAL_SECTION.                               *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "OverlayScene.h"
+#include "OverlaySurface.h"
+
+// The glyphs an atlas holds; anything else is drawn as a '?'
+const WCHAR firstAtlasGlyph = 32;
+const WCHAR lastAtlasGlyph = 126;
+const int numAtlasGlyphs = lastAtlasGlyph - firstAtlasGlyph + 1;
+// Font sizes with an atlas at once, and strings with a layout
+const int maxGlyphAtlases = 4;
+const int maxTextLayouts = 16;
+// How wide an atlas is; it grows downwards
+const int glyphAtlasWidth = 1024;
+// The overlay's text, as GDI+ Color(a, r, g, b) would have it
+const DWORD overlayTextColor = 0xFF80FF80;
+
+// One glyph rendered as coverage (0 to 255), into a cell width x height
+// with the top of the line along the top and the pen size / 2 in from the
+// left.  The renderer fills in coverage and advance.
+struct GlyphMask
+{
+	int width;
+	int height;
+	int originX;
+	BYTE* coverage;
+	// How far along the pen goes after it
+	int advance;
+};
+
+// Renders one glyph at one font size (in pixels); FALSE if it can't
+typedef BOOL (*GlyphRenderer)(void* context, WCHAR glyph, int size, GlyphMask &mask);
+
+// Where a glyph is in its atlas, and where it goes relative to the pen
+struct AtlasGlyph
+{
+	BOOL rendered;
+	int atlasX;
+	int atlasY;
+	int width;
+	int height;
+	int offsetX;
+	int offsetY;
+	int advance;
+};
+
+// Every glyph of one font size, packed into rows as they're rendered
+class GlyphAtlas
+{
+public:
+	GlyphAtlas();
+	~GlyphAtlas(void);
+
+	// Forgets every glyph, for another font size
+	void reset(int newSize);
+	// A glyph, rendered now if it hasn't been
+	const AtlasGlyph &glyph(WCHAR character, GlyphRenderer renderer, void* context);
+
+	int size;
+	// glyphAtlasWidth wide, atlasHeight rows of coverage
+	BYTE* coverage;
+	int atlasHeight;
+	// Glyphs rendered since the program started
+	LONG rendered;
+	// When it was last drawn from, to pick which one to reuse
+	LONG lastUsed;
+
+private:
+	BYTE* reserve(int rows);
+
+	AtlasGlyph glyphs[numAtlasGlyphs];
+	// Where the next glyph goes: along the current row of glyphs, or below it
+	int shelfX;
+	int shelfY;
+	int shelfHeight;
+	int rowsAllocated;
+	// Where the renderer draws, before the glyph's trimmed and packed
+	BYTE* cell;
+};
+
+// A string at one font size, ready to draw
+struct TextLayout
+{
+	int size;
+	WCHAR text[maxOverlayText];
+	int numGlyphs;
+	// Where each glyph goes from the top left of the text
+	int glyphX[maxOverlayText];
+	int glyphY[maxOverlayText];
+	// From the top left: as far as the pen or the ink goes either way, and
+	// the line or the lowest ink
+	int left;
+	int right;
+	int height;
+	LONG lastUsed;
+};
+
+class OverlayTextCache
+{
+public:
+	OverlayTextCache();
+	~OverlayTextCache(void);
+
+	// Who renders glyphs.  Without one, glyphs are blank and half a font
+	// size wide, so text can still be measured.  Throws the caches away.
+	void setRenderer(GlyphRenderer newRenderer, void* newContext);
+
+	// Where text at (x, y) goes, without the background
+	RECT measure(int x, int y, const WCHAR* text, int size);
+	// A text primitive: its black background, then the text
+	void draw(OverlaySurface &surface, const OverlayPrimitive &text);
+
+	// Glyphs rendered, layouts made, and draws and measures that found
+	// their layout already made
+	LONG glyphsRendered;
+	LONG layoutsMade;
+	LONG layoutHits;
+
+private:
+	GlyphAtlas &atlas(int size);
+	const TextLayout &layout(const WCHAR* text, int size);
+
+	GlyphRenderer renderer;
+	void* context;
+	GlyphAtlas atlases[maxGlyphAtlases];
+	TextLayout layouts[maxTextLayouts];
+	int numLayouts;
+	LONG clock;
+	// Measured from the detectors' thread, drawn from the magnifier's
+	CRITICAL_SECTION lock;
+};
+
+// The one the overlay measures and draws its text with
+extern OverlayTextCache overlayTextCache;
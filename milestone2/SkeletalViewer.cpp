@@ -17,6 +17,9 @@
 #include "SkeletalViewer.h"
 #include "resource.h"
 #include "NuiImpl.h"
+#include "SkeletonRecorder.h"
+#include "DepthPalette.h"
+#include "GestureEventRing.h"
 
 // Global Variables:
 int activeSkeleton = -1;		// The skeleton we care about for gestures
@@ -28,6 +31,9 @@ CSkeletalViewerApp* skeletalViewer = NULL; // This is the skeletal viewer window
 extern BOOL allowMagnifyGestures;
 extern BOOL quit_properly;
 NuiImpl* nui_impl;
+extern DepthPalette depthPalette;
+SkeletonRecorder* skeletonRecorder = NULL;	// Only exists when recording (-record)
+extern char recordPath[MAX_PATH];
 
 // Variables used to deal with the problem that threads might be in a
 // GUI section when the GUI exits, and so we need to preserve the GUI
@@ -37,45 +43,6 @@ BOOL GUI_On = FALSE;
 
 #define INSTANCE_MUTEX_NAME L"SkeletalViewerInstanceCheck"
 
-static const COLORREF g_JointColorTable[NUI_SKELETON_POSITION_COUNT] = 
-{
-	RGB(169, 176, 155), // NUI_SKELETON_POSITION_HIP_CENTER
-	RGB(169, 176, 155), // NUI_SKELETON_POSITION_SPINE
-	RGB(168, 230, 29),  // NUI_SKELETON_POSITION_SHOULDER_CENTER
-	RGB(200, 0,   0),   // NUI_SKELETON_POSITION_HEAD
-	RGB(79,  84,  33),  // NUI_SKELETON_POSITION_SHOULDER_LEFT
-	RGB(84,  33,  42),  // NUI_SKELETON_POSITION_ELBOW_LEFT
-	RGB(255, 126, 0),   // NUI_SKELETON_POSITION_WRIST_LEFT
-	RGB(215,  86, 0),   // NUI_SKELETON_POSITION_HAND_LEFT
-	RGB(33,  79,  84),  // NUI_SKELETON_POSITION_SHOULDER_RIGHT
-	RGB(33,  33,  84),  // NUI_SKELETON_POSITION_ELBOW_RIGHT
-	RGB(77,  109, 243), // NUI_SKELETON_POSITION_WRIST_RIGHT
-	RGB(37,   69, 243), // NUI_SKELETON_POSITION_HAND_RIGHT
-	RGB(77,  109, 243), // NUI_SKELETON_POSITION_HIP_LEFT
-	RGB(69,  33,  84),  // NUI_SKELETON_POSITION_KNEE_LEFT
-	RGB(229, 170, 122), // NUI_SKELETON_POSITION_ANKLE_LEFT
-	RGB(255, 126, 0),   // NUI_SKELETON_POSITION_FOOT_LEFT
-	RGB(181, 165, 213), // NUI_SKELETON_POSITION_HIP_RIGHT
-	RGB(71, 222,  76),  // NUI_SKELETON_POSITION_KNEE_RIGHT
-	RGB(245, 228, 156), // NUI_SKELETON_POSITION_ANKLE_RIGHT
-	RGB(77,  109, 243)  // NUI_SKELETON_POSITION_FOOT_RIGHT
-};
-
-static const COLORREF g_SkeletonColors[NUI_SKELETON_COUNT] =
-{
-	RGB( 255, 0, 0),
-	RGB( 0, 255, 0 ),
-	RGB( 64, 255, 255 ),
-	RGB( 255, 255, 64 ),
-	RGB( 255, 64, 255 ),
-	RGB( 128, 128, 255 )
-};
-
-//lookups for color tinting based on player index
-static const int g_IntensityShiftByPlayerR[] = { 1, 2, 0, 2, 0, 0, 2, 0 };
-static const int g_IntensityShiftByPlayerG[] = { 1, 2, 2, 0, 2, 0, 0, 1 };
-static const int g_IntensityShiftByPlayerB[] = { 1, 0, 2, 2, 0, 2, 0, 2 };
-
 //-------------------------------------------------------------------
 // StartKinectProcessing
 //
@@ -97,6 +64,18 @@ DWORD WINAPI StartKinectProcessing(LPVOID lpParam)
 		gestureDetectors[ii] = new GestureDetector(ii);
 	}
 
+	// Start recording before the sensor starts sending frames
+	if (recordPath[0] != '\0')
+	{
+		skeletonRecorder = new SkeletonRecorder();
+		if (! skeletonRecorder->open(recordPath))
+		{
+			MessageBoxA(NULL, recordPath, "Couldn't open skeleton recording", MB_OK | MB_ICONERROR);
+			delete skeletonRecorder;
+			skeletonRecorder = NULL;
+		}
+	}
+
 	// Start up movement timer and handler
 	MoveAndMagnifyHandler* movementHandler = new MoveAndMagnifyHandler();
 	// Start up the NUI implementation
@@ -130,6 +109,9 @@ DWORD WINAPI StartKinectProcessing(LPVOID lpParam)
 	// And the NUI implementation
 	delete nui_impl;
 	nui_impl = NULL;
+	// Only once the sensor thread is gone
+	delete skeletonRecorder;
+	skeletonRecorder = NULL;
 	
 	return returnval;
 }
@@ -443,10 +425,7 @@ LRESULT CALLBACK CSkeletalViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wPa
 		break;
 	case WM_USER_UPDATE_STATE:
 		{
-			// The LPARAM needs to be a char pointer in this case, so let's poke some holes
-			void* tmp = (void*)lParam;
-			char* charptr = (char*)tmp;
-			::SetDlgItemText( m_hWnd, static_cast<int>(wParam), static_cast<LPCTSTR>(charptr));
+			UpdateGestureStates();
 		}
 		break;
 	case WM_USER_UPDATE_MAGNIFICATION:
@@ -465,12 +444,29 @@ LRESULT CALLBACK CSkeletalViewerApp::WndProc(HWND hWnd, UINT message, WPARAM wPa
 		}
 		break;
 
+	case WM_USER_PRESENT_FRAMES:
+		{
+			PresentFrames();
+		}
+		break;
+
 	case WM_USER_UPDATE_COMBO:
 		{
 			UpdateComboBox();
 		}
 		break;
 
+	case WM_USER_SENSOR_REMOVED:
+		{
+			// Unless it's been torn down already
+			if ( GUI_On )
+			{
+				SV_UnInit();
+				SV_Zero();
+			}
+		}
+		break;
+
 	case WM_COMMAND:
 		{
 			if( HIWORD( wParam ) == CBN_SELCHANGE )
@@ -581,20 +577,8 @@ int CSkeletalViewerApp::MessageBoxResource( UINT nID, UINT nType )
 //-------------------------------------------------------------------
 RGBQUAD CSkeletalViewerApp::Nui_ShortToQuad_Depth( USHORT s )
 {
-	USHORT RealDepth = NuiDepthPixelToDepth(s);
-	USHORT Player    = NuiDepthPixelToPlayerIndex(s);
-
-	// transform 13-bit depth information into an 8-bit intensity appropriate
-	// for display (we disregard information in most significant bit)
-	BYTE intensity = (BYTE)~(RealDepth >> 4);
-
-	// tint the intensity by dividing by per-player values
-	RGBQUAD color;
-	color.rgbRed   = intensity >> g_IntensityShiftByPlayerR[Player];
-	color.rgbGreen = intensity >> g_IntensityShiftByPlayerG[Player];
-	color.rgbBlue  = intensity >> g_IntensityShiftByPlayerB[Player];
-
-	return color;
+	// Whatever colormap the depth view is showing
+	return depthPalette.lookup( s );
 }
 
 void CSkeletalViewerApp::Nui_BlankSkeletonScreen (HWND hWnd, bool getDC )
@@ -609,140 +593,53 @@ void CSkeletalViewerApp::Nui_BlankSkeletonScreen (HWND hWnd, bool getDC )
 	{
 		ReleaseDC( hWnd, hdc );
 	}
-}
-
-void CSkeletalViewerApp::Nui_DrawSkeletonSegment( NUI_SKELETON_DATA * pSkel, int numJoints, ... )
-{
-	va_list vl;
-	va_start(vl,numJoints);
-
-	POINT segmentPositions[NUI_SKELETON_POSITION_COUNT];
-	int segmentPositionsCount = 0;
-
-	DWORD polylinePointCounts[NUI_SKELETON_POSITION_COUNT];
-	int numPolylines = 0;
-	int currentPointCount = 0;
-
-	// Note the loop condition: We intentionally run one iteration beyond the
-	// last element in the joint list, so we can properly end the final polyline.
-	for ( int iJoint = 0; iJoint <= numJoints; iJoint++ )
+	else if ( m_pSkeletonRenderer != NULL )
 	{
-		if ( iJoint < numJoints )
-		{
-			NUI_SKELETON_POSITION_INDEX jointIndex = va_arg( vl, NUI_SKELETON_POSITION_INDEX );
-
-			if ( pSkel->eSkeletonPositionTrackingState[jointIndex] != NUI_SKELETON_POSITION_NOT_TRACKED )
-			{
-				// This joint is tracked: add it to the array of segment positions.            
-				segmentPositions[segmentPositionsCount] = m_Points[jointIndex];
-				segmentPositionsCount++;
-				currentPointCount++;
-
-				// Fully processed the current joint; move on to the next one
-				continue;
-			}
-		}
-
-		// If we fall through to here, we're either beyond the last joint, or
-		// the current joint is not tracked: end the current polyline here.
-		if ( currentPointCount > 1 )
-		{
-			// Current polyline already has at least two points: save the count.
-			polylinePointCounts[numPolylines++] = currentPointCount;
-		}
-		else if ( currentPointCount == 1 )
-		{
-			// Current polyline has only one point: ignore it.
-			segmentPositionsCount--;
-		}
-		currentPointCount = 0;
-	}
-
-#ifdef _DEBUG
-	// We should end up with no more points in segmentPositions than the
-	// original number of joints.
-	assert(segmentPositionsCount <= numJoints);
-
-	int totalPointCount = 0;
-	for (int i = 0; i < numPolylines; i++)
-	{
-		// Each polyline should contain at least two points.
-		assert(polylinePointCounts[i] > 1);
-
-		totalPointCount += polylinePointCounts[i];
-	}
-
-	// Total number of points in all polylines should be the same as number
-	// of points in segmentPositions.
-	assert(totalPointCount == segmentPositionsCount);
-#endif
-
-	if (numPolylines > 0)
-	{
-		PolyPolyline( m_SkeletonDC, segmentPositions, polylinePointCounts, numPolylines );
+		// A new frame; anything left from the last one won't be drawn now
+		m_pSkeletonRenderer->list.clear();
 	}
-
-	va_end(vl);
 }
 
-void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd, int WhichSkeletonColor )
+void CSkeletalViewerApp::Nui_DrawSkeleton( const SkeletonView &skeleton, HWND hWnd, int WhichSkeletonColor )
 {
-	HGDIOBJ hOldObj = SelectObject( m_SkeletonDC, m_Pen[WhichSkeletonColor % m_PensTotal] );
-
 	RECT rct;
 	GetClientRect(hWnd, &rct);
 	int width = rct.right;
 	int height = rct.bottom;
 
-	if ( m_Pen[0] == NULL )
-	{
-		for (int i = 0; i < m_PensTotal; i++)
-		{
-			m_Pen[i] = CreatePen( PS_SOLID, width / 80, g_SkeletonColors[i] );
-		}
-	}
-
-	int i;
-	USHORT depth;
-	for (i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
-	{
-		NuiTransformSkeletonToDepthImage( pSkel->SkeletonPositions[i], &m_Points[i].x, &m_Points[i].y, &depth );
+	// Nothing is drawn until Nui_DrawSkeletons(), so every skeleton's
+	// bones and joints go in together
+	m_pSkeletonRenderer->list.add( skeleton, WhichSkeletonColor, width, height );
+}
 
-		m_Points[i].x = (m_Points[i].x * width) / 320;
-		m_Points[i].y = (m_Points[i].y * height) / 240;
-	}
+void CSkeletalViewerApp::Nui_DrawSkeletons( const NUI_SKELETON_FRAME &SkeletonFrame, HWND hWnd )
+{
+	RECT rct;
+	GetClientRect(hWnd, &rct);
 
-	SelectObject(m_SkeletonDC,m_Pen[WhichSkeletonColor%m_PensTotal]);
+	// The IDs and hitboxes go over the top, so copy down which skeletons
+	// there were before the list is emptied
+	SkeletonDrawList &list = m_pSkeletonRenderer->list;
+	int numSkeletons = list.numSkeletons;
+	int slots[NUI_SKELETON_COUNT];
+	CopyMemory( slots, list.colors, sizeof(slots) );
 
-	Nui_DrawSkeletonSegment(pSkel,4,NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_HEAD);
-	Nui_DrawSkeletonSegment(pSkel,5,NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT);
-	Nui_DrawSkeletonSegment(pSkel,5,NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT);
-	Nui_DrawSkeletonSegment(pSkel,5,NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT);
-	Nui_DrawSkeletonSegment(pSkel,5,NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT);
+	m_pSkeletonRenderer->draw( m_SkeletonDC, rct.right );
 
-	// Draw the joints in a different color
-	for ( i = 0; i < NUI_SKELETON_POSITION_COUNT ; i++ )
+	for (int s = 0; s < numSkeletons; s++)
 	{
-		if ( pSkel->eSkeletonPositionTrackingState[i] != NUI_SKELETON_POSITION_NOT_TRACKED )
+		SkeletonView skeleton( SkeletonFrame, slots[s] );
+		if (nui->m_bAppTracking)
 		{
-			HPEN hJointPen;
-
-			hJointPen = CreatePen( PS_SOLID, 9, g_JointColorTable[i] );
-			hOldObj = SelectObject( m_SkeletonDC, hJointPen );
-
-			MoveToEx( m_SkeletonDC, m_Points[i].x, m_Points[i].y, NULL );
-			LineTo( m_SkeletonDC, m_Points[i].x, m_Points[i].y );
-
-			SelectObject( m_SkeletonDC, hOldObj );
-			DeleteObject( hJointPen );
+			Nui_DrawSkeletonId(skeleton, hWnd, slots[s]);
 		}
-
+		Nui_DrawHitboxes(skeleton, slots[s]);
 	}
+}
 
-	if (nui->m_bAppTracking)
-	{
-		Nui_DrawSkeletonId(pSkel, hWnd, WhichSkeletonColor);
-	}
+void CSkeletalViewerApp::Nui_DrawHitboxes( const SkeletonView &skeleton, int WhichSkeletonColor )
+{
+	HGDIOBJ hOldObj;
 
 	// Draw the gesture hitboxes
 	if (gestureDetectors[WhichSkeletonColor] != NULL)
@@ -754,16 +651,13 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 		// HPEN hCancelPen;
 		// hCancelPen = CreatePen(PS_DOT, 1, RGB(0,0,255));
 		// hOldObj = SelectObject(m_SkeletonDC, hCancelPen);
-		// DrawBox(pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SHOULDER_RIGHT], detectRange/2);
-		// DrawBox(pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SHOULDER_LEFT], detectRange/2);
+		// DrawBox(skeleton.joint(NUI_SKELETON_POSITION_SHOULDER_RIGHT), detectRange/2);
+		// DrawBox(skeleton.joint(NUI_SKELETON_POSITION_SHOULDER_LEFT), detectRange/2);
 		// SelectObject( m_SkeletonDC, hOldObj );
 		// DeleteObject(hCancelPen);
 
-		// Make a new pen for the gesture hitboxes
-		HPEN hGesturePen;
-		// Hard-code to red for now
-		hGesturePen = CreatePen(PS_DASH, 1, RGB(255,0,0));
-		hOldObj = SelectObject(m_SkeletonDC, hGesturePen);
+		// The same pen every time
+		hOldObj = SelectObject(m_SkeletonDC, m_pSkeletonRenderer->hitboxPen());
 
 		// Where we draw the box is going to depend on what gesture state we're in
 		Vector4 headPoint;
@@ -777,11 +671,11 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 		{
 		case OFF:
 			// Draw a detectRange box around the head
-			DrawBox(pSkel->SkeletonPositions[NUI_SKELETON_POSITION_HEAD], detectRange/2);
+			DrawBox(skeleton.joint(NUI_SKELETON_POSITION_HEAD), detectRange/2);
 			break;
 		case SALUTE1:
 			// Up and away from the head, both hands
-			headPoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_HEAD];
+			headPoint = skeleton.joint(NUI_SKELETON_POSITION_HEAD);
 			headPoint.y += saluteUp;
 			if (gestureDetector->hand == RIGHT)
 			{
@@ -794,7 +688,7 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 			DrawBox(headPoint, detectRange/2);
 			break;
 		case SALUTE2:
-			spinePoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+			spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
 			centerPoint = spinePoint;
 			if (gestureDetector->hand == RIGHT)
 			{
@@ -815,7 +709,7 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 			}
 			break;
 		//case BODYCENTER:
-		//	spinePoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+		//	spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
 		//	centerPoint = spinePoint;
 		//	if (gestureDetector->hand == RIGHT)
 		//	{
@@ -832,7 +726,7 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 		case MOVEDOWN:
 		case MOVERIGHT:
 		case MOVELEFT:
-			spinePoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+			spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
 			centerPoint = spinePoint;
 			if (gestureDetector->hand == RIGHT)
 			{
@@ -846,7 +740,7 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 			DrawX(centerPoint);
 			break;
 			//case MOVE:
-			//	spinePoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+			//	spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
 			//	centerPoint = spinePoint;
 			//	if (gestureDetector->hand == RIGHT)
 			//	{
@@ -859,7 +753,7 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 			//	DrawBox(centerPoint, detectRange/2);
 			//	break;
 		// case MAGNIFYCENTER:
-		// 	spinePoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+		// 	spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
 		// 	centerPoint = spinePoint;
 		// 	if (gestureDetector->hand == RIGHT)
 		// 	{
@@ -884,7 +778,7 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 		// 	break;
 		case MAGNIFYUP:
 		case MAGNIFYDOWN:
-			spinePoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+			spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
 			centerPoint = spinePoint;
 			if (gestureDetector->hand == RIGHT)
 			{
@@ -903,7 +797,7 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 			break;
 		case MAGNIFYLEFT:
 		case MAGNIFYRIGHT:
-			spinePoint = pSkel->SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+			spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
 			centerPoint = spinePoint;
 			if (gestureDetector->hand == RIGHT)
 			{
@@ -924,18 +818,17 @@ void CSkeletalViewerApp::Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd,
 
 		// Cleanup
 		SelectObject( m_SkeletonDC, hOldObj );
-		DeleteObject(hGesturePen);
 	}
 }
 
-void CSkeletalViewerApp::Nui_DrawSkeletonId( NUI_SKELETON_DATA * pSkel, HWND hWnd, int WhichSkeletonColor )
+void CSkeletalViewerApp::Nui_DrawSkeletonId( const SkeletonView &skeleton, HWND hWnd, int WhichSkeletonColor )
 {
 	RECT rct;
 	GetClientRect( hWnd, &rct );
 
 	float fx = 0, fy = 0;
 
-	NuiTransformSkeletonToDepthImage( pSkel->Position, &fx, &fy );
+	NuiTransformSkeletonToDepthImage( skeleton.position(), &fx, &fy );
 
 	int skelPosX = (int)( fx * rct.right + 0.5f );
 	int skelPosY = (int)( fy * rct.bottom + 0.5f );
@@ -943,7 +836,7 @@ void CSkeletalViewerApp::Nui_DrawSkeletonId( NUI_SKELETON_DATA * pSkel, HWND hWn
 	WCHAR number[20];
 	size_t length;
 
-	if ( FAILED(StringCchPrintfW(number, ARRAYSIZE(number), L"%d", pSkel->dwTrackingID)) )
+	if ( FAILED(StringCchPrintfW(number, ARRAYSIZE(number), L"%d", skeleton.trackingId())) )
 	{
 		return;
 	}
@@ -972,7 +865,7 @@ void CSkeletalViewerApp::Nui_DrawSkeletonId( NUI_SKELETON_DATA * pSkel, HWND hWn
 }
 
 // Draw a box around a skeletal position
-BOOL CSkeletalViewerApp::DrawBox(Vector4& s_point, FLOAT radius)
+BOOL CSkeletalViewerApp::DrawBox(const Vector4& s_point, FLOAT radius)
 {
 	RECT rct;
 	GetClientRect(GetDlgItem( m_hWnd, IDC_SKELETALVIEW ), &rct);
@@ -1058,15 +951,16 @@ void CSkeletalViewerApp::Nui_DoDoubleBuffer( HWND hWnd, HDC hDC )
 //-------------------------------------------------------------------
 void CSkeletalViewerApp::SV_Zero()
 {
-	ZeroMemory(m_Pen,sizeof(m_Pen));
 	m_SkeletonDC = NULL;
 	m_SkeletonBMP = NULL;
 	m_SkeletonOldObj = NULL;
-	m_PensTotal = 6;
-	ZeroMemory(m_Points,sizeof(m_Points));
+	m_pSkeletonRenderer = NULL;
 	m_bScreenBlanked = false;
 	m_pDrawDepth = NULL;
 	m_pDrawColor = NULL;
+	m_pDepthFrames = NULL;
+	m_pColorFrames = NULL;
+	m_presentPending = 0;
 }
 
 //-------------------------------------------------------------------
@@ -1093,9 +987,15 @@ HRESULT CSkeletalViewerApp::SV_Init()
 
 	ReleaseDC(GetDlgItem(m_hWnd,IDC_SKELETALVIEW), hdc );
 	m_SkeletonOldObj = SelectObject( m_SkeletonDC, m_SkeletonBMP );
+	m_pSkeletonRenderer = new SkeletonRenderer( );
+
+	// The same sizes the sensor's streams are opened at
+	DWORD depthWidth, depthHeight, colorWidth, colorHeight;
+	NuiImageResolutionToSize( depthResolution, depthWidth, depthHeight );
+	NuiImageResolutionToSize( colorResolution, colorWidth, colorHeight );
 
 	m_pDrawDepth = new DrawDevice( );
-	result = m_pDrawDepth->Initialize( GetDlgItem( m_hWnd, IDC_DEPTHVIEWER ), m_pD2DFactory, 320, 240, 320 * 4 );
+	result = m_pDrawDepth->Initialize( GetDlgItem( m_hWnd, IDC_DEPTHVIEWER ), m_pD2DFactory, depthWidth, depthHeight, depthWidth * 4 );
 	if ( !result )
 	{
 		MessageBoxResource( IDS_ERROR_DRAWDEVICE, MB_OK | MB_ICONHAND );
@@ -1103,16 +1003,22 @@ HRESULT CSkeletalViewerApp::SV_Init()
 	}
 
 	m_pDrawColor = new DrawDevice( );
-	result = m_pDrawColor->Initialize( GetDlgItem( m_hWnd, IDC_VIDEOVIEW ), m_pD2DFactory, 640, 480, 640 * 4 );
+	result = m_pDrawColor->Initialize( GetDlgItem( m_hWnd, IDC_VIDEOVIEW ), m_pD2DFactory, colorWidth, colorHeight, colorWidth * 4 );
 	if ( !result )
 	{
 		MessageBoxResource( IDS_ERROR_DRAWDEVICE, MB_OK | MB_ICONHAND );
 		return E_FAIL;
 	}
 
-	// Set up the mutex to allow clean shutdown (FALSE means don't start off with ownership)
-	num_GUIers_mutex = CreateMutex(NULL, FALSE, NULL);
-	num_GUIers = 0;
+	m_pDepthFrames = new FrameTripleBuffer( depthWidth * depthHeight * 4 );
+	m_pColorFrames = new FrameTripleBuffer( colorWidth * colorHeight * 4 );
+	m_presentPending = 0;
+
+	// Anything still pending from last time was never drained
+	gestureEvents.clearWake();
+
+	// Let the other threads in
+	m_guiGuard.open();
 	GUI_On = TRUE;
 
 	return hr;
@@ -1125,36 +1031,19 @@ HRESULT CSkeletalViewerApp::SV_Init()
 //-------------------------------------------------------------------
 void CSkeletalViewerApp::SV_UnInit( )
 {
-	// Wait until we have no GUIers before unIniting
+	// Wait until we have no GUIers before unIniting, however long that
+	// takes; nothing below is freed while anyone's still using it
 	GUI_On = FALSE;
-	unsigned int timesWaiting = 0;
-	unsigned int MAX_TIMES_TO_WAIT = 65536;
-	while (1)
-	{
-		WaitForSingleObject(num_GUIers_mutex, INFINITE);
-		if (num_GUIers == 0 || (timesWaiting > MAX_TIMES_TO_WAIT))
-		{
-			ReleaseMutex(num_GUIers_mutex);
-			break;
-		}
-		else
-		{
-			timesWaiting++;
-		}
-	}
-	CloseHandle(num_GUIers_mutex);
+	m_guiGuard.close();
 	
 	SelectObject( m_SkeletonDC, m_SkeletonOldObj );
 	DeleteDC( m_SkeletonDC );
 	DeleteObject( m_SkeletonBMP );
 	
-	if ( NULL != m_Pen[0] )
+	if ( NULL != m_pSkeletonRenderer )
 	{
-		for ( int i = 0; i < NUI_SKELETON_COUNT; i++ )
-		{
-			DeleteObject( m_Pen[i] );
-		}
-		ZeroMemory( m_Pen, sizeof(m_Pen) );
+		delete m_pSkeletonRenderer;
+		m_pSkeletonRenderer = NULL;
 	}
 
 	if ( NULL != m_hFontSkeletonId )
@@ -1169,32 +1058,117 @@ void CSkeletalViewerApp::SV_UnInit( )
 
 	delete m_pDrawColor;
 	m_pDrawColor = NULL;    
+
+	// Nobody's publishing any more, and any WM_USER_PRESENT_FRAMES still
+	// in the queue will find these gone
+	delete m_pDepthFrames;
+	m_pDepthFrames = NULL;
+
+	delete m_pColorFrames;
+	m_pColorFrames = NULL;
+}
+
+//-------------------------------------------------------------------
+// PublishFrame
+//
+// Hand the frame just written into frames' write buffer to the GUI
+// thread.  Called from the sensor thread while counted as a GUIer, and
+// never waits: if the GUI is behind, it just draws the newer frame.
+//-------------------------------------------------------------------
+void CSkeletalViewerApp::PublishFrame( FrameTripleBuffer * frames )
+{
+	frames->publish();
+
+	// One message is enough however many frames arrive before it's handled
+	if ( InterlockedExchange( &m_presentPending, 1 ) == 0 )
+	{
+		PostMessageW( m_hWnd, WM_USER_PRESENT_FRAMES, 0, 0 );
+	}
+}
+
+//-------------------------------------------------------------------
+// PresentFrames
+//
+// Draw the newest depth and color frames on the GUI thread
+//-------------------------------------------------------------------
+void CSkeletalViewerApp::PresentFrames()
+{
+	// Clear first, so a frame published while we draw posts a new message
+	InterlockedExchange( &m_presentPending, 0 );
+
+	PresentFrame( m_pDepthFrames, m_pDrawDepth );
+	PresentFrame( m_pColorFrames, m_pDrawColor );
+}
+
+void CSkeletalViewerApp::PresentFrame( FrameTripleBuffer * frames, DrawDevice * drawDevice )
+{
+	if ( frames == NULL || drawDevice == NULL )
+	{
+		return;
+	}
+
+	if ( frames->acquire() )
+	{
+		drawDevice->Draw( frames->readBuffer(), frames->frameBytes );
+		frames->presented();
+	}
+}
+
+//-------------------------------------------------------------------
+// UpdateGestureStates
+//
+// Drain the gesture state changes, and show the newest one for the
+// active skeleton and for everyone else
+//-------------------------------------------------------------------
+void CSkeletalViewerApp::UpdateGestureStates()
+{
+	// Clear first, so a change pushed while we drain posts a new message
+	gestureEvents.clearWake();
+
+	int activeState = -1;
+	int otherState = -1;
+	GestureEvent event;
+	while ( gestureEvents.pop( event ) )
+	{
+		if ( event.skeletonId == activeSkeleton )
+		{
+			activeState = event.newState;
+		}
+		else
+		{
+			otherState = event.newState;
+		}
+	}
+
+	if ( activeState >= 0 )
+	{
+		::SetDlgItemText( m_hWnd, IDC_STATE, GestureStateName( (GestureStateEnum) activeState ) );
+	}
+	if ( otherState >= 0 )
+	{
+		::SetDlgItemText( m_hWnd, IDC_STATE2, GestureStateName( (GestureStateEnum) otherState ) );
+	}
 }
 
 //-------------------------------------------------------------------
 // increment_num_GUIers
 //
-// Increment the num_GUIers variable, mutex-protected
+// Count this thread as using the GUI.  Returns 0 if the GUI has gone
+// away, in which case don't touch it, and don't decrement either.
 //-------------------------------------------------------------------
 int CSkeletalViewerApp::increment_num_GUIers( )
 {
-	WaitForSingleObject(num_GUIers_mutex, INFINITE);
-	num_GUIers++;
-	ReleaseMutex(num_GUIers_mutex);
-
-	return 1;
+	return m_guiGuard.enter() ? 1 : 0;
 }
 
 //-------------------------------------------------------------------
 // decrement_num_GUIers
 //
-// Decrement the num_GUIers variable, mutex-protected
+// Done with the GUI, after a successful increment_num_GUIers
 //-------------------------------------------------------------------
 int CSkeletalViewerApp::decrement_num_GUIers( )
 {
-	WaitForSingleObject(num_GUIers_mutex, INFINITE);
-	num_GUIers--;
-	ReleaseMutex(num_GUIers_mutex);
+	m_guiGuard.leave();
 
 	return 1;
 }
@@ -12,8 +12,12 @@
 #include "NuiApi.h"
 #include "DrawDevice.h"
 #include "GestureDetector.h"
+#include "SkeletonView.h"
+#include "SkeletonRenderer.h"
 #include "MoveAndMagnifyHandler.h"
 #include "NuiImpl.h"
+#include "FrameTripleBuffer.h"
+#include "GuiGuard.h"
 
 #define SZ_APPDLG_WINDOW_CLASS          _T("SkeletalViewerAppDlgWndClass")
 #define WM_USER_UPDATE_FPS              WM_USER
@@ -27,6 +31,8 @@
 #define WM_USER_UPDATE_MAGNIFICATION    WM_USER+6
 #define WM_USER_UPDATE_MOVEX            WM_USER+7
 #define WM_USER_UPDATE_MOVEY            WM_USER+8
+#define WM_USER_PRESENT_FRAMES          WM_USER+9
+#define WM_USER_SENSOR_REMOVED          WM_USER+10
 
 DWORD WINAPI StartKinectProcessing(LPVOID lpParam);
 
@@ -49,10 +55,10 @@ public:
 	void                    SV_UnInit( );
 	void                    Nui_BlankSkeletonScreen( HWND hWnd, bool getDC );
 	void                    Nui_DoDoubleBuffer(HWND hWnd,HDC hDC);
-	void                    Nui_DrawSkeleton( NUI_SKELETON_DATA * pSkel, HWND hWnd, int WhichSkeletonColor );
-	void                    Nui_DrawSkeletonId( NUI_SKELETON_DATA * pSkel, HWND hWnd, int WhichSkeletonColor );
-
-	void                    Nui_DrawSkeletonSegment( NUI_SKELETON_DATA * pSkel, int numJoints, ... );
+	void                    Nui_DrawSkeleton( const SkeletonView &skeleton, HWND hWnd, int WhichSkeletonColor );
+	void                    Nui_DrawSkeletonId( const SkeletonView &skeleton, HWND hWnd, int WhichSkeletonColor );
+	/* Draws every skeleton Nui_DrawSkeleton() was given this frame */
+	void                    Nui_DrawSkeletons( const NUI_SKELETON_FRAME &SkeletonFrame, HWND hWnd );
 	/* void                    Nui_SetApplicationTracking(bool applicationTracks); */
 	/* void                    Nui_SetTrackedSkeletons(int skel1, int skel2); */
 
@@ -71,12 +77,14 @@ public:
 	/* Added for remote startup */
 	int CSkeletalViewerApp::DisplayWindow(HINSTANCE hInstance, int nCmdShow);
 
-	/* Mutex functions */
-	/* Technically, this could be made into its own class with
-	 * overloaded operators, but this is easier for right now. */
+	/* GUI liveness, see GuiGuard */
+	/* increment_num_GUIers returns 0 if the GUI is gone */
 	int CSkeletalViewerApp::decrement_num_GUIers( );
 	int CSkeletalViewerApp::increment_num_GUIers( );
 
+	/* Sensor-thread side of the frame hand-off */
+	void                    PublishFrame( FrameTripleBuffer * frames );
+
 private:
 	void UpdateComboBox();
 	void ClearComboBox();
@@ -84,6 +92,10 @@ private:
 	void UpdateTrackingComboBoxes();
 	void UpdateTrackingFromComboBoxes();
 
+	void PresentFrames();
+	void UpdateGestureStates();
+	void PresentFrame( FrameTripleBuffer * frames, DrawDevice * drawDevice );
+
 	NuiImpl*                nui;
 	bool                    m_fUpdatingUi;
 	TCHAR                   m_szAppTitle[256];    // Application title
@@ -111,13 +123,16 @@ private:
 	HFONT         m_hFontFPS;
 	HFONT		  m_smallFontFPS;
 	HFONT         m_hFontSkeletonId;
-	HPEN          m_Pen[NUI_SKELETON_COUNT];
 	HDC           m_SkeletonDC;
 	HBITMAP       m_SkeletonBMP;
 	HGDIOBJ       m_SkeletonOldObj;
-	int           m_PensTotal;
-	POINT         m_Points[NUI_SKELETON_POSITION_COUNT];
-	RGBQUAD       m_rgbWk[640*480];
+	// This frame's skeletons, and the pens they're drawn with
+	SkeletonRenderer * m_pSkeletonRenderer;
+	// Finished frames waiting for the GUI thread to draw them
+	FrameTripleBuffer * m_pDepthFrames;
+	FrameTripleBuffer * m_pColorFrames;
+	// Set while a WM_USER_PRESENT_FRAMES is on its way, so we only post one
+	volatile LONG m_presentPending;
 	/* DWORD         m_LastSkeletonFoundTime; */
 	bool          m_bScreenBlanked;
 	/* bool          m_bAppTracking; */
@@ -128,13 +143,14 @@ private:
 	/* DWORD         m_TrackedSkeletonIds[NUI_SKELETON_MAX_TRACKED_COUNT]; */
 	ULONG_PTR     m_GdiplusToken;
 
+	// Draw the boxes the hand has to get to for the skeleton's next gesture
+	void Nui_DrawHitboxes( const SkeletonView &skeleton, int WhichSkeletonColor );
 	// Draw a box around a skeletal position
-	BOOL CSkeletalViewerApp::DrawBox(Vector4& s_point, FLOAT radius);
+	BOOL CSkeletalViewerApp::DrawBox(const Vector4& s_point, FLOAT radius);
 	void CSkeletalViewerApp::DrawX(Vector4& s_point);
 
-	// Mutex variables
-	int num_GUIers;
-	HANDLE num_GUIers_mutex;
+	// Who's still using the GUI from other threads
+	GuiGuard m_guiGuard;
 };
 
 
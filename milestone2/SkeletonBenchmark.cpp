@@ -0,0 +1,735 @@
+#include "Benchmark.h"
+#include "BenchmarkFixtures.h"
+#include "JointSmoother.h"
+#include "HandPredictor.h"
+#include "JointHistory.h"
+#include "SkeletonView.h"
+#include "SkeletonDrawList.h"
+#include <math.h>
+
+// Disable "conditional expression is constant" warning
+#pragma warning( disable : 4127 )
+
+/*** Joint smoothing ***/
+
+// The test trajectory: still, then moving at jointSpeed, then still again
+const int stillFrames = 60;
+const int movingFrames = 30;
+const FLOAT jointSpeed = 1.0f;
+
+// Where the joints really are in a given frame (x only)
+static FLOAT TrajectoryX(int frame)
+{
+	if (frame < stillFrames)
+	{
+		return 0;
+	}
+	if (frame < stillFrames + movingFrames)
+	{
+		return jointSpeed * (frame - stillFrames) / 30.0f;
+	}
+	return jointSpeed * movingFrames / 30.0f;
+}
+
+// One tracked skeleton with every joint at x (plus noise), the rest empty
+static void MakeNoisyFrame(NUI_SKELETON_FRAME &SkeletonFrame, FLOAT x, DWORD frameNumber, DWORD &noise)
+{
+	ZeroMemory(&SkeletonFrame, sizeof(SkeletonFrame));
+	SkeletonFrame.dwFrameNumber = frameNumber;
+	SkeletonFrame.liTimeStamp.QuadPart = (frameNumber * 1000) / 30;
+	NUI_SKELETON_DATA &skeleton = SkeletonFrame.SkeletonData[0];
+	skeleton.eTrackingState = NUI_SKELETON_TRACKED;
+	skeleton.dwTrackingID = 1;
+	for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+	{
+		noise = noise * 1103515245 + 12345;
+		FLOAT n = jointNoise * (((noise >> 16) % 2001) / 1000.0f - 1.0f);
+		skeleton.eSkeletonPositionTrackingState[j] = NUI_SKELETON_POSITION_TRACKED;
+		skeleton.SkeletonPositions[j].x = x + n;
+		skeleton.SkeletonPositions[j].y = 0;
+		skeleton.SkeletonPositions[j].z = bodyZ;
+		skeleton.SkeletonPositions[j].w = 1;
+	}
+}
+
+// Jitter while still (after settling) and lag while moving, for one joint
+static void ReportSmoothing(FILE* results, const char* name, int joint)
+{
+	JointSmoother smoother;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	DWORD noise = 12345;
+	double rawSquares = 0;
+	double smoothSquares = 0;
+	int stillSamples = 0;
+	double lagSum = 0;
+	int lagSamples = 0;
+
+	for (int frame = 0; frame < 2 * stillFrames + movingFrames; frame++)
+	{
+		FLOAT truth = TrajectoryX(frame);
+		MakeNoisyFrame(SkeletonFrame, truth, frame, noise);
+		double raw = SkeletonFrame.SkeletonData[0].SkeletonPositions[joint].x;
+		smoother.smooth(SkeletonFrame);
+		double smoothed = SkeletonFrame.SkeletonData[0].SkeletonPositions[joint].x;
+
+		// The second half of the first still part, so the filter has settled
+		if (frame >= stillFrames / 2 && frame < stillFrames)
+		{
+			rawSquares += (raw - truth) * (raw - truth);
+			smoothSquares += (smoothed - truth) * (smoothed - truth);
+			stillSamples++;
+		}
+		// The second half of the move, once it's up to speed
+		if (frame >= stillFrames + movingFrames / 2 && frame < stillFrames + movingFrames)
+		{
+			lagSum += (truth - smoothed) / jointSpeed;
+			lagSamples++;
+		}
+	}
+
+	fprintf(results, "%-24s jitter %5.2f mm -> %5.2f mm  lag at %.1f m/s %6.1f ms\n", name,
+		1000 * sqrt(rawSquares / stillSamples), 1000 * sqrt(smoothSquares / stillSamples),
+		jointSpeed, 1000 * lagSum / lagSamples);
+}
+
+static void RunSmoothingBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	ReportSmoothing(results, "hand", NUI_SKELETON_POSITION_HAND_RIGHT);
+	ReportSmoothing(results, "elbow", NUI_SKELETON_POSITION_ELBOW_RIGHT);
+	ReportSmoothing(results, "spine", NUI_SKELETON_POSITION_SPINE);
+
+	// The two kernels should agree (up to rounding in the divide)
+	JointSmoother scalar;
+	JointSmoother simd;
+	scalar.useSSE = FALSE;
+	simd.useSSE = TRUE;
+	NUI_SKELETON_FRAME scalarFrame;
+	NUI_SKELETON_FRAME simdFrame;
+	DWORD noise = 12345;
+	double maxDifference = 0;
+	for (int frame = 0; frame < 2 * stillFrames + movingFrames; frame++)
+	{
+		MakeNoisyFrame(scalarFrame, TrajectoryX(frame), frame, noise);
+		simdFrame = scalarFrame;
+		scalar.smooth(scalarFrame);
+		simd.smooth(simdFrame);
+		for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+		{
+			double difference = fabs(scalarFrame.SkeletonData[0].SkeletonPositions[j].x - simdFrame.SkeletonData[0].SkeletonPositions[j].x);
+			if (difference > maxDifference)
+			{
+				maxDifference = difference;
+			}
+		}
+	}
+	fprintf(results, "SSE against scalar       max difference %g m%s\n", maxDifference,
+		(maxDifference < 1e-5) ? "" : "  MISMATCH");
+
+	// Cost with all six skeletons tracked
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	for (int k = 0; k < 2; k++)
+	{
+		JointSmoother smoother;
+		smoother.useSSE = (k == 1);
+		NUI_SKELETON_FRAME SkeletonFrame;
+		timer.reset();
+		for (int frame = 0; frame < benchmarkFrames; frame++)
+		{
+			MakeFrame(SkeletonFrame, restPose, frame);
+			timer.start();
+			smoother.smooth(SkeletonFrame);
+			timer.stop();
+		}
+		timer.report(results, smoother.useSSE ? "JointSmoother SSE" : "JointSmoother scalar");
+	}
+}
+
+/*** Hand prediction ***/
+
+// The hand sweeps strokeLength side to side in strokeSeconds, then rests
+// for pauseSeconds at each end, for predictionFrames frames at 30 fps
+const int predictionFrames = 600;
+const double strokeLength = 0.4;
+const double strokeSeconds = 0.6;
+const double pauseSeconds = 0.4;
+// Lags searched for the best fit, in ms
+const int minSearchedLag = -150;
+const int maxSearchedLag = 250;
+// How old a frame is by the time we get it
+const double sensorLatencyMs = 33.0;
+
+// Where the hand really is at time t, moving with minimum jerk
+static double SweepX(double t)
+{
+	double period = strokeSeconds + pauseSeconds;
+	int stroke = (int) (t / period);
+	double s = (t - stroke * period) / strokeSeconds;
+	if (s > 1)
+	{
+		s = 1;
+	}
+	double progress = s * s * s * (10 - 15 * s + 6 * s * s);
+	return (stroke % 2 == 0) ? strokeLength * progress : strokeLength * (1 - progress);
+}
+
+// Runs the sweep through smoothing (and the predictor, if there is one) and
+// reports how far behind the true path the hand is, how far off it is from
+// where the hand is right now, how far it overshoots each stop, and how
+// much it shakes once it's settled at a stop
+static void ReportPrediction(FILE* results, const char* name, HandPredictor* predictor)
+{
+	JointSmoother smoother;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	DWORD noise = 12345;
+	static double seen[predictionFrames];
+	const int joint = NUI_SKELETON_POSITION_HAND_RIGHT;
+
+	for (int frame = 0; frame < predictionFrames; frame++)
+	{
+		MakeNoisyFrame(SkeletonFrame, (FLOAT) SweepX(frame / 30.0 - sensorLatencyMs / 1000), frame, noise);
+		smoother.smooth(SkeletonFrame);
+		if (predictor != NULL)
+		{
+			predictor->predict(SkeletonFrame);
+		}
+		seen[frame] = SkeletonFrame.SkeletonData[0].SkeletonPositions[joint].x;
+	}
+
+	// Skip the first stroke while the filters settle
+	int firstFrame = (int) ((strokeSeconds + pauseSeconds) * 30);
+	double bestSquares = -1;
+	int bestLag = 0;
+	double nowSquares = 0;
+	for (int lag = minSearchedLag; lag <= maxSearchedLag; lag++)
+	{
+		double squares = 0;
+		for (int frame = firstFrame; frame < predictionFrames; frame++)
+		{
+			double error = seen[frame] - SweepX(frame / 30.0 - lag / 1000.0);
+			squares += error * error;
+		}
+		if (bestSquares < 0 || squares < bestSquares)
+		{
+			bestSquares = squares;
+			bestLag = lag;
+		}
+		if (lag == 0)
+		{
+			nowSquares = squares;
+		}
+	}
+
+	double overshoot = 0;
+	double restSquares = 0;
+	int restSamples = 0;
+	for (int frame = firstFrame; frame < predictionFrames; frame++)
+	{
+		double end = (SweepX(frame / 30.0) > strokeLength / 2) ? strokeLength : 0;
+		double beyond = (end > 0) ? seen[frame] - end : end - seen[frame];
+		if (beyond > overshoot)
+		{
+			overshoot = beyond;
+		}
+		// The second half of each pause
+		double period = strokeSeconds + pauseSeconds;
+		double t = frame / 30.0;
+		if (t - period * floor(t / period) > strokeSeconds + pauseSeconds / 2)
+		{
+			restSquares += (seen[frame] - end) * (seen[frame] - end);
+			restSamples++;
+		}
+	}
+
+	int samples = predictionFrames - firstFrame;
+	fprintf(results, "%-28s lag %4d ms  error %5.1f mm  overshoot %5.1f mm  jitter %4.2f mm\n", name,
+		bestLag, 1000 * sqrt(nowSquares / samples), 1000 * overshoot, 1000 * sqrt(restSquares / restSamples));
+}
+
+static void RunPredictionBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	ReportPrediction(results, "smoothed only", NULL);
+
+	static const FLOAT horizons[] = { 33.0f, 50.0f, 66.0f };
+	for (int style = Velocity_Prediction; style <= Acceleration_Prediction; style++)
+	{
+		for (int k = 0; k < ARRAYSIZE(horizons); k++)
+		{
+			HandPredictor predictor;
+			predictor.style = (Prediction_Style) style;
+			predictor.horizonMs = horizons[k];
+			char name[64];
+			sprintf_s(name, sizeof(name), "%s %2.0f ms ahead",
+				(style == Velocity_Prediction) ? "velocity" : "acceleration", horizons[k]);
+			ReportPrediction(results, name, &predictor);
+		}
+	}
+
+	// Cost with all six skeletons tracked
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	HandPredictor predictor;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		MakeFrame(SkeletonFrame, restPose, frame);
+		timer.start();
+		predictor.predict(SkeletonFrame);
+		timer.stop();
+	}
+	timer.report(results, "HandPredictor");
+}
+
+/*** Joint history ***/
+
+// A hand moving across at a steady speed, then speeding up, which the
+// history should give back the velocity, acceleration and mean of
+static void CheckJointHistory(FILE* results)
+{
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	const FLOAT speed = 0.5f;
+	const FLOAT pull = 2.0f;
+	const int steadyFrames = 40;
+	const int frameTicks = 10000000 / 30;
+	JointHistory history;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	FLOAT x[steadyFrames + 3];
+	int failures = 0;
+	for (int frame = 0; frame < steadyFrames + 3; frame++)
+	{
+		FLOAT t = frame / 30.0f;
+		FLOAT late = (frame < steadyFrames) ? 0 : (frame - steadyFrames + 1) / 30.0f;
+		x[frame] = speed * t + 0.5f * pull * late * late;
+		MakeFrame(SkeletonFrame, restPose, frame);
+		SkeletonFrame.SkeletonData[0].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].x = x[frame];
+		history.add(SkeletonFrame, (long long) frame * frameTicks);
+
+		if (frame == steadyFrames - 1)
+		{
+			Vector4 velocity = history.velocity(0, NUI_SKELETON_POSITION_HAND_RIGHT);
+			Vector4 acceleration = history.acceleration(0, NUI_SKELETON_POSITION_HAND_RIGHT);
+			double sum = 0;
+			for (int f = steadyFrames - jointHistoryFrames; f < steadyFrames; f++)
+			{
+				sum += x[f];
+			}
+			FLOAT mean = history.mean(0, NUI_SKELETON_POSITION_HAND_RIGHT).x;
+			if (history.frames(0) != jointHistoryFrames || fabs(velocity.x - speed) > 0.01f
+				|| fabs(acceleration.x) > 0.05f || fabs(mean - sum / jointHistoryFrames) > 0.001f
+				|| history.position(0, NUI_SKELETON_POSITION_HAND_RIGHT, 5).x != x[frame - 5])
+			{
+				fprintf(results, "%-24s FAILED: %.3f m/s, %.3f m/s/s, mean %.4f not %.4f\n", "steady hand",
+					velocity.x, acceleration.x, mean, sum / jointHistoryFrames);
+				failures++;
+			}
+		}
+	}
+	Vector4 acceleration = history.acceleration(0, NUI_SKELETON_POSITION_HAND_RIGHT);
+	if (fabs(acceleration.x - pull) > 0.05f)
+	{
+		fprintf(results, "%-24s FAILED: %.3f m/s/s, not %.3f\n", "speeding up", acceleration.x, pull);
+		failures++;
+	}
+
+	// Someone else in the same slot starts over
+	SkeletonFrame.SkeletonData[0].dwTrackingID = 99;
+	history.add(SkeletonFrame, (long long) (steadyFrames + 3) * frameTicks);
+	Vector4 velocity = history.velocity(0, NUI_SKELETON_POSITION_HAND_RIGHT);
+	if (history.frames(0) != 1 || velocity.x != 0)
+	{
+		fprintf(results, "%-24s FAILED: %d frames kept\n", "new tracking ID", history.frames(0));
+		failures++;
+	}
+	fprintf(results, "%-24s %s\n", "history checks", CheckResult(failures == 0));
+}
+
+// What the live code used to do every frame, copying the whole frame so
+// the next one can be compared with it, against adding it to the history
+static void RunJointHistoryBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	CheckJointHistory(results);
+
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	const int historyFrames = 64;
+	NUI_SKELETON_FRAME* frames = new NUI_SKELETON_FRAME[historyFrames];
+	for (int f = 0; f < historyFrames; f++)
+	{
+		MakeFrame(frames[f], restPose, f);
+	}
+
+	NUI_SKELETON_FRAME prevFrame = frames[0];
+	volatile FLOAT sink = 0;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		const NUI_SKELETON_FRAME &SkeletonFrame = frames[frame % historyFrames];
+		timer.start();
+		FLOAT moved = 0;
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			moved += SkeletonFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].x
+				- prevFrame.SkeletonData[i].SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT].x;
+		}
+		prevFrame = SkeletonFrame;
+		timer.stop();
+		sink += moved;
+	}
+	timer.report(results, "previous frame copy");
+	fprintf(results, "%-24s %lu bytes copied per frame\n", "", (unsigned long) sizeof(NUI_SKELETON_FRAME));
+
+	JointHistory history;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		const NUI_SKELETON_FRAME &SkeletonFrame = frames[frame % historyFrames];
+		timer.start();
+		history.add(SkeletonFrame, (long long) frame * 10000000 / 30);
+		FLOAT moved = 0;
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			moved += history.displacement(i, NUI_SKELETON_POSITION_HAND_RIGHT, 1).x;
+		}
+		timer.stop();
+		sink += moved;
+	}
+	timer.report(results, "JointHistory");
+	fprintf(results, "%-24s %lu bytes copied per frame, %lu held\n", "",
+		(unsigned long) (NUI_SKELETON_COUNT * NUI_SKELETON_POSITION_COUNT * sizeof(Vector4)),
+		(unsigned long) (NUI_SKELETON_COUNT * sizeof(SkeletonHistory)));
+
+	delete [] frames;
+}
+
+/*** Skeleton views ***/
+
+// Everything detect() reads from a skeleton, taken the way it used to be:
+// the whole skeleton copied out of the frame, then the joints by value
+static FLOAT ReadCopied(const NUI_SKELETON_FRAME &SkeletonFrame, int id)
+{
+	NUI_SKELETON_DATA SkeletonData = SkeletonFrame.SkeletonData[id];
+	Vector4 headPoint = SkeletonData.SkeletonPositions[NUI_SKELETON_POSITION_HEAD];
+	Vector4 handPoint = SkeletonData.SkeletonPositions[NUI_SKELETON_POSITION_HAND_RIGHT];
+	Vector4 spinePoint = SkeletonData.SkeletonPositions[NUI_SKELETON_POSITION_SPINE];
+	return (headPoint.x - handPoint.x) + (spinePoint.z - handPoint.z);
+}
+
+// And through a view, which leaves everything where it is
+static FLOAT ReadViewed(const NUI_SKELETON_FRAME &SkeletonFrame, int id)
+{
+	SkeletonView skeleton(SkeletonFrame, id);
+	const Vector4 &headPoint = skeleton.joint(NUI_SKELETON_POSITION_HEAD);
+	const Vector4 &handPoint = skeleton.joint(NUI_SKELETON_POSITION_HAND_RIGHT);
+	const Vector4 &spinePoint = skeleton.joint(NUI_SKELETON_POSITION_SPINE);
+	return (headPoint.x - handPoint.x) + (spinePoint.z - handPoint.z);
+}
+
+static void RunSkeletonViewBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	NUI_SKELETON_FRAME SkeletonFrame;
+	MakeFrame(SkeletonFrame, restPose, 0);
+	// Called through a pointer, so neither gets folded into the loop
+	FLOAT (* volatile reads[2])(const NUI_SKELETON_FRAME &, int) = { ReadCopied, ReadViewed };
+	static const char* const names[2] = { "skeleton copies", "skeleton views" };
+	volatile FLOAT sink = 0;
+	for (int k = 0; k < 2; k++)
+	{
+		timer.reset();
+		for (int frame = 0; frame < benchmarkFrames; frame++)
+		{
+			timer.start();
+			FLOAT sum = 0;
+			for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+			{
+				sum += reads[k](SkeletonFrame, i);
+			}
+			timer.stop();
+			sink += sum;
+		}
+		timer.report(results, names[k]);
+	}
+	fprintf(results, "%-24s %lu bytes of skeleton copied per frame by detect() before, none now\n", "",
+		(unsigned long) (NUI_SKELETON_COUNT * sizeof(NUI_SKELETON_DATA)));
+}
+
+/*** Skeleton drawing ***/
+
+// What one skeleton's drawing comes to, however it was worked out
+struct DrawnSkeleton
+{
+	POINT points[maxSkeletonBonePoints];
+	DWORD lineCounts[maxSkeletonPolylines];
+	int numPoints;
+	int numLines;
+	POINT dots[NUI_SKELETON_POSITION_COUNT];
+	int numDots;
+};
+
+// The skeleton view's old Nui_DrawSkeletonSegment(), with the PolyPolyline
+// it ended in replaced by adding on to drawn
+static void OldDrawSkeletonSegment(const SkeletonView &skeleton, const POINT* projected, DrawnSkeleton &drawn, int numJoints, ...)
+{
+	va_list vl;
+	va_start(vl,numJoints);
+
+	POINT segmentPositions[NUI_SKELETON_POSITION_COUNT];
+	int segmentPositionsCount = 0;
+
+	DWORD polylinePointCounts[NUI_SKELETON_POSITION_COUNT];
+	int numPolylines = 0;
+	int currentPointCount = 0;
+
+	for ( int iJoint = 0; iJoint <= numJoints; iJoint++ )
+	{
+		if ( iJoint < numJoints )
+		{
+			// Enums go through ... as ints
+			NUI_SKELETON_POSITION_INDEX jointIndex = (NUI_SKELETON_POSITION_INDEX) va_arg( vl, int );
+
+			if ( skeleton.hasJoint( jointIndex ) )
+			{
+				segmentPositions[segmentPositionsCount] = projected[jointIndex];
+				segmentPositionsCount++;
+				currentPointCount++;
+				continue;
+			}
+		}
+
+		if ( currentPointCount > 1 )
+		{
+			polylinePointCounts[numPolylines++] = currentPointCount;
+		}
+		else if ( currentPointCount == 1 )
+		{
+			segmentPositionsCount--;
+		}
+		currentPointCount = 0;
+	}
+
+	if (numPolylines > 0)
+	{
+		CopyMemory(&drawn.points[drawn.numPoints], segmentPositions, segmentPositionsCount * sizeof(POINT));
+		CopyMemory(&drawn.lineCounts[drawn.numLines], polylinePointCounts, numPolylines * sizeof(DWORD));
+		drawn.numPoints += segmentPositionsCount;
+		drawn.numLines += numPolylines;
+	}
+
+	va_end(vl);
+}
+
+// The old Nui_DrawSkeleton(), one skeleton at a time
+static void OldDrawSkeleton(const SkeletonView &skeleton, int width, int height, DrawnSkeleton &drawn)
+{
+	POINT projected[NUI_SKELETON_POSITION_COUNT];
+	USHORT depth;
+	for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+	{
+		NuiTransformSkeletonToDepthImage( skeleton.joint(i), &projected[i].x, &projected[i].y, &depth );
+
+		projected[i].x = (projected[i].x * width) / 320;
+		projected[i].y = (projected[i].y * height) / 240;
+	}
+
+	drawn.numPoints = 0;
+	drawn.numLines = 0;
+	OldDrawSkeletonSegment(skeleton,projected,drawn,4,NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_HEAD);
+	OldDrawSkeletonSegment(skeleton,projected,drawn,5,NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT);
+	OldDrawSkeletonSegment(skeleton,projected,drawn,5,NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT);
+	OldDrawSkeletonSegment(skeleton,projected,drawn,5,NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT);
+	OldDrawSkeletonSegment(skeleton,projected,drawn,5,NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT);
+
+	drawn.numDots = 0;
+	for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+	{
+		if ( skeleton.hasJoint( i ) )
+		{
+			drawn.dots[drawn.numDots++] = projected[i];
+		}
+	}
+}
+
+// Six skeletons spread across the view, with joints dropping in and out
+static void MakeDrawingFrame(NUI_SKELETON_FRAME &SkeletonFrame, DWORD &noise)
+{
+	static const HandPose restPose = { HANDS_AT_REST, 1 };
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		NUI_SKELETON_DATA &skeleton = SkeletonFrame.SkeletonData[i];
+		MakeSkeleton(skeleton, (i - 2.5f) * 0.5f, restPose);
+		for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+		{
+			noise = noise * 1103515245 + 12345;
+			skeleton.SkeletonPositions[j].y += ((noise >> 16) % 1001) / 1000.0f - 0.5f;
+			if ((noise >> 8) % 8 == 0)
+			{
+				skeleton.eSkeletonPositionTrackingState[j] = NUI_SKELETON_POSITION_NOT_TRACKED;
+			}
+		}
+	}
+}
+
+// The draw list has to come out with exactly the bones and joints the
+// old path drew, every skeleton and every way its joints can drop out
+static void CheckSkeletonDrawList(FILE* results)
+{
+	const int width = 640;
+	const int height = 480;
+	const int frames = 1000;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	ZeroMemory(&SkeletonFrame, sizeof(SkeletonFrame));
+	SkeletonDrawList list;
+	DrawnSkeleton drawn;
+	DWORD noise = 777;
+	int mismatches = 0;
+	int polylines = 0;
+	for (int frame = 0; frame < frames; frame++)
+	{
+		MakeDrawingFrame(SkeletonFrame, noise);
+		list.clear();
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			list.add(SkeletonView(SkeletonFrame, i), i, width, height);
+		}
+
+		// Where each kind of joint has got to in the list's dots
+		int dotsSeen[NUI_SKELETON_POSITION_COUNT];
+		ZeroMemory(dotsSeen, sizeof(dotsSeen));
+		for (int s = 0; s < NUI_SKELETON_COUNT; s++)
+		{
+			OldDrawSkeleton(SkeletonView(SkeletonFrame, s), width, height, drawn);
+			BOOL same = (list.colors[s] == s) && (list.numLines[s] == drawn.numLines)
+				&& (memcmp(&list.lineCounts[list.firstLines[s]], drawn.lineCounts, drawn.numLines * sizeof(DWORD)) == 0);
+			int numPoints = (s + 1 < list.numSkeletons ? list.firstPoints[s + 1] : list.numPoints) - list.firstPoints[s];
+			same = same && (numPoints == drawn.numPoints)
+				&& (memcmp(&list.points[list.firstPoints[s]], drawn.points, drawn.numPoints * sizeof(POINT)) == 0);
+			int d = 0;
+			for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+			{
+				if (SkeletonView(SkeletonFrame, s).hasJoint(j))
+				{
+					const POINT* dot = &list.dots[j][2 * dotsSeen[j]++];
+					same = same && (dot[0].x == drawn.dots[d].x) && (dot[0].y == drawn.dots[d].y)
+						&& (dot[1].x == drawn.dots[d].x) && (dot[1].y == drawn.dots[d].y);
+					d++;
+				}
+			}
+			same = same && (d == drawn.numDots);
+			if (! same)
+			{
+				mismatches++;
+			}
+			polylines += drawn.numLines;
+		}
+		for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+		{
+			if (dotsSeen[j] != list.numDots[j])
+			{
+				mismatches++;
+			}
+		}
+	}
+	fprintf(results, "%-24s %s (%d frames, %d polylines)\n", "draw list = old drawing",
+		CheckResult(mismatches == 0), frames, polylines);
+}
+
+// Working out a frame's geometry both ways, and what each then asks of GDI
+static void RunSkeletonDrawingBenchmark(FILE* results, BenchmarkTimer &timer)
+{
+	CheckSkeletonDrawList(results);
+
+	const int width = 640;
+	const int height = 480;
+	NUI_SKELETON_FRAME SkeletonFrame;
+	ZeroMemory(&SkeletonFrame, sizeof(SkeletonFrame));
+	DWORD noise = 4242;
+	MakeDrawingFrame(SkeletonFrame, noise);
+
+	DrawnSkeleton drawn;
+	volatile LONG sink = 0;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		timer.start();
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			OldDrawSkeleton(SkeletonView(SkeletonFrame, i), width, height, drawn);
+			sink += drawn.numPoints;
+		}
+		timer.stop();
+	}
+	timer.report(results, "segments, 6 skeletons");
+
+	SkeletonDrawList list;
+	timer.reset();
+	for (int frame = 0; frame < benchmarkFrames; frame++)
+	{
+		timer.start();
+		list.clear();
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			list.add(SkeletonView(SkeletonFrame, i), i, width, height);
+		}
+		timer.stop();
+		sink += list.numPoints;
+	}
+	timer.report(results, "draw list, 6 skeletons");
+
+	// GDI calls: before, each skeleton selected its pen twice, made up to
+	// five PolyPolylines, and made, selected, drew, put back and deleted
+	// a pen for every joint, then did the same for the hitbox pen.  Now
+	// it's one select and PolyPolyline per skeleton and per kind of joint.
+	int oldCalls = 0;
+	int oldPens = 0;
+	int newCalls = 2;
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		OldDrawSkeleton(SkeletonView(SkeletonFrame, i), width, height, drawn);
+		// Only the segments with a polyline in them got as far as GDI
+		int segments = 0;
+		for (int c = 0; c < numBoneChains; c++)
+		{
+			const BoneChain &bones = boneChains[c];
+			int run = 0;
+			for (int j = 0; j <= bones.numJoints; j++)
+			{
+				if (j < bones.numJoints && SkeletonView(SkeletonFrame, i).hasJoint(bones.joints[j]))
+				{
+					run++;
+					continue;
+				}
+				if (run > 1)
+				{
+					segments++;
+					break;
+				}
+				run = 0;
+			}
+		}
+		oldCalls += 2 + segments + 6 * drawn.numDots + 4;
+		oldPens += drawn.numDots + 1;
+		newCalls += (list.numLines[i] > 0) ? 2 : 0;
+	}
+	for (int j = 0; j < NUI_SKELETON_POSITION_COUNT; j++)
+	{
+		newCalls += (list.numDots[j] > 0) ? 2 : 0;
+	}
+	fprintf(results, "%-24s %d GDI calls and %d pens made per frame before, %d calls and none now\n", "",
+		oldCalls, oldPens, newCalls);
+}
+
+// Smoothing, prediction and the joint history, then what reads and draws
+// the skeletons
+void BenchmarkSkeletons(FILE* results, BenchmarkTimer &timer)
+{
+	fprintf(results, "\nJoint smoothing, %.0f mm noise, %d skeletons\n", jointNoise * 1000, NUI_SKELETON_COUNT);
+	RunSmoothingBenchmark(results, timer);
+
+	fprintf(results, "\nHand prediction, frames %.0f ms old\n", sensorLatencyMs);
+	RunPredictionBenchmark(results, timer);
+
+	fprintf(results, "\nJoint history, %d frames per skeleton\n", jointHistoryFrames);
+	RunJointHistoryBenchmark(results, timer);
+	RunSkeletonViewBenchmark(results, timer);
+
+	fprintf(results, "\nSkeleton drawing, %d skeletons\n", NUI_SKELETON_COUNT);
+	RunSkeletonDrawingBenchmark(results, timer);
+}
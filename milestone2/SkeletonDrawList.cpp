@@ -0,0 +1,84 @@
+#include "SkeletonDrawList.h"
+
+const BoneChain boneChains[numBoneChains] = {
+	{ 4, { NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_SPINE, NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_HEAD } },
+	{ 5, { NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_LEFT, NUI_SKELETON_POSITION_ELBOW_LEFT, NUI_SKELETON_POSITION_WRIST_LEFT, NUI_SKELETON_POSITION_HAND_LEFT } },
+	{ 5, { NUI_SKELETON_POSITION_SHOULDER_CENTER, NUI_SKELETON_POSITION_SHOULDER_RIGHT, NUI_SKELETON_POSITION_ELBOW_RIGHT, NUI_SKELETON_POSITION_WRIST_RIGHT, NUI_SKELETON_POSITION_HAND_RIGHT } },
+	{ 5, { NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_LEFT, NUI_SKELETON_POSITION_KNEE_LEFT, NUI_SKELETON_POSITION_ANKLE_LEFT, NUI_SKELETON_POSITION_FOOT_LEFT } },
+	{ 5, { NUI_SKELETON_POSITION_HIP_CENTER, NUI_SKELETON_POSITION_HIP_RIGHT, NUI_SKELETON_POSITION_KNEE_RIGHT, NUI_SKELETON_POSITION_ANKLE_RIGHT, NUI_SKELETON_POSITION_FOOT_RIGHT } },
+};
+
+SkeletonDrawList::SkeletonDrawList()
+{
+	clear();
+	ZeroMemory(projected, sizeof(projected));
+}
+
+void SkeletonDrawList::clear()
+{
+	numSkeletons = 0;
+	numPoints = 0;
+	numLineCounts = 0;
+	ZeroMemory(numDots, sizeof(numDots));
+}
+
+void SkeletonDrawList::add(const SkeletonView &skeleton, int color, int width, int height)
+{
+	if (numSkeletons == NUI_SKELETON_COUNT)
+	{
+		return;
+	}
+
+	// From skeleton space to the 320x240 depth image, then to the view
+	USHORT depth;
+	for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+	{
+		NuiTransformSkeletonToDepthImage( skeleton.joint(i), &projected[i].x, &projected[i].y, &depth );
+
+		projected[i].x = (projected[i].x * width) / 320;
+		projected[i].y = (projected[i].y * height) / 240;
+	}
+
+	int s = numSkeletons++;
+	colors[s] = color;
+	firstPoints[s] = numPoints;
+	firstLines[s] = numLineCounts;
+
+	// A chain is broken wherever a joint isn't tracked, and a piece with
+	// only one joint in it isn't drawn
+	for (int c = 0; c < numBoneChains; c++)
+	{
+		const BoneChain &chain = boneChains[c];
+		int currentPointCount = 0;
+		for (int j = 0; j <= chain.numJoints; j++)
+		{
+			if (j < chain.numJoints && skeleton.hasJoint(chain.joints[j]))
+			{
+				points[numPoints++] = projected[chain.joints[j]];
+				currentPointCount++;
+				continue;
+			}
+
+			if (currentPointCount > 1)
+			{
+				lineCounts[numLineCounts++] = currentPointCount;
+			}
+			else if (currentPointCount == 1)
+			{
+				numPoints--;
+			}
+			currentPointCount = 0;
+		}
+	}
+	numLines[s] = numLineCounts - firstLines[s];
+
+	for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+	{
+		if (skeleton.hasJoint(i))
+		{
+			POINT* dot = &dots[i][2 * numDots[i]++];
+			dot[0] = projected[i];
+			dot[1] = projected[i];
+		}
+	}
+}
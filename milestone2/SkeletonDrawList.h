@@ -0,0 +1,70 @@
+/************************************************************************
+*                                                                       *
+*   SkeletonDrawList.h -- Declaration of SkeletonDrawList class         *
+*                                                                       *
+*   Everything the skeleton view draws in a frame, as plain geometry:   *
+*   the bones of every skeleton as polylines, one run per skeleton,     *
+*   and every joint as a dot, grouped by joint so each colour is one    *
+*   call.  Nothing here calls GDI, so a frame can be built up,          *
+*   checked and timed without a window; SkeletonRenderer draws it.      *
+*   It still uses the Win32 and NUI types, POINT and the skeleton       *
+*   counts, so it builds where the rest of the viewer does.             *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "SkeletonView.h"
+
+// The longest run of joints a bone chain has
+const int maxChainJoints = 5;
+const int numBoneChains = 5;
+
+// Joints joined one after another
+struct BoneChain
+{
+	int numJoints;
+	int joints[maxChainJoints];
+};
+
+// The body, spine first, then the arms and the legs
+extern const BoneChain boneChains[numBoneChains];
+
+// Most bone points one skeleton can have (every joint of every chain),
+// and polylines (every one has at least two points)
+const int maxSkeletonBonePoints = 24;
+const int maxSkeletonPolylines = maxSkeletonBonePoints / 2;
+
+class SkeletonDrawList
+{
+public:
+	SkeletonDrawList();
+
+	void clear();
+	// Puts a skeleton in a view width by height pixels.  color is which of
+	// the skeleton colours its bones are drawn in (its slot, usually).
+	// Past NUI_SKELETON_COUNT skeletons, the rest are left out.
+	void add(const SkeletonView &skeleton, int color, int width, int height);
+
+	int numSkeletons;
+	// Per skeleton: its colour, and its polylines, which are numLines[s]
+	// counts from lineCounts[firstLines[s]] and the points from
+	// points[firstPoints[s]]
+	int colors[NUI_SKELETON_COUNT];
+	int firstPoints[NUI_SKELETON_COUNT];
+	int firstLines[NUI_SKELETON_COUNT];
+	int numLines[NUI_SKELETON_COUNT];
+	POINT points[NUI_SKELETON_COUNT * maxSkeletonBonePoints];
+	DWORD lineCounts[NUI_SKELETON_COUNT * maxSkeletonPolylines];
+	int numPoints;
+	int numLineCounts;
+
+	// Every tracked joint of that kind, as a line from the joint to itself
+	// (a dot with a wide pen), numDots[j] of them
+	POINT dots[NUI_SKELETON_POSITION_COUNT][2 * NUI_SKELETON_COUNT];
+	int numDots[NUI_SKELETON_POSITION_COUNT];
+
+	// Where every joint of the last skeleton added landed
+	POINT projected[NUI_SKELETON_POSITION_COUNT];
+};
@@ -0,0 +1,174 @@
+#include "SkeletonRecorder.h"
+
+DWORD SkeletonRecordSize(const SkeletonRecordHeader &recordHeader)
+{
+	if ((recordHeader.skeletonMask >> NUI_SKELETON_COUNT) != 0)
+	{
+		return 0;
+	}
+	DWORD skeletons = 0;
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		if (recordHeader.skeletonMask & (1 << i))
+		{
+			skeletons++;
+		}
+	}
+	DWORD expectedSize = sizeof(SkeletonRecordHeader) + skeletonFramePrefixSize + skeletons * sizeof(NUI_SKELETON_DATA);
+	return (recordHeader.recordSize == expectedSize) ? expectedSize : 0;
+}
+
+SkeletonRecorder::SkeletonRecorder()
+{
+	hFile = INVALID_HANDLE_VALUE;
+	framesRecorded = 0;
+}
+
+SkeletonRecorder::~SkeletonRecorder(void)
+{
+	close();
+}
+
+// Cuts an existing recording back to its last whole record, so a record
+// torn by a crash isn't left in front of what's appended next
+BOOL SkeletonRecorder::trim(HANDLE hExisting)
+{
+	DWORD fileSize = GetFileSize(hExisting, NULL);
+	if (fileSize == INVALID_FILE_SIZE)
+	{
+		return FALSE;
+	}
+
+	DWORD goodSize = sizeof(SkeletonRecordingHeader);
+	SkeletonRecordHeader recordHeader;
+	DWORD bytes = 0;
+	while (fileSize - goodSize >= sizeof(recordHeader)
+		&& SetFilePointer(hExisting, goodSize, NULL, FILE_BEGIN) == goodSize
+		&& ReadFile(hExisting, &recordHeader, sizeof(recordHeader), &bytes, NULL)
+		&& bytes == sizeof(recordHeader))
+	{
+		DWORD recordSize = SkeletonRecordSize(recordHeader);
+		if (recordSize == 0 || recordSize > fileSize - goodSize)
+		{
+			break;
+		}
+		goodSize += recordSize;
+	}
+
+	if (goodSize == fileSize)
+	{
+		return TRUE;
+	}
+	return SetFilePointer(hExisting, goodSize, NULL, FILE_BEGIN) == goodSize
+		&& SetEndOfFile(hExisting);
+}
+
+// Open (or continue) a recording.  Existing files are appended to, as
+// long as they were written with the same frame layout.
+BOOL SkeletonRecorder::open(const char* path)
+{
+	close();
+
+	// Check (or write) the header and trim off any torn record first...
+	HANDLE hExisting = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hExisting == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+	hFile = hExisting;
+
+	SkeletonRecordingHeader header;
+	DWORD bytes = 0;
+	if (GetFileSize(hFile, NULL) == 0)
+	{
+		header.magic = skeletonRecordingMagic;
+		header.version = skeletonRecordingVersion;
+		header.frameSize = sizeof(NUI_SKELETON_FRAME);
+		header.skeletonSize = sizeof(NUI_SKELETON_DATA);
+		if (! WriteFile(hFile, &header, sizeof(header), &bytes, NULL) || bytes != sizeof(header))
+		{
+			close();
+			return FALSE;
+		}
+	}
+	else
+	{
+		// Don't append to something that isn't ours
+		if (! ReadFile(hFile, &header, sizeof(header), &bytes, NULL)
+			|| bytes != sizeof(header)
+			|| header.magic != skeletonRecordingMagic
+			|| header.version != skeletonRecordingVersion
+			|| header.frameSize != sizeof(NUI_SKELETON_FRAME)
+			|| header.skeletonSize != sizeof(NUI_SKELETON_DATA))
+		{
+			close();
+			return FALSE;
+		}
+		if (! trim(hFile))
+		{
+			close();
+			return FALSE;
+		}
+	}
+	close();
+
+	// ...then reopen it to append.  FILE_APPEND_DATA without FILE_WRITE_DATA
+	// means every write goes to the end of the file, whatever else happens
+	// to it.
+	hFile = CreateFileA(path, FILE_APPEND_DATA, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	return (hFile != INVALID_HANDLE_VALUE);
+}
+
+void SkeletonRecorder::close()
+{
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(hFile);
+		hFile = INVALID_HANDLE_VALUE;
+	}
+}
+
+BOOL SkeletonRecorder::isRecording()
+{
+	return (hFile != INVALID_HANDLE_VALUE);
+}
+
+// Append one frame.  Called from the NUI thread, so it's a single write
+// of a stack buffer and nothing else.
+BOOL SkeletonRecorder::record(const NUI_SKELETON_FRAME &SkeletonFrame)
+{
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	BYTE buffer[maxSkeletonRecordSize];
+	SkeletonRecordHeader* recordHeader = (SkeletonRecordHeader*) buffer;
+	BYTE* writePos = buffer + sizeof(SkeletonRecordHeader);
+
+	memcpy(writePos, &SkeletonFrame, skeletonFramePrefixSize);
+	writePos += skeletonFramePrefixSize;
+
+	recordHeader->skeletonMask = 0;
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		if (SkeletonFrame.SkeletonData[i].eTrackingState != NUI_SKELETON_NOT_TRACKED)
+		{
+			recordHeader->skeletonMask |= (1 << i);
+			memcpy(writePos, &SkeletonFrame.SkeletonData[i], sizeof(NUI_SKELETON_DATA));
+			writePos += sizeof(NUI_SKELETON_DATA);
+		}
+	}
+	recordHeader->recordSize = (DWORD) (writePos - buffer);
+
+	DWORD bytes = 0;
+	if (! WriteFile(hFile, buffer, recordHeader->recordSize, &bytes, NULL) || bytes != recordHeader->recordSize)
+	{
+		// Stop rather than leave a half-written record in the middle of the file
+		close();
+		return FALSE;
+	}
+
+	framesRecorded++;
+	return TRUE;
+}
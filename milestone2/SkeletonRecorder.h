@@ -0,0 +1,74 @@
+/************************************************************************
+*                                                                       *
+*   SkeletonRecorder.h -- Declaration of SkeletonRecorder class         *
+*                                                                       *
+*   Appends every skeleton frame we get from the sensor to a file, so   *
+*   that sessions can be replayed later without a Kinect (see           *
+*   SkeletonReplayer).                                                  *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+
+/* File format
+ *
+ * A recording is one SkeletonRecordingHeader followed by any number of
+ * records.  Each record is a SkeletonRecordHeader, the part of the
+ * NUI_SKELETON_FRAME in front of SkeletonData (timestamp, frame number,
+ * floor plane...), and then one NUI_SKELETON_DATA for every bit set in
+ * skeletonMask.  Skeletons that aren't tracked at all aren't stored, which
+ * keeps a typical one-user record around 500 bytes instead of 2.7K.
+ *
+ * Everything is stored raw in native byte order, so a replayer can map
+ * the file and walk it in place.  The file is only ever appended to.  A
+ * record cut short by a crash is ignored on replay, and cut off the end
+ * of the file before the next session appends to it, so nothing recorded
+ * later ends up behind it. */
+const DWORD skeletonRecordingMagic = 0x524B534B; // "KSKR"
+const DWORD skeletonRecordingVersion = 1;
+
+struct SkeletonRecordingHeader
+{
+	DWORD magic;
+	DWORD version;
+	// Lets a replayer refuse files written with a different SDK layout
+	DWORD frameSize;
+	DWORD skeletonSize;
+};
+
+struct SkeletonRecordHeader
+{
+	// Size of the whole record, including this header
+	DWORD recordSize;
+	// Bit i is set if SkeletonData[i] is stored in this record
+	DWORD skeletonMask;
+};
+
+// Bytes of NUI_SKELETON_FRAME that come before the skeleton array
+const DWORD skeletonFramePrefixSize = (DWORD) offsetof(NUI_SKELETON_FRAME, SkeletonData);
+const DWORD maxSkeletonRecordSize = sizeof(SkeletonRecordHeader) + skeletonFramePrefixSize + NUI_SKELETON_COUNT * sizeof(NUI_SKELETON_DATA);
+
+// How big a record with this header should be, worked out from its mask
+// rather than trusting recordSize; 0 if the header can't be right
+DWORD SkeletonRecordSize(const SkeletonRecordHeader &recordHeader);
+
+class SkeletonRecorder
+{
+public:
+	SkeletonRecorder();
+	~SkeletonRecorder(void);
+
+	BOOL open(const char* path);
+	void close();
+	BOOL isRecording();
+	BOOL record(const NUI_SKELETON_FRAME &SkeletonFrame);
+
+	DWORD framesRecorded;
+
+private:
+	BOOL trim(HANDLE hExisting);
+
+	HANDLE hFile;
+};
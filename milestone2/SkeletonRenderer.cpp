@@ -0,0 +1,121 @@
+#include "SkeletonRenderer.h"
+
+const COLORREF g_JointColorTable[NUI_SKELETON_POSITION_COUNT] =
+{
+	RGB(169, 176, 155), // NUI_SKELETON_POSITION_HIP_CENTER
+	RGB(169, 176, 155), // NUI_SKELETON_POSITION_SPINE
+	RGB(168, 230, 29),  // NUI_SKELETON_POSITION_SHOULDER_CENTER
+	RGB(200, 0,   0),   // NUI_SKELETON_POSITION_HEAD
+	RGB(79,  84,  33),  // NUI_SKELETON_POSITION_SHOULDER_LEFT
+	RGB(84,  33,  42),  // NUI_SKELETON_POSITION_ELBOW_LEFT
+	RGB(255, 126, 0),   // NUI_SKELETON_POSITION_WRIST_LEFT
+	RGB(215,  86, 0),   // NUI_SKELETON_POSITION_HAND_LEFT
+	RGB(33,  79,  84),  // NUI_SKELETON_POSITION_SHOULDER_RIGHT
+	RGB(33,  33,  84),  // NUI_SKELETON_POSITION_ELBOW_RIGHT
+	RGB(77,  109, 243), // NUI_SKELETON_POSITION_WRIST_RIGHT
+	RGB(37,   69, 243), // NUI_SKELETON_POSITION_HAND_RIGHT
+	RGB(77,  109, 243), // NUI_SKELETON_POSITION_HIP_LEFT
+	RGB(69,  33,  84),  // NUI_SKELETON_POSITION_KNEE_LEFT
+	RGB(229, 170, 122), // NUI_SKELETON_POSITION_ANKLE_LEFT
+	RGB(255, 126, 0),   // NUI_SKELETON_POSITION_FOOT_LEFT
+	RGB(181, 165, 213), // NUI_SKELETON_POSITION_HIP_RIGHT
+	RGB(71, 222,  76),  // NUI_SKELETON_POSITION_KNEE_RIGHT
+	RGB(245, 228, 156), // NUI_SKELETON_POSITION_ANKLE_RIGHT
+	RGB(77,  109, 243)  // NUI_SKELETON_POSITION_FOOT_RIGHT
+};
+
+const COLORREF g_SkeletonColors[NUI_SKELETON_COUNT] =
+{
+	RGB( 255, 0, 0),
+	RGB( 0, 255, 0 ),
+	RGB( 64, 255, 255 ),
+	RGB( 255, 255, 64 ),
+	RGB( 255, 64, 255 ),
+	RGB( 128, 128, 255 )
+};
+
+// Every joint dot is a two-point polyline
+static const DWORD dotCounts[NUI_SKELETON_COUNT] = { 2, 2, 2, 2, 2, 2 };
+
+SkeletonRenderer::SkeletonRenderer()
+{
+	ZeroMemory(bonePens, sizeof(bonePens));
+	bonePenWidth = -1;
+	for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+	{
+		jointPens[i] = CreatePen( PS_SOLID, 9, g_JointColorTable[i] );
+	}
+	gesturePen = NULL;
+}
+
+SkeletonRenderer::~SkeletonRenderer(void)
+{
+	for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+	{
+		if (bonePens[i] != NULL)
+		{
+			DeleteObject( bonePens[i] );
+		}
+	}
+	for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+	{
+		DeleteObject( jointPens[i] );
+	}
+	if (gesturePen != NULL)
+	{
+		DeleteObject( gesturePen );
+	}
+}
+
+void SkeletonRenderer::draw(HDC hdc, int width)
+{
+	// Only when the view changes size
+	if (width / 80 != bonePenWidth)
+	{
+		bonePenWidth = width / 80;
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			if (bonePens[i] != NULL)
+			{
+				DeleteObject( bonePens[i] );
+			}
+			bonePens[i] = CreatePen( PS_SOLID, bonePenWidth, g_SkeletonColors[i] );
+		}
+	}
+
+	HGDIOBJ hOldObj = SelectObject( hdc, bonePens[0] );
+
+	// A PolyPolyline draws with one pen, and every skeleton has its own
+	// colour, so the bones are one call per skeleton
+	for (int s = 0; s < list.numSkeletons; s++)
+	{
+		if (list.numLines[s] > 0)
+		{
+			SelectObject( hdc, bonePens[list.colors[s] % NUI_SKELETON_COUNT] );
+			PolyPolyline( hdc, &list.points[list.firstPoints[s]], &list.lineCounts[list.firstLines[s]], list.numLines[s] );
+		}
+	}
+
+	// The joints in a different color, over every skeleton's bones
+	for (int i = 0; i < NUI_SKELETON_POSITION_COUNT; i++)
+	{
+		if (list.numDots[i] > 0)
+		{
+			SelectObject( hdc, jointPens[i] );
+			PolyPolyline( hdc, list.dots[i], dotCounts, list.numDots[i] );
+		}
+	}
+
+	SelectObject( hdc, hOldObj );
+	list.clear();
+}
+
+HPEN SkeletonRenderer::hitboxPen()
+{
+	if (gesturePen == NULL)
+	{
+		// Hard-code to red for now
+		gesturePen = CreatePen( PS_DASH, 1, RGB(255,0,0) );
+	}
+	return gesturePen;
+}
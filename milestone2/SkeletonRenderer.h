@@ -0,0 +1,42 @@
+/************************************************************************
+*                                                                       *
+*   SkeletonRenderer.h -- Declaration of SkeletonRenderer class         *
+*                                                                       *
+*   Draws a SkeletonDrawList with GDI.  The pens are made once and      *
+*   kept, so a frame is one PolyPolyline per skeleton for the bones     *
+*   and one per kind of joint, for every skeleton at once.              *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+#include "SkeletonDrawList.h"
+
+// One per skeleton slot, for its bones and its ID
+extern const COLORREF g_SkeletonColors[NUI_SKELETON_COUNT];
+// One per joint
+extern const COLORREF g_JointColorTable[NUI_SKELETON_POSITION_COUNT];
+
+class SkeletonRenderer
+{
+public:
+	SkeletonRenderer();
+	~SkeletonRenderer(void);
+
+	// Draws everything in the list into a view width pixels wide (the
+	// bones get thicker with it), then empties it
+	void draw(HDC hdc, int width);
+
+	// The red dashed pen the gesture hitboxes are drawn with
+	HPEN hitboxPen();
+
+	// This frame's skeletons
+	SkeletonDrawList list;
+
+private:
+	HPEN bonePens[NUI_SKELETON_COUNT];
+	int bonePenWidth;
+	HPEN jointPens[NUI_SKELETON_POSITION_COUNT];
+	HPEN gesturePen;
+};
@@ -0,0 +1,367 @@
+#include "SkeletonReplayer.h"
+#include "Magnifier.h"
+#include "FrameClock.h"
+#include "HandPredictor.h"
+#include "DtwRecognizer.h"
+#include "JointHistory.h"
+#include "GestureBatch.h"
+#include "OverlayScene.h"
+
+extern int activeSkeleton;
+extern GestureDetector* gestureDetectors[NUI_SKELETON_COUNT];
+extern FLOAT moveAmount_x;
+extern FLOAT moveAmount_y;
+extern float magnifyAmount;
+extern BOOL showOverlays;
+extern BOOL headlessMode;
+extern char templatePath[MAX_PATH];
+extern BOOL replayAppTracking;
+
+SkeletonReplayer::SkeletonReplayer()
+{
+	hFile = INVALID_HANDLE_VALUE;
+	hMapping = NULL;
+	data = NULL;
+	dataSize = 0;
+	readPos = 0;
+	badFrames = 0;
+}
+
+SkeletonReplayer::~SkeletonReplayer(void)
+{
+	close();
+}
+
+BOOL SkeletonReplayer::open(const char* path)
+{
+	close();
+
+	hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		return FALSE;
+	}
+
+	dataSize = GetFileSize(hFile, NULL);
+	if (dataSize == INVALID_FILE_SIZE || dataSize < sizeof(SkeletonRecordingHeader))
+	{
+		close();
+		return FALSE;
+	}
+
+	// Map the whole thing; recordings are a few megabytes at most
+	hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (hMapping == NULL)
+	{
+		close();
+		return FALSE;
+	}
+	data = (const BYTE*) MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL)
+	{
+		close();
+		return FALSE;
+	}
+
+	const SkeletonRecordingHeader* header = (const SkeletonRecordingHeader*) data;
+	if (header->magic != skeletonRecordingMagic
+		|| header->version != skeletonRecordingVersion
+		|| header->frameSize != sizeof(NUI_SKELETON_FRAME)
+		|| header->skeletonSize != sizeof(NUI_SKELETON_DATA))
+	{
+		close();
+		return FALSE;
+	}
+
+	rewind();
+	return TRUE;
+}
+
+void SkeletonReplayer::close()
+{
+	if (data != NULL)
+	{
+		UnmapViewOfFile(data);
+		data = NULL;
+	}
+	if (hMapping != NULL)
+	{
+		CloseHandle(hMapping);
+		hMapping = NULL;
+	}
+	if (hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(hFile);
+		hFile = INVALID_HANDLE_VALUE;
+	}
+	dataSize = 0;
+	readPos = 0;
+}
+
+void SkeletonReplayer::rewind()
+{
+	readPos = sizeof(SkeletonRecordingHeader);
+	badFrames = 0;
+}
+
+BOOL SkeletonReplayer::nextFrame(NUI_SKELETON_FRAME &SkeletonFrame)
+{
+	if (data == NULL)
+	{
+		return FALSE;
+	}
+
+	while (dataSize - readPos >= sizeof(SkeletonRecordHeader))
+	{
+		const SkeletonRecordHeader* recordHeader = (const SkeletonRecordHeader*) (data + readPos);
+
+		if (recordHeader->recordSize > dataSize - readPos)
+		{
+			// Cut off at the end of the file, nothing more to read
+			badFrames++;
+			readPos = dataSize;
+			return FALSE;
+		}
+		if (SkeletonRecordSize(*recordHeader) == 0)
+		{
+			// Can't trust anything after a corrupt record (the recorder trims
+			// torn records off before appending, so nothing good follows one)
+			badFrames++;
+			readPos = dataSize;
+			return FALSE;
+		}
+
+		const BYTE* readFrom = data + readPos + sizeof(SkeletonRecordHeader);
+		ZeroMemory(&SkeletonFrame, sizeof(SkeletonFrame));
+		memcpy(&SkeletonFrame, readFrom, skeletonFramePrefixSize);
+		readFrom += skeletonFramePrefixSize;
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			if (recordHeader->skeletonMask & (1 << i))
+			{
+				memcpy(&SkeletonFrame.SkeletonData[i], readFrom, sizeof(NUI_SKELETON_DATA));
+				readFrom += sizeof(NUI_SKELETON_DATA);
+			}
+			else
+			{
+				SkeletonFrame.SkeletonData[i].eTrackingState = NUI_SKELETON_NOT_TRACKED;
+			}
+		}
+
+		readPos += recordHeader->recordSize;
+		return TRUE;
+	}
+
+	// Leftover bytes too small to be a record
+	if (readPos != dataSize)
+	{
+		badFrames++;
+		readPos = dataSize;
+	}
+	return FALSE;
+}
+
+// Does what NuiImpl::Nui_GotSkeletonAlert() does with a frame, minus the
+// drawing and the smoothing (frames were recorded after smoothing, but
+// before the hands were predicted).  Frames with no skeleton found are
+// only looked at for losing the active one, as they are live.
+BOOL SkeletonReplayer::replay(GestureDetector* detectors[NUI_SKELETON_COUNT], float speed, FILE* results, ReplayStats &stats)
+{
+	if (data == NULL)
+	{
+		return FALSE;
+	}
+
+	ZeroMemory(&stats, sizeof(stats));
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	stats.ticksPerSecond = frequency.QuadPart;
+
+	NUI_SKELETON_FRAME SkeletonFrame;
+	JointHistory history;
+	GestureBatch batch(gestureTable);
+	HandPredictor predictor;
+	DtwRecognizer recognizer;
+	recognizer.addDefaultTemplates();
+	if (templatePath[0] != '\0')
+	{
+		recognizer.addRecordedTemplate("recorded", templatePath);
+	}
+	LONGLONG firstTimestamp = 0;
+	LARGE_INTEGER startCounter;
+	QueryPerformanceCounter(&startCounter);
+
+	while (nextFrame(SkeletonFrame))
+	{
+		stats.frames++;
+
+		// Keep to the recorded frame rate (scaled by speed)
+		if (stats.frames == 1)
+		{
+			firstTimestamp = SkeletonFrame.liTimeStamp.QuadPart;
+		}
+		else if (speed > 0)
+		{
+			// Timestamps are in milliseconds
+			LONGLONG due = (LONGLONG) ((SkeletonFrame.liTimeStamp.QuadPart - firstTimestamp) * frequency.QuadPart / (1000 * speed));
+			LARGE_INTEGER now;
+			QueryPerformanceCounter(&now);
+			LONGLONG waitTicks = due - (now.QuadPart - startCounter.QuadPart);
+			if (waitTicks > 0)
+			{
+				Sleep((DWORD) (waitTicks * 1000 / frequency.QuadPart));
+			}
+		}
+
+		LARGE_INTEGER frameStart;
+		QueryPerformanceCounter(&frameStart);
+		frameClock.newFrame(SkeletonFrame.liTimeStamp);
+
+		bool bFoundSkeleton = false;
+		for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+		{
+			if ((i == activeSkeleton) && (SkeletonFrame.SkeletonData[i].eTrackingState != NUI_SKELETON_TRACKED))
+			{
+				if (results != NULL)
+				{
+					fprintf(results, "%lu\tskeleton %d lost\n", SkeletonFrame.dwFrameNumber, activeSkeleton);
+				}
+				moveAmount_x = 0;
+				moveAmount_y = 0;
+				detectors[activeSkeleton]->state->state = OFF;
+				activeSkeleton = -1;
+			}
+
+			// Position-only skeletons count too if the application picked
+			// which ones get tracked, as they do live
+			if (SkeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED ||
+				(SkeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_POSITION_ONLY && replayAppTracking))
+			{
+				bFoundSkeleton = true;
+				if (activeSkeleton == -1)
+				{
+					moveAmount_x = 0;
+					moveAmount_y = 0;
+					activeSkeleton = i;
+					if (results != NULL)
+					{
+						fprintf(results, "%lu\tskeleton %d active\n", SkeletonFrame.dwFrameNumber, i);
+					}
+				}
+			}
+		}
+
+		if (bFoundSkeleton)
+		{
+			recognizer.recognize(SkeletonFrame);
+			for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+			{
+				DtwMatch match;
+				if (detectors[i]->takeDynamicGesture(recognizer, match) && results != NULL)
+				{
+					fprintf(results, "%lu\tskeleton %d\t%s (%.3f)\n", SkeletonFrame.dwFrameNumber, i,
+						recognizer.templateName(match.templateIndex), match.distance);
+				}
+			}
+			predictor.predict(SkeletonFrame);
+
+			history.add(SkeletonFrame, frameClock.frameTime());
+			batch.evaluate(SkeletonFrame, detectors);
+
+			for (int i = 0; i < NUI_SKELETON_COUNT; i++)
+			{
+				if (SkeletonFrame.SkeletonData[i].eTrackingState == NUI_SKELETON_TRACKED &&
+					SkeletonFrame.SkeletonData[i].eSkeletonPositionTrackingState[NUI_SKELETON_POSITION_SHOULDER_CENTER] != NUI_SKELETON_POSITION_NOT_TRACKED)
+				{
+					GestureStateEnum before = detectors[i]->state->state;
+
+					LARGE_INTEGER detectStart, detectEnd;
+					QueryPerformanceCounter(&detectStart);
+					detectors[i]->detect(SkeletonFrame, history, &batch);
+					QueryPerformanceCounter(&detectEnd);
+					stats.totalDetectTicks += detectEnd.QuadPart - detectStart.QuadPart;
+					stats.detectCalls++;
+
+					GestureStateEnum after = detectors[i]->state->state;
+					if (before != after)
+					{
+						stats.stateChanges++;
+						if (results != NULL)
+						{
+							fprintf(results, "%lu\tskeleton %d\t%s -> %s\tmove=(%.2f,%.2f) magnify=%.3f\n",
+								SkeletonFrame.dwFrameNumber, i, GestureStateName(before), GestureStateName(after),
+								moveAmount_x, moveAmount_y, magnifyAmount);
+						}
+					}
+				}
+			}
+			overlayScene.commit();
+		}
+
+		LARGE_INTEGER frameEnd;
+		QueryPerformanceCounter(&frameEnd);
+		if (frameEnd.QuadPart - frameStart.QuadPart > stats.maxFrameTicks)
+		{
+			stats.maxFrameTicks = frameEnd.QuadPart - frameStart.QuadPart;
+		}
+	}
+
+	stats.badFrames = badFrames;
+	return TRUE;
+}
+
+int RunReplay(const char* path, float speed, const char* resultsPath)
+{
+	// No windows, no cursor, no clicks
+	headlessMode = TRUE;
+	showOverlays = FALSE;
+	activeSkeleton = -1;
+	moveAmount_x = 0;
+	moveAmount_y = 0;
+	magnifyAmount = 0;
+
+	SkeletonReplayer replayer;
+	if (! replayer.open(path))
+	{
+		MessageBoxA(NULL, path, "Couldn't open skeleton recording", MB_OK | MB_ICONERROR);
+		return 1;
+	}
+
+	FILE* results = NULL;
+	if (fopen_s(&results, resultsPath, "w") != 0)
+	{
+		MessageBoxA(NULL, resultsPath, "Couldn't write replay results", MB_OK | MB_ICONERROR);
+		return 1;
+	}
+	fprintf(results, "replay of %s at speed %.2f\n", path, speed);
+
+	// Gesture timeouts follow the recording, so any speed gives the same results
+	frameClock.useVirtualTime();
+	for (int ii = 0; ii < NUI_SKELETON_COUNT; ii++)
+	{
+		gestureDetectors[ii] = new GestureDetector(ii);
+	}
+
+	ReplayStats stats;
+	replayer.replay(gestureDetectors, speed, results, stats);
+
+	double ticksToUs = 1000000.0 / (double) stats.ticksPerSecond;
+	fprintf(results, "\nframes: %lu (%lu bad)\n", stats.frames, stats.badFrames);
+	fprintf(results, "detect calls: %lu\n", stats.detectCalls);
+	fprintf(results, "state changes: %lu\n", stats.stateChanges);
+	if (stats.detectCalls > 0)
+	{
+		fprintf(results, "mean detect: %.3f us\n", stats.totalDetectTicks * ticksToUs / stats.detectCalls);
+	}
+	fprintf(results, "worst frame: %.3f us\n", stats.maxFrameTicks * ticksToUs);
+	fclose(results);
+
+	for (int ii = 0; ii < NUI_SKELETON_COUNT; ii++)
+	{
+		delete gestureDetectors[ii];
+		gestureDetectors[ii] = NULL;
+	}
+	frameClock.useRealTime();
+
+	return 0;
+}
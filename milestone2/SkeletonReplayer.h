@@ -0,0 +1,59 @@
+/************************************************************************
+*                                                                       *
+*   SkeletonReplayer.h -- Declaration of SkeletonReplayer class         *
+*                                                                       *
+*   Plays a file written by SkeletonRecorder back through the gesture   *
+*   detectors, without a sensor or any windows, and writes out every    *
+*   state change so that two runs can be diffed against each other.     *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include <stdio.h>
+#include "NuiApi.h"
+#include "SkeletonRecorder.h"
+#include "GestureDetector.h"
+
+// What a replay cost us.  Times are in QueryPerformanceCounter ticks.
+struct ReplayStats
+{
+	DWORD frames;
+	// Frames that had to be thrown away (truncated or malformed)
+	DWORD badFrames;
+	DWORD detectCalls;
+	DWORD stateChanges;
+	LONGLONG totalDetectTicks;
+	LONGLONG maxFrameTicks;
+	LONGLONG ticksPerSecond;
+};
+
+class SkeletonReplayer
+{
+public:
+	SkeletonReplayer();
+	~SkeletonReplayer(void);
+
+	BOOL open(const char* path);
+	void close();
+	void rewind();
+	// Fills in the next whole frame, returns FALSE at the end of the recording
+	BOOL nextFrame(NUI_SKELETON_FRAME &SkeletonFrame);
+
+	// Feed the whole recording through the detectors.  speed is a multiple
+	// of real time; 0 means don't wait between frames at all.  If results
+	// isn't NULL, every state change is written to it.
+	BOOL replay(GestureDetector* detectors[NUI_SKELETON_COUNT], float speed, FILE* results, ReplayStats &stats);
+
+private:
+	HANDLE hFile;
+	HANDLE hMapping;
+	const BYTE* data;
+	DWORD dataSize;
+	DWORD readPos;
+	DWORD badFrames;
+};
+
+// Entry point for "-replay": replays the file headless and writes the
+// transcript plus timing to resultsPath
+int RunReplay(const char* path, float speed, const char* resultsPath);
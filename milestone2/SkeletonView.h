@@ -0,0 +1,62 @@
+/************************************************************************
+*                                                                       *
+*   SkeletonView.h -- Declaration of SkeletonView class                 *
+*                                                                       *
+*   A read-only look at one skeleton in a frame.  It's only a pointer,  *
+*   so handing one to the detectors, the recognizers and the drawing    *
+*   code costs nothing, where a NUI_SKELETON_DATA is nearly half a      *
+*   kilobyte every time it's passed or assigned by value.               *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+#include "NuiApi.h"
+
+class SkeletonView
+{
+public:
+	SkeletonView(const NUI_SKELETON_FRAME &SkeletonFrame, int skeleton)
+		: data(&SkeletonFrame.SkeletonData[skeleton])
+	{
+	}
+	// Not explicit, so anything that takes a view takes a skeleton too
+	SkeletonView(const NUI_SKELETON_DATA &skeleton)
+		: data(&skeleton)
+	{
+	}
+
+	const Vector4 &joint(int joint) const
+	{
+		return data->SkeletonPositions[joint];
+	}
+	NUI_SKELETON_POSITION_TRACKING_STATE jointState(int joint) const
+	{
+		return data->eSkeletonPositionTrackingState[joint];
+	}
+	// Tracked or inferred
+	BOOL hasJoint(int joint) const
+	{
+		return data->eSkeletonPositionTrackingState[joint] != NUI_SKELETON_POSITION_NOT_TRACKED;
+	}
+	NUI_SKELETON_TRACKING_STATE trackingState() const
+	{
+		return data->eTrackingState;
+	}
+	DWORD trackingId() const
+	{
+		return data->dwTrackingID;
+	}
+	// Where the whole skeleton is, for skeletons that are only positioned
+	const Vector4 &position() const
+	{
+		return data->Position;
+	}
+	const NUI_SKELETON_DATA &skeleton() const
+	{
+		return *data;
+	}
+
+private:
+	const NUI_SKELETON_DATA* data;
+};
@@ -0,0 +1,187 @@
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(int numWorkers)
+{
+	this->numWorkers = (numWorkers > 0) ? numWorkers : 0;
+	quitting = FALSE;
+	function = NULL;
+	context = NULL;
+	numRows = 0;
+	rowsPerBand = 0;
+	nextBand = 0;
+	workersBusy = 0;
+	threads = NULL;
+	startEvents = NULL;
+	workerArgs = NULL;
+	doneEvent = NULL;
+
+	if (this->numWorkers == 0)
+	{
+		return;
+	}
+
+	doneEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+	threads = new HANDLE[this->numWorkers];
+	startEvents = new HANDLE[this->numWorkers];
+	workerArgs = new WorkerArgs[this->numWorkers];
+	int numEvents = 0;
+	while (doneEvent != NULL && numEvents < this->numWorkers)
+	{
+		startEvents[numEvents] = CreateEvent(NULL, FALSE, FALSE, NULL);
+		if (startEvents[numEvents] == NULL)
+		{
+			break;
+		}
+		workerArgs[numEvents].pool = this;
+		workerArgs[numEvents].startEvent = startEvents[numEvents];
+		numEvents++;
+	}
+	if (numEvents < this->numWorkers)
+	{
+		// Without every event run() can't tell when the workers are done,
+		// so the caller does the whole frame itself
+		for (int i = 0; i < numEvents; i++)
+		{
+			CloseHandle(startEvents[i]);
+		}
+		if (doneEvent != NULL)
+		{
+			CloseHandle(doneEvent);
+			doneEvent = NULL;
+		}
+		delete [] threads;
+		delete [] startEvents;
+		delete [] workerArgs;
+		threads = NULL;
+		startEvents = NULL;
+		workerArgs = NULL;
+		this->numWorkers = 0;
+		return;
+	}
+	for (int i = 0; i < this->numWorkers; i++)
+	{
+		threads[i] = CreateThread(NULL, 0, WorkerThread, &workerArgs[i], 0, NULL);
+		if (threads[i] == NULL)
+		{
+			// Make do with the ones we've got
+			for (int j = i; j < this->numWorkers; j++)
+			{
+				CloseHandle(startEvents[j]);
+			}
+			this->numWorkers = i;
+			break;
+		}
+	}
+}
+
+WorkerPool::~WorkerPool(void)
+{
+	quitting = TRUE;
+	for (int i = 0; i < numWorkers; i++)
+	{
+		SetEvent(startEvents[i]);
+	}
+	if (numWorkers > 0)
+	{
+		WaitForMultipleObjects(numWorkers, threads, TRUE, INFINITE);
+	}
+	for (int i = 0; i < numWorkers; i++)
+	{
+		CloseHandle(threads[i]);
+		CloseHandle(startEvents[i]);
+	}
+	delete [] threads;
+	delete [] startEvents;
+	delete [] workerArgs;
+	if (doneEvent != NULL)
+	{
+		CloseHandle(doneEvent);
+	}
+}
+
+int WorkerPool::numThreads()
+{
+	return numWorkers + 1;
+}
+
+int WorkerPool::defaultWorkers()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int) info.dwNumberOfProcessors - 1;
+}
+
+void WorkerPool::run(BandFunction function, void* context, DWORD numRows)
+{
+	if (numRows == 0)
+	{
+		return;
+	}
+
+	// Nobody to share with
+	if (numWorkers == 0)
+	{
+		function(context, 0, numRows);
+		return;
+	}
+
+	this->function = function;
+	this->context = context;
+	this->numRows = numRows;
+	DWORD numBands = numThreads() * bandsPerThread;
+	rowsPerBand = (numRows + numBands - 1) / numBands;
+	nextBand = 0;
+	workersBusy = numWorkers;
+
+	// SetEvent is a full barrier, so the workers see the job set up above
+	for (int i = 0; i < numWorkers; i++)
+	{
+		SetEvent(startEvents[i]);
+	}
+
+	doBands();
+
+	WaitForSingleObject(doneEvent, INFINITE);
+}
+
+// Keep taking bands until there aren't any left
+void WorkerPool::doBands()
+{
+	for (;;)
+	{
+		DWORD band = (DWORD) (InterlockedIncrement(&nextBand) - 1);
+		DWORD firstRow = band * rowsPerBand;
+		if (firstRow >= numRows)
+		{
+			return;
+		}
+		DWORD endRow = firstRow + rowsPerBand;
+		if (endRow > numRows)
+		{
+			endRow = numRows;
+		}
+		function(context, firstRow, endRow);
+	}
+}
+
+DWORD WINAPI WorkerPool::WorkerThread(LPVOID lpParam)
+{
+	WorkerArgs* args = (WorkerArgs*) lpParam;
+	WorkerPool* pool = args->pool;
+
+	for (;;)
+	{
+		WaitForSingleObject(args->startEvent, INFINITE);
+		if (pool->quitting)
+		{
+			return 0;
+		}
+
+		pool->doBands();
+
+		if (InterlockedDecrement(&pool->workersBusy) == 0)
+		{
+			SetEvent(pool->doneEvent);
+		}
+	}
+}
@@ -0,0 +1,63 @@
+/************************************************************************
+*                                                                       *
+*   WorkerPool.h -- Declaration of WorkerPool class                     *
+*                                                                       *
+*   A few threads that stay parked until there's a frame to split up.   *
+*   run() hands out the frame's rows in bands, does some of the bands   *
+*   itself, and only returns once every band is finished.               *
+*                                                                       *
+************************************************************************/
+
+#pragma once
+#include <windows.h>
+
+// Does rows [firstRow, endRow) of whatever context points at
+typedef void (*BandFunction)(void* context, DWORD firstRow, DWORD endRow);
+
+// Bands handed out per thread, so a thread that gets descheduled
+// doesn't hold everyone else up for a whole share of the frame
+const DWORD bandsPerThread = 4;
+
+class WorkerPool;
+
+// What each worker thread gets started with
+struct WorkerArgs
+{
+	WorkerPool* pool;
+	HANDLE startEvent;
+};
+
+class WorkerPool
+{
+public:
+	// numWorkers doesn't count the thread calling run()
+	WorkerPool(int numWorkers);
+	~WorkerPool(void);
+
+	void run(BandFunction function, void* context, DWORD numRows);
+	// Threads that take part in run(), including the caller
+	int numThreads();
+
+	// One fewer than the number of processors, since the caller helps
+	static int defaultWorkers();
+
+private:
+	static DWORD WINAPI WorkerThread(LPVOID lpParam);
+	void doBands();
+
+	int numWorkers;
+	HANDLE* threads;
+	// One per worker, so each gets woken exactly once per run()
+	HANDLE* startEvents;
+	WorkerArgs* workerArgs;
+	HANDLE doneEvent;
+	volatile BOOL quitting;
+
+	// The current job
+	BandFunction function;
+	void* context;
+	DWORD numRows;
+	DWORD rowsPerBand;
+	volatile LONG nextBand;
+	volatile LONG workersBusy;
+};